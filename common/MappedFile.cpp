@@ -0,0 +1,84 @@
+/*
+ * Read only files, mapped where possible
+ */
+#include "MappedFile.h"
+#include "msvc_fixes.h"
+
+#include <stdio.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPEDFILE_MMAP
+#endif
+
+bool MappedFile::open(const char *path, std::string &error)
+{
+    close();
+#ifdef MAPPEDFILE_MMAP
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        error = "cannot open";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        error = "cannot read";
+        return false;
+    }
+    if (st.st_size == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        error = "cannot map";
+        return false;
+    }
+    m_map = map;
+    m_data = (const uint8_t *)map;
+    m_size = st.st_size;
+    return true;
+#else
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr)
+    {
+        error = "cannot open";
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), f)) != 0)
+        m_owned.insert(m_owned.end(), buf, buf + got);
+    bool ok = not ferror(f);
+    fclose(f);
+    if (not ok)
+    {
+        error = "cannot read";
+        close();
+        return false;
+    }
+    m_data = m_owned.data();
+    m_size = m_owned.size();
+    return true;
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef MAPPEDFILE_MMAP
+    if (m_map)
+        munmap(m_map, m_size);
+#endif
+    m_map = nullptr;
+    std::vector<uint8_t>().swap(m_owned);
+    m_data = nullptr;
+    m_size = 0;
+}
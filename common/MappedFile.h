@@ -0,0 +1,27 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** A whole file, read only: mapped where the system can map files, read into memory elsewhere */
+class MappedFile
+{
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() { close(); }
+
+    /** On failure returns false and describes the problem in error.  An empty file has no data */
+    bool    open(const char *path, std::string &error);
+    void    close();
+
+    const uint8_t *data() const { return m_data; }
+    size_t  size() const { return m_size; }
+private:
+    const uint8_t *     m_data = nullptr;
+    size_t              m_size = 0;
+    std::vector<uint8_t> m_owned;          /* The contents, when not mapped */
+    void *              m_map = nullptr;
+};
@@ -1,8 +1,10 @@
 #ifndef PATTERNCOLLECTOR
 #define PATTERNCOLLECTOR
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 #include <vector>
 
 #define SYMLEN  16          /* Number of chars in the symbol name, incl null */
@@ -16,54 +18,7 @@ struct HASHENTRY
 };
 
 struct PatternCollector {
-    uint8_t buf[100], bufSave[7];   /* Temp buffer for reading the file */
-    uint16_t readShort(FILE *f)
-    {
-        uint8_t b1, b2;
-
-        if (fread(&b1, 1, 1, f) != 1)
-        {
-            printf("Could not read\n");
-            exit(11);
-        }
-        if (fread(&b2, 1, 1, f) != 1)
-        {
-            printf("Could not read\n");
-            exit(11);
-        }
-        return (b2 << 8) + b1;
-    }
-
-    void grab(FILE *f,int n)
-    {
-        if (fread(buf, 1, n, f) != (size_t)n)
-        {
-            printf("Could not read\n");
-            exit(11);
-        }
-    }
-
-    uint8_t readByte(FILE *f)
-    {
-        uint8_t b;
-
-        if (fread(&b, 1, 1, f) != 1)
-        {
-            printf("Could not read\n");
-            exit(11);
-        }
-        return b;
-    }
-
-    uint16_t readWord(FILE *fl)
-    {
-        uint8_t b1, b2;
-
-        b1 = readByte(fl);
-        b2 = readByte(fl);
-
-        return b1 + (b2 << 8);
-    }
+    virtual ~PatternCollector() {}
 
     /* Called by map(). Return the i+1th key in *pKeys */
     uint8_t *getKey(int i)
@@ -76,7 +31,22 @@ struct PatternCollector {
         printf("%s", keys[i].name);
     }
     std::vector<HASHENTRY> keys; /* array of keys */
-    virtual int readSyms(FILE *f)=0;
+    std::string log;        /* Messages about the library, printed once it is read */
+    std::string error;      /* Why readSyms() failed */
+
+    /* Read the library, size bytes at image, and put the keys into the array keys[]. Returns the
+        count, or -1 if the library is damaged or not of the right kind, see error */
+    virtual int readSyms(const uint8_t *image, size_t size)=0;
+protected:
+    void note(const char *fmt, ...)
+    {
+        char msg[256];
+        va_list ap;
+
+        va_start(ap, fmt);
+        vsnprintf(msg, sizeof(msg), fmt, ap);
+        va_end(ap);
+        log += msg;
+    }
 };
 #endif // PATTERNCOLLECTOR
-
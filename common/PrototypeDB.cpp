@@ -0,0 +1,364 @@
+/*
+ * Compiled library prototypes: building, mapping and looking up
+ */
+#include "PrototypeDB.h"
+#include "msvc_fixes.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(PrototypeDB::Header) == 56 and sizeof(PrototypeDB::Function) == 16 and
+              sizeof(PrototypeDB::Key) == 12, "the records are used as they lie in the file");
+
+namespace
+{
+const char MAGIC[4] = {'d','c','c','P'};
+const uint32_t ORDER_MARK = 0x01020304;
+
+uint64_t mix(uint64_t h)
+{
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+/* Hash, displace: a name goes to bucket(), and the displacement d of its bucket puts it in slot(d) */
+struct NameHash
+{
+    uint64_t h, h2;
+    NameHash(const char *name, size_t len, uint32_t seed)
+    {
+        h = 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull);
+        for (size_t i=0; i < len; i++)
+            h = (h ^ (uint8_t)name[i]) * 1099511628211ull;
+        h = mix(h);
+        h2 = mix(h ^ 0x6A09E667F3BCC909ull);
+    }
+    uint32_t bucket(uint32_t numBucket) const { return uint32_t(h >> 32) % numBucket; }
+    /* d is d0 * n + d1, the slot (f1 + d0 * f2 + d1) mod n */
+    uint32_t slot(uint32_t d, uint32_t n) const
+    {
+        uint64_t f1 = uint32_t(h2) % n, f2 = uint32_t(h2 >> 32) % n;
+        return uint32_t((f1 + (d / n) * f2 + d % n) % n);
+    }
+};
+
+size_t align4(size_t n)
+{
+    return (n + 3) & ~size_t(3);
+}
+}
+
+bool PrototypeDB::Builder::add(const std::string &name, uint16_t retType, const std::vector<uint16_t> &args,
+                               bool vararg, CallConv conv)
+{
+    if (not m_names.insert(name).second)
+        return false;
+    m_funcs.push_back({name, retType, args, vararg, conv});
+    return true;
+}
+
+std::vector<uint8_t> PrototypeDB::Builder::build(uint32_t seed) const
+{
+    std::vector<const Proto *> sorted;
+    for (const Proto &p : m_funcs)
+        sorted.push_back(&p);
+    std::sort(sorted.begin(), sorted.end(), [](const Proto *a, const Proto *b) { return a->name < b->name; });
+
+    /* The names, and the keys: every name, and the truncation of a long name unless it is taken */
+    std::string names;
+    std::vector<Function> funcs;
+    std::vector<Key> keys;
+    std::vector<uint16_t> argTypes;
+    std::vector<std::string> keyNames;
+    for (const Proto *p : sorted)
+    {
+        Function f;
+        f.name = names.size();
+        f.nameLen = p->name.size();
+        f.retType = p->retType;
+        f.numArg = p->args.size();
+        f.firstArg = argTypes.size();
+        f.flags = p->vararg ? FN_VARARG : 0;
+        f.callConv = p->conv;
+        names += p->name;
+        names += '\0';
+        argTypes.insert(argTypes.end(), p->args.begin(), p->args.end());
+        keys.push_back({f.name, f.nameLen, 0, uint32_t(funcs.size())});
+        keyNames.push_back(p->name);
+        funcs.push_back(f);
+    }
+    std::vector<std::string> all(keyNames);
+    std::sort(all.begin(), all.end());
+    for (size_t i=0; i < funcs.size(); i++)
+    {
+        if (funcs[i].nameLen < SYM_LEN)
+            continue;
+        std::string shortName = keyNames[i].substr(0, SYM_LEN-1);
+        if (std::binary_search(all.begin(), all.end(), shortName))
+            continue;
+        keys.push_back({funcs[i].name, uint16_t(SYM_LEN-1), 0, uint32_t(i)});
+        keyNames.push_back(shortName);
+        all.insert(std::lower_bound(all.begin(), all.end(), shortName), shortName);
+    }
+
+    /* Place the buckets, largest first, at the first displacement where all their keys land in free slots */
+    uint32_t n = keys.size();
+    uint32_t numBucket = std::max<uint32_t>(1, (n + 3) / 4);
+    std::vector<uint32_t> disp(numBucket, 0);
+    std::vector<Key> slots(n);
+    for (;; seed++)
+    {
+        std::vector<std::vector<uint32_t>> members(numBucket);
+        for (uint32_t k=0; k < n; k++)
+            members[NameHash(keyNames[k].data(), keyNames[k].size(), seed).bucket(numBucket)].push_back(k);
+        std::vector<uint32_t> order(numBucket);
+        for (uint32_t b=0; b < numBucket; b++)
+            order[b] = b;
+        std::stable_sort(order.begin(), order.end(), [&members](uint32_t a, uint32_t b) {
+            return members[a].size() > members[b].size();
+        });
+        std::vector<bool> taken(n, false);
+        bool placed = true;
+        for (uint32_t b : order)
+        {
+            if (members[b].empty())
+                break;
+            std::vector<NameHash> hashes;
+            for (uint32_t k : members[b])
+                hashes.emplace_back(keyNames[k].data(), keyNames[k].size(), seed);
+            std::vector<uint32_t> at(hashes.size());
+            uint64_t limit = std::min<uint64_t>(uint64_t(n) * n, UINT32_MAX);
+            uint64_t d;
+            for (d=0; d < limit; d++)
+            {
+                size_t i;
+                for (i=0; i < hashes.size(); i++)
+                {
+                    at[i] = hashes[i].slot(uint32_t(d), n);
+                    if (taken[at[i]] or std::find(at.begin(), at.begin() + i, at[i]) != at.begin() + i)
+                        break;
+                }
+                if (i == hashes.size())
+                    break;
+            }
+            if (d == limit)
+            {
+                placed = false;
+                break;
+            }
+            disp[b] = uint32_t(d);
+            for (size_t i=0; i < hashes.size(); i++)
+            {
+                taken[at[i]] = true;
+                slots[at[i]] = keys[members[b][i]];
+            }
+        }
+        if (placed)
+            break;
+    }
+
+    Header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MAGIC, 4);
+    hdr.byteOrder = ORDER_MARK;
+    hdr.version = VERSION;
+    hdr.memModel = m_model;
+    hdr.seed = seed;
+    hdr.numFunc = funcs.size();
+    hdr.numKey = n;
+    hdr.numBucket = numBucket;
+    hdr.numArg = argTypes.size();
+    hdr.offFunc = align4(sizeof(Header));
+    hdr.offKey = hdr.offFunc + funcs.size() * sizeof(Function);
+    hdr.offBucket = hdr.offKey + slots.size() * sizeof(Key);
+    hdr.offArg = hdr.offBucket + disp.size() * sizeof(uint32_t);
+    hdr.offName = align4(hdr.offArg + argTypes.size() * sizeof(uint16_t));
+    hdr.size = hdr.offName + names.size();
+    std::vector<uint8_t> blob(hdr.size, 0);
+    memcpy(&blob[0], &hdr, sizeof(hdr));
+    if (not funcs.empty())
+    {
+        memcpy(&blob[hdr.offFunc], funcs.data(), funcs.size() * sizeof(Function));
+        memcpy(&blob[hdr.offKey], slots.data(), slots.size() * sizeof(Key));
+        memcpy(&blob[hdr.offName], names.data(), names.size());
+    }
+    memcpy(&blob[hdr.offBucket], disp.data(), disp.size() * sizeof(uint32_t));
+    if (not argTypes.empty())
+        memcpy(&blob[hdr.offArg], argTypes.data(), argTypes.size() * sizeof(uint16_t));
+    return blob;
+}
+
+bool PrototypeDB::Builder::save(const char *path, std::string &error, uint32_t seed) const
+{
+    std::vector<uint8_t> blob = build(seed);
+    FILE *f = fopen(path, "wb");
+    if (f == nullptr)
+    {
+        error = "cannot create";
+        return false;
+    }
+    bool ok = fwrite(blob.data(), 1, blob.size(), f) == blob.size();
+    if (fclose(f) != 0)
+        ok = false;
+    if (not ok)
+        error = "cannot write";
+    return ok;
+}
+
+void PrototypeDB::close()
+{
+    m_file.close();
+    std::vector<uint8_t>().swap(m_owned);
+    m_data = nullptr;
+    m_size = 0;
+    m_hdr = nullptr;
+}
+
+bool PrototypeDB::open(const char *path, std::string &error)
+{
+    close();
+    if (not m_file.open(path, error))
+        return false;
+    m_data = m_file.data();
+    m_size = m_file.size();
+    return check(error);
+}
+
+bool PrototypeDB::adopt(std::vector<uint8_t> &&blob, std::string &error)
+{
+    close();
+    m_owned = std::move(blob);
+    m_data = m_owned.data();
+    m_size = m_owned.size();
+    return check(error);
+}
+
+bool PrototypeDB::openLegacy(const char *path, std::string &error)
+{
+    Builder builder;
+    if (not readLegacy(path, builder, error))
+        return false;
+    return adopt(builder.build(), error);
+}
+
+/* The sections must lie in the blob; the records are checked as find() meets them */
+bool PrototypeDB::check(std::string &error)
+{
+    const Header *hdr = (const Header *)m_data;
+    bool ok = m_size >= sizeof(Header) and memcmp(hdr->magic, MAGIC, 4) == 0;
+    if (not ok)
+        error = "not a dcc prototype database";
+    else if (hdr->byteOrder != ORDER_MARK or hdr->version != VERSION)
+    {
+        error = "written for another version or byte order";
+        ok = false;
+    }
+    else
+    {
+        uint64_t size = hdr->size;
+        ok = size <= m_size and
+             (hdr->offFunc | hdr->offKey | hdr->offBucket | hdr->offArg) % 4 == 0 and
+             hdr->offFunc + uint64_t(hdr->numFunc) * sizeof(Function) <= size and
+             hdr->offKey + uint64_t(hdr->numKey) * sizeof(Key) <= size and
+             hdr->offBucket + uint64_t(hdr->numBucket) * sizeof(uint32_t) <= size and
+             hdr->offArg + uint64_t(hdr->numArg) * sizeof(uint16_t) <= size and
+             hdr->offName <= size and (hdr->numKey == 0 or hdr->numBucket != 0);
+        if (not ok)
+            error = "truncated or damaged";
+    }
+    if (not ok)
+    {
+        close();
+        return false;
+    }
+    m_hdr = hdr;
+    return true;
+}
+
+const PrototypeDB::Function *PrototypeDB::find(const char *name) const
+{
+    if (m_hdr == nullptr or m_hdr->numKey == 0)
+        return nullptr;
+    size_t len = strlen(name);
+    NameHash h(name, len, m_hdr->seed);
+    const Key &k(keys()[h.slot(buckets()[h.bucket(m_hdr->numBucket)], m_hdr->numKey)]);
+    size_t names = m_hdr->size - m_hdr->offName;
+    if (k.len != len or k.func >= m_hdr->numFunc or uint64_t(k.name) + len > names or
+            memcmp(m_data + m_hdr->offName + k.name, name, len) != 0)
+        return nullptr;
+    const Function &f(funcs()[k.func]);
+    if (uint64_t(f.name) + f.nameLen >= names or m_data[m_hdr->offName + f.name + f.nameLen] != 0 or
+            uint64_t(f.firstArg) + f.numArg > m_hdr->numArg)
+        return nullptr;
+    return &f;
+}
+
+/* "dccp", then "FN", the number of functions and for each its SYM_LEN byte name, return type, number and
+    index of its arguments (2 bytes each) and a vararg byte, then "PM", the number of arguments and their
+    2 byte types */
+bool PrototypeDB::readLegacy(const char *path, Builder &builder, std::string &error)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr)
+    {
+        error = "cannot open";
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), f)) != 0)
+        data.insert(data.end(), buf, buf + got);
+    fclose(f);
+
+    const size_t REC = SYM_LEN + 7;
+    size_t pos = 0;
+    auto tag = [&](const char *t, size_t len) {
+        bool ok = pos + len <= data.size() and memcmp(&data[pos], t, len) == 0;
+        pos += len;
+        return ok;
+    };
+    auto shortAt = [&data](size_t at) { return uint16_t(data[at] | (data[at+1] << 8)); };
+    if (not tag("dccp", 4))
+    {
+        error = "not a dcc prototype file";
+        return false;
+    }
+    if (not tag("FN", 2) or pos + 2 > data.size())
+    {
+        error = "FN (Function Name) subsection expected";
+        return false;
+    }
+    int numFunc = shortAt(pos);
+    size_t funcs = pos + 2;
+    pos = funcs + numFunc * REC;
+    if (not tag("PM", 2) or pos + 2 > data.size())
+    {
+        error = "PM (Parameter) subsection expected";
+        return false;
+    }
+    int numArg = shortAt(pos);
+    size_t args = pos + 2;
+    if (args + 2 * numArg > data.size())
+    {
+        error = "truncated";
+        return false;
+    }
+    for (int i=0; i < numFunc; i++)
+    {
+        size_t rec = funcs + i * REC;
+        std::string name((const char *)&data[rec], strnlen((const char *)&data[rec], SYM_LEN-1));
+        int n = shortAt(rec + SYM_LEN + 2), first = shortAt(rec + SYM_LEN + 4);
+        if (first + n > numArg)
+        {
+            error = "arguments of " + name + " out of range";
+            return false;
+        }
+        std::vector<uint16_t> types;
+        for (int j=0; j < n; j++)
+            types.push_back(shortAt(args + 2 * (first + j)));
+        builder.add(name, shortAt(rec + SYM_LEN), types, data[rec + SYM_LEN + 6] != 0);
+    }
+    return true;
+}
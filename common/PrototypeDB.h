@@ -0,0 +1,110 @@
+#pragma once
+#include "MappedFile.h"
+
+#include <stdint.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/** Compiled library prototypes (dcclibs.pdb), as written by parsehdr: the functions, their argument types
+    and a minimal perfect hash of their names in one little endian blob, used where it lies once mapped.
+    Names can be of any length; a name longer than the SYMLEN-1 characters signatures keep can also be
+    found by its truncation */
+class PrototypeDB
+{
+public:
+    enum { VERSION=1, SYM_LEN=16 };
+    enum CallConv { CC_UNKNOWN=0, CC_CDECL, CC_PASCAL };
+    enum { FN_VARARG=1 };
+    struct Header
+    {
+        char        magic[4];       /* "dccP" */
+        uint32_t    byteOrder;      /* 0x01020304, as written */
+        uint16_t    version;
+        uint8_t     memModel;       /* 's', 'm', 'c', 'l', 'h', or 0 if not known */
+        uint8_t     reserved;
+        uint32_t    seed;           /* Of the name hash */
+        uint32_t    numFunc, numKey, numBucket, numArg;
+        uint32_t    offFunc, offKey, offBucket, offArg, offName, size;  /* Offsets from the header */
+    };
+    struct Function
+    {
+        uint32_t    name;           /* Offset in the names, nul terminated */
+        uint16_t    retType;        /* hlType */
+        uint16_t    numArg;         /* Fixed arguments */
+        uint32_t    firstArg;       /* Index of the first argument type */
+        uint8_t     flags;          /* FN_VARARG */
+        uint8_t     callConv;       /* CallConv */
+        uint16_t    nameLen;
+    };
+    struct Key
+    {
+        uint32_t    name;           /* Offset in the names */
+        uint16_t    len;            /* The key is the first len characters there */
+        uint16_t    reserved;
+        uint32_t    func;
+    };
+
+    /** Collects prototypes and lays them out */
+    class Builder
+    {
+    public:
+        void    setMemoryModel(char model) { m_model = model; }
+        /** Returns false, and keeps the first one, if a prototype of that name was added already */
+        bool    add(const std::string &name, uint16_t retType, const std::vector<uint16_t> &args, bool vararg,
+                    CallConv conv=CC_UNKNOWN);
+        int     count() const { return (int)m_funcs.size(); }
+        /** The blob; the hash is looked for from seed on, so the result depends on the prototypes and seed only */
+        std::vector<uint8_t> build(uint32_t seed=0) const;
+        bool    save(const char *path, std::string &error, uint32_t seed=0) const;
+    private:
+        struct Proto
+        {
+            std::string name;
+            uint16_t    retType;
+            std::vector<uint16_t> args;
+            bool        vararg;
+            CallConv    conv;
+        };
+        std::vector<Proto>  m_funcs;
+        std::unordered_set<std::string> m_names;
+        char                m_model = 0;
+    };
+
+    PrototypeDB() {}
+    PrototypeDB(const PrototypeDB &) = delete;
+    PrototypeDB &operator=(const PrototypeDB &) = delete;
+    ~PrototypeDB() { close(); }
+
+    /** Maps the file at path.  On failure returns false and describes the problem in error */
+    bool    open(const char *path, std::string &error);
+    /** Reads a dcclibs.dat file, the older sorted format, into a blob of this one */
+    bool    openLegacy(const char *path, std::string &error);
+    /** Uses blob, as made by Builder::build() */
+    bool    adopt(std::vector<uint8_t> &&blob, std::string &error);
+    void    close();
+
+    bool    empty() const { return count() == 0; }
+    int     count() const { return m_hdr ? (int)m_hdr->numFunc : 0; }
+    char    memoryModel() const { return m_hdr ? (char)m_hdr->memModel : 0; }
+    const Function &function(int i) const { return funcs()[i]; }
+    /** The prototype called name, or nullptr */
+    const Function *find(const char *name) const;
+    const char *name(const Function &f) const { return (const char *)m_data + m_hdr->offName + f.name; }
+    const uint16_t *args(const Function &f) const { return argTypes() + f.firstArg; }
+
+    /** Adds the prototypes of a dcclibs.dat file to builder */
+    static bool readLegacy(const char *path, Builder &builder, std::string &error);
+private:
+    bool    check(std::string &error);
+    const Function *funcs() const { return (const Function *)(m_data + m_hdr->offFunc); }
+    const Key *keys() const { return (const Key *)(m_data + m_hdr->offKey); }
+    const uint32_t *buckets() const { return (const uint32_t *)(m_data + m_hdr->offBucket); }
+    const uint16_t *argTypes() const { return (const uint16_t *)(m_data + m_hdr->offArg); }
+
+    const uint8_t *     m_data = nullptr;
+    size_t              m_size = 0;
+    const Header *      m_hdr = nullptr;
+    std::vector<uint8_t> m_owned;          /* The blob, when built here */
+    MappedFile          m_file;
+};
@@ -0,0 +1,184 @@
+/*
+ * Portable, SSE2 and AVX2 versions of the signature hashing and comparison loops
+ */
+#include "SigKernels.h"
+#include "msvc_fixes.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIG_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+void sumsPortable(const uint32_t *lanes, const uint8_t *pattern, uint16_t &u, uint16_t &v)
+{
+    uint32_t lo = 0, hi = 0;
+    for (int j=0; j < SigKernels::PAT_LEN; j++)
+    {
+        uint32_t x = lanes[j * SigKernels::SET_SIZE + pattern[j]];
+        lo += x & 0xFFFF;
+        hi += x >> 16;
+    }
+    u = (uint16_t)lo;
+    v = (uint16_t)hi;
+}
+bool equalPortable(const uint8_t *a, const uint8_t *b)
+{
+    return memcmp(a, b, SigKernels::PAT_LEN) == 0;
+}
+bool wildMatchPortable(const uint8_t *pattern, const uint8_t *bytes, int len, uint8_t wild)
+{
+    for (int j=0; j < len; j++)
+        if (bytes[j] != pattern[j] and pattern[j] != wild)
+            return false;
+    return true;
+}
+const SigKernels portable = {"portable", sumsPortable, equalPortable, wildMatchPortable};
+
+#ifdef SIG_KERNELS_X86
+/* The 16 bit halves are summed apart, the low ones would carry into the high ones */
+__attribute__((target("sse2")))
+uint32_t hsum(__m128i x)
+{
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1,0,3,2)));
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2,3,0,1)));
+    return (uint32_t)_mm_cvtsi128_si32(x);
+}
+__attribute__((target("sse2")))
+void sumsSse2(const uint32_t *lanes, const uint8_t *pattern, uint16_t &u, uint16_t &v)
+{
+    const __m128i low = _mm_set1_epi32(0xFFFF);
+    __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+    int j;
+    for (j=0; j+4 <= SigKernels::PAT_LEN; j += 4)
+    {
+        const uint32_t *l = lanes + j * SigKernels::SET_SIZE;
+        __m128i x = _mm_setr_epi32(l[pattern[j]], l[SigKernels::SET_SIZE + pattern[j+1]],
+                l[2*SigKernels::SET_SIZE + pattern[j+2]], l[3*SigKernels::SET_SIZE + pattern[j+3]]);
+        lo = _mm_add_epi32(lo, _mm_and_si128(x, low));
+        hi = _mm_add_epi32(hi, _mm_srli_epi32(x, 16));
+    }
+    uint32_t sumLo = hsum(lo), sumHi = hsum(hi);
+    for (; j < SigKernels::PAT_LEN; j++)
+    {
+        uint32_t x = lanes[j * SigKernels::SET_SIZE + pattern[j]];
+        sumLo += x & 0xFFFF;
+        sumHi += x >> 16;
+    }
+    u = (uint16_t)sumLo;
+    v = (uint16_t)sumHi;
+}
+/* Two overlapping loads cover the 23 bytes */
+__attribute__((target("sse2")))
+bool equalSse2(const uint8_t *a, const uint8_t *b)
+{
+    const int tail = SigKernels::PAT_LEN - 16;
+    __m128i eq = _mm_and_si128(
+                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a), _mm_loadu_si128((const __m128i *)b)),
+                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a+tail)), _mm_loadu_si128((const __m128i *)(b+tail))));
+    return _mm_movemask_epi8(eq) == 0xFFFF;
+}
+__attribute__((target("sse2")))
+bool wildMatchSse2(const uint8_t *pattern, const uint8_t *bytes, int len, uint8_t wild)
+{
+    if (len < 16)
+        return wildMatchPortable(pattern, bytes, len, wild);
+    const __m128i w = _mm_set1_epi8((char)wild);
+    for (int j=0; ; j += 16)
+    {
+        if (j + 16 > len)
+            j = len - 16;           /* the last block overlaps the one before */
+        __m128i p = _mm_loadu_si128((const __m128i *)(pattern+j));
+        __m128i b = _mm_loadu_si128((const __m128i *)(bytes+j));
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(p, b), _mm_cmpeq_epi8(p, w))) != 0xFFFF)
+            return false;
+        if (j + 16 == len)
+            return true;
+    }
+}
+const SigKernels sse2 = {"sse2", sumsSse2, equalSse2, wildMatchSse2};
+
+/* Three gathers of 8 lanes; the last one starts at byte 15 and leaves its first lane out */
+__attribute__((target("avx2")))
+void sumsAvx2(const uint32_t *lanes, const uint8_t *pattern, uint16_t &u, uint16_t &v)
+{
+    const int S = SigKernels::SET_SIZE;
+    const __m256i offs0 = _mm256_setr_epi32(0, S, 2*S, 3*S, 4*S, 5*S, 6*S, 7*S);
+    const __m256i offs1 = _mm256_add_epi32(offs0, _mm256_set1_epi32(8*S));
+    const __m256i offs2 = _mm256_add_epi32(offs0, _mm256_set1_epi32(15*S));
+    const __m256i notFirst = _mm256_setr_epi32(0, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i low = _mm256_set1_epi32(0xFFFF);
+    const int *base = (const int *)lanes;
+    __m256i i0 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)pattern)), offs0);
+    __m256i i1 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(pattern+8))), offs1);
+    __m256i i2 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(pattern+15))), offs2);
+    __m256i x0 = _mm256_i32gather_epi32(base, i0, 4);
+    __m256i x1 = _mm256_i32gather_epi32(base, i1, 4);
+    __m256i x2 = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), base, i2, notFirst, 4);
+    __m256i lo = _mm256_add_epi32(_mm256_add_epi32(_mm256_and_si256(x0, low), _mm256_and_si256(x1, low)),
+                                  _mm256_and_si256(x2, low));
+    __m256i hi = _mm256_add_epi32(_mm256_add_epi32(_mm256_srli_epi32(x0, 16), _mm256_srli_epi32(x1, 16)),
+                                  _mm256_srli_epi32(x2, 16));
+    u = (uint16_t)hsum(_mm_add_epi32(_mm256_castsi256_si128(lo), _mm256_extracti128_si256(lo, 1)));
+    v = (uint16_t)hsum(_mm_add_epi32(_mm256_castsi256_si128(hi), _mm256_extracti128_si256(hi, 1)));
+}
+__attribute__((target("avx2")))
+bool wildMatchAvx2(const uint8_t *pattern, const uint8_t *bytes, int len, uint8_t wild)
+{
+    if (len < 32)
+        return wildMatchSse2(pattern, bytes, len, wild);
+    const __m256i w = _mm256_set1_epi8((char)wild);
+    for (int j=0; ; j += 32)
+    {
+        if (j + 32 > len)
+            j = len - 32;
+        __m256i p = _mm256_loadu_si256((const __m256i *)(pattern+j));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(bytes+j));
+        if ((uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(p, b), _mm256_cmpeq_epi8(p, w))) != 0xFFFFFFFFu)
+            return false;
+        if (j + 32 == len)
+            return true;
+    }
+}
+/* The patterns are shorter than an AVX2 register, equality stays on SSE2 */
+const SigKernels avx2 = {"avx2", sumsAvx2, equalSse2, wildMatchAvx2};
+#endif
+}
+
+std::vector<const SigKernels *> SigKernels::available()
+{
+    std::vector<const SigKernels *> res {&portable};
+#ifdef SIG_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        res.push_back(&sse2);
+    if (__builtin_cpu_supports("avx2"))
+        res.push_back(&avx2);
+#endif
+    return res;
+}
+
+/* The last version available, unless DCC_SIG_KERNELS names another one */
+const SigKernels &SigKernels::best()
+{
+    static const SigKernels *chosen = []() {
+        std::vector<const SigKernels *> all = available();
+        const char *forced = getenv("DCC_SIG_KERNELS");
+        for (const SigKernels *k : all)
+            if (forced and strcmp(forced, k->name) == 0)
+                return k;
+        return all.back();
+    }();
+    return *chosen;
+}
+
+void SigKernels::packLanes(const uint16_t *t1, const uint16_t *t2, std::vector<uint32_t> &lanes)
+{
+    lanes.resize(PAT_LEN * SET_SIZE);
+    for (int i=0; i < PAT_LEN * SET_SIZE; i++)
+        lanes[i] = t1[i] | ((uint32_t)t2[i] << 16);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+/** Inner loops of signature matching: the two sums of the perfect hash, pattern equality and the
+    comparison of a pattern containing wild bytes.  Besides the portable versions there are SSE2 and
+    AVX2 ones on x86; best() picks, once, the fastest the processor supports */
+struct SigKernels
+{
+    enum { PAT_LEN=23, SET_SIZE=256 };
+    const char *name;
+    /** u and v of the perfect hash, before they are reduced modulo the number of vertices.  lanes holds
+        T1 in the low and T2 in the high 16 bits of each entry, as made by packLanes() */
+    void    (*sums)(const uint32_t *lanes, const uint8_t *pattern, uint16_t &u, uint16_t &v);
+    /** True if the PAT_LEN bytes at a and b are the same */
+    bool    (*equal)(const uint8_t *a, const uint8_t *b);
+    /** True if the len bytes at bytes match pattern, where the wild bytes match anything */
+    bool    (*wildMatch)(const uint8_t *pattern, const uint8_t *bytes, int len, uint8_t wild);
+
+    /** The version used; the environment variable DCC_SIG_KERNELS can name another available one */
+    static const SigKernels &best();
+    /** Every version the processor can run, the portable one first */
+    static std::vector<const SigKernels *> available();
+    static void packLanes(const uint16_t *t1, const uint16_t *t2, std::vector<uint32_t> &lanes);
+};
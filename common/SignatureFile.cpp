@@ -0,0 +1,164 @@
+/*
+ * Reader for the dcc signature files written by makedsig
+ */
+#include "SignatureFile.h"
+#include "SigKernels.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+struct SigReader
+{
+    FILE *      f;
+    std::string &error;
+    bool        ok=true;
+    SigReader(FILE *_f, std::string &_error) : f(_f), error(_error) {}
+    bool fail(const std::string &msg)
+    {
+        if(ok)
+            error = msg;
+        ok = false;
+        return false;
+    }
+    bool expect(const char *tag, size_t len)
+    {
+        char buf[4];
+        if(fread(buf, 1, len, f) != len)
+            return fail("unexpected end of file");
+        if(memcmp(buf, tag, len) != 0)
+            return fail(std::string("expected '") + tag + "'");
+        return true;
+    }
+    uint16_t readShort()
+    {
+        uint8_t b[2];
+        if(fread(b, 1, 2, f) != 2)
+        {
+            fail("unexpected end of file");
+            return 0;
+        }
+        return (uint16_t)(b[1] << 8) + b[0];
+    }
+    /* Reads a section made of a tag, its size in bytes and len/2 shorts */
+    bool readSection(const char *tag, std::vector<uint16_t> &to, size_t len)
+    {
+        if(not expect(tag, 2))
+            return false;
+        uint16_t w = readShort();
+        if(ok and w != (uint16_t)len)
+            return fail(std::string("size of ") + tag + " does not match the parameters");
+        to.resize(len/2);
+        for(uint16_t &v : to)
+            v = readShort();
+        return ok;
+    }
+};
+}
+
+bool SignatureFile::load(const char *path, std::string &error)
+{
+    FILE *f = fopen(path, "rb");
+    if(f == nullptr)
+    {
+        error = "cannot open";
+        return false;
+    }
+    SigReader rd(f, error);
+    if(rd.expect("dccs", 4))
+    {
+        numKeys = rd.readShort();
+        numVert = rd.readShort();
+        uint16_t patLen = rd.readShort();
+        uint16_t symLen = rd.readShort();
+        if(rd.ok and ((patLen != PAT_LEN) or (symLen != SYM_LEN)))
+            rd.fail("built for other symbol and pattern lengths");
+    }
+    size_t len = PAT_LEN * SET_SIZE * sizeof(uint16_t);
+    if(rd.ok)
+        rd.readSection("T1", T1, len) and rd.readSection("T2", T2, len) and
+                rd.readSection("gg", g, numVert * sizeof(uint16_t));
+    if(rd.ok)
+        SigKernels::packLanes(T1.data(), T2.data(), lanes);
+    if(rd.ok and rd.expect("ht", 2))
+    {
+        /* The size recorded counts a 2 byte offset per entry that is not written */
+        uint16_t w = rd.readShort();
+        if(rd.ok and w != (uint16_t)(numKeys * (SYM_LEN + PAT_LEN + sizeof(uint16_t))))
+            rd.fail("size of the hash table does not match the parameters");
+    }
+    if(rd.ok)
+    {
+        entries.resize(numKeys);
+        for(Entry &e : entries)
+        {
+            if(fread(&e, 1, SYM_LEN + PAT_LEN, f) != SYM_LEN + PAT_LEN)
+            {
+                rd.fail("could not read signature");
+                break;
+            }
+            e.name[SYM_LEN-1] = 0;
+        }
+    }
+    fclose(f);
+    return rd.ok;
+}
+
+int SignatureFile::hashIndex(const uint8_t *pattern) const
+{
+    uint16_t u, v;
+    SigKernels::best().sums(lanes.data(), pattern, u, v);
+    u %= numVert;
+    v %= numVert;
+    return (g[u] + g[v]) % numKeys;
+}
+
+int SignatureFile::find(const uint8_t *pattern) const
+{
+    if(numKeys == 0)
+        return -1;
+    int h = hashIndex(pattern);
+    return SigKernels::best().equal(entries[h].pattern, pattern) ? h : -1;
+}
+
+bool SignatureFile::verify(std::string &error) const
+{
+    char msg[160];
+    size_t tableLen = PAT_LEN * SET_SIZE;
+    if(T1.size() != tableLen or T2.size() != tableLen or g.size() != (size_t)numVert or
+            entries.size() != (size_t)numKeys or (numKeys and numVert == 0))
+    {
+        error = "the tables do not have the sizes of the parameters";
+        return false;
+    }
+    for(size_t v=0; v<g.size(); ++v)
+    {
+        if(g[v] >= numKeys and numKeys)
+        {
+            snprintf(msg, sizeof(msg), "g[%d] is %d, beyond the %d entries", (int)v, g[v], numKeys);
+            error = msg;
+            return false;
+        }
+    }
+    static const uint8_t zeroes[PAT_LEN] = {0};
+    int bad = 0;
+    for(int i=0; i<numKeys; ++i)
+    {
+        if(memcmp(entries[i].pattern, zeroes, PAT_LEN) == 0)
+            continue;
+        int h = hashIndex(entries[i].pattern);
+        if(h == i or memcmp(entries[h].pattern, entries[i].pattern, PAT_LEN) == 0)
+            continue;
+        if(bad++ == 0)
+            snprintf(msg, sizeof(msg), "entry %d (%s) hashes to %d (%s)", i, entries[i].name, h, entries[h].name);
+    }
+    if(bad)
+    {
+        error = msg;
+        if(bad > 1)
+            error += ", and " + std::to_string(bad-1) + " more entries hash elsewhere";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Contents of a dcc signature (.sig) file, as written by makedsig: the tables of the perfect hash
+    function and the hash table of (symbol, pattern) pairs it indexes */
+struct SignatureFile
+{
+    enum { SYM_LEN=16, PAT_LEN=23, SET_SIZE=256 };
+    struct Entry
+    {
+        char    name[SYM_LEN];      /* Symbol, nul terminated */
+        uint8_t pattern[PAT_LEN];   /* Its pattern, wildcards fixed */
+    };
+    int                     numKeys=0;  /* Number of entries in the hash table */
+    int                     numVert=0;  /* Number of vertices of the hash graph (size of g[]) */
+    std::vector<uint16_t>   T1, T2;     /* PAT_LEN * SET_SIZE hash tables */
+    std::vector<uint32_t>   lanes;      /* T1 and T2 side by side, see SigKernels */
+    std::vector<uint16_t>   g;          /* g[] */
+    std::vector<Entry>      entries;    /* The hash table, numKeys entries */
+
+    /** Reads the file at path.  On failure returns false and describes the problem in error */
+    bool    load(const char *path, std::string &error);
+    /** Index of the entry pattern hashes to; the pattern still has to be compared with the entry's */
+    int     hashIndex(const uint8_t *pattern) const;
+    /** Index of the entry whose pattern is pattern, or -1 */
+    int     find(const uint8_t *pattern) const;
+    /** Checks that the tables have the sizes the parameters give, and that every entry hashes to itself, or
+        to an entry with the same pattern: makedsig keeps only the first of identical patterns in the hash.
+        Entries whose pattern is all zeroes (duplicates older versions of makedsig dropped, and functions it
+        found no code for) are not in the hash.  On failure describes the problems in error */
+    bool    verify(std::string &error) const;
+};
@@ -0,0 +1,291 @@
+/*****************************************************************************
+ *          dcc project combined library signature lookup
+ ****************************************************************************/
+#include "SignatureIndex.h"
+
+#include "SignatureFile.h"
+#include "SigKernels.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <algorithm>
+#include <cstring>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+static_assert(SignatureFile::PAT_LEN == PATLEN and SignatureFile::SYM_LEN == SYMLEN,
+              "signature files and dcc use the same pattern and symbol lengths");
+
+SignatureIndex &SignatureIndex::get()
+{
+    static SignatureIndex index;
+    return index;
+}
+/* Three overlapping words cover the pattern, each multiplied by an odd constant and folded */
+uint32_t SignatureIndex::hash(const uint8_t *pattern)
+{
+    uint64_t w[3];
+    memcpy(&w[0],pattern,8);
+    memcpy(&w[1],pattern+8,8);
+    memcpy(&w[2],pattern+PATLEN-8,8);
+    uint64_t h = w[0]*0x9E3779B97F4A7C15ull ^ w[1]*0xC2B2AE3D27D4EB4Full ^ w[2]*0x165667B19E3779F9ull;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    return (uint32_t)(h ^ (h >> 32));
+}
+bool SignatureIndex::load(const QDir &dir, const QString &preferred)
+{
+    QStringList paths;
+    for(const QString &name : dir.entryList(QStringList() << "dcc*.sig", QDir::Files, QDir::Name))
+        paths << dir.absoluteFilePath(name);
+    return load(paths, preferred);
+}
+bool SignatureIndex::load(const QStringList &paths, const QString &preferred, std::vector<SignatureFile> *keep)
+{
+    auto start = steady_clock::now();
+    clear();
+    m_sets.clear();
+    m_preferred = -1;
+    struct Signature
+    {
+        const SignatureFile::Entry *entry;
+        uint16_t set;
+    };
+    std::vector<SignatureFile> files;
+    for(const QString &path : paths)
+    {
+        QString name = QFileInfo(path).fileName();
+        SignatureFile sig;
+        std::string error;
+        if(not sig.load(qPrintable(path), error))
+        {
+            printf("Warning: signature file %s: %s\n", qPrintable(name), error.c_str());
+            continue;
+        }
+        SignatureSet set;
+        set.file = name;
+        set.vendor = name.size() > 3 ? name.at(3).toLatin1() : 'x';
+        set.version = name.size() > 4 ? name.at(4).toLatin1() : 'x';
+        set.model = name.size() > 5 ? name.at(5).toLatin1() : 'x';
+        set.patterns = sig.entries.size();
+        if(name == preferred)
+            m_preferred = m_sets.size();
+        m_sets.push_back(set);
+        files.push_back(std::move(sig));
+    }
+    /* Group the signatures by pattern, in set order, then index the patterns */
+    std::vector<Signature> all;
+    for(size_t s=0; s<files.size(); ++s)
+        for(const SignatureFile::Entry &e : files[s].entries)
+            all.push_back({&e,uint16_t(s)});
+    std::stable_sort(all.begin(),all.end(),[](const Signature &a, const Signature &b) {
+        return memcmp(a.entry->pattern,b.entry->pattern,PATLEN) < 0;
+    });
+    for(const Signature &s : all)
+    {
+        if(m_patterns.empty() or memcmp(m_patterns.back().bytes,s.entry->pattern,PATLEN) != 0)
+        {
+            Pattern p;
+            memcpy(p.bytes,s.entry->pattern,PATLEN);
+            p.first_tag = m_tags.size();
+            p.tag_count = 0;
+            m_patterns.push_back(p);
+        }
+        Tag t;
+        t.set = s.set;
+        memcpy(t.name,s.entry->name,SYMLEN);
+        m_tags.push_back(t);
+        m_patterns.back().tag_count++;
+    }
+    uint32_t size = 16;
+    while(size < 2*m_patterns.size())
+        size *= 2;
+    m_mask = size-1;
+    m_slots.assign(size,-1);
+    for(size_t i=0; i<m_patterns.size(); ++i)
+    {
+        uint32_t slot = hash(m_patterns[i].bytes) & m_mask;
+        while(m_slots[slot] != -1)
+            slot = (slot+1) & m_mask;
+        m_slots[slot] = i;
+    }
+    if(keep)
+        *keep = std::move(files);
+    m_stats.load_time += duration_cast<nanoseconds>(steady_clock::now()-start);
+    return not m_patterns.empty();
+}
+/* Releases the table; the sets, their votes and the statistics are kept */
+void SignatureIndex::clear()
+{
+    std::vector<Pattern>().swap(m_patterns);
+    std::vector<Tag>().swap(m_tags);
+    std::vector<int32_t>().swap(m_slots);
+    m_mask = 0;
+}
+int SignatureIndex::elected() const
+{
+    int best = m_preferred;
+    for(size_t i=0; i<m_sets.size(); ++i)
+        if(best < 0 or m_sets[i].votes > m_sets[best].votes)
+            best = i;
+    return best;
+}
+int SignatureIndex::indexOf(const uint8_t *pattern, uint64_t &probes) const
+{
+    if(m_slots.empty())
+        return -1;
+    auto equal = SigKernels::best().equal;
+    for(uint32_t slot = hash(pattern) & m_mask; m_slots[slot] != -1; slot = (slot+1) & m_mask)
+    {
+        probes++;
+        if(equal(m_patterns[m_slots[slot]].bytes,pattern))
+            return m_slots[slot];
+    }
+    return -1;
+}
+const SignatureIndex::Tag *SignatureIndex::find(const uint8_t pattern[PATLEN], int &count) const
+{
+    uint64_t probes = 0;
+    int i = indexOf(pattern,probes);
+    if(i < 0)
+    {
+        count = 0;
+        return nullptr;
+    }
+    return tags(i,count);
+}
+const char *SignatureIndex::peek(const uint8_t pattern[PATLEN]) const
+{
+    int count;
+    const Tag *tags = find(pattern,count);
+    int set = elected();
+    for(int i=0; i<count; ++i)
+        if(tags[i].set == set)
+            return tags[i].name;
+    return nullptr;
+}
+const char *SignatureIndex::lookup(const uint8_t pattern[PATLEN])
+{
+    if(m_slots.empty())
+        return nullptr;
+    auto start = steady_clock::now();
+    m_stats.checked++;
+    int i = indexOf(pattern,m_stats.probes);
+    const Pattern *found = i < 0 ? nullptr : &m_patterns[i];
+    const char *name = nullptr;
+    if(found)
+    {
+        const Tag *tags = &m_tags[found->first_tag];
+        for(int i=0; i<found->tag_count; ++i)
+            m_sets[tags[i].set].votes++;
+        int set = elected();
+        for(int i=0; i<found->tag_count and name == nullptr; ++i)
+            if(tags[i].set == set)
+                name = tags[i].name;
+        if(name)
+            m_stats.recognised++;
+        else
+            m_stats.elsewhere++;
+    }
+    m_stats.lookup_time += duration_cast<nanoseconds>(steady_clock::now()-start);
+    return name;
+}
+SignatureIndex::TableStats SignatureIndex::tableStats() const
+{
+    TableStats ts;
+    ts.patterns = m_patterns.size();
+    ts.names = m_tags.size();
+    ts.table_size = m_slots.size();
+    for(uint32_t slot=0; slot<m_slots.size(); ++slot)
+    {
+        if(m_slots[slot] == -1)
+            continue;
+        const Pattern &p(m_patterns[m_slots[slot]]);
+        int probes = ((slot - hash(p.bytes)) & m_mask) + 1;
+        ts.probes += probes;
+        ts.max_probes = std::max(ts.max_probes,probes);
+        if(probes > 1)
+            ts.displaced++;
+        if(p.tag_count > 1 and std::any_of(&m_tags[p.first_tag+1],&m_tags[p.first_tag+p.tag_count],
+                                           [&](const Tag &t) { return t.set != m_tags[p.first_tag].set; }))
+            ts.shared++;
+        ts.wild_bytes += std::count(p.bytes,p.bytes+PATLEN,WILD);
+    }
+    return ts;
+}
+bool SignatureIndex::verify(std::string &error) const
+{
+    char msg[120];
+    std::vector<int> seen(m_patterns.size(),0);
+    for(int32_t i : m_slots)
+    {
+        if(i == -1)
+            continue;
+        if(i < 0 or (size_t)i >= m_patterns.size() or seen[i]++)
+        {
+            snprintf(msg,sizeof(msg),"a slot holds pattern %d, which is not loaded or has another slot",i);
+            error = msg;
+            return false;
+        }
+    }
+    for(size_t i=0; i<m_patterns.size(); ++i)
+    {
+        const Pattern &p(m_patterns[i]);
+        uint64_t probes = 0;
+        if(indexOf(p.bytes,probes) != (int)i)
+        {
+            snprintf(msg,sizeof(msg),"pattern %d is not found from the slot it hashes to",(int)i);
+            error = msg;
+            return false;
+        }
+        if(p.tag_count == 0 or p.first_tag + p.tag_count > m_tags.size())
+        {
+            snprintf(msg,sizeof(msg),"the names of pattern %d are not loaded",(int)i);
+            error = msg;
+            return false;
+        }
+        for(int t=0; t<p.tag_count; ++t)
+        {
+            if(m_tags[p.first_tag+t].set >= m_sets.size())
+            {
+                snprintf(msg,sizeof(msg),"pattern %d is named by set %d, which is not loaded",(int)i,
+                         m_tags[p.first_tag+t].set);
+                error = msg;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+void SignatureIndex::writeStats(QTextStream &ostr) const
+{
+    ostr << QString("\nLibrary signatures: %1 sets loaded in %2 ms, %3 procedures checked, %4 recognised (%5%), "
+                    "%6 only in other sets, %7 probes, %8 ns per lookup\n")
+            .arg(m_sets.size())
+            .arg(duration_cast<microseconds>(m_stats.load_time).count()/1000.0,0,'f',3)
+            .arg(m_stats.checked)
+            .arg(m_stats.recognised)
+            .arg(m_stats.checked ? m_stats.recognised*100.0/m_stats.checked : 0.0,0,'f',1)
+            .arg(m_stats.elsewhere)
+            .arg(m_stats.probes)
+            .arg(m_stats.checked ? m_stats.lookup_time.count()/m_stats.checked : 0);
+    if(m_stats.swept)
+        ostr << QString("Library sweep: %1 entries checked, %2 library functions found, %3 of them called\n")
+                .arg(m_stats.swept)
+                .arg(m_stats.preloaded)
+                .arg(m_stats.called);
+    int set = elected();
+    for(size_t i=0; i<m_sets.size(); ++i)
+    {
+        if(m_sets[i].votes == 0 and int(i) != m_preferred)
+            continue;
+        ostr << QString("  %1 %2 votes%3%4\n")
+                .arg(m_sets[i].file+":",-14)
+                .arg(m_sets[i].votes,5)
+                .arg(int(i) == m_preferred ? ", startup code" : "")
+                .arg(int(i) == set ? ", elected" : "");
+    }
+}
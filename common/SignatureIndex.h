@@ -0,0 +1,109 @@
+#pragma once
+#include "types.h"
+
+#include <QtCore/QString>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class QDir;
+class QStringList;
+class QTextStream;
+struct SignatureFile;
+
+/**
+ * All the library signature sets of sigs/ in one table, looked up with a single hash probe per procedure.
+ * Each signature is tagged with the set, and so the compiler, vendor and memory model, it comes from.
+ * Every lookup votes for the sets that have the pattern.  Names are taken from the elected set: the one
+ * checkStartup() chose, as long as no other set has more votes, otherwise the set with most votes.
+ */
+class SignatureIndex
+{
+public:
+    struct SignatureSet
+    {
+        QString     file;           /* e.g. dccb2s.sig                  */
+        char        vendor;         /* m(icrosoft), b(orland), t(urbo)  */
+        char        version;
+        char        model;          /* s, m, c, l or p(ascal)           */
+        size_t      patterns=0;     /* signatures in the set            */
+        uint64_t    votes=0;        /* procedures found in the set      */
+    };
+    struct Stats
+    {
+        uint64_t    checked=0;      /* procedures looked up                         */
+        uint64_t    recognised=0;   /* named from the elected set                   */
+        uint64_t    elsewhere=0;    /* found only in sets that were not elected     */
+        uint64_t    probes=0;       /* slots of the table visited                   */
+        uint64_t    swept=0;        /* entries checked by the whole image sweep     */
+        uint64_t    preloaded=0;    /* library functions the sweep found            */
+        uint64_t    called=0;       /* of which the parse reached                   */
+        std::chrono::nanoseconds lookup_time {0};
+        std::chrono::nanoseconds load_time {0};
+    };
+    /** The shape of the table, as the signature tools report it */
+    struct TableStats
+    {
+        size_t      patterns=0;
+        size_t      names=0;        /* (set, name) pairs                            */
+        size_t      table_size=0;   /* slots of the table                            */
+        size_t      shared=0;       /* patterns that more than one set has          */
+        size_t      displaced=0;    /* patterns not in the slot they hash to        */
+        uint64_t    probes=0;       /* slots visited finding every pattern once     */
+        int         max_probes=0;
+        uint64_t    wild_bytes=0;   /* WILD bytes in all the patterns               */
+    };
+    /** A name a set gives a pattern */
+    struct Tag
+    {
+        uint16_t    set;
+        char        name[SYMLEN];
+    };
+    static SignatureIndex &get();
+
+    /** Loads every dcc*.sig of dir; preferred is the set found by checkStartup().  Returns false if none loads */
+    bool        load(const QDir &dir, const QString &preferred);
+    /** Loads the signature files at paths, each one a set.  The files themselves are moved to *files if given,
+        in the order of the sets */
+    bool        load(const QStringList &paths, const QString &preferred, std::vector<SignatureFile> *files=nullptr);
+    void        clear();
+    bool        empty() const { return m_patterns.empty(); }
+    /** The name given to pattern by the elected set, nullptr if it has none */
+    const char *lookup(const uint8_t pattern[PATLEN]);
+    /** The name the elected set gives pattern, as lookup() would, but without voting or counting the lookup */
+    const char *peek(const uint8_t pattern[PATLEN]) const;
+    /** The names all the sets give pattern, in set order; count is 0 if it has none.  Does not vote */
+    const Tag * find(const uint8_t pattern[PATLEN], int &count) const;
+    int         elected() const;
+    const std::vector<SignatureSet> &sets() const { return m_sets; }
+    /** The distinct patterns, in byte order, and their names */
+    size_t      patternCount() const { return m_patterns.size(); }
+    const uint8_t *pattern(size_t i) const { return m_patterns[i].bytes; }
+    const Tag * tags(size_t i, int &count) const { count = m_patterns[i].tag_count; return &m_tags[m_patterns[i].first_tag]; }
+    const Stats &stats() const { return m_stats; }
+    Stats &     stats() { return m_stats; }
+    TableStats  tableStats() const;
+    /** Checks that every pattern is found from the slot it hashes to and every slot and tag refers to something
+        loaded; on failure describes the first problem in error */
+    bool        verify(std::string &error) const;
+    void        writeStats(QTextStream &ostr) const;
+private:
+    struct Pattern
+    {
+        uint8_t     bytes[PATLEN];
+        uint32_t    first_tag;      /* tags of the pattern are m_tags[first_tag, first_tag+tag_count) */
+        uint16_t    tag_count;
+    };
+    static uint32_t hash(const uint8_t *pattern);
+    /* Index of pattern in m_patterns or -1; probes counts the slots visited */
+    int         indexOf(const uint8_t *pattern, uint64_t &probes) const;
+
+    std::vector<SignatureSet>   m_sets;
+    std::vector<Pattern>        m_patterns;
+    std::vector<Tag>            m_tags;
+    std::vector<int32_t>        m_slots;        /* open addressing, index into m_patterns or -1 */
+    uint32_t                    m_mask=0;
+    int                         m_preferred=-1;
+    Stats                       m_stats;
+};
@@ -0,0 +1,164 @@
+/*
+ * Fix Wildcards
+ * (C) Mike van Emmerik
+ */
+
+/*  *   *   *   *   *   *   *   *   *   *   *  *\
+*                                               *
+*           Fix Wild Cards Code                 *
+*                                               *
+\*  *   *   *   *   *   *   *   *   *   *   *  */
+
+#include "fixwild.h"
+#include "msvc_fixes.h"
+
+#include <memory.h>
+
+#ifndef PATLEN
+#define PATLEN          23
+#define WILD            0xF4
+#endif
+
+namespace
+{
+/* What follows an opcode, or a mod/rm byte: the low three bits count the operand bytes */
+enum
+{
+    W = 0x08,   /* The operand bytes are made wild, else skipped */
+    M = 0x10,   /* A mod/rm byte, with its displacement, comes before the operands */
+    C = 0x20,   /* Return or unconditional jump: nothing after the operands can be relied on */
+    X = 0x40,   /* 0F: the opcode is in the second byte, see twoByteOps */
+    F = 0x80    /* int nn: one byte operand, followed by a mod/rm byte for the Borland/Microsoft FP
+                   emulation interrupts 34-3B */
+};
+const uint8_t COUNT = 0x07;
+
+/* Processor in 16 bit address mode (real mode).  Some entries keep the choices the switch they were
+    made from had: 69 and 6B have no operands, A4-A7 one byte and AA-AF two wild ones, 82 no
+    immediate, 0F A2 (cpuid) a mod/rm byte */
+const uint8_t oneByteOps[256] =
+{
+    M,      M,      M,      M,      1,      2,      0,      0,      M,      M,      M,      M,      1,      2,      0,      X,     /* 00 */
+    M,      M,      M,      M,      1,      2,      0,      0,      M,      M,      M,      M,      1,      2,      0,      0,     /* 10 */
+    M,      M,      M,      M,      1,      2,      0,      0,      M,      M,      M,      M,      1,      2,      0,      0,     /* 20 */
+    M,      M,      M,      M,      1,      2,      0,      0,      M,      M,      M,      M,      1,      2,      0,      0,     /* 30 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* 40 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* 50 */
+    0,      0,      4,      W|2,    0,      0,      0,      0,      1,      0,      1,      0,      0,      1,      0,      1,     /* 60 */
+    1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,     /* 70 */
+    M|1,    M|W|2,  M,      M|1,    M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,     /* 80 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      W|4,    0,      0,      0,      0,      0,     /* 90 */
+    W|2,    W|2,    W|2,    W|2,    1,      1,      1,      1,      1,      2,      W|2,    W|2,    W|2,    W|2,    W|2,    W|2,   /* A0 */
+    1,      1,      1,      1,      1,      1,      1,      1,      W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,   /* B0 */
+    M|1,    M|1,    C|2,    C,      M,      M,      M|1,    M|W|2,  3,      0,      C|2,    C,      0,      F,      0,      0,     /* C0 */
+    M,      M,      M,      M,      0,      0,      0,      0,      M,      M,      M,      M,      M,      M,      M,      M,     /* D0 */
+    1,      1,      1,      1,      1,      2,      1,      2,      W|2,    C|W|2,  C|W|4,  C|1,    0,      0,      0,      0,     /* E0 */
+    0,      0,      0,      0,      0,      0,      M,      M,      0,      0,      0,      0,      0,      0,      M,      M      /* F0 */
+};
+
+/* 386 opcodes 0F xx */
+const uint8_t twoByteOps[256] =
+{
+    M,      M,      M,      M,      M,      M,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* 00 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* 10 */
+    M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,     /* 20 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* 30 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* 40 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* 50 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* 60 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* 70 */
+    2,      2,      2,      2,      2,      2,      2,      2,      2,      2,      2,      2,      2,      2,      2,      2,     /* 80 */
+    M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M,     /* 90 */
+    0,      0,      M,      M,      M|1,    M,      M,      M,      0,      0,      M,      M,      M|1,    M,      M,      M,     /* A0 */
+    M,      M,      M,      M,      M,      M,      M,      M,      M,      M,      M|1,    M,      M,      M,      M,      M,     /* B0 */
+    M,      M,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* C0 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* D0 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* E0 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0      /* F0 */
+};
+
+/* [nnnn] and [reg + nnnn] displacements are made wild, [reg + nn] ones skipped */
+const uint8_t modRMBytes[256] =
+{
+    0,      0,      0,      0,      0,      0,      W|2,    0,      0,      0,      0,      0,      0,      0,      W|2,    0,     /* 00 */
+    0,      0,      0,      0,      0,      0,      W|2,    0,      0,      0,      0,      0,      0,      0,      W|2,    0,     /* 10 */
+    0,      0,      0,      0,      0,      0,      W|2,    0,      0,      0,      0,      0,      0,      0,      W|2,    0,     /* 20 */
+    0,      0,      0,      0,      0,      0,      W|2,    0,      0,      0,      0,      0,      0,      0,      W|2,    0,     /* 30 */
+    1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,     /* 40 */
+    1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,     /* 50 */
+    1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,     /* 60 */
+    1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,      1,     /* 70 */
+    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,   /* 80 */
+    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,   /* 90 */
+    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,   /* A0 */
+    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,    W|2,   /* B0 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* C0 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* D0 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,     /* E0 */
+    0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0      /* F0 */
+};
+
+/* Makes wild or skips the operands of desc.  Returns true if the pattern is exhausted */
+bool operands(uint8_t pat[], int &pc, uint8_t desc)
+{
+    int n = desc & COUNT;
+    if (not (desc & W))
+    {
+        pc += n;
+        return pc >= PATLEN;
+    }
+    while (n--)
+    {
+        pat[pc++] = WILD;
+        if (pc >= PATLEN) return true;
+    }
+    return false;
+}
+
+/* Handle the mod/rm case. Returns true if pattern exhausted */
+bool ModRM(uint8_t pat[], int &pc)
+{
+    uint8_t op = pat[pc++];                 /* The mod/rm byte */
+    if (pc >= PATLEN) return true;
+    return operands(pat, pc, modRMBytes[op]);
+}
+}
+
+/* Scan through the instructions in pat[], looking for opcodes that may
+    have operands that vary with different instances. For example, load and
+    store from statics, calls to other procs (even relative calls; they may
+    call procs loaded in a different order, etc).
+    Each opcode is looked up in the tables above, which describe its length
+    and the operands to make wild.
+    PATLEN bytes are scanned.
+*/
+void fixWildCards(uint8_t pat[])
+{
+    int pc = 0;                             /* Indexes into pat[] */
+    while (pc < PATLEN)
+    {
+        uint8_t desc = oneByteOps[pat[pc++]];
+        if (pc >= PATLEN) return;
+        if (desc & X)
+        {
+            desc = twoByteOps[pat[pc++]];
+            if (pc >= PATLEN) return;
+        }
+        if (desc & F)
+        {
+            uint8_t intArg = pat[pc++];
+            if (pc >= PATLEN) return;
+            if ((intArg >= 0x34) and (intArg <= 0x3B) and ModRM(pat, pc)) return;
+            continue;
+        }
+        if ((desc & M) and ModRM(pat, pc)) return;
+        if (operands(pat, pc, desc)) return;
+        if (desc & C)
+        {
+            /* Chop from the current point by wiping with zeroes. Can't rely on
+                anything after this point */
+            memset(&pat[pc], 0, PATLEN - pc);
+            return;
+        }
+    }
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+
+/** Makes wild the bytes of the PATLEN byte pattern pat[] that can vary between instances of the same
+    library function (addresses, relocatable immediates, call targets), and zeroes what follows a
+    return or unconditional jump.  Reentrant */
+void fixWildCards(uint8_t pat[]);
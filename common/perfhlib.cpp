@@ -18,28 +18,29 @@
 #include <cassert>
 #include <stdlib.h>
 #include <string.h>
-/* Private data structures */
-
-//static  int     NumEntry;   /* Number of entries in the hash table (# keys) */
-//static  int     EntryLen;   /* Size (bytes) of each entry (size of keys) */
-//static  int     SetSize;    /* Size of the char set */
-//static  char    SetMin;     /* First char in the set */
-//static  int     NumVert;    /* c times NumEntry */
-
-//static  uint16_t    *T1base, *T2base;   /* Pointers to start of T1, T2 */
-static  uint16_t    *T1, *T2;   /* Pointers to T1[i], T2[i] */
-
-static  int     *graphNode; /* The array of edges */
-static  int     *graphNext; /* Linked list of edges */
-static  int     *graphFirst;/* First edge at a vertex */
-
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
-static  int     numEdges;   /* An edge counter */
-static  bool    *visited;   /* Array of bools: whether visited */
-static  bool    *deleted;   /* Array of bools: whether deleted */
+/* Private data structures */
 
-/* Private prototypes */
-static void duplicateKeys(int v1, int v2);
+namespace
+{
+/* splitmix64; the tables of an attempt are drawn from the seed and the attempt number only */
+struct AttemptRandom
+{
+    uint64_t state;
+    AttemptRandom(uint32_t seed, int attempt) : state(((uint64_t)seed << 32) ^ (uint32_t)attempt) {}
+    uint32_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return (uint32_t)((z ^ (z >> 31)) >> 32);
+    }
+};
+}
 
 void PerfectHash::setHashParams(int _NumEntry, int _EntryLen, int _SetSize, char _SetMin,
                                 int _NumVert)
@@ -55,46 +56,15 @@ void PerfectHash::setHashParams(int _NumEntry, int _EntryLen, int _SetSize, char
     NumVert  = _NumVert;
 
     /* Allocate the variable sized tables etc */
-    if ((T1base = (uint16_t *)malloc(EntryLen * SetSize * sizeof(uint16_t))) == 0)
-    {
-        goto BadAlloc;
-    }
-    if ((T2base = (uint16_t *)malloc(EntryLen * SetSize * sizeof(uint16_t))) == 0)
+    T1base = (uint16_t *)malloc(EntryLen * SetSize * sizeof(uint16_t));
+    T2base = (uint16_t *)malloc(EntryLen * SetSize * sizeof(uint16_t));
+    g = (short *)malloc((NumVert+1) * sizeof(short));
+    if (T1base == 0 or T2base == 0 or g == 0)
     {
-        goto BadAlloc;
+        printf("Could not allocate memory\n");
+        hashCleanup();
+        exit(1);
     }
-
-    if ((graphNode = (int *)malloc((NumEntry*2 + 1) * sizeof(int))) == 0)
-    {
-        goto BadAlloc;
-    }
-    if ((graphNext = (int *)malloc((NumEntry*2 + 1) * sizeof(int))) == 0)
-    {
-        goto BadAlloc;
-    }
-    if ((graphFirst = (int *)malloc((NumVert + 1) * sizeof(int))) == 0)
-    {
-        goto BadAlloc;
-    }
-
-    if ((g = (short *)malloc((NumVert+1) * sizeof(short))) == 0)
-    {
-        goto BadAlloc;
-    }
-    if ((visited = (bool *)malloc((NumVert+1) * sizeof(bool))) == 0)
-    {
-        goto BadAlloc;
-    }
-    if ((deleted = (bool *)malloc((NumEntry+1) * sizeof(bool))) == 0)
-    {
-        goto BadAlloc;
-    }
-    return;
-
-BadAlloc:
-    printf("Could not allocate memory\n");
-    hashCleanup();
-    exit(1);
 }
 
 void PerfectHash::hashCleanup(void)
@@ -102,270 +72,145 @@ void PerfectHash::hashCleanup(void)
     /* Free the storage for variable sized tables etc */
     if (T1base) free(T1base);
     if (T2base) free(T2base);
-    if (graphNode) free(graphNode);
-    if (graphNext) free(graphNext);
-    if (graphFirst) free(graphFirst);
     if (g) free(g);
-    if (visited) free(visited);
-    if (deleted) free(deleted);
-}
-
-void PerfectHash::map(PatternCollector *collector)
-{
-    m_collector = collector;
-    assert(nullptr!=collector);
-    int i, j, c;
-    uint16_t f1, f2;
-    bool cycle;
-    uint8_t *keys;
-
-    c = 0;
-
-    do
-    {
-        initGraph();
-        cycle = false;
-
-        /* Randomly generate T1 and T2 */
-        for (i=0; i < SetSize*EntryLen; i++)
-        {
-            T1base[i] = rand() % NumVert;
-            T2base[i] = rand() % NumVert;
-        }
-
-        for (i=0; i < NumEntry; i++)
-        {
-            f1 = 0; f2 = 0;
-            keys = m_collector->getKey(i);
-            for (j=0; j < EntryLen; j++)
-            {
-                T1 = T1base + j * SetSize;
-                T2 = T2base + j * SetSize;
-                f1 += T1[keys[j] - SetMin];
-                f2 += T2[keys[j] - SetMin];
-            }
-            f1 %= (uint16_t)NumVert;
-            f2 %= (uint16_t)NumVert;
-            if (f1 == f2)
-            {
-                /* A self loop. Reject! */
-                printf("Self loop on vertex %d!\n", f1);
-                cycle = true;
-                break;
-            }
-            addToGraph(numEdges++, f1, f2);
-        }
-        if (cycle or (cycle = isCycle()))   /* OK - is there a cycle? */
-        {
-            printf("Iteration %d\n", ++c);
-        }
-        else
-        {
-            break;
-        }
-    }
-    while (/* there is a cycle */ 1);
-
+    T1base = T2base = nullptr;
+    g = nullptr;
 }
 
-/* Initialise the graph */
-void PerfectHash::initGraph()
+/* One attempt: random T1 and T2 put each key on an edge between the vertices u and v it hashes to.
+    The graph is peeled, removing over and over an edge at a vertex of degree one; if every edge goes
+    the graph is acyclic, and g is assigned in the reverse order of the removals, each edge fixing g[]
+    of the vertex it was removed at, so that (g[u] + g[v]) % NumEntry is the key's index */
+bool PerfectHash::tryAttempt(uint32_t seed, int attempt, const std::vector<int> &keys, uint16_t *t1,
+                             uint16_t *t2, short *gg) const
 {
-    int i;
-
-    for (i=1; i <= NumVert; i++)
+    AttemptRandom rnd(seed, attempt);
+    for (int i=0; i < SetSize*EntryLen; i++)
     {
-        graphFirst[i] = 0;
+        t1[i] = rnd.next() % NumVert;
+        t2[i] = rnd.next() % NumVert;
     }
-
-    for (i= -NumEntry; i <= NumEntry; i++)
+    int numEdges = keys.size();
+    std::vector<int> edgeU(numEdges), edgeV(numEdges);
+    std::vector<int> degree(NumVert, 0), incident(NumVert, 0);    /* incident: xor of the edges at v */
+    for (int e=0; e < numEdges; e++)
     {
-        /* No need to init graphNode[] as they will all be filled by successive
-            calls to addToGraph() */
-        graphNext[NumEntry+i] = 0;
-    }
-
-    numEdges = 0;
-}
-
-/* Add an edge e between vertices v1 and v2 */
-/* e, v1, v2 are 0 based */
-void PerfectHash::addToGraph(int e, int v1, int v2)
-{
-    e++; v1++; v2++;                        /* So much more convenient */
-
-    graphNode[NumEntry+e] = v2;             /* Insert the edge information */
-    graphNode[NumEntry-e] = v1;
-
-    graphNext[NumEntry+e] = graphFirst[v1]; /* Insert v1 to list of alphas */
-    graphFirst[v1]= e;
-    graphNext[NumEntry-e] = graphFirst[v2]; /* Insert v2 to list of omegas */
-    graphFirst[v2]= -e;
-
+        const uint8_t *key = m_collector->getKey(keys[e]);
+        uint16_t f1 = 0, f2 = 0;
+        for (int j=0; j < EntryLen; j++)
+        {
+            f1 += t1[j * SetSize + key[j] - SetMin];
+            f2 += t2[j * SetSize + key[j] - SetMin];
+        }
+        f1 %= (uint16_t)NumVert;
+        f2 %= (uint16_t)NumVert;
+        if (f1 == f2)
+            return false;           /* A self loop */
+        edgeU[e] = f1;
+        edgeV[e] = f2;
+        degree[f1]++;   incident[f1] ^= e;
+        degree[f2]++;   incident[f2] ^= e;
+    }
+    std::vector<int> leaves, removed, removedAt;
+    for (int v=0; v < NumVert; v++)
+        if (degree[v] == 1)
+            leaves.push_back(v);
+    while (not leaves.empty())
+    {
+        int v = leaves.back();
+        leaves.pop_back();
+        if (degree[v] != 1)
+            continue;
+        int e = incident[v];
+        int w = edgeU[e] ^ edgeV[e] ^ v;
+        removed.push_back(e);
+        removedAt.push_back(v);
+        degree[v] = 0;
+        incident[w] ^= e;
+        if (--degree[w] == 1)
+            leaves.push_back(w);
+    }
+    if ((int)removed.size() != numEdges)
+        return false;               /* A cycle is left */
+
+    for (int v=0; v < NumVert; v++)
+        gg[v] = 0;                  /* g is sparse; leave the gaps 0 */
+    for (int i=numEdges-1; i >= 0; i--)
+    {
+        int e = removed[i];
+        int v = removedAt[i];
+        int w = edgeU[e] ^ edgeV[e] ^ v;
+        int gv = (keys[e] - gg[w]) % NumEntry;
+        gg[v] = (gv < 0) ? gv + NumEntry : gv;
+    }
+    return true;
 }
 
-bool PerfectHash::DFS(int parentE, int v)
+void PerfectHash::generate(PatternCollector *collector, uint32_t seed, int threads)
 {
-    int e, w;
-
-    /* Depth first search of the graph, starting at vertex v, looking for
-        cycles. parent and v are origin 1. Note parent is an EDGE,
-        not a vertex */
-
-    visited[v] = true;
-
-    /* For each e incident with v .. */
-    for (e = graphFirst[v]; e; e = graphNext[NumEntry+e])
-    {
-        uint8_t *key1;
+    m_collector = collector;
+    assert(nullptr!=collector);
 
-        if (deleted[abs(e)])
+    /* Identical keys would always make a cycle: only the first of them is put in the graph, the others
+        hash to it */
+    std::vector<int> order(NumEntry);
+    for (int i=0; i < NumEntry; i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return memcmp(m_collector->getKey(a), m_collector->getKey(b), EntryLen) < 0;
+    });
+    std::vector<int> keys;
+    for (int i=0; i < NumEntry; i++)
+    {
+        if (i > 0 and memcmp(m_collector->getKey(order[i]), m_collector->getKey(order[i-1]), EntryLen) == 0)
         {
-            /* A deleted key. Just ignore it */
+            printf("Duplicate keys %d and %d (", keys.back(), order[i]);
+            m_collector->dispKey(keys.back());
+            printf(" & ");
+            m_collector->dispKey(order[i]);
+            printf(")\n");
             continue;
         }
-        key1 = m_collector->getKey(abs(e)-1);
-        w = graphNode[NumEntry+e];
-        if (visited[w])
-        {
-            /* Did we just come through this edge? If so, ignore it. */
-            if (abs(e) != abs(parentE))
-            {
-                /* There is a cycle in the graph. There is some subtle code here
-                    to work around the distinct possibility that there may be
-                    duplicate keys. Duplicate keys will always cause unit
-                    cycles, since f1 and f2 (used to select v and w) will be the
-                    same for both. The edges (representing an index into the
-                    array of keys) are distinct, but the key values are not.
-                    The logic is as follows: for the candidate edge e, check to
-                    see if it terminates in the parent vertex. If so, we test
-                    the keys associated with e and the parent, and if they are
-                    the same, we can safely ignore e for the purposes of cycle
-                    detection, since edge e adds nothing to the cycle. Cycles
-                    involving v, w, and e0 will still be found. The parent
-                    edge was not similarly eliminated because at the time when
-                    it was a candidate, v was not yet visited.
-                    We still have to remove the key from further consideration,
-                    since each edge is visited twice, but with a different
-                    parent edge each time.
-                */
-                /* We save some stack space by calculating the parent vertex
-                    for these relatively few cases where it is needed */
-                int parentV = graphNode[NumEntry-parentE];
-
-                if (w == parentV)
-                {
-                    uint8_t *key2;
-
-                    key2=m_collector->getKey(abs(parentE)-1);
-                    if (memcmp(key1, key2, EntryLen) == 0)
-                    {
-                        printf("Duplicate keys with edges %d and %d (",
-                               e, parentE);
-                        m_collector->dispKey(abs(e)-1);
-                        printf(" & ");
-                        m_collector->dispKey(abs(parentE)-1);
-                        printf(")\n");
-                        deleted[abs(e)] = true;      /* Wipe the key */
-                    }
-                    else
-                    {
-                        /* A genuine (unit) cycle. */
-                        printf("There is a unit cycle involving vertex %d and edge %d\n", v, e);
-                        return true;
-                    }
-
-                }
-                else
-                {
-                    /* We have reached a previously visited vertex not the
-                        parent. Therefore, we have uncovered a genuine cycle */
-                    printf("There is a cycle involving vertex %d and edge %d\n", v, e);
-                    return true;
+        keys.push_back(order[i]);
+    }
+    std::sort(keys.begin(), keys.end());
 
-                }
-            }
-        }
-        else                                /* Not yet seen. Traverse it */
+    std::atomic<int> next(0);
+    std::mutex lock;
+    int found = -1;                 /* Lowest attempt that succeeded */
+    auto worker = [&]() {
+        std::vector<uint16_t> t1(SetSize*EntryLen), t2(SetSize*EntryLen);
+        std::vector<short> gg(NumVert+1);
+        for (;;)
         {
-            if (DFS(e, w))
+            int attempt = next++;
             {
-                /* Cycle found deeper down. Exit */
-                return true;
+                std::lock_guard<std::mutex> guard(lock);
+                if (found >= 0 and attempt > found)
+                    return;
             }
-        }
-    }
-    return false;
-}
-
-bool PerfectHash::isCycle(void)
-{
-    int v, e;
-
-    for (v=1; v <= NumVert; v++)
-    {
-        visited[v] = false;
-    }
-    for (e=1; e <= NumEntry; e++)
-    {
-        deleted[e] = false;
-    }
-    for (v=1; v <= NumVert; v++)
-    {
-        if (not visited[v])
-        {
-            if (DFS(-32767, v))
+            if (not tryAttempt(seed, attempt, keys, t1.data(), t2.data(), gg.data()))
+                continue;
+            std::lock_guard<std::mutex> guard(lock);
+            if (found < 0 or attempt < found)
             {
-                return true;
+                found = attempt;
+                std::copy(t1.begin(), t1.end(), T1base);
+                std::copy(t2.begin(), t2.end(), T2base);
+                std::copy(gg.begin(), gg.end(), g);
             }
         }
-    }
-    return false;
-}
-
-void PerfectHash::traverse(int u)
-{
-    int w, e;
-
-    visited[u] = true;
-    /* Find w, the neighbours of u, by searching the edges e associated with u */
-    e = graphFirst[1+u];
-    while (e)
-    {
-        w = graphNode[NumEntry+e]-1;
-        if (not visited[w])
-        {
-            g[w] = (abs(e)-1 - g[u]) % NumEntry;
-            if (g[w] < 0) g[w] += NumEntry;     /* Keep these positive */
-            traverse(w);
-        }
-        e = graphNext[NumEntry+e];
-    }
-
+    };
+    std::vector<std::thread> pool;
+    for (int i=1; i < threads; i++)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread &t : pool)
+        t.join();
+    m_attempts = found + 1;
 }
 
-void PerfectHash::assign(void)
-{
-    int v;
-
-
-    for (v=0; v < NumVert; v++)
-    {
-        g[v] = 0;                           /* g is sparse; leave the gaps 0 */
-        visited[v] = false;
-    }
-
-    for (v=0; v < NumVert; v++)
-    {
-        if (not visited[v])
-        {
-            g[v] = 0;
-            traverse(v);
-        }
-    }
-}
-
-int PerfectHash::hash(uint8_t *string)
+int PerfectHash::hash(const uint8_t *string) const
 {
     uint16_t u, v;
     int  j;
@@ -373,66 +218,16 @@ int PerfectHash::hash(uint8_t *string)
     u = 0;
     for (j=0; j < EntryLen; j++)
     {
-        T1 = T1base + j * SetSize;
-        u += T1[string[j] - SetMin];
+        u += T1base[j * SetSize + string[j] - SetMin];
     }
     u %= NumVert;
 
     v = 0;
     for (j=0; j < EntryLen; j++)
     {
-        T2 = T2base + j * SetSize;
-        v += T2[string[j] - SetMin];
+        v += T2base[j * SetSize + string[j] - SetMin];
     }
     v %= NumVert;
 
     return (g[u] + g[v]) % NumEntry;
 }
-
-#if 0
-void dispRecord(int i);
-
-void
-duplicateKeys(int v1, int v2)
-{
-    int i, j;
-    uint8_t *keys;
-    int u, v;
-
-    v1--; v2--;             /* These guys are origin 1 */
-
-    printf("Duplicate keys:\n");
-
-    for (i=0; i < NumEntry; i++)
-    {
-        getKey(i, &keys);
-        u = 0;
-        for (j=0; j < EntryLen; j++)
-        {
-            T1 = T1base + j * SetSize;
-            u += T1[keys[j] - SetMin];
-        }
-        u %= NumVert;
-        if ((u != v1) and (u != v2)) continue;
-
-        v = 0;
-        for (j=0; j < EntryLen; j++)
-        {
-            T2 = T2base + j * SetSize;
-            v += T2[keys[j] - SetMin];
-        }
-        v %= NumVert;
-
-        if ((v == v2) or (v == v1))
-        {
-            printf("Entry #%d key: ", i+1);
-            for (j=0; j < EntryLen; j++) printf("%02X ", keys[j]);
-            printf("\n");
-            dispRecord(i+1);
-        }
-    }
-    exit(1);
-
-
-}
-#endif
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <vector>
 /** Perfect hashing function library. Contains functions to generate perfect
     hashing functions */
 struct PatternCollector;
@@ -17,10 +18,13 @@ struct PerfectHash {
     void setHashParams(int _numEntry, int _entryLen, int _setSize, char _setMin, int _numVert);
 
 public:
-    void map(PatternCollector * collector); /* Part 1 of creating the tables */
+    /** Generates T1, T2 and g for the keys of collector.  Attempts are numbered from 0 and each one draws
+        its tables from seed and its number only; threads try attempts concurrently, and the first attempt
+        that succeeds is kept, so that the result depends on the seed alone */
+    void generate(PatternCollector * collector, uint32_t seed, int threads=1);
     void hashCleanup(); /* Frees memory allocated by setHashParams() */
-    void assign(); /* Part 2 of creating the tables */
-    int hash(uint8_t *string); /* Hash the string to an int 0 .. NUMENTRY-1 */
+    int hash(const uint8_t *string) const; /* Hash the string to an int 0 .. NUMENTRY-1 */
+    int attempts() const { return m_attempts; } /* Attempts generate() made */
     const uint16_t *readT1(void) const { return T1base; }
     const uint16_t *readT2(void) const { return T2base; }
     const uint16_t *readG(void) const  { return (uint16_t *)g; }
@@ -28,11 +32,8 @@ public:
     uint16_t *readT2(void){ return T2base; }
     uint16_t *readG(void) { return (uint16_t *)g; }
 private:
-    void initGraph();
-    void addToGraph(int e, int v1, int v2);
-    bool isCycle();
-    bool DFS(int parentE, int v);
-    void traverse(int u);
-    PatternCollector *m_collector; /* used to retrieve the keys */
-
+    bool tryAttempt(uint32_t seed, int attempt, const std::vector<int> &keys, uint16_t *t1, uint16_t *t2,
+                    short *gg) const;
+    PatternCollector *m_collector=nullptr; /* used to retrieve the keys */
+    int m_attempts=0;
 };
@@ -5,7 +5,7 @@ class DccFrontend : public QObject
 {
     Q_OBJECT
     void    LoadImage();
-    void    parse(Project &proj);
+    bool    parse(Project &proj);
     std::string m_fname;
 public:
     explicit DccFrontend(QObject *parent = 0);
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class QTextStream;
+struct Constant;
+
+/**
+ * Bump allocator owning every expression node created while it is current.
+ * Nodes are never freed one by one: an arena is released as a whole together with its owner, a Function,
+ * or at exit for nodes created outside of any procedure.
+ * Leaves are immutable once built, so they are shared instead of copied by clone(), and constants are
+ * hash-consed per arena.
+ */
+class ExprArena
+{
+public:
+    struct Stats
+    {
+        uint64_t    nodes=0;            /* nodes allocated                          */
+        uint64_t    bytes=0;            /* bytes handed out to nodes                */
+        uint64_t    chunks=0;           /* memory blocks requested from the heap    */
+        uint64_t    shared_clones=0;    /* leaf clones that returned the original   */
+        uint64_t    interned_hits=0;    /* constants found in the hash-cons table   */
+    };
+    /** Makes arena current for the lifetime of this object */
+    class Scope
+    {
+        ExprArena *m_prev;
+    public:
+        explicit Scope(ExprArena &arena) : m_prev(s_current) { s_current = &arena; }
+        ~Scope() { s_current = m_prev; }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    ExprArena() {}
+    ExprArena(const ExprArena &) = delete;
+    ExprArena &operator=(const ExprArena &) = delete;
+
+    void *      allocate(size_t sz);
+    Constant *  constant(uint32_t value, uint8_t size);
+
+    static ExprArena &  current();
+    static const Stats &stats() { return s_stats; }
+    static void         noteSharedClone() { s_stats.shared_clones++; }
+    static void         writeStats(QTextStream &ostr);
+private:
+    static ExprArena *  s_current;
+    static Stats        s_stats;
+    std::vector<std::unique_ptr<char[]> > m_chunks;
+    char *              m_top=nullptr;
+    size_t              m_left=0;
+    std::unordered_map<uint64_t,Constant *> m_constants;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+
+class QTextStream;
+struct Expr;
+struct UnaryOperator;
+struct BinaryOperator;
+struct STKFRAME;
+
+/**
+ * Bottom-up rewriting of high-level expressions left over by forward substitution:
+ * constant folding, removal of identity operations (x+0, x*1 ...), shifts by a constant turned back into
+ * multiplications, and negations folded into the conditions they apply to.
+ * Each node is visited once and rewritten in place; subtrees are reused, never cloned.
+ * Rewrites only valid for a truth value (!!x => x, (a<b) != 0 => a<b) are applied in conditions only.
+ */
+class ExprSimplifier
+{
+public:
+    struct Stats
+    {
+        uint64_t    visited=0;      /* nodes visited                            */
+        uint64_t    folded=0;       /* operations on constants evaluated        */
+        uint64_t    identities=0;   /* identity operations removed              */
+        uint64_t    reassociated=0; /* constant operands merged, (x+1)+2 => x+3 */
+        uint64_t    shifts=0;       /* shifts by a constant made multiplications*/
+        uint64_t    conditions=0;   /* negations and comparisons normalised     */
+    };
+    Expr *      simplify(Expr *e, bool as_condition=false);
+    void        simplifyArgs(STKFRAME *args);
+    uint64_t    rewrites() const { return m_rewrites; }
+
+    static const Stats &stats() { return s_stats; }
+    static void         writeStats(QTextStream &ostr);
+private:
+    Expr *      simplifyUnary(UnaryOperator *u, bool as_condition);
+    Expr *      simplifyBinary(BinaryOperator *b, bool as_condition);
+    Expr *      fold(BinaryOperator *b);
+    uint64_t    m_rewrites=0;
+    static Stats s_stats;
+};
@@ -12,7 +12,7 @@ struct IDENTTYPE
 protected:
     condId           idType;
 public:
-    condId           type() {return idType;}
+    condId           type() const {return idType;}
     void             type(condId t) {idType=t;}
     union _idNode {
         int          localIdx;  /* idx into localId,  LOCAL_VAR		*/
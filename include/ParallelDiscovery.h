@@ -0,0 +1,82 @@
+#pragma once
+#include "error.h"
+#include "icode.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class QTextStream;
+
+/**
+ * Concurrent discovery of the code reachable from the entry point, run by worker threads while the
+ * parse goes on.
+ * A worker takes a procedure entry from the frontier, decodes its body following branches and jumps,
+ * and puts the targets of direct calls back on the frontier.  Decoded icodes are kept by address in
+ * a table split in shards, each behind its own lock.
+ * The parse (FollowCtrl) still runs alone and in order: scan() hands it the icodes already decoded,
+ * and it decodes the others itself.  Decoding only depends on the image, so procedures, symbols and
+ * their ordering are those of the sequential run.
+ */
+class ParallelDiscovery
+{
+public:
+    struct Stats
+    {
+        uint64_t    procedures=0;   /* entries taken from the frontier          */
+        uint64_t    decoded=0;      /* instructions decoded by the workers      */
+        uint64_t    taken=0;        /* decoded instructions used by the parse   */
+        uint64_t    scanned=0;      /* instructions the parse decoded itself    */
+    };
+    /** Starts \a threads workers from \a entry; does nothing unless threads > 1 */
+    ParallelDiscovery(uint32_t entry, int threads);
+    /** Stops the workers and releases the icodes the parse did not use */
+    ~ParallelDiscovery();
+    ParallelDiscovery(const ParallelDiscovery &) = delete;
+    ParallelDiscovery &operator=(const ParallelDiscovery &) = delete;
+
+    /** Appends the icode at ip to decoded, taken from the running discovery if it has decoded it */
+    static eErrorId     scan(uint32_t ip, CIcodeRec &decoded);
+    static const Stats &stats() { return s_stats; }
+    static void         writeStats(QTextStream &ostr);
+private:
+    static const int SHARD_COUNT = 64;
+    struct Decoded
+    {
+        CIcodeRec::iterator icode;
+        eErrorId    err=NO_ERR;
+        bool        ready=false;    /* icode has been decoded   */
+        bool        taken=false;    /* icode was given to the parse */
+    };
+    struct Shard
+    {
+        std::mutex  lock;
+        std::unordered_map<uint32_t,Decoded> by_address;
+        CIcodeRec   icodes;
+    };
+    Shard &     shard(uint32_t ip) { return m_shards[(ip >> 4) % SHARD_COUNT]; }
+    bool        claim(uint32_t ip);
+    void        store(uint32_t ip, CIcodeRec &node, eErrorId err);
+    bool        take(uint32_t ip, CIcodeRec &decoded, eErrorId &err);
+    void        push(uint32_t entry);
+    void        worker();
+    void        discover(uint32_t entry);
+
+    Shard                   m_shards[SHARD_COUNT];
+    std::mutex              m_frontier_lock;
+    std::condition_variable m_frontier_cv;
+    std::deque<uint32_t>    m_frontier;
+    int                     m_pending=0;    /* entries queued or being discovered */
+    int                     m_started=0;    /* workers ready to discover */
+    std::atomic<bool>       m_stop;
+    std::atomic<uint64_t>   m_procedures;
+    std::atomic<uint64_t>   m_decoded;
+    std::vector<std::thread> m_workers;
+
+    static ParallelDiscovery *  s_active;
+    static Stats                s_stats;
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <list>
+
+class QString;
+class QTextStream;
+struct Function;
+
+/* Analysis phases timed by ScopedPassTimer */
+enum ePass
+{
+    PASS_LOAD=0,        /* Loading the binary image                         */
+    PASS_PARSE,         /* Recursive traversal and scanning                 */
+    PASS_LIBCHECK,      /* Library signature checking                       */
+    PASS_CREATE_CFG,    /* Basic block construction                         */
+    PASS_COMPRESS_CFG,  /* Jump-to-jump removal, dfs numbering              */
+    PASS_IDIOMS,        /* Machine idiom recognition                        */
+    PASS_PROPLONG,      /* Long variable propagation                        */
+    PASS_HLGEN,         /* High-level icode generation                      */
+    PASS_DATAFLOW,      /* Liveness, def-use chains and forward substitution*/
+    PASS_SIMPLIFY,      /* Folding and simplification of hl expressions     */
+    PASS_STRUCTURE,     /* Interval analysis and control structuring        */
+    PASS_CODEGEN,       /* C code generation                                */
+    PASS_COUNT
+};
+/* Event counters kept alongside the pass times */
+enum eCounter
+{
+    CNT_LL_ICODES=0,    /* Low-level icodes at code generation              */
+    CNT_HL_ICODES,      /* High-level icodes written out                    */
+    CNT_BBS,            /* Basic blocks after compressCFG                   */
+    CNT_IDIOMS,         /* Idioms matched                                   */
+    CNT_LIVENESS_VISITS,/* Basic block visits of the liveness solver        */
+    CNT_SIMPLIFIED,     /* Expression rewrites by the simplifier            */
+    CNT_COUNT
+};
+
+/** Times and counters of one procedure, or of the whole binary */
+struct PassStats
+{
+    typedef std::chrono::steady_clock::duration duration;
+    duration    time[PASS_COUNT];
+    uint32_t    calls[PASS_COUNT];
+    uint64_t    counters[CNT_COUNT];
+    PassStats()
+    {
+        std::fill(time,time+PASS_COUNT,duration::zero());
+        std::fill(calls,calls+PASS_COUNT,0);
+        std::fill(counters,counters+CNT_COUNT,0);
+    }
+    duration totalTime() const;
+    static const char *passName(ePass p);
+    static const char *counterName(eCounter c);
+};
+
+/**
+ * Collects pass statistics, when enabled (-s or --stats-json).
+ * A disabled collector costs a single flag test per pass.
+ */
+class Instrumentation
+{
+    static bool         s_enabled;
+    static PassStats    s_total;
+public:
+    static bool enabled() { return s_enabled; }
+    static void enable(bool v) { s_enabled = v; }
+    static const PassStats &total() { return s_total; }
+    static void record(Function *f, ePass pass, PassStats::duration d);
+    static void count(Function *f, eCounter c, uint64_t v=1)
+    {
+        if(not s_enabled)
+            return;
+        countEnabled(f,c,v);
+    }
+    static void writeReport(QTextStream &ostr, const std::list<Function> &funcs);
+    static bool writeJson(const QString &path, const std::list<Function> &funcs);
+private:
+    static void countEnabled(Function *f, eCounter c, uint64_t v);
+};
+
+/**
+ * Times the enclosing scope as one run of \a pass, for function \a f (or for the binary only, if f is null).
+ * Nested timers are subtracted from the enclosing one, so recorded times are exclusive and add up to the total.
+ */
+class ScopedPassTimer
+{
+    static ScopedPassTimer *s_current;
+    ScopedPassTimer *   m_parent;
+    Function *          m_func;
+    ePass               m_pass;
+    bool                m_active;
+    std::chrono::steady_clock::time_point m_start;
+    PassStats::duration m_nested;
+public:
+    ScopedPassTimer(ePass pass, Function *f=nullptr) : m_func(f), m_pass(pass), m_active(Instrumentation::enabled())
+    {
+        if(not m_active)
+            return;
+        m_parent = s_current;
+        s_current = this;
+        m_nested = PassStats::duration::zero();
+        m_start = std::chrono::steady_clock::now();
+    }
+    ~ScopedPassTimer()
+    {
+        if(not m_active)
+            return;
+        PassStats::duration elapsed = std::chrono::steady_clock::now() - m_start;
+        Instrumentation::record(m_func, m_pass, elapsed - m_nested);
+        if(m_parent)
+            m_parent->m_nested += elapsed;
+        s_current = m_parent;
+    }
+    ScopedPassTimer(const ScopedPassTimer &) = delete;
+    ScopedPassTimer &operator=(const ScopedPassTimer &) = delete;
+};
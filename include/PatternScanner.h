@@ -0,0 +1,70 @@
+#pragma once
+#include "types.h"
+#include "SigKernels.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Finds byte patterns containing WILD bytes, any number of them in one pass over the image.
+ * Each pattern is anchored on its longest run of non wild bytes; the anchors are matched by an
+ * Aho-Corasick automaton and every anchor found is checked against the whole pattern.
+ * Once compile()d, scanning does not modify the scanner, which can be shared between threads.
+ */
+class PatternScanner
+{
+public:
+    /** Adds a pattern of len bytes, which must not all be WILD, and returns its id.  Only the
+        pointer is kept */
+    int     add(const uint8_t *pattern, int len);
+    void    compile();
+    int     patternCount() const { return (int)m_patterns.size(); }
+    int     length(int id) const { return m_patterns[id].len; }
+
+    /** Calls found(id, start) for every match lying entirely in source[from, to), in the order
+        of the matches' ends; return false from found to stop the scan */
+    template<class F>
+    void    scan(const uint8_t *source, int from, int to, F found) const;
+    /** Sets first[id] to the start of the leftmost match of each pattern in source[from, to), or
+        -1 if there is none */
+    void    firstMatches(const uint8_t *source, int from, int to, std::vector<int> &first) const;
+private:
+    struct Pattern
+    {
+        const uint8_t * bytes;
+        int             len;
+        int             anchor;         /* start of the anchor in the pattern   */
+        int             anchor_len;
+    };
+    bool    matches(const Pattern &p, const uint8_t *at) const;
+
+    std::vector<Pattern>    m_patterns;
+    std::vector<int32_t>    m_next;         /* 256 transitions per state, failures resolved */
+    std::vector<uint32_t>   m_first_out;    /* patterns whose anchor ends at state s are       */
+    std::vector<int>        m_out;          /* m_out[m_first_out[s], m_first_out[s+1])         */
+};
+
+inline bool PatternScanner::matches(const Pattern &p, const uint8_t *at) const
+{
+    return SigKernels::best().wildMatch(p.bytes,at,p.len,WILD);
+}
+
+template<class F>
+void PatternScanner::scan(const uint8_t *source, int from, int to, F found) const
+{
+    int32_t state = 0;
+    for(int pos=from; pos<to; ++pos)
+    {
+        state = m_next[state*256 + source[pos]];
+        for(uint32_t o=m_first_out[state]; o<m_first_out[state+1]; ++o)
+        {
+            int id = m_out[o];
+            const Pattern &p(m_patterns[id]);
+            int start = pos + 1 - p.anchor - p.anchor_len;
+            if(start < from or start + p.len > to or not matches(p,source+start))
+                continue;
+            if(not found(id,start))
+                return;
+        }
+    }
+}
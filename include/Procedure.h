@@ -5,10 +5,13 @@
 #include "icode.h"
 #include "StackFrame.h"
 #include "CallConvention.h"
+#include "PassStats.h"
+#include "ExprArena.h"
 
 #include <QtCore/QString>
 #include <bitset>
 #include <map>
+#include <memory>
 
 class QIODevice;
 class QTextStream;
@@ -20,6 +23,7 @@ struct Disassembler;
 struct Function;
 struct CALL_GRAPH;
 struct PROG;
+struct LongRegDefs;
 
 struct Function;
 
@@ -29,6 +33,7 @@ enum PROC_FLAGS
     PROC_BADINST=0x00000100,/* Proc contains invalid or 386 instruction */
     PROC_IJMP   =0x00000200,/* Proc incomplete due to indirect jmp	 	*/
     PROC_ICALL  =0x00000400, /* Proc incomplete due to indirect call		*/
+    PROC_SELECTED=0x00000800,/* Proc asked for with -E                   */
     PROC_HLL    =0x00001000, /* Proc is likely to be from a HLL			*/
 //    CALL_PASCAL =0x00002000, /* Proc uses Pascal calling convention		*/
 //    CALL_C      =0x00004000, /* Proc uses C calling convention			*/
@@ -130,9 +135,18 @@ public:
     LivenessSet     liveOut;	/* Registers that may be used in successors	 */
     bool            liveAnal;	/* Procedure has been analysed already		 */
 
+    PassStats       m_pass_stats; /* Per-pass times and counters, filled when stats are enabled */
+    std::shared_ptr<ExprArena> m_expr_arena; /* Expression nodes of this procedure, created on first use */
+
     virtual ~Function() {
         delete type;
     }
+    ExprArena &exprArena()
+    {
+        if(not m_expr_arena)
+            m_expr_arena = std::make_shared<ExprArena>();
+        return *m_expr_arena;
+    }
 public:
     static Function *Create(FunctionType *ty=0,int /*Linkage*/=0,const QString &nm="",void */*module*/=0)
     {
@@ -183,8 +197,8 @@ public:
     Expr * adjustActArgType(Expr *_exp, hlType forType);
     QString writeCall(Function *tproc, STKFRAME &args, int *numLoc);
     void processDosInt(STATE *pstate, PROG &prog, bool done);
-    ICODE *translate_DIV(LLInst *ll, ICODE &_Icode);
-    ICODE *translate_XCHG(LLInst *ll, ICODE &_Icode);
+    ICODE *translate_DIV(LLInst *ll, CIcodeRec &decoded);
+    ICODE *translate_XCHG(LLInst *ll, CIcodeRec &decoded);
 protected:
     void extractJumpTableRange(ICODE& pIcode, STATE *pstate, JumpTable &table);
     bool followAllTableEntries(JumpTable &table, uint32_t cs, ICODE &pIcode, CALL_GRAPH *pcallGraph, STATE *pstate);
@@ -197,15 +211,16 @@ protected:
     void processExpPush(int &numHlIcodes, iICODE picode);
 
     // TODO: replace those with friend visitor ?
-    void propLongReg(int loc_ident_idx, const ID &pLocId);
-    void propLongStk(int i, const ID &pLocId);
-    void propLongGlb(int i, const ID &pLocId);
+    void propLongReg(int loc_ident_idx, const LongRegDefs &defs);
+    void propLongStk(size_t first, size_t last);
+    void propLongGlb(int i);
     void processTargetIcode(iICODE picode, int &numHlIcodes, iICODE ticode, bool isLong);
 
-    int     findBackwarLongDefs(int loc_ident_idx, const ID &pLocId, iICODE iter);
-    int     findForwardLongUses(int loc_ident_idx, const ID &pLocId, iICODE beg);
+    int     findBackwarLongDefs(int loc_ident_idx, const LongRegDefs &defs, iICODE iter);
+    int     findForwardLongUses(int loc_ident_idx, iICODE beg);
     void    structCases();
     void    findExps();
+    void    simplifyExps();
     void    genDU1();
     void    elimCondCodes();
     void    liveRegAnalysis(LivenessSet &in_liveOut);
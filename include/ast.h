@@ -7,6 +7,7 @@
 #pragma once
 
 #include "Enums.h"
+#include "ExprArena.h"
 #include "msvc_fixes.h"
 
 #include <boost/range/iterator_range.hpp>
@@ -39,33 +40,49 @@ typedef std::list<ICODE>::iterator iICODE;
 typedef boost::iterator_range<iICODE> rICODE;
 #include "IdentType.h"
 
-/* Expression data type */
+/* Expression data type.
+ * Nodes live in the current ExprArena and are released with it; deleting a node does not free anything. */
 struct Expr
 {
 public:
     condNodeType            m_type;     /* Conditional Expression Node Type */
 public:
+    static void *operator new(size_t sz) { return ExprArena::current().allocate(sz); }
+    static void *operator new(size_t, void *at) { return at; }
+    static void operator delete(void *) {}
+    static void operator delete(void *, void *) {}
     static bool         insertSubTreeLongReg(Expr *exp, Expr *&tree, int longIdx);
     static bool         insertSubTreeReg(Expr *&tree, Expr *_expr, eReg regi, const LOCAL_ID *locsym);
     static bool         insertSubTreeReg(AstIdent *&tree, Expr *_expr, eReg regi, const LOCAL_ID *locsym);
 public:
 
-    virtual Expr *clone() const=0;  //!< Makes a deep copy of the given expression
-    Expr(condNodeType t=UNKNOWN_OP) : m_type(t)
+    virtual Expr *clone() const=0;  //!< Makes a copy of the given expression, sharing its leaves
+    Expr(condNodeType t=UNKNOWN_OP) : m_type(t),m_attr_stamp(0)
     {
 
     }
-    /** Recursively deallocates the abstract syntax tree rooted at *exp */
     virtual ~Expr() {}
 public:
-    virtual QString walkCondExpr (Function * pProc, int* numLoc) const=0;
+    /* The following dispatch on m_type (and on ident.idType for identifiers) instead of virtual calls */
+    QString walkCondExpr (Function * pProc, int* numLoc) const;
+    hlType expType(Function *pproc) const;
+    int hlTypeSize(Function *pproc) const;
+    /// Drops the cached type and size of this node, after one of its subtrees was replaced
+    void attributesChanged() { m_attr_stamp = 0; }
+    /// Drops all cached types and sizes, after the type of an identifier changed
+    static void symbolTypesChanged() { s_attr_generation++; }
+
     virtual Expr *inverse() const=0; // return new COND_EXPR that is invarse of this
     virtual bool xClear(rICODE range_to_check, iICODE lastBBinst, const LOCAL_ID &locId)=0;
     virtual Expr *insertSubTreeReg(Expr *_expr, eReg regi, const LOCAL_ID *locsym)=0;
     virtual Expr *insertSubTreeLongReg(Expr *_expr, int longIdx)=0;
-    virtual hlType expType(Function *pproc) const=0;
-    virtual int hlTypeSize(Function *pproc) const=0;
     virtual Expr * performLongRemoval(eReg regi, LOCAL_ID *locId) { return this; }
+private:
+    static uint32_t     s_attr_generation;
+    mutable uint32_t    m_attr_stamp;   /* s_attr_generation when the attributes were cached, 0 if stale */
+    mutable hlType      m_attr_type;    /* cached expType()     */
+    mutable int         m_attr_size;    /* cached hlTypeSize()  */
+    void    computeAttributes(Function *pproc) const;
 };
 struct UnaryOperator : public Expr
 {
@@ -73,7 +90,7 @@ struct UnaryOperator : public Expr
     Expr *unaryExp;
     virtual Expr *inverse() const
     {
-        if (m_type == NEGATION) //TODO: memleak here
+        if (m_type == NEGATION)
         {
             return unaryExp->clone();
         }
@@ -93,19 +110,9 @@ struct UnaryOperator : public Expr
         newExp->unaryExp = sub_expr;
         return (newExp);
     }
-    ~UnaryOperator()
-    {
-        delete unaryExp;
-        unaryExp=nullptr;
-    }
 public:
-    int hlTypeSize(Function *pproc) const;
-    virtual QString walkCondExpr(Function *pProc, int *numLoc) const;
     virtual Expr *insertSubTreeReg(Expr *_expr, eReg regi, const LOCAL_ID *locsym);
-    virtual hlType expType(Function *pproc) const;
     virtual Expr *insertSubTreeLongReg(Expr *_expr, int longIdx);
-private:
-    QString wrapUnary(Function *pProc, int *numLoc, QChar op) const;
 };
 
 struct BinaryOperator : public Expr
@@ -124,13 +131,6 @@ struct BinaryOperator : public Expr
         m_lhs=l;
         m_rhs=r;
     }
-    ~BinaryOperator()
-    {
-        assert(m_lhs!=m_rhs or m_lhs==nullptr);
-        delete m_lhs;
-        delete m_rhs;
-        m_lhs=m_rhs=nullptr;
-    }
     static BinaryOperator *Create(condOp o,Expr *l,Expr *r)
     {
         BinaryOperator *res = new BinaryOperator(o);
@@ -190,10 +190,6 @@ struct BinaryOperator : public Expr
     condOp op() const { return m_op;}
     /* Changes the boolean conditional operator at the root of this expression */
     void op(condOp o) { m_op=o;}
-    QString walkCondExpr(Function * pProc, int* numLoc) const;
-public:
-    hlType expType(Function *pproc) const;
-    int hlTypeSize(Function *pproc) const;
 };
 struct AstIdent : public UnaryOperator
 {
@@ -210,14 +206,17 @@ struct AstIdent : public UnaryOperator
     static AstIdent *  idID(const ID *retVal, LOCAL_ID *locsym, iICODE ix_);
     static Expr * id(const LLInst &ll_insn, opLoc sd, Function *pProc, iICODE ix_, ICODE &duIcode, operDu du);
 
+    /// Identifiers are never modified once built, so copies share the node
     virtual Expr *clone() const
     {
-        return new AstIdent(*this);
+        ExprArena::noteSharedClone();
+        return const_cast<AstIdent *>(this);
     }
-    virtual int hlTypeSize(Function *pproc) const;
-    virtual hlType expType(Function *pproc) const;
+    /* Attributes and C form of the identifier, according to ident.idType */
+    int     identSize(Function *pproc) const;
+    hlType  identType(Function *pproc) const;
+    void    writeIdent(QString &out, Function *pProc, int *numLoc) const;
     virtual Expr * performLongRemoval(eReg regi, LOCAL_ID *locId);
-    virtual QString walkCondExpr(Function *pProc, int *numLoc) const;
     virtual Expr *insertSubTreeReg(Expr *_expr, eReg regi, const LOCAL_ID *locsym);
     virtual Expr *insertSubTreeLongReg(Expr *_expr, int longIdx);
     virtual bool xClear(rICODE range_to_check, iICODE lastBBinst, const LOCAL_ID &locId);
@@ -226,28 +225,14 @@ struct GlobalVariable : public AstIdent
 {
     bool valid;
     int globIdx;
-    virtual Expr *clone() const
-    {
-        return new GlobalVariable(*this);
-    }
     GlobalVariable(int16_t segValue, int16_t off);
-    QString walkCondExpr(Function *pProc, int *numLoc) const;
-    int hlTypeSize(Function *pproc) const;
-    hlType expType(Function *pproc) const;
 };
 struct GlobalVariableIdx : public AstIdent
 {
     bool valid;
     int idxGlbIdx;	/* idx into localId, GLOB_VAR_IDX   */
 
-    virtual Expr *clone() const
-    {
-        return new GlobalVariableIdx(*this);
-    }
     GlobalVariableIdx(int16_t segValue, int16_t off, uint8_t regi, const LOCAL_ID *locSym);
-    QString walkCondExpr(Function *pProc, int *numLoc) const;
-    int hlTypeSize(Function *pproc) const;
-    hlType expType(Function *pproc) const;
 };
 struct Constant : public AstIdent
 {
@@ -263,13 +248,11 @@ struct Constant : public AstIdent
         kte.kte = _kte;
         kte.size = size;
     }
-    virtual Expr *clone() const
+    /// Returns the shared constant node for _kte of the given size
+    static Constant *Create(uint32_t _kte, uint8_t size)
     {
-        return new Constant(*this);
+        return ExprArena::current().constant(_kte,size);
     }
-    QString walkCondExpr(Function *pProc, int *numLoc) const;
-    int hlTypeSize(Function *pproc) const;
-    hlType expType(Function *pproc) const { return TYPE_CONST; }
 };
 struct FuncNode : public AstIdent
 {
@@ -280,16 +263,10 @@ struct FuncNode : public AstIdent
 
     FuncNode(Function *pproc, STKFRAME *args)
     {
+        ident.type(FUNCTION);
         call.proc = pproc;
         call.args = args;
     }
-    virtual Expr *clone() const
-    {
-        return new FuncNode(*this);
-    }
-    QString walkCondExpr(Function *pProc, int *numLoc) const;
-    int hlTypeSize(Function *pproc) const;
-    hlType expType(Function *pproc) const;
 };
 struct RegisterNode : public AstIdent
 {
@@ -309,12 +286,6 @@ struct RegisterNode : public AstIdent
     RegisterNode(const LLOperand &, LOCAL_ID *locsym);
 
     //RegisterNode(eReg regi, uint32_t icodeFlg, LOCAL_ID *locsym);
-    virtual Expr *clone() const
-    {
-        return new RegisterNode(*this);
-    }
-    QString walkCondExpr(Function *pProc, int *numLoc) const;
-    int hlTypeSize(Function *) const;
-    hlType expType(Function *pproc) const;
+    void writeName(QString &out, Function *pProc, int *numLoc) const;
     bool xClear(rICODE range_to_check, iICODE lastBBinst, const LOCAL_ID &locId);
 };
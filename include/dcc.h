@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <bitset>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
 
 #include "Enums.h"
 #include "types.h"
@@ -40,7 +41,9 @@ struct OPTION
     bool Interact;      /* Interactive mode */
     bool Calls;         /* Follow register indirect calls */
     QString	filename;			/* The input filename */
-    uint32_t CustomEntryPoint;
+    QString StatsJson;          /* Write pass statistics as JSON here */
+    int     ParseThreads;       /* Threads decoding code ahead of the parse, 1 for none */
+    QStringList EntryPoints;    /* Procedures to decompile, with their callees parsed only; all if empty */
 };
 
 extern OPTION option;       /* Command line options             */
@@ -88,13 +91,15 @@ bool    JmpInst(llIcode opcode);                            /* idioms.c     */
 queue::iterator  appendQueue(queue &Q, BB *node);           /* reducible.c  */
 
 bool    SetupLibCheck(void);                                /* chklib.c     */
+void    SweepLibCheck(const STATE &state);                  /* chklib.c     */
+void    LibCheckReached(Function &p);                       /* chklib.c     */
 void    CleanupLibCheck(void);                              /* chklib.c     */
 bool    LibCheck(Function &p);                              /* chklib.c     */
 
 
 /* Exported functions from hlicode.c */
 QString writeJcond(const HLTYPE &, Function *, int *);
-QString writeJcondInv(HLTYPE, Function *, int *);
+QString writeJcondInv(const HLTYPE &, Function *, int *);
 
 
 /* Exported funcions from locident.c */
@@ -36,52 +36,31 @@ typedef boost::iterator_range<iICODE> rCODE;
 
 struct LivenessSet
 {
-    std::set<eReg> registers;
+    std::bitset<LAST_REG> registers;    /* bit position is the eReg value */
 public:
-    LivenessSet(const std::initializer_list<eReg> &init) : registers(init) {}
-    LivenessSet() {}
-    LivenessSet(const LivenessSet &other) : registers(other.registers)
+    LivenessSet(const std::initializer_list<eReg> &init)
     {
+        for(eReg r : init)
+            registers.set(r);
     }
+    LivenessSet() {}
     void reset()
     {
-        registers.clear();
-    }
-
-    //    LivenessSet(LivenessSet &&other) : LivenessSet()
-    //    {
-    //        swap(*this,other);
-    //    }
-    LivenessSet &operator=(LivenessSet other)
-    {
-        swap(*this,other);
-        return *this;
-    }
-    friend void swap(LivenessSet& first, LivenessSet& second) // nothrow
-    {
-        std::swap(first.registers, second.registers);
+        registers.reset();
     }
     LivenessSet &operator|=(const LivenessSet &other)
     {
-        registers.insert(other.registers.begin(),other.registers.end());
+        registers |= other.registers;
         return *this;
     }
     LivenessSet &operator&=(const LivenessSet &other)
     {
-        std::set<eReg> res;
-        std::set_intersection(registers.begin(),registers.end(),
-                              other.registers.begin(),other.registers.end(),
-                              std::inserter(res, res.end()));
-        registers = res;
+        registers &= other.registers;
         return *this;
     }
     LivenessSet &operator-=(const LivenessSet &other)
     {
-        std::set<eReg> res;
-        std::set_difference(registers.begin(),registers.end(),
-                            other.registers.begin(),other.registers.end(),
-                            std::inserter(res, res.end()));
-        registers = res;
+        registers &= ~other.registers;
         return *this;
     }
     LivenessSet operator-(const LivenessSet &other) const
@@ -98,7 +77,7 @@ public:
     }
     bool any() const
     {
-        return not registers.empty();
+        return registers.any();
     }
     bool operator==(const LivenessSet &other) const
     {
@@ -110,7 +89,7 @@ public:
     LivenessSet &addReg(int r);
     bool testReg(int r) const
     {
-        return registers.find(eReg(r))!=registers.end();
+        return registers.test(r);
     }
     bool testRegAndSubregs(int r) const;
     LivenessSet &clrReg(int r);
@@ -134,13 +113,12 @@ struct DU
 struct Expr;
 struct AstIdent;
 struct UnaryOperator;
+/* The payloads below share storage in HLTYPE, the opcode selects the one in use: they must stay trivial
+ * (no virtual functions, no constructors) and begin with their expression or procedure pointer. */
 struct HlTypeSupport
 {
-    //hlIcode              opcode;    /* hlIcode opcode           */
-    virtual bool    removeRegFromLong(eReg regi, LOCAL_ID *locId)=0;
-    virtual QString writeOut(Function *pProc, int *numLoc) const=0;
 protected:
-    Expr * performLongRemoval (eReg regi, LOCAL_ID *locId, Expr *tree);
+    static Expr * performLongRemoval (eReg regi, LOCAL_ID *locId, Expr *tree);
 };
 
 struct CallType : public HlTypeSupport
@@ -151,7 +129,7 @@ struct CallType : public HlTypeSupport
     void allocStkArgs (int num);
     bool newStkArg(Expr *exp, llIcode opcode, Function *pproc);
     void placeStkArg(Expr *exp, int pos);
-    virtual Expr * toAst();
+    Expr * toAst();
 public:
     bool removeRegFromLong(eReg /*regi*/, LOCAL_ID * /*locId*/)
     {
@@ -163,11 +141,9 @@ public:
 struct AssignType : public HlTypeSupport
 {
     /* for HLI_ASSIGN */
-protected:
 public:
     Expr *  m_lhs;
     Expr *  m_rhs;
-    AssignType() {}
     Expr *lhs() const {return m_lhs;}
     void lhs(Expr *l);
     bool removeRegFromLong(eReg regi, LOCAL_ID *locId);
@@ -177,7 +153,6 @@ struct ExpType : public HlTypeSupport
 {
     /* for HLI_JCOND, HLI_RET, HLI_PUSH, HLI_POP*/
     Expr *  v;
-    ExpType() : v(nullptr) {}
     bool removeRegFromLong(eReg regi, LOCAL_ID *locId)
     {
         v=performLongRemoval(regi,locId,v);
@@ -186,18 +161,20 @@ struct ExpType : public HlTypeSupport
     QString writeOut(Function *pProc, int *numLoc) const;
 };
 
+/* HIGH_LEVEL part of an icode: the opcode tags which of the payloads is valid */
 struct HLTYPE
 {
-protected:
 public:
-    ExpType         exp;      /* for HLI_JCOND, HLI_RET, HLI_PUSH, HLI_POP*/
     hlIcode         opcode;    /* hlIcode opcode           */
-    AssignType      asgn;
-    CallType        call;
-    HlTypeSupport *get();
-    const HlTypeSupport *get() const
+    union
+    {
+        ExpType     exp;      /* for HLI_JCOND, HLI_RET, HLI_PUSH, HLI_POP*/
+        AssignType  asgn;     /* for HLI_ASSIGN           */
+        CallType    call;     /* for HLI_CALL             */
+    };
+    static bool isExpOpcode(hlIcode op)
     {
-        return const_cast<const HlTypeSupport *>(const_cast<HLTYPE*>(this)->get());
+        return (op==HLI_JCOND) or (op==HLI_RET) or (op==HLI_PUSH) or (op==HLI_POP);
     }
 
     void expr(Expr *e)
@@ -218,28 +195,54 @@ public:
     {
         if(i!=HLI_RET)
             assert(e);
-        assert(exp.v==0);
+        assert(not isExpOpcode(opcode) or exp.v==0);
         opcode=i;
         exp.v=e;
     }
     void set(Expr *l,Expr *r);
     void setCall(Function *proc);
+    bool removeRegFromLong(eReg regi, LOCAL_ID *locId);
     HLTYPE(hlIcode op=HLI_INVALID) : opcode(op)
-    {}
-    //    HLTYPE() // help valgrind find uninitialized HLTYPES
-    //    {}
-    HLTYPE & operator=(const HLTYPE &l)
-    {
-        exp     = l.exp;
-        opcode  = l.opcode;
-        asgn    = l.asgn;
-        call    = l.call;
-        return *this;
+    {
+        asgn.m_lhs = asgn.m_rhs = nullptr;
     }
 public:
     QString write1HlIcode(Function *pProc, int *numLoc) const;
     void setAsgn(Expr *lhs, Expr *rhs);
 } ;
+static_assert(sizeof(HLTYPE) <= 3*sizeof(void *), "HLTYPE payloads are expected to share their storage");
+
+/* Owning pointer to the HLTYPE of an icode, allocated when the icode is raised to HIGH_LEVEL.
+ * Copies are deep, so icodes keep their value semantics. */
+class HlTypePtr
+{
+    std::unique_ptr<HLTYPE> m_ptr;
+public:
+    HlTypePtr() {}
+    HlTypePtr(const HlTypePtr &other) : m_ptr(other.m_ptr ? new HLTYPE(*other.m_ptr) : nullptr) {}
+    HlTypePtr(HlTypePtr &&other) = default;
+    HlTypePtr &operator=(const HlTypePtr &other)
+    {
+        if(this != &other)
+            m_ptr.reset(other.m_ptr ? new HLTYPE(*other.m_ptr) : nullptr);
+        return *this;
+    }
+    HlTypePtr &operator=(HlTypePtr &&other) = default;
+    HLTYPE *    get() const { return m_ptr.get(); }
+    HLTYPE *    getOrCreate()
+    {
+        if(not m_ptr)
+            m_ptr.reset(new HLTYPE);
+        return m_ptr.get();
+    }
+    void        reset(HLTYPE &&v)
+    {
+        if(m_ptr)
+            *m_ptr = std::move(v);
+        else
+            m_ptr.reset(new HLTYPE(std::move(v)));
+    }
+};
 /* LOW_LEVEL icode operand record */
 struct LLOperand
 {
@@ -446,9 +449,10 @@ struct ICODE
     typedef BB MachineBasicBlock;
 protected:
     LLInst m_ll;
-    HLTYPE m_hl;
+    HlTypePtr m_hl;                     /* Only allocated for HIGH_LEVEL icodes*/
     MachineBasicBlock * Parent;      	/* BB to which this icode belongs   */
     bool                invalid;        /* Has no HIGH_LEVEL equivalent     */
+    static const HLTYPE s_no_hl;        /* hl() of icodes never raised      */
 public:
     x86_insn_t insn;
     template<int FLAG>
@@ -489,51 +493,57 @@ public:
             use.addReg(r);
         }
     };
+    /**
+     * Level-1 def-use chains.
+     * Every register defined by this icode owns an intrusive list of Use nodes, one per icode using that
+     * definition; each node is also linked into its user's list of reaching definitions, so that a use can
+     * be unlinked in O(1) from either side when an icode is invalidated or forward substituted.
+     * Chains refer to positions in the owning icode list, so copies of a DU1 start without any.
+     */
     struct DU1
     {
+        struct Use
+        {
+            std::list<ICODE>::iterator user;    /* icode using the definition       */
+            DU1 *       def;                    /* chains of the defining icode     */
+            int         regIdx;                 /* index of the register in def     */
+            Use *       nextUse() const { return m_next; }
+        private:
+            friend struct DU1;
+            Use *       m_prev;                 /* siblings in def->m_first[regIdx] */
+            Use *       m_next;
+            Use *       m_next_reaching;        /* siblings in user->du1.m_reaching */
+            Use **      m_prev_reaching;
+        };
     protected:
         int     numRegsDef;             /* # registers defined by this inst */
+        Use *   m_first[MAX_REGS_DEF+1];/* uses of each defined register, in recording order */
+        Use *   m_last[MAX_REGS_DEF+1];
+        int     m_num_uses[MAX_REGS_DEF+1];
+        Use *   m_reaching;             /* uses this icode makes of other definitions */
+        void    unlink(Use *u);
+        void    resetChains();
 
     public:
-        struct Use
-        {
-            int Reg; // used register
-            std::vector<std::list<ICODE>::iterator> uses; // use locations [MAX_USES]
-            void removeUser(std::list<ICODE>::iterator us)
-            {
-                // ic is no no longer an user
-                auto iter=std::find(uses.begin(),uses.end(),us);
-                if(iter==uses.end())
-                    return;
-                uses.erase(iter);
-                assert("Same user more then once!" and uses.end()==std::find(uses.begin(),uses.end(),us));
-            }
-
-        };
         uint8_t	regi[MAX_REGS_DEF+1];	/* registers defined by this inst   */
-        Use     idx[MAX_REGS_DEF+1];
-        //int     idx[MAX_REGS_DEF][MAX_USES];	/* inst that uses this def  */
-        bool    used(int regIdx)
-        {
-            return not idx[regIdx].uses.empty();
-        }
-        int     numUses(int regIdx)
-        {
-            return idx[regIdx].uses.size();
-        }
-        void recordUse(int regIdx,std::list<ICODE>::iterator location)
+        bool    used(int regIdx) const
         {
-            idx[regIdx].uses.push_back(location);
+            return m_num_uses[regIdx]!=0;
         }
-        void remove(int regIdx,int use_idx)
+        int     numUses(int regIdx) const
         {
-            idx[regIdx].uses.erase(idx[regIdx].uses.begin()+use_idx);
+            return m_num_uses[regIdx];
         }
-        void remove(int regIdx,std::list<ICODE>::iterator ic)
+        const Use *uses(int regIdx) const { return m_first[regIdx]; }
+        /// First recorded user of the definition regIdx
+        std::list<ICODE>::iterator firstUse(int regIdx) const
         {
-            Use &u(idx[regIdx]);
-            u.removeUser(ic);
+            assert(used(regIdx));
+            return m_first[regIdx]->user;
         }
+        void    recordUse(int regIdx,std::list<ICODE>::iterator location);
+        void    unlinkAll();
+        void    moveReachingTo(std::list<ICODE>::iterator target);
         int getNumRegsDef() const {return numRegsDef;}
         void clearAllDefs() {numRegsDef=0;}
         DU1 &addDef(eReg r) {numRegsDef++; return *this;}
@@ -541,6 +551,26 @@ public:
         void removeDef(eReg r) {numRegsDef--;}
         DU1() : numRegsDef(0)
         {
+            std::fill(regi,regi+MAX_REGS_DEF+1,0);
+            resetChains();
+        }
+        DU1(const DU1 &other) : numRegsDef(other.numRegsDef)
+        {
+            std::copy(other.regi,other.regi+MAX_REGS_DEF+1,regi);
+            resetChains();
+        }
+        DU1 &operator=(const DU1 &other)
+        {
+            if(this==&other)
+                return *this;
+            unlinkAll();
+            numRegsDef = other.numRegsDef;
+            std::copy(other.regi,other.regi+MAX_REGS_DEF+1,regi);
+            return *this;
+        }
+        ~DU1()
+        {
+            unlinkAll();
         }
     };
     icodeType           type;           /* Icode type                       */
@@ -551,20 +581,17 @@ public:
     LLInst *            ll() { return &m_ll;}
     const LLInst *      ll() const { return &m_ll;}
 
-    HLTYPE *            hlU() {
-        //        assert(type==HIGH_LEVEL);
-        //        assert(m_hl.opcode!=HLI_INVALID);
-        return &m_hl;
-    }
+    HLTYPE *            hlU() { return m_hl.getOrCreate(); }
     const HLTYPE *      hl() const {
-        //        assert(type==HIGH_LEVEL);
-        //        assert(m_hl.opcode!=HLI_INVALID);
-        return &m_hl;
+        const HLTYPE *res = m_hl.get();
+        return res ? res : &s_no_hl;
     }
-    void                hl(const HLTYPE &v) { m_hl=v;}
+    void                hl(HLTYPE &&v) { m_hl.reset(std::move(v));}
+    bool                hasHl() const { return m_hl.get() != nullptr; }
 
     void setRegDU(eReg regi, operDu du_in);
     void invalidate();
+    void forwardSubstituted();
     void newCallHl();
     void writeDU();
     condId idType(opLoc sd);
@@ -592,6 +619,12 @@ public:
     ICODE() : m_ll(this),Parent(0),invalid(false),type(NOT_SCANNED_ICODE),loc_ip(0)
     {
     }
+    /* Icodes are built in place in their CIcodeRec, copies are counted to keep it that way */
+    ICODE(const ICODE &other);
+    ICODE &operator=(const ICODE &other);
+    static uint64_t copies() { return s_copies; }
+private:
+    static uint64_t s_copies;
 public:
     const MachineBasicBlock* getParent() const { return Parent; }
     MachineBasicBlock* getParent() { return Parent; }
@@ -613,7 +646,8 @@ class CIcodeRec : public std::list<ICODE>
 public:
     CIcodeRec();	// Constructor
 
-    ICODE *     addIcode(ICODE *pIcode);
+    ICODE &     newIcode();
+    ICODE *     addIcode(CIcodeRec &decoded);
     void        SetInBB(rCODE &rang, BB* pnewBB);
     bool        labelSrch(uint32_t target, uint32_t &pIndex);
     iterator    labelSrch(uint32_t target);
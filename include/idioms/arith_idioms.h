@@ -43,7 +43,7 @@ public:
     Idiom18(Function *f) : Idiom(f)
     {
     }
-    uint8_t minimum_match_length() {return 4;}
+    uint8_t minimum_match_length() {return 3;} // input point is the INC/DEC, preceded by the MOV
     bool match(iICODE picode);
     int action();
 };
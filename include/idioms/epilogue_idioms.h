@@ -12,6 +12,11 @@ public:
     EpilogIdiom(Function *f) : Idiom(f)
     {
     }
+    void bind(Function *f, iICODE fin)
+    {
+        Idiom::bind(f,fin);
+        m_icodes.clear();
+    }
 
 };
 struct Idiom2 : public EpilogIdiom
@@ -1,15 +1,31 @@
 #pragma once
 #include "icode.h"
 #include "Procedure.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+class QTextStream;
 struct Idiom
 {
 protected:
     Function *m_func;
     iICODE m_end;
 public:
-    Idiom(Function *f) : m_func(f),m_end(f->Icode.end())
+    Idiom(Function *f=nullptr) : m_func(f)
     {
+        if(f)
+            m_end = f->Icode.end();
     }
+    virtual ~Idiom() {}
+    /// Re-targets this idiom at another procedure, so a single instance can be reused for the whole run.
+    virtual void bind(Function *f, iICODE fin)
+    {
+        m_func = f;
+        m_end  = fin;
+    }
+    /// Number of icodes, starting at the matched one, that must exist for match() to be called
     virtual uint8_t minimum_match_length()=0;
     virtual bool match(iICODE at)=0;
     virtual int action()=0;
@@ -20,3 +36,32 @@ public:
         return 1;
     }
 };
+
+/**
+ * Opcode-indexed idiom dispatch table.
+ * Idioms are created once per run and registered under every opcode they can start with, in priority order.
+ * For each icode only the idioms registered for its opcode that fit in the remaining icodes are tried.
+ */
+class IdiomRegistry
+{
+public:
+    struct Entry
+    {
+        std::unique_ptr<Idiom> idiom;
+        const char *name;
+        uint8_t     min_length;
+        size_t      attempts=0;
+        size_t      hits=0;
+        std::chrono::steady_clock::duration time {0};
+    };
+    static IdiomRegistry &get();
+    void    bind(Function *f, iICODE fin);
+    int     match(iICODE at, size_t remaining);
+    void    writeStats(QTextStream &ostr) const;
+private:
+    IdiomRegistry();
+    void    add(Idiom *idiom, const char *name, std::initializer_list<llIcode> leaders);
+    Function *m_bound=nullptr;
+    std::vector<Entry> m_entries;
+    std::vector<uint8_t> m_by_opcode[iMOD+1];  /* indices into m_entries */
+};
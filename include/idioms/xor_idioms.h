@@ -40,7 +40,7 @@ public:
     Idiom10(Function *f) : Idiom(f)
     {
     }
-    uint8_t minimum_match_length() {return 1;}
+    uint8_t minimum_match_length() {return 2;}
     bool match(iICODE pIcode);
     int action();
 };
@@ -16,6 +16,7 @@
 #include <vector>
 #include <list>
 #include <set>
+#include <unordered_map>
 #include <algorithm>
 
 /* Type definition */
@@ -28,10 +29,10 @@ struct LLInst;
 typedef std::list<ICODE>::iterator iICODE;
 struct IDX_ARRAY : public std::vector<iICODE>
 {
-    bool inList(iICODE idx) const
-    {
-        return std::find(begin(),end(),idx)!=end();
-    }
+    bool inList(iICODE idx) const;
+    void push_back(iICODE idx);
+private:
+    std::vector<const ICODE *> m_members;   /* the same icodes, sorted, for inList() */
 };
 
 enum frameType
@@ -150,6 +151,9 @@ struct LOCAL_ID
 {
     std::vector<ID> id_arr;
 protected:
+    std::unordered_map<uint64_t,int> m_index;  /* location key => first id_arr entry at that location */
+    int     findIndexed(uint64_t key) const;
+    int     addIndexed(uint64_t key);
     int newLongIdx(int16_t seg, int16_t offH, int16_t offL, uint8_t regi, hlType t);
     int newLongGlb(int16_t seg, int16_t offH, int16_t offL, hlType t);
     int newLongStk(hlType t, int offH, int offL);
@@ -4,9 +4,27 @@
  */
 #include <stdint.h>
 #include "error.h"
+#include "libdis.h"
 
+/* Extracts reg bits from middle of mod-reg-rm uint8_t */
 #define REG(x)  ((uint8_t)(x & 0x38) >> 3)
 //#define LH(p)  ((int)((uint8_t *)(p))[0] + ((int)((uint8_t *)(p))[1] << 8))
 struct ICODE;
-/* Extracts reg bits from middle of mod-reg-rm uint8_t */
+
+/* Instruction decoder of one thread.  The libdisasm decoder is set up once and reused for every
+ * instruction scanned; the state of the instruction being decoded lives on the stack of scan(). */
+class ScanContext
+{
+    X86_Disasm  m_disasm;
+    int         disassemble(uint32_t ip, x86_insn_t &l);
+    void        fixFloatEmulation(x86_insn_t &insn);
+public:
+    ScanContext();
+    ScanContext(const ScanContext &) = delete;
+    ScanContext &operator=(const ScanContext &) = delete;
+    eErrorId    scan(uint32_t ip, ICODE &p);
+
+    static ScanContext &current();
+};
+/* Scans with the context of the calling thread */
 extern eErrorId scan(uint32_t ip, ICODE &p);
@@ -5,6 +5,7 @@
 #include "project.h"
 #include "disassem.h"
 #include "CallGraph.h"
+#include "ParallelDiscovery.h"
 
 #include <QtCore/QFileInfo>
 #include <QtCore/QDebug>
@@ -157,7 +158,8 @@ bool DccFrontend::FrontEnd ()
 
     /* Do depth first flow analysis building call graph and procedure list,
      * and attaching the I-code to each procedure          */
-    parse (*Project::get());
+    if (not parse (*Project::get()))
+        return false;
 
     if (option.asm1)
     {
@@ -353,9 +355,121 @@ bool Project::load()
     return false;
 }
 uint32_t SynthLab;
+/* Creates the procedure at entry, a root of the parse.  Sets up state, the state at program start, for it */
+static ilFunction createRootProc(Project &proj, STATE &state, uint32_t entry)
+{
+    PROG &prog(proj.prog);
+    ilFunction proc;
+    if (prog.offMain != -1 and entry == (uint32_t)prog.offMain)
+    {
+        proc = proj.createFunction(0,"main");
+        proc->retVal.loc = REG_FRAME;
+        proc->retVal.type = TYPE_WORD_SIGN;
+        proc->retVal.id.regi = rAX;
+        /* We know where main() is. Start the flow of control from there */
+        proc->procEntry = prog.offMain;
+        /* In medium and large models, the segment of main may (will?) not be
+            the same as the initial CS segment (of the startup code) */
+        state.setState(rCS, prog.segMain);
+        state.IP = prog.offMain;
+    }
+    else if (entry == state.IP)
+    {
+        proc = proj.createFunction(0,"start");
+        /* Create initial procedure at program start address */
+        proc->procEntry = (uint32_t)state.IP;
+    }
+    else
+    {
+        proc = proj.createFunction(0,"");
+        proc->procEntry = entry;
+        LibCheck(*proc);
+        if (proc->name.isEmpty())
+            proc->name = QString("proc_%1_%2").arg(entry,6,16,QChar('0')).arg(++prog.cProcs);
+        state.IP = entry;
+    }
+    /* The state info is for the first procedure */
+    proc->state = state;
+    return proc;
+}
+/* Entry points of the procedures asked for with -E.  Besides hex offsets, only main and start are known
+ * before the parse; returns false if another name is asked for */
+static bool selectedEntries(const PROG &prog, const STATE &state, std::vector<uint32_t> &entries)
+{
+    for(const QString &spec : option.EntryPoints)
+    {
+        bool is_offset;
+        uint32_t entry = spec.toUInt(&is_offset,16);
+        if (spec == "main" and prog.offMain != -1)
+            entry = prog.offMain;
+        else if (spec == "start")
+            entry = state.IP;
+        else if (not is_offset)
+            return false;
+        if (std::find(entries.begin(),entries.end(),entry) == entries.end())
+            entries.push_back(entry);
+    }
+    return true;
+}
+/* Flags the procedures asked for with -E after a whole program parse.  Returns false if none is found */
+static bool selectParsedProcs(Project &proj)
+{
+    bool found = false;
+    for(const QString &spec : option.EntryPoints)
+    {
+        bool is_offset;
+        uint32_t entry = spec.toUInt(&is_offset,16);
+        auto iter = std::find_if(proj.pProcList.begin(),proj.pProcList.end(),[&](const Function &f) {
+            return f.name == spec or (is_offset and f.procEntry == entry);
+        });
+        if (iter == proj.pProcList.end())
+        {
+            qCritical() << "dcc: no procedure" << spec;
+            continue;
+        }
+        iter->flg |= PROC_SELECTED;
+        found = true;
+    }
+    return found;
+}
+/* Parses the procedures at entries and, through the calls, their callees only.  The first one is the root of
+ * the call graph, the others are linked under it unless one of the previous ones calls them */
+static bool parseSelected(Project &proj, const STATE &start, const std::vector<uint32_t> &entries)
+{
+    for(uint32_t entry : entries)
+    {
+        ilFunction proc = proj.findByEntry(entry);
+        if (not proj.valid(proc))
+        {
+            STATE state(start);
+            proc = createRootProc(proj, state, entry);
+            if (proj.callGraph == nullptr)
+            {
+                /* The library functions of the sweep are already in the list, the root goes first */
+                proj.pProcList.splice(proj.pProcList.begin(), proj.pProcList, proc);
+                proj.callGraph = new CALL_GRAPH;
+                proj.callGraph->proc = proc;
+            }
+            else
+                proj.callGraph->insertArc(proc);
+            if (not proc->isLibrary())
+            {
+                ParallelDiscovery discovery(state.IP, option.ParseThreads);
+                proc->FollowCtrl(proj.callGraph, &state);
+            }
+        }
+        if (proc->isLibrary())
+            qWarning() << "dcc:" << proc->name << "is a library function";
+        else
+            proc->flg |= PROC_SELECTED;
+    }
+    return std::any_of(proj.pProcList.begin(),proj.pProcList.end(),[](const Function &f) {
+        return (f.flg & PROC_SELECTED) != 0;
+    });
+}
 /* Parses the program, builds the call graph, and returns the list of
- * procedures found     */
-void DccFrontend::parse(Project &proj)
+ * procedures found.  With -E, returns false if none of the procedures asked for exists */
+bool DccFrontend::parse(Project &proj)
 {
     PROG &prog(proj.prog);
     STATE state;
@@ -372,43 +486,43 @@ void DccFrontend::parse(Project &proj)
     /* Check for special settings of initial state, based on idioms of the
           startup code */
     state.checkStartup();
-    ilFunction start_proc;
-    /* Make a struct for the initial procedure */
-    if (prog.offMain != -1)
-    {
-        start_proc = proj.createFunction(0,"main");
-        start_proc->retVal.loc = REG_FRAME;
-        start_proc->retVal.type = TYPE_WORD_SIGN;
-        start_proc->retVal.id.regi = rAX;
-        /* We know where main() is. Start the flow of control from there */
-        start_proc->procEntry = prog.offMain;
-        /* In medium and large models, the segment of main may (will?) not be
-            the same as the initial CS segment (of the startup code) */
-        state.setState(rCS, prog.segMain);
-        state.IP = prog.offMain;
-    }
-    else
-    {
-        start_proc = proj.createFunction(0,"start");
-        /* Create initial procedure at program start address */
-        start_proc->procEntry = (uint32_t)state.IP;
-    }
-
-    /* The state info is for the first procedure */
-    start_proc->state = state;
-
-    /* Set up call graph initial node */
-    proj.callGraph = new CALL_GRAPH;
-    proj.callGraph->proc = start_proc;
 
     /* This proc needs to be called to set things up for LibCheck(), which
        checks a proc to see if it is a know C (etc) library */
     prog.bSigs = SetupLibCheck();
     //BUG:  proj and g_proj are 'live' at this point !
+    SweepLibCheck(state);
 
-    /* Recursively build entire procedure list */
-    start_proc->FollowCtrl(proj.callGraph, &state);
+    std::vector<uint32_t> entries;
+    bool found = true;
+    if (not option.EntryPoints.isEmpty() and selectedEntries(prog, state, entries))
+    {
+        /* Demand driven: only the procedures asked for and their callees are parsed */
+        ScopedPassTimer timer(PASS_PARSE);
+        found = parseSelected(proj, state, entries);
+    }
+    else
+    {
+        /* Make a struct for the initial procedure */
+        ilFunction start_proc = createRootProc(proj, state, (prog.offMain != -1) ? prog.offMain : state.IP);
+        /* The library functions of the sweep are already in the list, the root goes first */
+        proj.pProcList.splice(proj.pProcList.begin(), proj.pProcList, start_proc);
+
+        /* Set up call graph initial node */
+        proj.callGraph = new CALL_GRAPH;
+        proj.callGraph->proc = start_proc;
+
+        /* Recursively build entire procedure list */
+        {
+            ScopedPassTimer timer(PASS_PARSE);
+            ParallelDiscovery discovery(state.IP, option.ParseThreads);
+            start_proc->FollowCtrl(proj.callGraph, &state);
+        }
+        if (not option.EntryPoints.isEmpty())
+            found = selectParsedProcs(proj);
+    }
 
     /* This proc needs to be called to clean things up from SetupLibCheck() */
     CleanupLibCheck();
+    return found;
 }
@@ -0,0 +1,67 @@
+/*****************************************************************************
+ *          dcc project expression node allocation
+ ****************************************************************************/
+#include "ExprArena.h"
+
+#include "ast.h"
+
+#include <QtCore/QString>
+#include <QtCore/QTextStream>
+
+namespace
+{
+const size_t CHUNK_SIZE = 16*1024;
+const size_t NODE_ALIGN = alignof(std::max_align_t);
+}
+ExprArena *         ExprArena::s_current = nullptr;
+ExprArena::Stats    ExprArena::s_stats;
+
+/* Returns the arena nodes are currently allocated from; outside of any procedure it is a process-wide one */
+ExprArena &ExprArena::current()
+{
+    static ExprArena global_arena;
+    if(s_current)
+        return *s_current;
+    return global_arena;
+}
+void *ExprArena::allocate(size_t sz)
+{
+    sz = (sz + NODE_ALIGN - 1) & ~(NODE_ALIGN - 1);
+    if(sz > m_left)
+    {
+        size_t chunk_size = std::max(sz,CHUNK_SIZE);
+        m_chunks.emplace_back(new char[chunk_size]);
+        m_top = m_chunks.back().get();
+        m_left = chunk_size;
+        s_stats.chunks++;
+    }
+    void *res = m_top;
+    m_top += sz;
+    m_left -= sz;
+    s_stats.nodes++;
+    s_stats.bytes += sz;
+    return res;
+}
+/* Returns the single constant node of this arena with the given value and size */
+Constant *ExprArena::constant(uint32_t value, uint8_t size)
+{
+    uint64_t key = (uint64_t(size)<<32) | value;
+    auto iter = m_constants.find(key);
+    if(iter!=m_constants.end())
+    {
+        s_stats.interned_hits++;
+        return iter->second;
+    }
+    Constant *res = new (allocate(sizeof(Constant))) Constant(value,size);
+    m_constants[key] = res;
+    return res;
+}
+void ExprArena::writeStats(QTextStream &ostr)
+{
+    ostr << QString("\nExpression nodes: %1 allocated (%2 KiB in %3 chunks), %4 copies avoided by sharing, %5 constants reused\n")
+            .arg(s_stats.nodes)
+            .arg(s_stats.bytes/1024)
+            .arg(s_stats.chunks)
+            .arg(s_stats.shared_clones)
+            .arg(s_stats.interned_hits);
+}
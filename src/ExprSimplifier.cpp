@@ -0,0 +1,315 @@
+/*****************************************************************************
+ *          dcc project high-level expression simplification
+ ****************************************************************************/
+#include "ExprSimplifier.h"
+
+#include "ast.h"
+#include "StackFrame.h"
+
+#include <QtCore/QString>
+#include <QtCore/QTextStream>
+#include <algorithm>
+
+ExprSimplifier::Stats ExprSimplifier::s_stats;
+
+namespace
+{
+uint32_t sizeMask(int size)
+{
+    return (size >= 4) ? 0xFFFFFFFFu : ((1u << (8*size)) - 1);
+}
+bool isNegative(uint32_t v, int size)
+{
+    return (size >= 4) ? (v & 0x80000000u) : (v & (1u << (8*size-1)));
+}
+Constant *asConstant(Expr *e)
+{
+    if(e == nullptr or e->m_type != IDENTIFIER)
+        return nullptr;
+    AstIdent *id = static_cast<AstIdent *>(e);
+    return (id->ident.type() == CONSTANT) ? static_cast<Constant *>(id) : nullptr;
+}
+bool isConstant(Expr *e, uint32_t v)
+{
+    Constant *c = asConstant(e);
+    return c and (c->kte.kte == v);
+}
+bool isComparison(condOp op)
+{
+    return op >= LESS_EQUAL and op <= GREATER_EQUAL;
+}
+/* True if the value of e is always 0 or 1 */
+bool isTruthValue(Expr *e)
+{
+    if(e->m_type == NEGATION)
+        return true;
+    if(e->m_type != BOOLEAN_OP)
+        return false;
+    condOp op = static_cast<BinaryOperator *>(e)->op();
+    return isComparison(op) or op == DBL_AND or op == DBL_OR;
+}
+BinaryOperator *invertedComparison(BinaryOperator *b)
+{
+    static const condOp invCondOp[] = {GREATER, GREATER_EQUAL, NOT_EQUAL, EQUAL, LESS_EQUAL, LESS};
+    return BinaryOperator::Create(invCondOp[b->op()], b->lhs(), b->rhs());
+}
+}
+
+/* Returns the simplified form of e, which may be e itself rewritten in place, one of its subtrees or a constant.
+ * as_condition is set when only the truth value of e is used. */
+Expr *ExprSimplifier::simplify(Expr *e, bool as_condition)
+{
+    if(e == nullptr)
+        return nullptr;
+    s_stats.visited++;
+    switch(e->m_type)
+    {
+        case BOOLEAN_OP:
+            return simplifyBinary(static_cast<BinaryOperator *>(e), as_condition);
+        case NEGATION:
+        case ADDRESSOF:
+        case DEREFERENCE:
+            return simplifyUnary(static_cast<UnaryOperator *>(e), as_condition);
+        case IDENTIFIER:
+            if(static_cast<AstIdent *>(e)->ident.type() == FUNCTION)
+                simplifyArgs(static_cast<FuncNode *>(e)->call.args);
+            return e;
+        default:    /* increments, whose operand is a variable */
+            return e;
+    }
+}
+/* Simplifies the actual arguments of a call */
+void ExprSimplifier::simplifyArgs(STKFRAME *args)
+{
+    if(args == nullptr)
+        return;
+    for(STKSYM &arg : *args)
+        arg.actual = simplify(arg.actual);
+}
+Expr *ExprSimplifier::simplifyUnary(UnaryOperator *u, bool as_condition)
+{
+    Expr *sub = simplify(u->unaryExp, u->m_type == NEGATION);
+    if(sub != u->unaryExp)
+    {
+        u->unaryExp = sub;
+        u->attributesChanged();
+    }
+    if(u->m_type != NEGATION)
+        return u;
+    if(Constant *c = asConstant(sub))
+    {
+        s_stats.folded++;
+        m_rewrites++;
+        return Constant::Create(c->kte.kte == 0, c->kte.size);
+    }
+    /* !!x is x for a condition, and also as a value when x is 0 or 1 */
+    if(sub->m_type == NEGATION)
+    {
+        Expr *inner = static_cast<UnaryOperator *>(sub)->unaryExp;
+        if(as_condition or isTruthValue(inner))
+        {
+            s_stats.conditions++;
+            m_rewrites++;
+            return inner;
+        }
+    }
+    /* !(a < b) => a >= b */
+    if(sub->m_type == BOOLEAN_OP and isComparison(static_cast<BinaryOperator *>(sub)->op()))
+    {
+        s_stats.conditions++;
+        m_rewrites++;
+        return invertedComparison(static_cast<BinaryOperator *>(sub));
+    }
+    return u;
+}
+/* Evaluates b when both of its operands are constants, returns nullptr when it cannot (or should not) */
+Expr *ExprSimplifier::fold(BinaryOperator *b)
+{
+    Constant *r = asConstant(b->rhs());
+    if(r == nullptr)
+        return nullptr;
+    if(b->op() == NOT)
+        return Constant::Create(~r->kte.kte & sizeMask(r->kte.size), r->kte.size);
+    Constant *l = asConstant(b->lhs());
+    if(l == nullptr)
+        return nullptr;
+    int size = std::max(l->kte.size, r->kte.size);
+    uint32_t mask = sizeMask(size);
+    uint32_t a = l->kte.kte & mask;
+    uint32_t c = r->kte.kte & mask;
+    uint32_t res;
+    switch(b->op())
+    {
+        case ADD:   res = a + c; break;
+        case SUB:   res = a - c; break;
+        case MUL:   res = a * c; break;
+        case AND:   res = a & c; break;
+        case OR:    res = a | c; break;
+        case XOR:   res = a ^ c; break;
+        case DBL_AND:   res = (a and c); break;
+        case DBL_OR:    res = (a or c); break;
+        case SHL:
+            if(c >= 8u*size)
+                return nullptr;
+            res = a << c;
+            break;
+        /* The signedness of the operands is not known: leave those that depend on it alone */
+        case SHR:
+            if(c >= 8u*size or isNegative(a,size))
+                return nullptr;
+            res = a >> c;
+            break;
+        case DIV:
+        case MOD:
+            if(c == 0 or isNegative(a,size) or isNegative(c,size))
+                return nullptr;
+            res = (b->op() == DIV) ? a / c : a % c;
+            break;
+        default:    /* comparisons */
+            return nullptr;
+    }
+    return Constant::Create(res & mask, size);
+}
+Expr *ExprSimplifier::simplifyBinary(BinaryOperator *b, bool as_condition)
+{
+    bool logical = (b->op() == DBL_AND) or (b->op() == DBL_OR);
+    if(b->op() != NOT)
+    {
+        Expr *l = simplify(b->m_lhs, logical);
+        if(l != b->m_lhs)
+        {
+            b->m_lhs = l;
+            b->attributesChanged();
+        }
+    }
+    Expr *r = simplify(b->m_rhs, logical);
+    if(r != b->m_rhs)
+    {
+        b->m_rhs = r;
+        b->attributesChanged();
+    }
+    if(Expr *k = fold(b))
+    {
+        s_stats.folded++;
+        m_rewrites++;
+        return k;
+    }
+    condOp op = b->op();
+    if(op == NOT)
+    {
+        /* ~~x => x */
+        Expr *sub = b->rhs();
+        if(sub->m_type == BOOLEAN_OP and static_cast<BinaryOperator *>(sub)->op() == NOT)
+        {
+            s_stats.identities++;
+            m_rewrites++;
+            return static_cast<BinaryOperator *>(sub)->rhs();
+        }
+        return b;
+    }
+    Expr *lhs = b->lhs();
+    Expr *rhs = b->rhs();
+    /* Identity operations */
+    switch(op)
+    {
+        case ADD: case OR: case XOR:
+            if(isConstant(lhs,0))
+            {
+                s_stats.identities++;
+                m_rewrites++;
+                return rhs;
+            }
+            /* fall through */
+        case SUB: case SHL: case SHR:
+            if(isConstant(rhs,0))
+            {
+                s_stats.identities++;
+                m_rewrites++;
+                return lhs;
+            }
+            break;
+        case MUL:
+            if(isConstant(lhs,1))
+            {
+                s_stats.identities++;
+                m_rewrites++;
+                return rhs;
+            }
+            /* fall through */
+        case DIV:
+            if(isConstant(rhs,1))
+            {
+                s_stats.identities++;
+                m_rewrites++;
+                return lhs;
+            }
+            break;
+        default:
+            break;
+    }
+    /* x << k => x * 2^k, merged with a multiplication by a constant already applied to x */
+    Constant *k = asConstant(rhs);
+    if(op == SHL and k and k->kte.kte < 15)
+    {
+        b->op(MUL);
+        b->m_rhs = Constant::Create(1u << k->kte.kte, 2);
+        b->attributesChanged();
+        s_stats.shifts++;
+        m_rewrites++;
+        op = MUL;
+        k = static_cast<Constant *>(b->m_rhs);
+    }
+    /* (x + c1) + c2 => x + (c1+c2), (x - c1) - c2 => x - (c1+c2), (x * c1) * c2 => x * (c1*c2).
+     * The inner node may be shared, so only this one is rewritten. */
+    if(k and (op == ADD or op == SUB or op == MUL) and lhs->m_type == BOOLEAN_OP)
+    {
+        BinaryOperator *inner = static_cast<BinaryOperator *>(lhs);
+        Constant *k1 = asConstant(inner->m_rhs);
+        if(k1 and inner->op() == op)
+        {
+            uint64_t merged = (op == MUL) ? uint64_t(k1->kte.kte) * k->kte.kte : uint64_t(k1->kte.kte) + k->kte.kte;
+            int size = std::max(k1->kte.size, k->kte.size);
+            if(merged <= (sizeMask(size) >> 1))
+            {
+                b->m_lhs = inner->m_lhs;
+                b->m_rhs = Constant::Create(uint32_t(merged), size);
+                b->attributesChanged();
+                s_stats.reassociated++;
+                m_rewrites++;
+            }
+        }
+    }
+    if(not as_condition)
+        return b;
+    /* Truth value normalisation: (a < b) != 0 => a < b, (a < b) == 0 => a >= b, 1 && x => x, 0 || x => x */
+    if((op == NOT_EQUAL or op == EQUAL) and isConstant(rhs,0) and isTruthValue(lhs))
+    {
+        s_stats.conditions++;
+        m_rewrites++;
+        if(op == NOT_EQUAL)
+            return lhs;
+        if(lhs->m_type == NEGATION)
+            return static_cast<UnaryOperator *>(lhs)->unaryExp;
+        if(isComparison(static_cast<BinaryOperator *>(lhs)->op()))
+            return invertedComparison(static_cast<BinaryOperator *>(lhs));
+        return UnaryOperator::Create(NEGATION, lhs);
+    }
+    if((op == DBL_AND and isConstant(lhs,1)) or (op == DBL_OR and isConstant(lhs,0)))
+    {
+        s_stats.conditions++;
+        m_rewrites++;
+        return rhs;
+    }
+    return b;
+}
+void ExprSimplifier::writeStats(QTextStream &ostr)
+{
+    ostr << QString("\nExpression simplification: %1 nodes visited, %2 folded, %3 identities, %4 reassociated, "
+                    "%5 shifts to multiplications, %6 conditions normalised\n")
+            .arg(s_stats.visited)
+            .arg(s_stats.folded)
+            .arg(s_stats.identities)
+            .arg(s_stats.reassociated)
+            .arg(s_stats.shifts)
+            .arg(s_stats.conditions);
+}
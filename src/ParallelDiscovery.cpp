@@ -0,0 +1,199 @@
+/*****************************************************************************
+ *          dcc project concurrent discovery of reachable code
+ ****************************************************************************/
+#include "ParallelDiscovery.h"
+
+#include "dcc.h"
+#include "project.h"
+#include "scanner.h"
+
+#include <QtCore/QString>
+#include <QtCore/QTextStream>
+
+ParallelDiscovery *         ParallelDiscovery::s_active = nullptr;
+ParallelDiscovery::Stats    ParallelDiscovery::s_stats;
+
+ParallelDiscovery::ParallelDiscovery(uint32_t entry, int threads) : m_stop(false), m_procedures(0), m_decoded(0)
+{
+    if(threads < 2 or s_active)
+        return;
+    s_active = this;
+    /* The disassembler options are global to libdisasm and set by each scanner context created: all the
+     * contexts are created, one at a time, before any worker or the parse goes on */
+    ScanContext::current();
+    m_pending = 1;
+    m_frontier.push_back(entry);
+    for(int i=0; i<threads; ++i)
+        m_workers.emplace_back([this,threads]() {
+            {
+                std::unique_lock<std::mutex> guard(m_frontier_lock);
+                ScanContext::current();
+                m_started++;
+                m_frontier_cv.notify_all();
+                m_frontier_cv.wait(guard, [this,threads]() { return m_started == threads; });
+            }
+            worker();
+        });
+    std::unique_lock<std::mutex> guard(m_frontier_lock);
+    m_frontier_cv.wait(guard, [this,threads]() { return m_started == threads; });
+}
+ParallelDiscovery::~ParallelDiscovery()
+{
+    if(s_active != this)
+        return;
+    {
+        std::lock_guard<std::mutex> guard(m_frontier_lock);
+        m_stop = true;
+    }
+    m_frontier_cv.notify_all();
+    for(std::thread &t : m_workers)
+        t.join();
+    s_active = nullptr;
+    s_stats.procedures += m_procedures;
+    s_stats.decoded += m_decoded;
+}
+/* Returns false if ip was already claimed, by a worker or by the parse */
+bool ParallelDiscovery::claim(uint32_t ip)
+{
+    Shard &sh(shard(ip));
+    std::lock_guard<std::mutex> guard(sh.lock);
+    return sh.by_address.emplace(ip,Decoded()).second;
+}
+/* Publishes the icode decoded at ip, the only one in node */
+void ParallelDiscovery::store(uint32_t ip, CIcodeRec &node, eErrorId err)
+{
+    Shard &sh(shard(ip));
+    std::lock_guard<std::mutex> guard(sh.lock);
+    Decoded &d(sh.by_address[ip]);
+    if(d.taken)     /* the parse did not wait for it */
+        return;
+    sh.icodes.splice(sh.icodes.end(),node);
+    d.icode = --sh.icodes.end();
+    d.err = err;
+    d.ready = true;
+}
+/* Moves the icode decoded at ip to the end of decoded.  Returns false if none is ready, in which case
+ * ip is claimed so that no worker decodes it afterwards */
+bool ParallelDiscovery::take(uint32_t ip, CIcodeRec &decoded, eErrorId &err)
+{
+    Shard &sh(shard(ip));
+    std::lock_guard<std::mutex> guard(sh.lock);
+    Decoded &d(sh.by_address[ip]);
+    if(d.taken or not d.ready)
+    {
+        d.taken = true;
+        return false;
+    }
+    d.taken = true;
+    decoded.splice(decoded.end(),sh.icodes,d.icode);
+    err = d.err;
+    return true;
+}
+void ParallelDiscovery::push(uint32_t entry)
+{
+    {
+        std::lock_guard<std::mutex> guard(m_frontier_lock);
+        m_frontier.push_back(entry);
+        m_pending++;
+    }
+    m_frontier_cv.notify_one();
+}
+void ParallelDiscovery::worker()
+{
+    for(;;)
+    {
+        uint32_t entry;
+        {
+            std::unique_lock<std::mutex> guard(m_frontier_lock);
+            m_frontier_cv.wait(guard, [this]() { return m_stop or not m_frontier.empty() or m_pending == 0; });
+            if(m_stop or m_frontier.empty())
+                return;
+            entry = m_frontier.front();
+            m_frontier.pop_front();
+        }
+        m_procedures++;
+        discover(entry);
+        bool finished;
+        {
+            std::lock_guard<std::mutex> guard(m_frontier_lock);
+            finished = (--m_pending == 0);
+        }
+        if(finished)
+            m_frontier_cv.notify_all();
+    }
+}
+/* Decodes the code reachable from entry without going through calls, whose targets go on the frontier */
+void ParallelDiscovery::discover(uint32_t entry)
+{
+    std::vector<uint32_t> paths {entry};
+    ScanContext &context(ScanContext::current());
+    while(not paths.empty() and not m_stop)
+    {
+        uint32_t ip = paths.back();
+        paths.pop_back();
+        bool more = true;
+        while(more and not m_stop and claim(ip))
+        {
+            CIcodeRec node;
+            eErrorId err = context.scan(ip,node.newIcode());
+            const LLInst &ll(*node.back().ll());
+            llIcode opcode = ll.getOpcode();
+            bool direct = ll.testFlags(I);
+            uint32_t target = direct ? ll.src().getImm2() : 0;
+            uint32_t next = ip + ll.numBytes;
+            store(ip,node,err);
+            m_decoded++;
+            if(err)
+                break;
+            switch(opcode)
+            {
+                case iLOOP: case iLOOPE:    case iLOOPNE:
+                case iJB:   case iJBE:      case iJAE:  case iJA:
+                case iJL:   case iJLE:      case iJGE:  case iJG:
+                case iJE:   case iJNE:      case iJS:   case iJNS:
+                case iJO:   case iJNO:      case iJP:   case iJNP:
+                case iJCXZ:
+                    if(direct)
+                        paths.push_back(target);
+                    ip = next;
+                    break;
+                case iJMP:  case iJMPF:
+                    more = direct;
+                    ip = target;
+                    break;
+                case iCALL: case iCALLF:
+                    if(direct)
+                        push(target);
+                    ip = next;
+                    break;
+                case iRET:  case iRETF:     case iIRET:
+                    more = false;
+                    break;
+                default:
+                    ip = next;
+                    break;
+            }
+        }
+    }
+}
+/* Used by FollowCtrl in place of scan() */
+eErrorId ParallelDiscovery::scan(uint32_t ip, CIcodeRec &decoded)
+{
+    eErrorId err;
+    if(s_active and s_active->take(ip,decoded,err))
+    {
+        s_stats.taken++;
+        return err;
+    }
+    s_stats.scanned++;
+    return ::scan(ip,decoded.newIcode());
+}
+void ParallelDiscovery::writeStats(QTextStream &ostr)
+{
+    ostr << QString("\nParallel discovery: %1 procedure entries, %2 instructions decoded ahead, "
+                    "%3 used by the parse, %4 decoded by the parse\n")
+            .arg(s_stats.procedures)
+            .arg(s_stats.decoded)
+            .arg(s_stats.taken)
+            .arg(s_stats.scanned);
+}
@@ -0,0 +1,150 @@
+/*****************************************************************************
+ *          dcc project pass timing and counters
+ ****************************************************************************/
+#include "PassStats.h"
+
+#include "dcc.h"
+#include "project.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+
+using namespace std::chrono;
+
+bool        Instrumentation::s_enabled = false;
+PassStats   Instrumentation::s_total;
+ScopedPassTimer *ScopedPassTimer::s_current = nullptr;
+
+static const char *passNames[PASS_COUNT] = {
+    "load", "parse", "libcheck", "createCFG", "compressCFG", "findIdioms", "propLong", "highLevelGen",
+    "dataFlow", "simplify", "structure", "codeGen"
+};
+static const char *counterNames[CNT_COUNT] = {
+    "ll_icodes", "hl_icodes", "basic_blocks", "idioms", "liveness_visits", "simplified"
+};
+
+const char *PassStats::passName(ePass p)
+{
+    return passNames[p];
+}
+const char *PassStats::counterName(eCounter c)
+{
+    return counterNames[c];
+}
+PassStats::duration PassStats::totalTime() const
+{
+    duration res = duration::zero();
+    for(int i=0; i<PASS_COUNT; ++i)
+        res += time[i];
+    return res;
+}
+
+void Instrumentation::record(Function *f, ePass pass, PassStats::duration d)
+{
+    s_total.time[pass] += d;
+    s_total.calls[pass]++;
+    if(f)
+    {
+        f->m_pass_stats.time[pass] += d;
+        f->m_pass_stats.calls[pass]++;
+    }
+}
+void Instrumentation::countEnabled(Function *f, eCounter c, uint64_t v)
+{
+    s_total.counters[c] += v;
+    if(f)
+        f->m_pass_stats.counters[c] += v;
+}
+static double toMs(PassStats::duration d)
+{
+    return duration_cast<microseconds>(d).count() / 1000.0;
+}
+/* Writes the per-binary pass table, followed by one line per procedure */
+void Instrumentation::writeReport(QTextStream &ostr, const std::list<Function> &funcs)
+{
+    double total_ms = toMs(s_total.totalTime());
+    ostr << "\nPass statistics (exclusive times)\n";
+    for(int i=0; i<PASS_COUNT; ++i)
+    {
+        if(s_total.calls[i]==0)
+            continue;
+        double ms = toMs(s_total.time[i]);
+        ostr << QString("  %1 %2 calls %3 ms %4%\n")
+                .arg(QString(passNames[i])+":",-14)
+                .arg(s_total.calls[i],6)
+                .arg(ms,9,'f',3)
+                .arg(total_ms>0 ? ms*100.0/total_ms : 0.0,6,'f',2);
+    }
+    ostr << QString("  %1 %2 ms\n").arg("total:",-14).arg(total_ms,22,'f',3);
+    uint64_t ll_icodes = s_total.counters[CNT_LL_ICODES];
+    uint64_t hl_icodes = s_total.counters[CNT_HL_ICODES];
+    ostr << QString("\nIcode storage: %1 icodes of %2 bytes, %3 high-level parts of %4 bytes (%5 KiB)\n")
+            .arg(ll_icodes).arg(sizeof(ICODE))
+            .arg(hl_icodes).arg(sizeof(HLTYPE))
+            .arg((ll_icodes*sizeof(ICODE) + hl_icodes*sizeof(HLTYPE))/1024);
+    ostr << "\nProcedure statistics (ll icodes / hl icodes / bbs / idioms / liveness visits / ms)\n";
+    for(const Function &f : funcs)
+    {
+        if(f.isLibrary())
+            continue;
+        const PassStats &ps(f.m_pass_stats);
+        ostr << QString("  %1 %2 / %3 / %4 / %5 / %6 / %7\n")
+                .arg(f.name+":",-20)
+                .arg(ps.counters[CNT_LL_ICODES],6).arg(ps.counters[CNT_HL_ICODES],6)
+                .arg(ps.counters[CNT_BBS],5).arg(ps.counters[CNT_IDIOMS],5)
+                .arg(ps.counters[CNT_LIVENESS_VISITS],5)
+                .arg(toMs(ps.totalTime()),9,'f',3);
+    }
+}
+
+static QString jsonString(const QString &s)
+{
+    QString res("\"");
+    for(QChar c : s)
+    {
+        if(c=='"' or c=='\\')
+            res += '\\';
+        res += c;
+    }
+    return res+"\"";
+}
+static void writeJsonStats(QTextStream &ostr, const PassStats &ps)
+{
+    ostr << "\"passes\": {";
+    const char *sep="";
+    for(int i=0; i<PASS_COUNT; ++i)
+    {
+        if(ps.calls[i]==0)
+            continue;
+        ostr << sep << "\"" << passNames[i] << "\": {\"calls\": " << ps.calls[i]
+             << ", \"us\": " << qlonglong(duration_cast<microseconds>(ps.time[i]).count()) << "}";
+        sep=", ";
+    }
+    ostr << "}, \"counters\": {";
+    for(int i=0; i<CNT_COUNT; ++i)
+        ostr << (i ? ", " : "") << "\"" << counterNames[i] << "\": " << qulonglong(ps.counters[i]);
+    ostr << "}";
+}
+/* Writes all collected statistics into a JSON document at path */
+bool Instrumentation::writeJson(const QString &path, const std::list<Function> &funcs)
+{
+    QFile fs(path);
+    if(not fs.open(QFile::WriteOnly|QFile::Text))
+        return false;
+    QTextStream ostr(&fs);
+    ostr << "{\n  \"binary\": " << jsonString(option.filename) << ",\n  \"total\": {";
+    writeJsonStats(ostr,s_total);
+    ostr << "},\n  \"functions\": [";
+    const char *sep="\n";
+    for(const Function &f : funcs)
+    {
+        ostr << sep << "    {\"name\": " << jsonString(f.name) << ", \"entry\": " << f.procEntry
+             << ", \"library\": " << (f.isLibrary() ? "true" : "false") << ", ";
+        writeJsonStats(ostr,f.m_pass_stats);
+        ostr << "}";
+        sep=",\n";
+    }
+    ostr << "\n  ]\n}\n";
+    ostr.flush();
+    return true;
+}
@@ -0,0 +1,102 @@
+/*****************************************************************************
+ *          dcc project multiple wildcard pattern search
+ ****************************************************************************/
+#include "PatternScanner.h"
+
+#include <cassert>
+#include <deque>
+
+int PatternScanner::add(const uint8_t *pattern, int len)
+{
+    Pattern p {pattern, len, 0, 0};
+    for(int i=0; i<len; )
+    {
+        if(pattern[i] == WILD)
+        {
+            ++i;
+            continue;
+        }
+        int run = i;
+        while(i<len and pattern[i] != WILD)
+            ++i;
+        if(i-run > p.anchor_len)
+        {
+            p.anchor = run;
+            p.anchor_len = i-run;
+        }
+    }
+    assert(p.anchor_len > 0);
+    m_patterns.push_back(p);
+    return m_patterns.size()-1;
+}
+/* Builds the automaton of the anchors, with the failure transitions folded into m_next */
+void PatternScanner::compile()
+{
+    std::vector<std::vector<int>> out(1);
+    m_next.assign(256,-1);
+    for(size_t id=0; id<m_patterns.size(); ++id)
+    {
+        const Pattern &p(m_patterns[id]);
+        int32_t state = 0;
+        for(int j=p.anchor; j<p.anchor+p.anchor_len; ++j)
+        {
+            int32_t &next(m_next[state*256 + p.bytes[j]]);
+            if(next < 0)
+            {
+                next = out.size();
+                out.emplace_back();
+                m_next.resize(m_next.size()+256,-1);
+            }
+            state = m_next[state*256 + p.bytes[j]];
+        }
+        out[state].push_back(id);
+    }
+    std::vector<int32_t> fail(out.size(),0);
+    std::deque<int32_t> queue;
+    for(int c=0; c<256; ++c)
+    {
+        int32_t &next(m_next[c]);
+        if(next < 0)
+            next = 0;
+        else
+            queue.push_back(next);
+    }
+    while(not queue.empty())
+    {
+        int32_t state = queue.front();
+        queue.pop_front();
+        for(int c=0; c<256; ++c)
+        {
+            int32_t next = m_next[state*256 + c];
+            int32_t on_fail = m_next[fail[state]*256 + c];
+            if(next < 0)
+            {
+                m_next[state*256 + c] = on_fail;
+                continue;
+            }
+            fail[next] = on_fail;
+            out[next].insert(out[next].end(),out[on_fail].begin(),out[on_fail].end());
+            queue.push_back(next);
+        }
+    }
+    m_first_out.assign(1,0);
+    m_out.clear();
+    for(const std::vector<int> &o : out)
+    {
+        m_out.insert(m_out.end(),o.begin(),o.end());
+        m_first_out.push_back(m_out.size());
+    }
+}
+void PatternScanner::firstMatches(const uint8_t *source, int from, int to, std::vector<int> &first) const
+{
+    first.assign(m_patterns.size(),-1);
+    size_t left = m_patterns.size();
+    scan(source,from,to,[&first,&left](int id, int start) {
+        if(first[id] < 0)
+        {
+            first[id] = start;
+            --left;
+        }
+        return left != 0;
+    });
+}
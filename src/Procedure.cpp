@@ -23,9 +23,9 @@ void JumpTable::pruneEntries(uint16_t cs)
         else if (target >= (uint32_t)prg->cbImage)
             finish = i;
     }
-    ICODE _Icode; // used as scan input
     for (uint32_t i = start; i < finish; i += 2)
     {
+        ICODE _Icode; // used as scan input
         uint32_t target = cs + LH(&prg->image()[i]);
         /* Be wary of 00 00 as code - it's probably data */
         if (not (prg->image()[target] or prg->image()[target+1]) or scan(target, _Icode))
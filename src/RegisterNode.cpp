@@ -56,11 +56,11 @@ RegisterNode::RegisterNode(const LLOperand &op, LOCAL_ID *locsym)
 //    regiType = reg_type;
 //}
 
-QString RegisterNode::walkCondExpr(Function *pProc, int *numLoc) const
+/* Appends the name of the register variable to out, declaring it first if it had none */
+void RegisterNode::writeName(QString &out, Function *pProc, int *numLoc) const
 {
     QString codeOut;
 
-    QString o;
     assert(&pProc->localId==m_syms);
     ID *id = &pProc->localId.id_arr[regiIdx];
     if (id->name[0] == '\0')	/* no name */
@@ -70,28 +70,11 @@ QString RegisterNode::walkCondExpr(Function *pProc, int *numLoc) const
         codeOut += QString("/* %1 */\n").arg(Machine_X86::regName(id->id.regi));
     }
     if (id->hasMacro)
-        o += QString("%1(%2)").arg(id->macro).arg(id->name);
+        out += QString("%1(%2)").arg(id->macro).arg(id->name);
     else
-        o += id->name;
+        out += id->name;
 
     cCode.appendDecl(codeOut);
-    return o;
-}
-
-int RegisterNode::hlTypeSize(Function *) const
-{
-    if (regiType == BYTE_REG)
-        return 1;
-    else
-        return 2;
-}
-
-hlType RegisterNode::expType(Function *pproc) const
-{
-    if (regiType == BYTE_REG)
-        return TYPE_BYTE_SIGN;
-    else
-        return TYPE_WORD_SIGN;
 }
 
 Expr *RegisterNode::insertSubTreeReg(Expr *_expr, eReg regi, const LOCAL_ID *locsym)
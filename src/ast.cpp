@@ -20,6 +20,7 @@
 #include <boost/assign.hpp>
 #include <stdint.h>
 #include <string>
+#include <vector>
 #include <sstream>
 #include <iostream>
 #include <cassert>
@@ -137,13 +138,6 @@ GlobalVariable::GlobalVariable(int16_t segValue, int16_t off)
     globIdx = i;
 }
 
-QString GlobalVariable::walkCondExpr(Function *, int *) const
-{
-    if(valid)
-        return Project::get()->symbolName(globIdx);
-    return "INVALID GlobalVariable";
-}
-
 /* Returns an identifier conditional expression node of type LOCAL_VAR */
 AstIdent *AstIdent::Loc(int off, LOCAL_ID *localId)
 {
@@ -195,13 +189,6 @@ GlobalVariableIdx::GlobalVariableIdx (int16_t segValue, int16_t off, uint8_t reg
         printf ("Error, indexed-glob var not found in local id table\n");
     idxGlbIdx = i;
 }
-QString GlobalVariableIdx::walkCondExpr(Function *pProc, int *) const
-{
-    auto bwGlb = &pProc->localId.id_arr[idxGlbIdx].id.bwGlb;
-    return QString("%1[%2]").arg((bwGlb->seg << 4) + bwGlb->off).arg(Machine_X86::regName(bwGlb->regi));
-}
-
-
 /* Returns an identifier conditional expression node of type LONG_VAR,
  * that points to the given index idx.  */
 AstIdent *AstIdent::LongIdx (int idx)
@@ -233,7 +220,7 @@ AstIdent *AstIdent::Long(LOCAL_ID *localId, opLoc sd, iICODE pIcode, hlFirst f,
             value = (pIcode->ll()->src().getImm2() << 16) + atOffset.src().getImm2();
         else/* LOW_FIRST */
             value = (atOffset.src().getImm2() << 16)+ pIcode->ll()->src().getImm2();
-        newExp = new Constant(value,4);
+        newExp = Constant::Create(value,4);
     }
     /* Save it as a long expression (reg, stack or glob) */
     else
@@ -318,7 +305,7 @@ Expr *AstIdent::id(const LLInst &ll_insn, opLoc sd, Function * pProc, iICODE ix_
     }
     
     else if ((sd == SRC) and ll_insn.testFlags(I)) /* constant */
-        newExp = new Constant(ll_insn.src().getImm2(), 2);
+        newExp = Constant::Create(ll_insn.src().getImm2(), 2);
     else if (pm.regi == rUNDEF) /* global variable */
         newExp = new GlobalVariable(pm.segValue, pm.off);
     else if ( pm.isReg() )      /* register */
@@ -399,39 +386,23 @@ condId LLInst::idType(opLoc sd) const
 
 
 
-int Expr::hlTypeSize(Function * pproc) const
-{
-    if (this == nullptr)
-        return 2;		/* for TYPE_UNKNOWN */
-    fprintf(stderr,"hlTypeSize queried for Unkown type %d \n",m_type);
-    return 2;			// CC: is this correct?
-}
-
-/* Returns the type of the expression */
-int BinaryOperator::hlTypeSize(Function * pproc) const
-{
-    return std::max(lhs()->hlTypeSize (pproc),rhs()->hlTypeSize (pproc));
-}
-int UnaryOperator::hlTypeSize(Function *pproc) const
-{
-    return (unaryExp->hlTypeSize (pproc));
-}
-int GlobalVariable::hlTypeSize(Function *pproc) const
-{
-    return (Project::get()->symbolSize(globIdx));
-}
-int GlobalVariableIdx::hlTypeSize(Function *pproc) const
-{
-    return (hlSize[pproc->localId.id_arr[idxGlbIdx].type]);
-}
+uint32_t Expr::s_attr_generation = 1;
 
-int AstIdent::hlTypeSize(Function *pproc) const
+/* Size of the identifier, in bytes */
+int AstIdent::identSize(Function *pproc) const
 {
     switch (ident.idType)
     {
         case GLOB_VAR:
-            assert(false);
-            return 1;
+            return (Project::get()->symbolSize(static_cast<const GlobalVariable *>(this)->globIdx));
+        case GLOB_VAR_IDX:
+            return (hlSize[pproc->localId.id_arr[static_cast<const GlobalVariableIdx *>(this)->idxGlbIdx].type]);
+        case CONSTANT:
+            return static_cast<const Constant *>(this)->kte.size;
+        case FUNCTION:
+            return hlSize[static_cast<const FuncNode *>(this)->call.proc->retVal.type];
+        case REGISTER:
+            return (static_cast<const RegisterNode *>(this)->regiType == BYTE_REG) ? 1 : 2;
         case LOCAL_VAR:
             return (hlSize[pproc->localId.id_arr[ident.idNode.localIdx].type]);
         case PARAM:
@@ -447,43 +418,22 @@ int AstIdent::hlTypeSize(Function *pproc) const
             return -1;
     } /* eos */
 }
-hlType BinaryOperator::expType(Function *pproc) const
-{
-    hlType first = lhs()->expType ( pproc );
-    hlType second = rhs()->expType ( pproc );
-    if (first != second)
-    {
-        if (lhs()->hlTypeSize(pproc) > rhs()->hlTypeSize (pproc))
-            return (first);
-        else
-            return (second);
-    }
-    else
-        return (first);
-}
-hlType UnaryOperator::expType(Function *pproc) const
-{
-    return unaryExp->expType (pproc);
-}
-hlType GlobalVariable::expType(Function *pproc) const
-{
-    return Project::get()->symbolType(globIdx);
-}
-hlType GlobalVariableIdx::expType(Function *pproc) const
-{
-    return (pproc->localId.id_arr[idxGlbIdx].type);
-}
-
-hlType AstIdent::expType(Function *pproc) const
+/* High-level type of the identifier */
+hlType AstIdent::identType(Function *pproc) const
 {
     switch (ident.idType)
     {
-        case UNDEF:
+        case GLOB_VAR:
+            return Project::get()->symbolType(static_cast<const GlobalVariable *>(this)->globIdx);
+        case GLOB_VAR_IDX:
+            return (pproc->localId.id_arr[static_cast<const GlobalVariableIdx *>(this)->idxGlbIdx].type);
         case CONSTANT:
+            return TYPE_CONST;
         case FUNCTION:
+            return static_cast<const FuncNode *>(this)->call.proc->retVal.type;
         case REGISTER:
-        case GLOB_VAR:
-        case GLOB_VAR_IDX:
+            return (static_cast<const RegisterNode *>(this)->regiType == BYTE_REG) ? TYPE_BYTE_SIGN : TYPE_WORD_SIGN;
+        case UNDEF:
             assert(false);
             return TYPE_UNKNOWN;
         case LOCAL_VAR:
@@ -499,7 +449,56 @@ hlType AstIdent::expType(Function *pproc) const
     } /* eos */
     return (TYPE_UNKNOWN);
 }
+/* Computes the type and size of an operator node from its operands, and caches them until the node or the
+ * identifier types change. Identifiers are not cached, their attributes are single table lookups. */
+void Expr::computeAttributes(Function *pproc) const
+{
+    switch (m_type)
+    {
+        case BOOLEAN_OP:
+        {
+            const BinaryOperator *b = static_cast<const BinaryOperator *>(this);
+            hlType first = b->lhs()->expType (pproc);
+            int first_size = b->lhs()->hlTypeSize (pproc);
+            hlType second = b->rhs()->expType (pproc);
+            int second_size = b->rhs()->hlTypeSize (pproc);
+            m_attr_size = std::max(first_size,second_size);
+            if ((first != second) and (first_size <= second_size))
+                m_attr_type = second;
+            else
+                m_attr_type = first;
+            break;
+        }
+        case IDENTIFIER:
+            assert(false);
+            break;
+        default:
+        {
+            const Expr *sub = static_cast<const UnaryOperator *>(this)->unaryExp;
+            m_attr_type = sub->expType(pproc);
+            m_attr_size = sub->hlTypeSize(pproc);
+        }
+    }
+    m_attr_stamp = s_attr_generation;
+}
 /* Returns the type of the expression */
+hlType Expr::expType(Function *pproc) const
+{
+    if (m_type == IDENTIFIER)
+        return static_cast<const AstIdent *>(this)->identType(pproc);
+    if (m_attr_stamp != s_attr_generation)
+        computeAttributes(pproc);
+    return m_attr_type;
+}
+/* Returns the size of the expression's type, in bytes */
+int Expr::hlTypeSize(Function *pproc) const
+{
+    if (m_type == IDENTIFIER)
+        return static_cast<const AstIdent *>(this)->identSize(pproc);
+    if (m_attr_stamp != s_attr_generation)
+        computeAttributes(pproc);
+    return m_attr_size;
+}
 
 
 /* Removes the register from the tree.  If the register was part of a long
@@ -537,16 +536,8 @@ static QString getString (int offset)
     o += "\"\0";
     return o;
 }
-QString BinaryOperator::walkCondExpr(Function * pProc, int* numLoc) const
-{
-    assert(rhs());
-    
-    return QString("(%1%2%3)")
-            .arg((m_op!=NOT) ? lhs()->walkCondExpr(pProc, numLoc) : "")
-            .arg(condOpSym[m_op])
-            .arg(rhs()->walkCondExpr(pProc, numLoc));
-}
-QString AstIdent::walkCondExpr(Function *pProc, int *numLoc) const
+/* Appends the C form of the identifier to out */
+void AstIdent::writeIdent(QString &out, Function *pProc, int *numLoc) const
 {
     int16_t off;              /* temporal - for OTHER */
     ID* id;                 /* Pointer to local identifier table */
@@ -560,6 +551,37 @@ QString AstIdent::walkCondExpr(Function *pProc, int *numLoc) const
     
     switch (ident.idType)
     {
+        case GLOB_VAR:
+        {
+            const GlobalVariable *gv = static_cast<const GlobalVariable *>(this);
+            if(gv->valid)
+                out += Project::get()->symbolName(gv->globIdx);
+            else
+                out += "INVALID GlobalVariable";
+            return;
+        }
+        case GLOB_VAR_IDX:
+            bwGlb = &pProc->localId.id_arr[static_cast<const GlobalVariableIdx *>(this)->idxGlbIdx].id.bwGlb;
+            out += QString("%1[%2]").arg((bwGlb->seg << 4) + bwGlb->off).arg(Machine_X86::regName(bwGlb->regi));
+            return;
+        case CONSTANT:
+        {
+            const Constant *c = static_cast<const Constant *>(this);
+            if (c->kte.kte < 1000)
+                out += QString::number(c->kte.kte);
+            else
+                out += "0x" + QString::number(c->kte.kte,16);
+            return;
+        }
+        case FUNCTION:
+        {
+            const FuncNode *f = static_cast<const FuncNode *>(this);
+            out += pProc->writeCall(f->call.proc,*f->call.args, numLoc);
+            return;
+        }
+        case REGISTER:
+            static_cast<const RegisterNode *>(this)->writeName(out,pProc,numLoc);
+            return;
         case LOCAL_VAR:
             o << pProc->localId.id_arr[ident.idNode.localIdx].name;
             break;
@@ -595,7 +617,7 @@ QString AstIdent::walkCondExpr(Function *pProc, int *numLoc) const
                 else if (id->id.longGlb.regi == rBX)
                     o << "[" << (id->id.longGlb.seg<<4) + id->id.longGlb.offH <<"][bx]";
                 else {
-                    qCritical() << "AstIdent::walkCondExpr unhandled LONG_VAR in GLB_FRAME";
+                    qCritical() << "AstIdent::writeIdent unhandled LONG_VAR in GLB_FRAME";
                     assert(false);
                 }
             }
@@ -612,63 +634,83 @@ QString AstIdent::walkCondExpr(Function *pProc, int *numLoc) const
             break;
         default:
             assert(false);
-            return "";
-            
-            
+            return;
     } /* eos */
     cCode.appendDecl(codeContents);
-    return collectedContents;
-    
-}
-QString UnaryOperator::wrapUnary(Function *pProc, int *numLoc,QChar op) const
-{
-    QString outStr = op;
-    QString inner = unaryExp->walkCondExpr (pProc, numLoc);
-    if (unaryExp->m_type == IDENTIFIER)
-        outStr += inner;
-    else
-        outStr += "("+inner+')';
-    return outStr;
+    out += collectedContents;
 }
-
-QString UnaryOperator::walkCondExpr(Function *pProc, int *numLoc) const
+/* Walks the conditional expression tree and returns the result on a string.
+ * The tree is walked iteratively, appending to a single buffer. */
+QString Expr::walkCondExpr(Function *pProc, int *numLoc) const
 {
-    QString outStr;
-    switch(m_type)
+    struct Pending
     {
-        case NEGATION:
-            outStr+=wrapUnary(pProc,numLoc,'!');
-            break;
-            
-        case ADDRESSOF:
-            outStr+=wrapUnary(pProc,numLoc,'&');
-            break;
-            
-        case DEREFERENCE:
-            outStr+=wrapUnary(pProc,numLoc,'*');
-            break;
-            
-        case POST_INC:
-            outStr +=  unaryExp->walkCondExpr (pProc, numLoc) + "++";
-            break;
-            
-        case POST_DEC:
-            outStr +=  unaryExp->walkCondExpr (pProc, numLoc) + "--";
-            break;
-            
-        case PRE_INC:
-            outStr += "++" + unaryExp->walkCondExpr (pProc, numLoc);
-            break;
-            
-        case PRE_DEC:
-            outStr += "--" + unaryExp->walkCondExpr (pProc, numLoc);
-            break;
+        const Expr *node;   /* subtree still to be written, or */
+        const char *text;   /* text to be appended             */
+    };
+    QString out;
+    std::vector<Pending> todo {{this,nullptr}};
+    while(not todo.empty())
+    {
+        Pending p = todo.back();
+        todo.pop_back();
+        if(p.text)
+        {
+            out += p.text;
+            continue;
+        }
+        const Expr *e = p.node;
+        switch(e->m_type)
+        {
+            case BOOLEAN_OP:
+            {
+                const BinaryOperator *b = static_cast<const BinaryOperator *>(e);
+                assert(b->rhs());
+                /* pushed in reverse: (lhs op rhs) */
+                todo.push_back({nullptr,")"});
+                todo.push_back({b->rhs(),nullptr});
+                todo.push_back({nullptr,condOpSym[b->op()]});
+                if(b->op()!=NOT)
+                    todo.push_back({b->lhs(),nullptr});
+                out += '(';
+                break;
+            }
+            case IDENTIFIER:
+                static_cast<const AstIdent *>(e)->writeIdent(out,pProc,numLoc);
+                break;
+            case NEGATION:
+            case ADDRESSOF:
+            case DEREFERENCE:
+            {
+                const Expr *sub = static_cast<const UnaryOperator *>(e)->unaryExp;
+                out += (e->m_type==NEGATION) ? '!' : ((e->m_type==ADDRESSOF) ? '&' : '*');
+                if (sub->m_type == IDENTIFIER)
+                    todo.push_back({sub,nullptr});
+                else
+                {
+                    todo.push_back({nullptr,")"});
+                    todo.push_back({sub,nullptr});
+                    out += '(';
+                }
+                break;
+            }
+            case POST_INC:
+            case POST_DEC:
+                todo.push_back({nullptr,(e->m_type==POST_INC) ? "++" : "--"});
+                todo.push_back({static_cast<const UnaryOperator *>(e)->unaryExp,nullptr});
+                break;
+            case PRE_INC:
+            case PRE_DEC:
+                out += (e->m_type==PRE_INC) ? "++" : "--";
+                todo.push_back({static_cast<const UnaryOperator *>(e)->unaryExp,nullptr});
+                break;
+            default:
+                break;
+        }
     }
-    return outStr;
+    return out;
 }
 
-/* Walks the conditional expression tree and returns the result on a string */
-
 
 /* Changes the boolean conditional operator at the root of this expression */
 void BinaryOperator::changeBoolOp (condOp newOp)
@@ -715,6 +757,7 @@ Expr *UnaryOperator::insertSubTreeReg(Expr *_expr, eReg regi, const LOCAL_ID *lo
             if (nullptr!=temp)
             {
                 unaryExp = temp;
+                attributesChanged();
                 return this;
             }
             return nullptr;
@@ -733,6 +776,7 @@ Expr *BinaryOperator::insertSubTreeReg(Expr *_expr, eReg regi, const LOCAL_ID *l
         if(r)
         {
             m_lhs = r;
+            attributesChanged();
             return this;
         }
     }
@@ -741,6 +785,7 @@ Expr *BinaryOperator::insertSubTreeReg(Expr *_expr, eReg regi, const LOCAL_ID *l
     if(r)
     {
         m_rhs = r;
+        attributesChanged();
         return this;
     }
     return nullptr;
@@ -773,6 +818,7 @@ Expr *UnaryOperator::insertSubTreeLongReg(Expr *_expr, int longIdx)
     if (nullptr!=temp)
     {
         unaryExp = temp;
+        attributesChanged();
         return this;
     }
     return nullptr;
@@ -786,6 +832,7 @@ Expr *BinaryOperator::insertSubTreeLongReg(Expr *_expr, int longIdx)
         if(r)
         {
             m_lhs = r;
+            attributesChanged();
             return this;
         }
     }
@@ -793,6 +840,7 @@ Expr *BinaryOperator::insertSubTreeLongReg(Expr *_expr, int longIdx)
     if(r)
     {
         m_rhs = r;
+        attributesChanged();
         return this;
     }
     return nullptr;
@@ -853,33 +901,6 @@ Expr *AstIdent::performLongRemoval(eReg regi, LOCAL_ID *locId)
         return this;
     otherRegi = locId->getPairedRegisterAt(ident.idNode.longIdx,regi);
     bool long_was_signed = locId->id_arr[ident.idNode.longIdx].isSigned();
-    delete this;
     return new RegisterNode(locId->newByteWordReg(long_was_signed ? TYPE_WORD_SIGN : TYPE_WORD_UNSIGN,otherRegi),WORD_REG,locId);
 }
 
-QString Constant::walkCondExpr(Function *, int *) const
-{
-    if (kte.kte < 1000)
-        return  QString::number(kte.kte);
-    return "0x" + QString::number(kte.kte,16);
-}
-
-int Constant::hlTypeSize(Function *) const
-{
-    return kte.size;
-}
-
-QString FuncNode::walkCondExpr(Function *pProc, int *numLoc) const
-{
-    return pProc->writeCall(call.proc,*call.args, numLoc);
-}
-
-int FuncNode::hlTypeSize(Function *) const
-{
-    return hlSize[call.proc->retVal.type];
-}
-
-hlType FuncNode::expType(Function *) const
-{
-    return call.proc->retVal.type;
-}
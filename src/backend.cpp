@@ -216,6 +216,8 @@ static void emitFwdGotoLabel (ICODE * pt, int indLevel)
  * and invokes the procedure that writes the code of the given record *hli */
 void Function::codeGen (QIODevice &fs)
 {
+    ScopedPassTimer timer(PASS_CODEGEN,this);
+    ExprArena::Scope arena_scope(exprArena());
     int numLoc;
     QString ostr_contents;
     QTextStream ostr(&ostr_contents);
@@ -338,11 +340,16 @@ static void backBackEnd (CALL_GRAPH * pcallGraph, QIODevice &_ios)
     {
         backBackEnd (elem, _ios);
     }
+    /* With -E, the callees were parsed for their liveness only */
+    if (not option.EntryPoints.isEmpty() and not (pcallGraph->proc->flg & PROC_SELECTED))
+        return;
 
     /* Generate code for this procedure */
     stats.numLLIcode = pcallGraph->proc->Icode.size();
     stats.numHLIcode = 0;
     pcallGraph->proc->codeGen (_ios);
+    Instrumentation::count(&(*pcallGraph->proc),CNT_LL_ICODES,stats.numLLIcode);
+    Instrumentation::count(&(*pcallGraph->proc),CNT_HL_ICODES,stats.numHLIcode);
 
     /* Generate statistics */
     if (option.Stats)
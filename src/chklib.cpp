@@ -8,76 +8,43 @@
 #include "dcc.h"
 #include "msvc_fixes.h"
 #include "project.h"
-#include "perfhlib.h"
+#include "CallGraph.h"
+#include "SignatureIndex.h"
+#include "PatternScanner.h"
+#include "fixwild.h"
+#include "PrototypeDB.h"
 #include "dcc_interface.h"
 
 #include <QtCore/QDir>
+#include <QtCore/QFile>
 #include <QtCore/QString>
 #include <QtCore/QDebug>
+#include <algorithm>
+#include <unordered_set>
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
 #include <string.h>
 
-PerfectHash g_pattern_hasher;
-#define  NIL   -1                   /* Used like NULL, but 0 is valid */
-
-/* Hash table structure */
-typedef struct HT_tag
-{
-    char    htSym[SYMLEN];
-    uint8_t    htPat[PATLEN];
-} HT;
-
-/* Structure of the prototypes table. Same as the struct in parsehdr.h,
-    except here we don't need the "next" index (the elements are already
-    sorted by function name) */
-typedef
-struct ph_func_tag
-{
-    char    name[SYMLEN];               /* Name of function or arg */
-    hlType  typ;                        /* Return type */
-    int     numArg;                     /* Number of args */
-    int     firstArg;                   /* Index of first arg in chain */
-    //  int     next;                       /* Index of next function in chain */
-    bool    bVararg;                    /* True if variable arguements */
-} PH_FUNC_STRUCT;
-
 
 #define NUM_PLIST   64              	/* Number of entries to increase allocation by */
 
 /* statics */
-static char buf[100];          				/* A general purpose buffer */
-int numKeys;            				/* Number of hash table entries (keys) */
-int numVert;            				/* Number of vertices in the graph (also size of g[]) */
-unsigned PatLen;        				/* Size of the keys (pattern length) */
-unsigned SymLen;        				/* Max size of the symbols, including null */
-static FILE *g_file;                				/* File being read */
 static QString sSigName; 			/* Full path name of .sig file */
 
-static  uint16_t    *T1base, *T2base;       /* Pointers to start of T1, T2 */
-static  uint16_t    *g;                     /* g[] */
-static  HT      *ht;                    /* The hash table */
-static  PH_FUNC_STRUCT *pFunc;          /* Points to the array of func names */
-static  hlType  *pArg=nullptr;                /* Points to the array of param types */
-static  int     numFunc;                /* Number of func names actually stored */
-static  int     numArg;                 /* Number of param names actually stored */
-#define DCCLIBS "dcclibs.dat"           /* Name of the prototypes data file */
+static  PrototypeDB protos;             /* Prototypes of the library functions */
+static  std::vector<Function *> swept;  /* Library functions added by SweepLibCheck() */
+static  std::unordered_set<Function *> unchecked;  /* Those of them LibCheck() has not been run on yet */
+#define DCCLIBS "dcclibs.pdb"           /* Name of the prototypes database */
+#define DCCLIBS_DAT "dcclibs.dat"       /* Its older, sorted form */
 
 /* prototypes */
-void grab(int n, FILE *_file);
-uint16_t readFileShort(FILE *_file);
-void readFileSection(uint16_t* p, int len, FILE *_file);
 void cleanup(void);
 void checkStartup(STATE *state);
 void readProtoFile(void);
-int  searchPList(char *name);
 void checkHeap(char *msg);              /* For debugging */
 
-void fixWildCards(uint8_t pat[]);			/* In fixwild.c */
 
-static bool locatePattern(const uint8_t *source, int iMin, int iMax, uint8_t *pattern,
-                           int iPatLen, int *index);
 
 /*  *   *   *   *   *   *   *   *   *   *   *   *   *   *   *\
 *                                                            *
@@ -294,141 +261,219 @@ static uint8_t pattMsChkstk[] =
     0xE9					/* jmp XXXX		*/
 };
 
-
-
-
-/* This procedure is called to initialise the library check code */
-bool SetupLibCheck(void)
+/* All the patterns above, searched for together */
+enum eLibPattern
 {
-    uint16_t w, len;
-    int i;
-    IDcc *dcc = IDcc::get();
-    QString fpath = dcc->dataDir("sigs").absoluteFilePath(sSigName);
-    if ((g_file = fopen(qPrintable(fpath), "rb")) == nullptr)
-    {
-        printf("Warning: cannot open signature file %s\n", qPrintable(fpath));
-        return false;
-    }
+    MS_C5_START=0,
+    MS_C8_START,
+    MS_C8_COM_START,
+    BORL2_START,
+    BORL3_START,
+    BORL4_ON,
+    BORL4_INIT,
+    BORL5_INIT,
+    BORL7_INIT,
+    LOGI_START,
+    TPAS_START,
+    MAIN_SMALL,
+    MAIN_MEDIUM,
+    MAIN_COMPACT,
+    MAIN_LARGE,
+    MS_CHKSTK
+};
+static const PatternScanner &libPatterns()
+{
+    static PatternScanner scanner = []() {
+        PatternScanner res;
+        res.add(pattMsC5Start, sizeof(pattMsC5Start));
+        res.add(pattMsC8Start, sizeof(pattMsC8Start));
+        res.add(pattMsC8ComStart, sizeof(pattMsC8ComStart));
+        res.add(pattBorl2Start, sizeof(pattBorl2Start));
+        res.add(pattBorl3Start, sizeof(pattBorl3Start));
+        res.add(pattBorl4on, sizeof(pattBorl4on));
+        res.add(pattBorl4Init, sizeof(pattBorl4Init));
+        res.add(pattBorl5Init, sizeof(pattBorl5Init));
+        res.add(pattBorl7Init, sizeof(pattBorl7Init));
+        res.add(pattLogiStart, sizeof(pattLogiStart));
+        res.add(pattTPasStart, sizeof(pattTPasStart));
+        res.add(pattMainSmall, sizeof(pattMainSmall));
+        res.add(pattMainMedium, sizeof(pattMainMedium));
+        res.add(pattMainCompact, sizeof(pattMainCompact));
+        res.add(pattMainLarge, sizeof(pattMainLarge));
+        res.add(pattMsChkstk, sizeof(pattMsChkstk));
+        res.compile();
+        return res;
+    }();
+    return scanner;
+}
+/* Matches of all the patterns in the image, from iMin up to iMax or the end of the image */
+static void scanImage(int iMin, int iMax, std::vector<int> &first)
+{
+    PROG &prog(Project::get()->prog);
+    libPatterns().firstMatches(prog.image(), iMin, std::min(iMax, prog.cbImage), first);
+}
+/* True if the leftmost match of pattern id, as found by scanImage(), ends before iMax; in which
+    case *index is its start */
+static bool locatePattern(const std::vector<int> &first, eLibPattern id, int iMax, int *index)
+{
+    *index = first[id];
+    if (*index >= 0 and *index + libPatterns().length(id) <= iMax)
+        return true;
+    *index = -1;
+    return false;
+}
 
-    readProtoFile();
 
 
-    /* Read the parameters */
-    grab(4, g_file);
-    if (memcmp("dccs", buf, 4) != 0)
-    {
-        printf("Not a dcc signature file!\n");
-        exit(3);
-    }
-    numKeys = readFileShort(g_file);
-    numVert = readFileShort(g_file);
-    PatLen = readFileShort(g_file);
-    SymLen = readFileShort(g_file);
-    if ((PatLen != PATLEN) or (SymLen != SYMLEN))
-    {
-        printf("Sorry! Compiled for sym and pattern lengths of %d and %d\n", SYMLEN, PATLEN);
-        return false;
-    }
 
-    /* Initialise the perfhlib stuff. Also allocates T1, T2, g, etc */
-    /* Set the parameters for the hash table */
-    g_pattern_hasher.setHashParams(
-                    numKeys,                /* The number of symbols */
-                    PatLen,                 /* The length of the pattern to be hashed */
-                    256,                    /* The character set of the pattern (0-FF) */
-                    0,                      /* Minimum pattern character value */
-                    numVert);               /* Specifies c, the sparseness of the graph. See Czech, Havas and Majewski for details */
-    T1base  = g_pattern_hasher.readT1();
-    T2base  = g_pattern_hasher.readT2();
-    g       = g_pattern_hasher.readG();
-
-    /* Read T1 and T2 tables */
-    grab(2, g_file);
-    if (memcmp("T1", buf, 2) != 0)
-    {
-        printf("Expected 'T1'\n");
-        exit(3);
-    }
-    len = (uint16_t) (PatLen * 256 * sizeof(uint16_t));
-    w = readFileShort(g_file);
-    if (w != len)
-    {
-        printf("Problem with size of T1: file %d, calc %d\n", w, len);
+/* The wildcarded pattern of the code at entry; false if the image ends before it does */
+static bool entryPattern(uint32_t entry, uint8_t pat[PATLEN])
+{
+    PROG &prog(Project::get()->prog);
+    if (entry + PATLEN > (uint32_t)prog.cbImage)
         return false;
-    }
-    readFileSection(T1base, len, g_file);
+    memcpy(pat, &prog.image()[entry], PATLEN);
+    fixWildCards(pat);
+    return true;
+}
+/* True if the code at entry is Microsoft's _chkstk */
+static bool isChkstk(uint32_t entry)
+{
+    PROG &prog(Project::get()->prog);
+    bool chkstk = false;
+    libPatterns().scan(prog.image(), entry, std::min<int>(entry+sizeof(pattMsChkstk), prog.cbImage),
+                       [&chkstk](int id, int) { chkstk = (id == MS_CHKSTK); return not chkstk; });
+    return chkstk;
+}
 
-    grab(2, g_file);
-    if (memcmp("T2", buf, 2) != 0)
-    {
-        printf("Expected 'T2'\n");
-        return false;
-    }
-    w = readFileShort(g_file);
-    if (w != len)
-    {
-        printf("Problem with size of T2: file %d, calc %d\n", w, len);
-        return false;
-    }
-    readFileSection(T2base, len, g_file);
 
-    /* Now read the function g[] */
-    grab(2, g_file);
-    if (memcmp("gg", buf, 2) != 0)
-    {
-        printf("Expected 'gg'\n");
-        return false;
-    }
-    len = (uint16_t)(numVert * sizeof(uint16_t));
-    w = readFileShort(g_file);
-    if (w != len)
+/* This procedure is called to initialise the library check code.  All the signature sets are
+    loaded; the one checkStartup() chose is preferred when naming procedures */
+bool SetupLibCheck(void)
+{
+    IDcc *dcc = IDcc::get();
+    QDir sigs = dcc->dataDir("sigs");
+    SignatureIndex &index(SignatureIndex::get());
+    if (not index.load(sigs, sSigName))
     {
-        printf("Problem with size of g[]: file %d, calc %d\n", w, len);
+        printf("Warning: no signature file could be read from %s\n", qPrintable(sigs.absolutePath()));
         return false;
     }
-    readFileSection(g, len, g_file);
+    if (index.sets()[index.elected()].file != sSigName)
+        printf("Warning: cannot open signature file %s\n", qPrintable(sigs.absoluteFilePath(sSigName)));
 
+    readProtoFile();
+    return true;
+}
 
-    /* This is now the hash table */
-    /* First allocate space for the table */
-    ht = new HT[numKeys];
-    if ( nullptr == ht)
-    {
-        printf("Could not allocate hash table\n");
-        return false;
-    }
-    grab(2, g_file);
-    if (memcmp("ht", buf, 2) != 0)
-    {
-        printf("Expected 'ht'\n");
-        return false;
-    }
-    w = readFileShort(g_file);
-    if (w != numKeys * (SymLen + PatLen + sizeof(uint16_t)))
-    {
-        printf("Problem with size of hash table: file %d, calc %d\n", w, len);
-        return false;
-    }
 
+/* Pre-pass over the whole image.  The targets of all the near and far calls a linear sweep finds, and
+    the far pointers the relocations point to, are checked against the signatures; the library functions
+    among them are put in the procedure list, so that the parser finds them there and does not descend
+    into them, however they are reached.  The check neither votes nor sets anything up: LibCheckReached()
+    does the rest once the parse reaches the function */
+void SweepLibCheck(const STATE &state)
+{
+    Project &proj(*Project::get());
+    PROG &prog(proj.prog);
+    const uint8_t *image = prog.image();
+    std::vector<uint32_t> entries;
+    int i;
+
+    if (prog.bSigs == false)
+        return;
+    ScopedPassTimer timer(PASS_LIBCHECK);
+    for (i=0; i+3 <= prog.cbImage; i++)
+    {
+        if (image[i] == 0xE8)                       /* call near, as the scanner computes it */
+            entries.push_back((uint16_t)(i + 3 + LH(&image[i+1])));
+        else if (image[i] == 0x9A and i+5 <= prog.cbImage)     /* call far */
+            entries.push_back(((uint32_t)LH(&image[i+3]) << 4) + LH(&image[i+1]));
+    }
+    for (uint32_t v : prog.relocTable)
+    {
+        /* The segment of a far pointer, or of a far call */
+        if (v >= 2 and v+2 <= (uint32_t)prog.cbImage)
+            entries.push_back(((uint32_t)LH(&image[v]) << 4) + LH(&image[v-2]));
+    }
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    SignatureIndex &index(SignatureIndex::get());
+    SignatureIndex::Stats &stats(index.stats());
+    for (uint32_t entry : entries)
+    {
+        uint8_t pat[PATLEN];
+        if (entry == state.IP or (prog.offMain != -1 and entry == (uint32_t)prog.offMain) or
+                not entryPattern(entry, pat))
+            continue;
+        stats.swept++;
+        /* As LibCheck() decides it */
+        const char *sym = index.peek(pat);
+        if (sym and not protos.empty() and protos.find(sym) == nullptr)
+            sym = nullptr;              /* A runtime routine, parsed as user code */
+        if (isChkstk(entry))
+            sym = "chkstk";
+        if (sym == nullptr)
+            continue;
+        ilFunction proc = proj.createFunction(0, sym);
+        proc->procEntry = entry;
+        proc->flg |= PROC_ISLIB;
+        swept.push_back(&*proc);
+        unchecked.insert(&*proc);
+    }
+    stats.preloaded += swept.size();
+}
 
-    for (i=0; i < numKeys; i++)
+/* Called when the parse reaches a procedure that is in the list already.  A library function of the sweep
+    is LibCheck()ed the first time, which votes and sets up its prototype */
+void LibCheckReached(Function &proc)
+{
+    if (unchecked.erase(&proc) == 0)
+        return;
+    QString name = proc.name;
+    proc.name.clear();
+    proc.flg &= ~PROC_ISLIB;
+    if (not LibCheck(proc))
     {
-        if (fread(&ht[i], 1, SymLen + PatLen, g_file) != SymLen + PatLen)
-        {
-            printf("Could not read signature\n");
-            return false;
-        }
+        /* The votes have elected another set since the sweep; the parse did not descend into it regardless */
+        proc.name = name;
+        proc.flg |= PROC_ISLIB;
     }
-    fclose(g_file);
-    return true;
 }
 
+/* Collects the procedures of the call graph */
+static void calledProcs(const CALL_GRAPH *node, std::unordered_set<const Function *> &called)
+{
+    called.insert(&*node->proc);
+    for (const CALL_GRAPH *callee : node->outEdges)
+        calledProcs(callee, called);
+}
 
 void CleanupLibCheck(void)
 {
+    Project &proj(*Project::get());
+    /* Drop the library functions of the sweep that are never called */
+    if (not swept.empty())
+    {
+        std::unordered_set<const Function *> called;
+        if (proj.callGraph)
+            calledProcs(proj.callGraph, called);
+        std::unordered_set<const Function *> unused;
+        for (Function *f : swept)
+        {
+            if (called.count(f))
+                SignatureIndex::get().stats().called++;
+            else
+                unused.insert(f);
+        }
+        proj.pProcList.remove_if([&unused](const Function &f) { return unused.count(&f) != 0; });
+        swept.clear();
+        unchecked.clear();
+    }
     /* Deallocate all the stuff allocated in SetupLibCheck() */
-    delete [] ht;
-    delete [] pFunc;
+    SignatureIndex::get().clear();
+    protos.close();
 }
 
 
@@ -437,10 +482,10 @@ void CleanupLibCheck(void)
 */
 bool LibCheck(Function & pProc)
 {
+    ScopedPassTimer timer(PASS_LIBCHECK,&pProc);
     PROG &prog(Project::get()->prog);
     long fileOffset;
-    int h, i, j, arg;
-    int Idx;
+    int j;
     uint8_t pat[PATLEN];
 
     if (prog.bSigs == false)
@@ -457,41 +502,37 @@ bool LibCheck(Function & pProc)
         pProc.name = "main";
         return false;
     }
-    if(fileOffset + PATLEN > prog.cbImage)
+    if (not entryPattern(fileOffset, pat))  /* Wild cards fixed in the copy */
         return false;
-    memcpy(pat, &prog.image()[fileOffset], PATLEN);
-    //memmove(pat, &prog.image()[fileOffset], PATLEN);
-    fixWildCards(pat);                  /* Fix wild cards in the copy */
-    h = g_pattern_hasher.hash(pat);                      /* Hash the found proc */
-    /* We always have to compare keys, because the hash function will always return a valid index */
-    if (memcmp(ht[h].htPat, pat, PATLEN) == 0)
+    const char *sym = SignatureIndex::get().lookup(pat);
+    if (sym != nullptr)
     {
         /* We have a match. Save the name, if not already set */
         if (pProc.name.isEmpty() )     /* Don't overwrite existing name */
         {
             /* Give proc the new name */
-            pProc.name = ht[h].htSym;
+            pProc.name = sym;
         }
         /* But is it a real library function? */
-        i = NIL;
-        if ((numFunc == 0) or (i=searchPList(ht[h].htSym)) != NIL)
+        const PrototypeDB::Function *proto = protos.find(sym);
+        if (protos.empty() or proto)
         {
             pProc.flg |= PROC_ISLIB; 		/* It's a lib function */
-            pProc.callingConv(CConv::eCdecl);
-            if (i != NIL)
+            pProc.callingConv(proto and proto->callConv == PrototypeDB::CC_PASCAL ? CConv::ePascal : CConv::eCdecl);
+            if (proto)
             {
                 /* Allocate space for the arg struct, and copy the hlType to
                     the appropriate field */
-                arg = pFunc[i].firstArg;
-                pProc.args.numArgs = pFunc[i].numArg;
-                pProc.args.resize(pFunc[i].numArg);
-                for (j=0; j < pFunc[i].numArg; j++)
+                const uint16_t *arg = protos.args(*proto);
+                pProc.args.numArgs = proto->numArg;
+                pProc.args.resize(proto->numArg);
+                for (j=0; j < proto->numArg; j++)
                 {
-                    pProc.args[j].type = pArg[arg++];
+                    pProc.args[j].type = (hlType)arg[j];
                 }
-                if (pFunc[i].typ != TYPE_UNKNOWN)
+                if (proto->retType != TYPE_UNKNOWN)
                 {
-                    pProc.retVal.type = pFunc[i].typ;
+                    pProc.retVal.type = (hlType)proto->retType;
                     pProc.flg |= PROC_IS_FUNC;
                     switch (pProc.retVal.type) {
                         case TYPE_LONG_SIGN: case TYPE_LONG_UNSIGN:
@@ -514,19 +555,17 @@ bool LibCheck(Function & pProc)
                             /*** other types are not considered yet ***/
                     }
                 }
-                pProc.getFunctionType()->m_vararg = pFunc[i].bVararg;
+                pProc.getFunctionType()->m_vararg = (proto->flags & PrototypeDB::FN_VARARG) != 0;
             }
         }
-        else if (i == NIL)
+        else
         {
             /* Have a symbol for it, but does not appear in a header file.
                 Treat it as if it is not a library function */
             pProc.flg |= PROC_RUNTIME;		/* => is a runtime routine */
         }
     }
-    if (locatePattern(prog.image(), pProc.procEntry,
-                      pProc.procEntry+sizeof(pattMsChkstk),
-                      pattMsChkstk, sizeof(pattMsChkstk), &Idx))
+    if (isChkstk(pProc.procEntry))
     {
         /* Found _chkstk */
         pProc.name = "chkstk";
@@ -539,41 +578,6 @@ bool LibCheck(Function & pProc)
 
 
 
-void grab(int n, FILE *_file)
-{
-    if (fread(buf, 1, n, _file) != (unsigned)n)
-    {
-        printf("Could not grab\n");
-        exit(11);
-    }
-}
-
-uint16_t readFileShort(FILE *f)
-{
-    uint8_t b1, b2;
-
-    if (fread(&b1, 1, 1, f) != 1)
-    {
-        printf("Could not read short\n");
-        exit(11);
-    }
-    if (fread(&b2, 1, 1, f) != 1)
-    {
-        printf("Could not read short\n");
-        exit(11);
-    }
-    return (uint16_t)(b2 << 8) + (uint16_t)b1;
-}
-
-// Read a section of the file, considering endian issues
-void readFileSection(uint16_t* p, int len, FILE* f)
-{
-    for (int i=0; i < len; i += 2)
-    {
-        *p++ = readFileShort(f);
-    }
-}
-
 /* The following two functions are dummies, since we don't call map() */
 void getKey(int /*i*/, uint8_t **/*keys*/)
 {
@@ -585,47 +589,6 @@ void dispKey(int /*i*/)
 
 }
 
-/* Search the source array between limits iMin and iMax for the pattern (length
-    iPatLen). The pattern can contain wild bytes; if you really want to match
-    for the pattern that is used up by the WILD uint8_t, tough - it will match with
-    everything else as well. */
-static bool locatePattern(const uint8_t *source, int iMin, int iMax, uint8_t *pattern, int iPatLen,
-                           int *index)
-{
-    int i, j;
-    const uint8_t *pSrc;                             /* Pointer to start of considered source */
-    int iLast;
-
-    iLast = iMax - iPatLen;                 /* Last source uint8_t to consider */
-
-    for (i=iMin; i <= iLast; i++)
-    {
-        pSrc = &source[i];                  /* Start of current part of source */
-        /* i is the index of the start of the moving pattern */
-        for (j=0; j < iPatLen; j++)
-        {
-            /* j is the index of the uint8_t being considered in the pattern. */
-            if ((*pSrc != pattern[j]) and (pattern[j] != WILD))
-            {
-                /* A definite mismatch */
-                break;                      /* Break to outer loop */
-            }
-            pSrc++;
-        }
-        if (j >= iPatLen)
-        {
-            /* Pattern has been found */
-            *index = i;                     /* Pass start of pattern */
-            return 1;                       /* Indicate success */
-        }
-        /* Else just try next value of i */
-    }
-    /* Pattern was not found */
-    *index = -1;                            /* Invalidate index */
-    return 0;                               /* Indicate failure */
-}
-
-
 void STATE::checkStartup()
 {
     PROG &prog(Project::get()->prog);
@@ -640,21 +603,24 @@ void STATE::checkStartup()
     char chModel = 'x';
     char chVendor = 'x';
     char chVersion = 'x';
-    char temp[4];
+    std::vector<int> first;       /* Leftmost match of each pattern */
 
     startOff = ((uint32_t)prog.initCS << 4) + prog.initIP;
+    /* All the startup, main and vendor patterns are searched for in one pass */
+    scanImage(startOff, startOff+0x180, first);
 
     /* Check the Turbo Pascal signatures first, since they involve only the
                 first 3 bytes, and false positives may be founf with the others later */
-    if (locatePattern(prog.image(), startOff, startOff+5, pattBorl4on,sizeof(pattBorl4on), &i))
+    if (locatePattern(first, BORL4_ON, startOff+5, &i))
     {
         /* The first 5 bytes are a far call. Follow that call and
                         determine the version from that */
         rel = LH(&prog.image()[startOff+1]);  	 /* This is abs off of init */
         para= LH(&prog.image()[startOff+3]);/* This is abs seg of init */
         init = ((uint32_t)para << 4) + rel;
-        if (locatePattern(prog.image(), init, init+26, pattBorl4Init,
-                          sizeof(pattBorl4Init), &i))
+        std::vector<int> firstInit;
+        scanImage(init, init+26, firstInit);
+        if (locatePattern(firstInit, BORL4_INIT, init+26, &i))
         {
 
             setState(rDS, LH(&prog.image()[i+1]));
@@ -666,8 +632,7 @@ void STATE::checkStartup()
             prog.segMain = prog.initCS;			/* At the 5 uint8_t jump */
             goto gotVendor;                     /* Already have vendor */
         }
-        else if (locatePattern(prog.image(), init, init+26, pattBorl5Init,
-                               sizeof(pattBorl5Init), &i))
+        else if (locatePattern(firstInit, BORL5_INIT, init+26, &i))
         {
 
             setState( rDS, LH(&prog.image()[i+1]));
@@ -679,8 +644,7 @@ void STATE::checkStartup()
             prog.segMain = prog.initCS;
             goto gotVendor;                     /* Already have vendor */
         }
-        else if (locatePattern(prog.image(), init, init+26, pattBorl7Init,
-                               sizeof(pattBorl7Init), &i))
+        else if (locatePattern(firstInit, BORL7_INIT, init+26, &i))
         {
 
             setState( rDS, LH(&prog.image()[i+1]));
@@ -702,7 +666,7 @@ void STATE::checkStartup()
         as near data, just more pushes at the start. */
     if(prog.cbImage>int(startOff+0x180+sizeof(pattMainLarge)))
     {
-        if (locatePattern(prog.image(), startOff, startOff+0x180, pattMainLarge,sizeof(pattMainLarge), &i))
+        if (locatePattern(first, MAIN_LARGE, startOff+0x180, &i))
         {
             rel = LH(&prog.image()[i+OFFMAINLARGE]);  /* This is abs off of main */
             para= LH(&prog.image()[i+OFFMAINLARGE+2]);/* This is abs seg of main */
@@ -711,16 +675,14 @@ void STATE::checkStartup()
             prog.segMain = (uint16_t)para;
             chModel = 'l';                          /* Large model */
         }
-        else if (locatePattern(prog.image(), startOff, startOff+0x180, pattMainCompact,
-                               sizeof(pattMainCompact), &i))
+        else if (locatePattern(first, MAIN_COMPACT, startOff+0x180, &i))
         {
             rel = LH_SIGNED(&prog.image()[i+OFFMAINCOMPACT]);/* This is the rel addr of main */
             prog.offMain = i+OFFMAINCOMPACT+2+rel;  /* Save absolute image offset */
             prog.segMain = prog.initCS;
             chModel = 'c';                          /* Compact model */
         }
-        else if (locatePattern(prog.image(), startOff, startOff+0x180, pattMainMedium,
-                               sizeof(pattMainMedium), &i))
+        else if (locatePattern(first, MAIN_MEDIUM, startOff+0x180, &i))
         {
             rel = LH(&prog.image()[i+OFFMAINMEDIUM]);  /* This is abs off of main */
             para= LH(&prog.image()[i+OFFMAINMEDIUM+2]);/* This is abs seg of main */
@@ -728,15 +690,14 @@ void STATE::checkStartup()
             prog.segMain = (uint16_t)para;
             chModel = 'm';                          /* Medium model */
         }
-        else if (locatePattern(prog.image(), startOff, startOff+0x180, pattMainSmall,
-                               sizeof(pattMainSmall), &i))
+        else if (locatePattern(first, MAIN_SMALL, startOff+0x180, &i))
         {
             rel = LH_SIGNED(&prog.image()[i+OFFMAINSMALL]); /* This is rel addr of main */
             prog.offMain = i+OFFMAINSMALL+2+rel;    /* Save absolute image offset */
             prog.segMain = prog.initCS;
             chModel = 's';                          /* Small model */
         }
-        else if (memcmp(&prog.image()[startOff], pattTPasStart, sizeof(pattTPasStart)) == 0)
+        else if (locatePattern(first, TPAS_START, startOff+sizeof(pattTPasStart), &i))
         {
             rel = LH_SIGNED(&prog.image()[startOff+1]);     /* Get the jump offset */
             prog.offMain = rel+startOff+3;          /* Save absolute image offset */
@@ -765,7 +726,7 @@ void STATE::checkStartup()
     prog.addressingMode = chModel;
 
     /* Now decide the compiler vendor and version number */
-    if (memcmp(&prog.image()[startOff], pattMsC5Start, sizeof(pattMsC5Start)) == 0)
+    if (locatePattern(first, MS_C5_START, startOff+sizeof(pattMsC5Start), &i))
     {
         /* Yes, this is Microsoft startup code. The DS is sitting right here
             in the next 2 bytes */
@@ -776,7 +737,7 @@ void STATE::checkStartup()
     }
 
     /* The C8 startup pattern is different from C5's */
-    else if (memcmp(&prog.image()[startOff], pattMsC8Start, sizeof(pattMsC8Start)) == 0)
+    else if (locatePattern(first, MS_C8_START, startOff+sizeof(pattMsC8Start), &i))
     {
         setState( rDS, LH(&prog.image()[startOff+sizeof(pattMsC8Start)]));
         printf("MSC 8 detected\n");
@@ -785,16 +746,14 @@ void STATE::checkStartup()
     }
 
     /* The C8 .com startup pattern is different again! */
-    else if (memcmp(&prog.image()[startOff], pattMsC8ComStart,
-                    sizeof(pattMsC8ComStart)) == 0)
+    else if (locatePattern(first, MS_C8_COM_START, startOff+sizeof(pattMsC8ComStart), &i))
     {
         printf("MSC 8 .com detected\n");
         chVendor = 'm';                     /* Microsoft compiler */
         chVersion = '8';                    /* Version 8 */
     }
 
-    else if (locatePattern(prog.image(), startOff, startOff+0x30, pattBorl2Start,
-                           sizeof(pattBorl2Start), &i))
+    else if (locatePattern(first, BORL2_START, startOff+0x30, &i))
     {
         /* Borland startup. DS is at the second uint8_t (offset 1) */
         setState( rDS, LH(&prog.image()[i+1]));
@@ -803,8 +762,7 @@ void STATE::checkStartup()
         chVersion = '2';                    /* Version 2 */
     }
 
-    else if (locatePattern(prog.image(), startOff, startOff+0x30, pattBorl3Start,
-                           sizeof(pattBorl3Start), &i))
+    else if (locatePattern(first, BORL3_START, startOff+0x30, &i))
     {
         /* Borland startup. DS is at the second uint8_t (offset 1) */
         setState( rDS, LH(&prog.image()[i+1]));
@@ -813,8 +771,7 @@ void STATE::checkStartup()
         chVersion = '3';                    /* Version 3 */
     }
 
-    else if (locatePattern(prog.image(), startOff, startOff+0x30, pattLogiStart,
-                           sizeof(pattLogiStart), &i))
+    else if (locatePattern(first, LOGI_START, startOff+0x30, &i))
     {
         /* Logitech modula startup. DS is 0, despite appearances */
         printf("Logitech modula detected\n");
@@ -839,122 +796,36 @@ gotVendor:
 
 }
 
-/* DCCLIBS.DAT is a data file sorted on function name containing names and
-    return types of functions found in include files, and the names and types
-    of arguements. Only functions in this list will be considered library
-    functions; others (like LXMUL@) are helper files, and need to be analysed
-    by dcc, rather than considered as known functions. When a prototype is
-    found (in searchPList()), the parameter info is written to the proc struct.
+/* DCCLIBS.PDB holds the names and return types of functions found in include
+    files, and the types of their arguments, hashed on the function name.
+    Only functions in this list will be considered library functions; others
+    (like LXMUL@) are helper files, and need to be analysed by dcc, rather than
+    considered as known functions. When a prototype is found by LibCheck(), the
+    parameter info is written to the proc struct. Without DCCLIBS.PDB, the
+    DCCLIBS.DAT parsehdr used to write is read and hashed as it is loaded.
 */
 void readProtoFile(void)
 {
     IDcc *dcc = IDcc::get();
-    QString szProFName = dcc->dataDir("prototypes").absoluteFilePath(DCCLIBS); /* Full name of dclibs.lst */
+    QDir dir = dcc->dataDir("prototypes");
+    QString szProFName = dir.absoluteFilePath(DCCLIBS); /* Full name of dcclibs.pdb */
+    std::string error;
 
-    FILE *fProto;
-    int  i;
-
-    if ((fProto = fopen(qPrintable(szProFName), "rb")) == nullptr)
+    if (protos.open(qPrintable(szProFName), error))
+        return;
+    if (QFile::exists(szProFName))
+        printf("Warning: library prototype database %s: %s\n", qPrintable(szProFName), error.c_str());
+    szProFName = dir.absoluteFilePath(DCCLIBS_DAT);
+    if (not QFile::exists(szProFName))
     {
         printf("Warning: cannot open library prototype data file %s\n", qPrintable(szProFName));
         return;
     }
-
-    grab(4, fProto);
-    if (strncmp(buf, "dccp", 4) != 0)
+    if (not protos.openLegacy(qPrintable(szProFName), error))
     {
-        printf("%s is not a dcc prototype file\n", qPrintable(szProFName));
+        printf("%s: %s\n", qPrintable(szProFName), error.c_str());
         exit(1);
     }
-
-    grab(2, fProto);
-    if (strncmp(buf, "FN", 2) != 0)
-    {
-        printf("FN (Function Name) subsection expected in %s\n", qPrintable(szProFName));
-        exit(2);
-    }
-
-    numFunc = readFileShort(fProto);     /* Num of entries to allocate */
-
-    /* Allocate exactly correct # entries */
-    pFunc = new PH_FUNC_STRUCT[numFunc];
-
-    for (i=0; i < numFunc; i++)
-    {
-        size_t read_size=fread(&pFunc[i], 1, SYMLEN, fProto);
-        assert(read_size==SYMLEN);
-        if(read_size!=SYMLEN)
-            break;
-        pFunc[i].typ      = (hlType)readFileShort(fProto);
-        pFunc[i].numArg   = readFileShort(fProto);
-        pFunc[i].firstArg = readFileShort(fProto);
-        if(feof(fProto))
-            break;
-        int c = fgetc(fProto);
-        pFunc[i].bVararg = (c!=0); //fread(&pFunc[i].bVararg, 1, 1, fProto);
-    }
-
-    grab(2, fProto);
-    if (strncmp(buf, "PM", 2) != 0)
-    {
-        printf("PM (Parameter) subsection expected in %s\n", qPrintable(szProFName));
-        exit(2);
-    }
-
-    numArg = readFileShort(fProto);     /* Num of entries to allocate */
-
-    /* Allocate exactly correct # entries */
-    delete [] pArg;
-    pArg = new hlType[numArg];
-
-    for (i=0; i < numArg; i++)
-    {
-        //      fread(&pArg[i], 1, SYMLEN, fProto);     /* No names to read as yet */
-        pArg[i] = (hlType) readFileShort(fProto);
-    }
-
-    fclose(fProto);
-
-}
-
-int searchPList(char *name)
-{
-    /* Search through the symbol names for the name */
-    /* Use binary search */
-    int mx, mn, i, res;
-
-
-    mx = numFunc;
-    mn = 0;
-
-    while (mn < mx)
-    {
-        i = (mn + mx) /2;
-        res = strcmp(pFunc[i].name, name);
-        if (res == 0)
-        {
-            return i;            /* Found! */
-        }
-        else
-        {
-            if (res < 0)
-            {
-                mn = i+1;
-            }
-            else
-            {
-                mx = i-1;
-            }
-        }
-    }
-
-    /* Still could be the case that mn == mx == required record */
-    res = strcmp(pFunc[mn].name, name);
-    if (res == 0)
-    {
-        return mn;            /* Found! */
-    }
-    return NIL;
 }
 
 
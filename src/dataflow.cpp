@@ -6,6 +6,7 @@
  ****************************************************************************/
 
 #include "dcc.h"
+#include "ExprSimplifier.h"
 #include "project.h"
 #include "msvc_fixes.h"
 
@@ -16,6 +17,8 @@
 #include <boost/assign.hpp>
 #include <stdint.h>
 #include <cstring>
+#include <deque>
+#include <map>
 #include <iostream>
 #include <iomanip>
 #include <cstdio>
@@ -60,7 +63,7 @@ Expr *srcIdent (const LLInst &ll_insn, Function * pProc, iICODE i, ICODE & duIco
     if (src_op->isImmediate())   /* immediate operand ll_insn.testFlags(I)*/
     {
         //if (ll_insn.testFlags(B))
-        return new Constant(src_op->getImm2(), src_op->byteWidth());
+        return Constant::Create(src_op->getImm2(), src_op->byteWidth());
     }
     // otherwise
     return AstIdent::id (ll_insn, SRC, pProc, i, duIcode, du);
@@ -87,7 +90,7 @@ void forwardSubsLong (int longIdx, Expr *_exp, ICODE &picode, ICODE &ticode, int
     res = Expr::insertSubTreeLongReg (_exp, ticode.hlU()->asgn.m_rhs, longIdx);
     if (res)
     {
-        picode.invalidate();
+        picode.forwardSubstituted();
         (*numHlIcodes)--;
     }
     else
@@ -96,7 +99,7 @@ void forwardSubsLong (int longIdx, Expr *_exp, ICODE &picode, ICODE &ticode, int
         res = Expr::insertSubTreeLongReg (_exp, ticode.hlU()->asgn.m_lhs, longIdx);
         if (res)
         {
-            picode.invalidate();
+            picode.forwardSubstituted();
             (*numHlIcodes)--;
         }
     }
@@ -156,45 +159,194 @@ size_t STKFRAME::getLocVar(int off)
 }
 
 
+namespace
+{
+/** For each of the 8 flag bits, the icode whose definition of that flag reaches a program point */
+struct FlagDefs
+{
+    enum eState : uint8_t
+    {
+        UNKNOWN=0,  /* not reached yet (lattice top)          */
+        UNIQUE,     /* a single definition reaches            */
+        NONE        /* undefined, or several definitions reach*/
+    };
+    eState  state[8];
+    iICODE  at[8];
+    FlagDefs(eState s=UNKNOWN)
+    {
+        std::fill(state,state+8,s);
+    }
+    /* Kills and regenerates the flags in mask */
+    void define(uint8_t mask, iICODE ic)
+    {
+        for(int b=0; b<8; ++b)
+            if(mask & (1<<b))
+            {
+                state[b] = UNIQUE;
+                at[b] = ic;
+            }
+    }
+    /* Out(pred) is merged into this In set; returns true if it changed */
+    bool meet(const FlagDefs &o)
+    {
+        bool changed=false;
+        for(int b=0; b<8; ++b)
+        {
+            eState res = state[b];
+            if(o.state[b]==UNKNOWN or state[b]==NONE)
+                continue;
+            if(state[b]==UNKNOWN)
+            {
+                res = o.state[b];
+                at[b] = o.at[b];
+            }
+            else if(o.state[b]==NONE or at[b]!=o.at[b])
+                res = NONE;
+            changed |= (res!=state[b]);
+            state[b] = res;
+        }
+        return changed;
+    }
+    /* Returns true, and the icode in res, if all flags in use are defined by the same icode */
+    bool singleDef(uint8_t use, iICODE &res) const
+    {
+        bool first=true;
+        for(int b=0; b<8; ++b)
+        {
+            if(0==(use & (1<<b)))
+                continue;
+            if(state[b]!=UNIQUE or (not first and at[b]!=res))
+                return false;
+            res = at[b];
+            first = false;
+        }
+        return not first;
+    }
+};
+/** Per basic block flag summary: gen is the last definer of each flag within the block, kill its mask */
+struct FlagBlockInfo
+{
+    FlagDefs    gen;
+    uint8_t     kill=0;
+    FlagDefs    in;
+    FlagDefs    out;
+    bool        queued=false;
+};
+} // end of anonymous namespace
+
+/** Computes the definitions of condition codes reaching the start of each basic block.
+ * Flags are tracked as 8-bit masks; blocks are summarized by gen/kill and the reaching definitions are
+ * propagated forward with a worklist, so flags set in one block and tested in a successor are resolved
+ * whenever a single definition reaches the test.
+ * \returns In sets indexed as m_dfsLast */
+static std::vector<FlagBlockInfo> reachingFlagDefs(std::vector<BB *> &dfsLast)
+{
+    std::vector<FlagBlockInfo> info(dfsLast.size());
+    std::vector<size_t> worklist;
+    std::map<const BB *,size_t> index_of;
+    for(size_t i=0; i<dfsLast.size(); ++i)
+        index_of[dfsLast[i]] = i;
+    for(size_t i=0; i<dfsLast.size(); ++i)
+    {
+        BB *pbb = dfsLast[i];
+        if(not pbb->valid())
+            continue;
+        FlagBlockInfo &bi(info[i]);
+        for(iICODE ic=pbb->begin(); ic!=pbb->end(); ++ic)
+        {
+            uint8_t d = ic->ll()->flagDU.d;
+            bi.gen.define(d,ic);
+            bi.kill |= d;
+        }
+    }
+    if(dfsLast.empty())
+        return info;
+    /* Nothing is defined on procedure entry */
+    info[0].in = FlagDefs(FlagDefs::NONE);
+    info[0].queued = true;
+    worklist.push_back(0);
+    while(not worklist.empty())
+    {
+        size_t idx = worklist.back();
+        worklist.pop_back();
+        FlagBlockInfo &bi(info[idx]);
+        bi.queued = false;
+        bi.out = bi.in;
+        for(int b=0; b<8; ++b)
+            if(bi.kill & (1<<b))
+            {
+                bi.out.state[b] = bi.gen.state[b];
+                bi.out.at[b] = bi.gen.at[b];
+            }
+        for(const TYPEADR_TYPE &edge : dfsLast[idx]->edges)
+        {
+            auto succ = index_of.find(edge.BBptr);
+            if(succ==index_of.end() or not edge.BBptr->valid())
+                continue;
+            FlagBlockInfo &si(info[succ->second]);
+            if(si.in.meet(bi.out) and not si.queued)
+            {
+                si.queued = true;
+                worklist.push_back(succ->second);
+            }
+        }
+    }
+    return info;
+}
+
 /* Eliminates all condition codes and generates new hlIcode instructions */
 void Function::elimCondCodes ()
 {
-    //    int i;
-
     uint8_t use;           /* Used flags bit vector                  */
-    uint8_t def;           /* Defined flags bit vector               */
     bool notSup;       /* Use/def combination not supported      */
     Expr *rhs;     /* Source operand                         */
     Expr *lhs;     /* Destination operand                    */
     BinaryOperator *_expr;   /* Boolean expression                     */
-    //BB * pBB;           /* Pointer to BBs in dfs last ordering    */
-    riICODE useAt;      /* Instruction that used flag    */
-    riICODE defAt;      /* Instruction that defined flag */
-    //lhs=rhs=_expr=0;
-    auto valid_reversed_bbs = (m_dfsLast | reversed | filtered(BB::ValidFunctor()) );
-    for( BB * pBB : valid_reversed_bbs)
+    iICODE useAt;      /* Instruction that used flag    */
+    iICODE defAt;      /* Instruction that defined flag */
+    std::vector<FlagBlockInfo> flag_info = reachingFlagDefs(m_dfsLast);
+    std::vector<std::pair<iICODE,iICODE> > flag_uses; /* (use, def) pairs of one BB, def==end() if not found */
+    for(size_t bb_idx=m_dfsLast.size(); bb_idx-- > 0; )
     {
-        //auto reversed_instructions = pBB->range() | reversed;
-        for (useAt = pBB->rbegin(); useAt != pBB->rend(); useAt++)
+        BB * pBB = m_dfsLast[bb_idx];
+        if(not pBB->valid())
+            continue;
+        /* Resolve the definition of every flag use of this BB in one forward sweep */
+        FlagDefs current = flag_info[bb_idx].in;
+        flag_uses.clear();
+        for (iICODE ic = pBB->begin(); ic != pBB->end(); ++ic)
         {
+            use = ic->ll()->flagDU.u;
+            if ((ic->type == LOW_LEVEL_ICODE) and ic->valid() and ( 0 != use ))
+            {
+                if(not current.singleDef(use,defAt))
+                {
+                    /* Flags set by different instructions, pick the closest one defining all of them */
+                    defAt = Icode.end();
+                    for(riICODE scan=riICODE(ic); scan!=pBB->rend(); ++scan)
+                        if ((use & scan->ll()->flagDU.d) == use)
+                        {
+                            defAt = (++riICODE(scan)).base();
+                            break;
+                        }
+                }
+                flag_uses.push_back(std::make_pair(ic,defAt));
+            }
+            current.define(ic->ll()->flagDU.d,ic);
+        }
+        for (auto use_def = flag_uses.rbegin(); use_def != flag_uses.rend(); ++use_def)
+        {
+            useAt = use_def->first;
+            defAt = use_def->second;
             llIcode useAtOp = llIcode(useAt->ll()->getOpcode());
-            use = useAt->ll()->flagDU.u;
-            if ((useAt->type != LOW_LEVEL_ICODE) or ( not useAt->valid() ) or ( 0 == use ))
-                continue;
-            /* Find definition within the same basic block */
-            defAt=useAt;
-            ++defAt;
-            for (; defAt != pBB->rend(); defAt++)
+            if (defAt != Icode.end())
             {
                 ICODE &defIcode(*defAt);
-                def = defAt->ll()->flagDU.d;
-                if ((use & def) != use)
-                    continue;
                 notSup = false;
                 LLOperand *dest_ll = defIcode.ll()->get(DST);
                 if ((useAtOp >= iJB) and (useAtOp <= iJNS))
                 {
-                    iICODE befDefAt = (++riICODE(defAt)).base();
+                    iICODE befDefAt = defAt;
                     switch (defIcode.ll()->getOpcode())
                     {
                     case iCMP:
@@ -206,7 +358,7 @@ void Function::elimCondCodes ()
                         lhs = defIcode.hl()->asgn.lhs()->clone();
                         useAt->copyDU(*defAt, eUSE, eDEF);
                         //if (defAt->ll()->testFlags(B))
-                        rhs = new Constant(0, dest_ll->byteWidth());
+                        rhs = Constant::Create(0, dest_ll->byteWidth());
                         break;
 
                     case iTEST:
@@ -214,13 +366,13 @@ void Function::elimCondCodes ()
                         lhs = dstIdent (*defIcode.ll(),this, befDefAt,*useAt, eUSE);
                         lhs = BinaryOperator::And(lhs, rhs);
                         //                            if (defAt->ll()->testFlags(B))
-                        rhs = new Constant(0, dest_ll->byteWidth());
+                        rhs = Constant::Create(0, dest_ll->byteWidth());
                         break;
                     case iINC:
                     case iDEC: //WARNING: verbatim copy from iOR needs fixing ?
                         lhs = defIcode.hl()->asgn.lhs()->clone();
                         useAt->copyDU(*defAt, eUSE, eDEF);
-                        rhs = new Constant(0, dest_ll->byteWidth());
+                        rhs = Constant::Create(0, dest_ll->byteWidth());
                         break;
                     default:
                         notSup = true;
@@ -242,7 +394,7 @@ void Function::elimCondCodes ()
                     //NOTICE: was rCX, 0
                     lhs = new RegisterNode(LLOperand(rCX, 0 ), &localId);
                     useAt->setRegDU (rCX, eUSE);
-                    rhs = new Constant(0, 2);
+                    rhs = Constant::Create(0, 2);
                     _expr = BinaryOperator::Create(EQUAL,lhs,rhs);
                     useAt->setJCond(_expr);
                 }
@@ -256,11 +408,10 @@ void Function::elimCondCodes ()
                     reportError (NOT_DEF_USE,a.ll()->label,a.ll()->getOpcode(),b.ll()->getOpcode());
                     flg |= PROC_ASM;		/* generate asm */
                 }
-                break;
             }
 
             /* Check for extended basic block */
-            if ((pBB->size() == 1) and(useAtOp >= iJB) and (useAtOp <= iJNS))
+            else if ((pBB->size() == 1) and(useAtOp >= iJB) and (useAtOp <= iJNS))
             {
                 ICODE & _prev(pBB->back()); /* For extended basic blocks - previous icode inst */
                 if (_prev.hl()->opcode == HLI_JCOND)
@@ -273,7 +424,7 @@ void Function::elimCondCodes ()
                 }
             }
             /* Error - definition not found for use of a cond code */
-            else if (defAt == pBB->rend())
+            else
             {
                 reportError(DEF_NOT_FOUND,useAtOp);
             }
@@ -314,115 +465,131 @@ void Function::genLiveKtes ()
 }
 
 
-/* Generates the liveIn() and liveOut() sets for each basic block via an
- * iterative approach.
+/* Generates the liveIn() and liveOut() sets for each basic block with a
+ * worklist solver: every valid block is visited once in reverse dfsLast
+ * order, after which only the predecessors of blocks whose liveIn changed
+ * are revisited.
  * Propagates register usage information to the procedure call. */
 void Function::liveRegAnalysis (LivenessSet &in_liveOut)
 {
-    using namespace boost::adaptors;
-    using namespace boost::assign;
-    //BB * pbb=0;             /* pointer to current basic block   */
     Function * pcallee;     /* invoked subroutine               */
-    //ICODE  *ticode        /* icode that invokes a subroutine  */
-    ;
-    LivenessSet prevLiveOut,	/* previous live out 				*/
-            prevLiveIn;		/* previous live in					*/
-    bool change;			/* is there change in the live sets?*/
+    LivenessSet prevLiveIn;	/* previous live in					*/
+    std::map<const BB *,size_t> index_of;
+    std::vector<std::vector<size_t> > preds(m_dfsLast.size());
+    std::vector<bool> queued(m_dfsLast.size(),false);
+    std::deque<size_t> worklist;
 
     /* liveOut for this procedure */
     liveOut = in_liveOut;
 
-    change = true;
-    while (change)
+    for(size_t i=0; i<m_dfsLast.size(); ++i)
+        index_of[m_dfsLast[i]] = i;
+    for(size_t i=m_dfsLast.size(); i-- > 0; )
     {
-        /* Process nodes in reverse postorder order */
-        change = false;
-        auto valid_reversed_bbs = (m_dfsLast | reversed | filtered(BB::ValidFunctor()) );
-        for( BB * pbb : valid_reversed_bbs) // for each valid pbb in reversed dfs order
+        BB *pbb = m_dfsLast[i];
+        if(not pbb->valid())
+            continue;
+        for(TYPEADR_TYPE &e : pbb->edges)
         {
+            auto succ = index_of.find(e.BBptr);
+            if(succ!=index_of.end())
+                preds[succ->second].push_back(i);
+        }
+        queued[i] = true;
+        worklist.push_back(i);
+    }
+    while (not worklist.empty())
+    {
+        size_t bb_idx = worklist.front();
+        BB * pbb = m_dfsLast[bb_idx];
+        worklist.pop_front();
+        queued[bb_idx] = false;
+        Instrumentation::count(this,CNT_LIVENESS_VISITS);
+        prevLiveIn  = pbb->liveIn;
+
+        /* liveOut(b) = U LiveIn(s); where s is successor(b)
+         * liveOut(b) = {liveOut}; when b is a HLI_RET node     */
+        if (pbb->edges.empty())      /* HLI_RET node         */
+        {
+            pbb->liveOut = in_liveOut;
 
-            /* Get current liveIn() and liveOut() sets */
-            prevLiveIn  = pbb->liveIn;
-            prevLiveOut = pbb->liveOut;
-
-            /* liveOut(b) = U LiveIn(s); where s is successor(b)
-             * liveOut(b) = {liveOut}; when b is a HLI_RET node     */
-            if (pbb->edges.empty())      /* HLI_RET node         */
+            /* Get return expression of function */
+            if (flg & PROC_IS_FUNC)
             {
-                pbb->liveOut = in_liveOut;
-
-                /* Get return expression of function */
-                if (flg & PROC_IS_FUNC)
+                auto picode = pbb->rbegin(); /* icode of function return */
+                if (picode->hl()->opcode == HLI_RET)
                 {
-                    auto picode = pbb->rbegin(); /* icode of function return */
-                    if (picode->hl()->opcode == HLI_RET)
-                    {
-                        picode->hlU()->expr(AstIdent::idID(&retVal, &localId, (++pbb->rbegin()).base()));
-                        picode->du.use = in_liveOut;
-                    }
+                    picode->hlU()->expr(AstIdent::idID(&retVal, &localId, (++pbb->rbegin()).base()));
+                    picode->du.use = in_liveOut;
                 }
             }
-            else                            /* Check successors */
+        }
+        else                            /* Check successors */
+        {
+            for(TYPEADR_TYPE &e : pbb->edges)
+            {
+                pbb->liveOut |= e.BBptr->liveIn;
+            }
+
+            /* propagate to invoked procedure */
+            if (pbb->nodeType == CALL_NODE)
             {
-                for(TYPEADR_TYPE &e : pbb->edges)
+                ICODE &ticode(pbb->back());
+                pcallee = ticode.hl()->call.proc;
+
+                /* user/runtime routine */
+                if (not (pcallee->flg & PROC_ISLIB))
                 {
-                    pbb->liveOut |= e.BBptr->liveIn;
+                    if (pcallee->liveAnal == false) /* hasn't been processed */
+                        pcallee->dataFlow (pbb->liveOut);
+                    pbb->liveOut = pcallee->liveIn;
                 }
-
-                /* propagate to invoked procedure */
-                if (pbb->nodeType == CALL_NODE)
+                else    /* library routine */
                 {
-                    ICODE &ticode(pbb->back());
-                    pcallee = ticode.hl()->call.proc;
-
-                    /* user/runtime routine */
-                    if (not (pcallee->flg & PROC_ISLIB))
-                    {
-                        if (pcallee->liveAnal == false) /* hasn't been processed */
-                            pcallee->dataFlow (pbb->liveOut);
-                        pbb->liveOut = pcallee->liveIn;
-                    }
-                    else    /* library routine */
-                    {
-                        if ( (pcallee->flg & PROC_IS_FUNC) and /* returns a value */
-                             (pcallee->liveOut & pbb->edges[0].BBptr->liveIn).any()
-                             )
-                            pbb->liveOut = pcallee->liveOut;
-                        else
-                            pbb->liveOut.reset();
-                    }
+                    if ( (pcallee->flg & PROC_IS_FUNC) and /* returns a value */
+                         (pcallee->liveOut & pbb->edges[0].BBptr->liveIn).any()
+                         )
+                        pbb->liveOut = pcallee->liveOut;
+                    else
+                        pbb->liveOut.reset();
+                }
 
-                    if ((not (pcallee->flg & PROC_ISLIB)) or ( pbb->liveOut.any() ))
-                    {
-                        switch (pcallee->retVal.type) {
-                        case TYPE_LONG_SIGN:
-                        case TYPE_LONG_UNSIGN:
-                            ticode.du1.setDef(rAX).addDef(rDX);
-                            //TODO: use Calling convention to properly set regs here
-                            break;
-                        case TYPE_WORD_SIGN: case TYPE_WORD_UNSIGN:
-                        case TYPE_BYTE_SIGN: case TYPE_BYTE_UNSIGN:
-                            ticode.du1.setDef(rAX);
-                            break;
-                        default:
-                            ticode.du1 = ICODE::DU1(); // was .numRegsDef = 0
-                            //fprintf(stderr,"Function::liveRegAnalysis : Unknown return type %d, assume 0\n",pcallee->retVal.type);
-                        } /*eos*/
+                if ((not (pcallee->flg & PROC_ISLIB)) or ( pbb->liveOut.any() ))
+                {
+                    switch (pcallee->retVal.type) {
+                    case TYPE_LONG_SIGN:
+                    case TYPE_LONG_UNSIGN:
+                        ticode.du1.setDef(rAX).addDef(rDX);
+                        //TODO: use Calling convention to properly set regs here
+                        break;
+                    case TYPE_WORD_SIGN: case TYPE_WORD_UNSIGN:
+                    case TYPE_BYTE_SIGN: case TYPE_BYTE_UNSIGN:
+                        ticode.du1.setDef(rAX);
+                        break;
+                    default:
+                        ticode.du1 = ICODE::DU1(); // was .numRegsDef = 0
+                        //fprintf(stderr,"Function::liveRegAnalysis : Unknown return type %d, assume 0\n",pcallee->retVal.type);
+                    } /*eos*/
 
-                        /* Propagate def/use results to calling icode */
-                        ticode.du.use = pcallee->liveIn;
-                        ticode.du.def = pcallee->liveOut;
-                    }
+                    /* Propagate def/use results to calling icode */
+                    ticode.du.use = pcallee->liveIn;
+                    ticode.du.def = pcallee->liveOut;
                 }
             }
+        }
 
-            /* liveIn(b) = liveUse(b) U (liveOut(b) - def(b) */
-            pbb->liveIn = LivenessSet(pbb->liveUse + (pbb->liveOut - pbb->def));
+        /* liveIn(b) = liveUse(b) U (liveOut(b) - def(b) */
+        pbb->liveIn = LivenessSet(pbb->liveUse + (pbb->liveOut - pbb->def));
 
-            /* Check if live sets have been modified */
-            if ((prevLiveIn != pbb->liveIn) or (prevLiveOut != pbb->liveOut))
-                change = true;
-        }
+        /* Revisit the predecessors if liveIn has been modified */
+        if (prevLiveIn == pbb->liveIn)
+            continue;
+        for(size_t pred : preds[bb_idx])
+            if(m_dfsLast[pred]->valid() and not queued[pred])
+            {
+                queued[pred] = true;
+                worklist.push_back(pred);
+            }
     }
     BB *pbb = m_dfsLast.front();
     /* Propagate liveIn(b) to procedure header */
@@ -529,18 +696,9 @@ void BB::RemoveUnusedDefs(eReg regi, int defRegIdx, iICODE picode)
     {
         if (not (this->liveOut.testRegAndSubregs(regi)))	/* not liveOut */
         {
-            bool res = picode->removeDefRegi (regi, defRegIdx+1,&Parent->localId);
-            if (res == true)
-            {
-
-                /* Backpatch any uses of this instruction, within
-                 * the same BB, if the instruction was invalidated */
-                rICODE the_rest(begin(),picode);
-                for ( ICODE &back_patch_at : the_rest|reversed)
-                {
-                    back_patch_at.du1.remove(0,picode);
-                }
-            }
+            /* If the instruction gets invalidated, its uses of earlier
+             * definitions are unlinked from their chains as well */
+            picode->removeDefRegi (regi, defRegIdx+1,&Parent->localId);
         }
         else		/* liveOut */
             picode->du.lastDefRegi.addReg(regi);
@@ -612,7 +770,7 @@ void LOCAL_ID::forwardSubs (Expr *lhs, Expr *rhs, ICODE &picode, ICODE &ticode,
     res = Expr::insertSubTreeReg (ticode.hlU()->asgn.m_rhs,rhs, id_arr[lhs_reg->regiIdx].id.regi, this);
     if (res)
     {
-        picode.invalidate();
+        picode.forwardSubstituted();
         numHlIcodes--;
     }
     else
@@ -632,7 +790,7 @@ void LOCAL_ID::forwardSubs (Expr *lhs, Expr *rhs, ICODE &picode, ICODE &ticode,
         res = Expr::insertSubTreeReg (ticode.hlU()->asgn.m_lhs,rhs, id_arr[lhs_reg->regiIdx].id.regi, this);
         if (res)
         {
-            picode.invalidate();
+            picode.forwardSubstituted();
             numHlIcodes--;
         }
     }
@@ -709,7 +867,7 @@ int C_CallingConvention::processCArg (Function * callee, Function * pProc, ICODE
                                     size_of_arg += 2;
                                 }
                             } else if(idn) {
-                                Expr *tmp1 = new Constant(2,1);
+                                Expr *tmp1 = Constant::Create(2,1);
                                 Expr *tmp2 = BinaryOperator::createSHL(_exp,tmp1);
                                 _exp = BinaryOperator::CreateAdd(g_exp_stk.top(),tmp2);
                                 g_exp_stk.pop(); // pop segment
@@ -792,14 +950,14 @@ void LOCAL_ID::processTargetIcode(ICODE &picode, int &numHlIcodes, ICODE &ticode
         }
         if (res)
         {
-            picode.invalidate();
+            picode.forwardSubstituted();
             numHlIcodes--;
         }
         break;
 
     case HLI_CALL:    /* register arguments */
         newRegArg ( picode, ticode);
-        picode.invalidate();
+        picode.forwardSubstituted();
         numHlIcodes--;
         break;
     default:
@@ -914,13 +1072,13 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                     /* Replace rhs of current icode into target
                          * icode expression */
 
-                    ticode = _ic.du1.idx[0].uses.front();
+                    ticode = _ic.du1.firstUse(0);
                     if ((_ic.du.lastDefRegi.testRegAndSubregs(regi)) and
                             ((ticode->hl()->opcode != HLI_CALL) and
                              (ticode->hl()->opcode != HLI_RET)))
                         continue;
 
-                    if (_icHl.asgn.m_rhs->xClear (make_iterator_range(picode.base(),_ic.du1.idx[0].uses[0]),
+                    if (_icHl.asgn.m_rhs->xClear (make_iterator_range(picode.base(),_ic.du1.firstUse(0)),
                                                 end(), locals))
                     {
                         locals.processTargetIcode(_ic, numHlIcodes, *ticode,false);
@@ -928,11 +1086,11 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                     break;
 
                 case HLI_POP:
-                    // TODO: sometimes picode->du1.idx[0].uses.front() points to next basic block ?
+                    // TODO: sometimes picode->du1.firstUse(0) points to next basic block ?
                     // pop X
                     // lab1:
                     //   call F() <- somehow this is marked as user of POP ?
-                    ticode = _ic.du1.idx[0].uses.front();
+                    ticode = _ic.du1.firstUse(0);
                     ti_hl = ticode->hlU();
                     if ((_ic.du.lastDefRegi.testRegAndSubregs(regi)) and
                             ((ti_hl->opcode != HLI_CALL) and
@@ -955,7 +1113,7 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                                 &locals);
                         if (res)
                         {
-                            _ic.invalidate();
+                            _ic.forwardSubstituted();
                             numHlIcodes--;
                         }
                     }
@@ -973,7 +1131,7 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                     break;
 
                 case HLI_CALL:
-                    ticode = _ic.du1.idx[0].uses.front();
+                    ticode = _ic.du1.firstUse(0);
                     ti_hl = ticode->hlU();
                     _retVal = &_icHl.call.proc->retVal;
                     switch (ti_hl->opcode)
@@ -985,13 +1143,13 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                         if (not res)
                             Expr::insertSubTreeReg (ti_hl->asgn.m_lhs, _exp,_retVal->id.regi, &locals);
                         //TODO: HERE missing: 2 regs
-                        _ic.invalidate();
+                        _ic.forwardSubstituted();
                         numHlIcodes--;
                         break;
 
                     case HLI_PUSH: case HLI_RET:
                         ti_hl->expr( _icHl.call.toAst() );
-                        _ic.invalidate();
+                        _ic.forwardSubstituted();
                         numHlIcodes--;
                         break;
 
@@ -1000,7 +1158,7 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                         res = Expr::insertSubTreeReg (ti_hl->exp.v, _exp, _retVal->id.regi, &locals);
                         if (res)	/* was substituted */
                         {
-                            _ic.invalidate();
+                            _ic.forwardSubstituted();
                             numHlIcodes--;
                         }
                         else	/* cannot substitute function */
@@ -1031,9 +1189,9 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                 case HLI_ASSIGN:
                     /* Replace rhs of current icode into target
                          * icode expression */
-                    if (_ic.du1.idx[0].uses[0] == _ic.du1.idx[1].uses[0])
+                    if (_ic.du1.firstUse(0) == _ic.du1.firstUse(1))
                     {
-                        ticode = _ic.du1.idx[0].uses.front();
+                        ticode = _ic.du1.firstUse(0);
                         if ((_ic.du.lastDefRegi.testRegAndSubregs(regi)) and
                                 ((ticode->hl()->opcode != HLI_CALL) and
                                  (ticode->hl()->opcode != HLI_RET)))
@@ -1043,9 +1201,9 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                     break;
 
                 case HLI_POP:
-                    if (_ic.du1.idx[0].uses[0] == _ic.du1.idx[1].uses[0])
+                    if (_ic.du1.firstUse(0) == _ic.du1.firstUse(1))
                     {
-                        ticode = _ic.du1.idx[0].uses.front();
+                        ticode = _ic.du1.firstUse(0);
                         if ((_ic.du.lastDefRegi.testRegAndSubregs(regi)) and
                                 ((ticode->hl()->opcode != HLI_CALL) and
                                  (ticode->hl()->opcode != HLI_RET)))
@@ -1063,7 +1221,7 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                                                               dynamic_cast<AstIdent *>(_icHl.asgn.lhs())->ident.idNode.longIdx);
                             if (res)
                             {
-                                _ic.invalidate();
+                                _ic.forwardSubstituted();
                                 numHlIcodes--;
                             }
                             break;
@@ -1076,7 +1234,7 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                     break;
 
                 case HLI_CALL:    /* check for function return */
-                    ticode = _ic.du1.idx[0].uses.front();
+                    ticode = _ic.du1.firstUse(0);
                     switch (ticode->hl()->opcode)
                     {
                     case HLI_ASSIGN:
@@ -1086,14 +1244,14 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                                                    ticode,HIGH_FIRST, picode.base(),
                                                    eDEF, *(++iICODE(ticode))->ll()));
                         ticode->hlU()->asgn.m_rhs = _exp;
-                        _ic.invalidate();
+                        _ic.forwardSubstituted();
                         numHlIcodes--;
                         break;
 
                     case HLI_PUSH:
                     case HLI_RET:
                         ticode->hlU()->expr( _icHl.call.toAst() );
-                        _ic.invalidate();
+                        _ic.forwardSubstituted();
                         numHlIcodes--;
                         break;
 
@@ -1105,7 +1263,7 @@ void BB::findBBExps(LOCAL_ID &locals,Function *fnc)
                                                           locals.newLongReg ( _retVal->type, _retVal->longId(), picode.base()));
                         if (res)	/* was substituted */
                         {
-                            _ic.invalidate();
+                            _ic.forwardSubstituted();
                             numHlIcodes--;
                         }
                         else	/* cannot substitute function */
@@ -1170,6 +1328,38 @@ void Function::findExps()
         pbb->findBBExps( this->localId, this);
     }
 }
+/* Simplifies the expressions of all high-level icodes left by findExps() */
+void Function::simplifyExps()
+{
+    ScopedPassTimer timer(PASS_SIMPLIFY,this);
+    ExprSimplifier simplifier;
+    for(ICODE &ic : Icode)
+    {
+        if(not ic.valid() or ic.type != HIGH_LEVEL_ICODE)
+            continue;
+        HLTYPE &hl(*ic.hlU());
+        switch(hl.opcode)
+        {
+            case HLI_ASSIGN:
+                hl.asgn.m_lhs = simplifier.simplify(hl.asgn.m_lhs);
+                hl.asgn.m_rhs = simplifier.simplify(hl.asgn.m_rhs);
+                break;
+            case HLI_JCOND:
+                hl.exp.v = simplifier.simplify(hl.exp.v,true);
+                break;
+            case HLI_RET:
+            case HLI_PUSH:
+                hl.exp.v = simplifier.simplify(hl.exp.v);
+                break;
+            case HLI_CALL:
+                simplifier.simplifyArgs(hl.call.args);
+                break;
+            default:
+                break;
+        }
+    }
+    Instrumentation::count(this,CNT_SIMPLIFIED,simplifier.rewrites());
+}
 
 void Function::preprocessReturnDU(LivenessSet &_liveOut)
 {
@@ -1225,6 +1415,7 @@ void Function::preprocessReturnDU(LivenessSet &_liveOut)
         {
             retVal.type = TYPE_LONG_SIGN;
             retVal.loc = REG_FRAME;
+            Expr::symbolTypesChanged();
             retVal.longId() = LONGID_TYPE(rDX,rAX);
             /*idx = */localId.newLongReg(TYPE_LONG_SIGN, LONGID_TYPE(rDX,rAX), Icode.begin());
             localId.propLongId (rAX, rDX, "");
@@ -1233,6 +1424,7 @@ void Function::preprocessReturnDU(LivenessSet &_liveOut)
         {
             retVal.type = TYPE_WORD_SIGN;
             retVal.loc = REG_FRAME;
+            Expr::symbolTypesChanged();
             if (isAx)
                 retVal.id.regi = rAX;
             else if (isBx)
@@ -1247,6 +1439,7 @@ void Function::preprocessReturnDU(LivenessSet &_liveOut)
         {
             retVal.type = TYPE_BYTE_SIGN;
             retVal.loc = REG_FRAME;
+            Expr::symbolTypesChanged();
             if (isAL)
                 retVal.id.regi = rAL;
             else if (isBL)
@@ -1261,6 +1454,7 @@ void Function::preprocessReturnDU(LivenessSet &_liveOut)
         {
             retVal.type = TYPE_BYTE_SIGN;
             retVal.loc = REG_FRAME;
+            Expr::symbolTypesChanged();
             if (isAH)
                 retVal.id.regi = rAH;
             else if (isBH)
@@ -1278,6 +1472,8 @@ void Function::preprocessReturnDU(LivenessSet &_liveOut)
  \note indirect recursion in liveRegAnalysis is possible. */
 void Function::dataFlow(LivenessSet &_liveOut)
 {
+    ScopedPassTimer timer(PASS_DATAFLOW,this);
+    ExprArena::Scope arena_scope(exprArena());
 
     /* Remove references to register variables */
     if (flg & SI_REGVAR)
@@ -1297,5 +1493,6 @@ void Function::dataFlow(LivenessSet &_liveOut)
     {
         genDU1 ();			/* generate def/use level 1 chain */
         findExps (); 		/* forward substitution algorithm */
+        simplifyExps ();    /* constant folding, identities */
     }
 }
@@ -10,13 +10,20 @@
 #include "project.h"
 #include "CallGraph.h"
 #include "DccFrontend.h"
+#include "idiom.h"
+#include "ExprSimplifier.h"
+#include "ParallelDiscovery.h"
+#include "SignatureIndex.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <QtCore/QCoreApplication>
 #include <QCommandLineParser>
 
+#include <QtCore/QDebug>
 #include <QtCore/QFile>
+#include <QtCore/QTextStream>
 
 
 /* Global variables - extern to other modules */
@@ -51,13 +58,22 @@ void setupOptions(const QCoreApplication &app) {
                                         QCoreApplication::translate("main", "Place output into <file>."),
                                         QCoreApplication::translate("main", "file"));
     QCommandLineOption entryPointOption(QStringList() << "E",
-                                        QCoreApplication::translate("main", "Custom entry point as hex"),
-                                        QCoreApplication::translate("main", "offset"),
-                                        "0"
+                                        QCoreApplication::translate("main", "Decompile only the procedures at these comma separated hex entry points or with these names."),
+                                        QCoreApplication::translate("main", "entries")
+                                        );
+    QCommandLineOption statsJsonOption(QStringList() << "stats-json",
+                                        QCoreApplication::translate("main", "Write per-pass statistics as JSON into <file>."),
+                                        QCoreApplication::translate("main", "file"));
+    QCommandLineOption parseThreadsOption(QStringList() << "parse-threads",
+                                        QCoreApplication::translate("main", "Decode code ahead of the parse on <n> threads."),
+                                        QCoreApplication::translate("main", "n"),
+                                        "1"
                                         );
     parser.addOption(targetFileOption);
     parser.addOption(assembly);
     parser.addOption(entryPointOption);
+    parser.addOption(statsJsonOption);
+    parser.addOption(parseThreadsOption);
     //parser.addOption(forceOption);
     // Process the actual command line arguments given by the user
     parser.addPositionalArgument("source", QCoreApplication::translate("main", "Dos Executable file to decompile."));
@@ -79,7 +95,12 @@ void setupOptions(const QCoreApplication &app) {
     option.Interact = false;
     option.Calls = parser.isSet(boolOpts[2]);
     option.filename = args.first();
-    option.CustomEntryPoint = parser.value(entryPointOption).toUInt(nullptr,16);
+    for(const QString &entry : parser.values(entryPointOption))
+        option.EntryPoints += entry.split(',',QString::SkipEmptyParts);
+    if(parser.isSet(statsJsonOption))
+        option.StatsJson = parser.value(statsJsonOption);
+    option.ParseThreads = std::max(1,parser.value(parseThreadsOption).toInt());
+    Instrumentation::enable(option.Stats or not option.StatsJson.isEmpty());
     if(parser.isSet(targetFileOption))
         asm1_name = asm2_name = parser.value(targetFileOption);
     else if(option.asm1 or option.asm2) {
@@ -102,8 +123,11 @@ int main(int argc, char **argv)
     Project::get()->create(option.filename);
 
     DccFrontend fe(&app);
-    if(not Project::get()->load()) {
-        return -1;
+    {
+        ScopedPassTimer timer(PASS_LOAD);
+        if(not Project::get()->load()) {
+            return -1;
+        }
     }
     if (option.verbose)
         Project::get()->prog.displayLoadInfo();
@@ -129,6 +153,9 @@ int main(int argc, char **argv)
 
     if (option.Stats)
         displayTotalStats();
+    if (not option.StatsJson.isEmpty() and
+            not Instrumentation::writeJson(option.StatsJson, Project::get()->functions()))
+        qWarning() << "dcc: cannot write statistics to" << option.StatsJson;
 
     return 0;
 }
@@ -142,6 +169,14 @@ displayTotalStats ()
     printf ("  Total number of high-level Icodes: %d\n", stats.totalHL);
     printf ("  Total reduction of instructions  : %2.2f%%\n", 100.0 -
             (stats.totalHL * 100.0) / stats.totalLL);
+    QTextStream ostr(stdout);
+    IdiomRegistry::get().writeStats(ostr);
+    Instrumentation::writeReport(ostr, Project::get()->functions());
+    ExprArena::writeStats(ostr);
+    ExprSimplifier::writeStats(ostr);
+    if(option.ParseThreads > 1)
+        ParallelDiscovery::writeStats(ostr);
+    SignatureIndex::get().writeStats(ostr);
 }
 
 
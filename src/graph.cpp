@@ -33,6 +33,7 @@ void Function::addOutEdgesForConditionalJump(BB * pBB,int next_ip, LLInst *ll)
  ****************************************************************************/
 void Function::createCFG()
 {
+    ScopedPassTimer timer(PASS_CREATE_CFG,this);
     /* Splits Icode associated with the procedure into Basic Blocks.
      * The links between BBs represent the control flow graph of the
      * procedure.
@@ -204,6 +205,7 @@ void Function::freeCFG()
  ****************************************************************************/
 void Function::compressCFG()
 {
+    ScopedPassTimer timer(PASS_COMPRESS_CFG,this);
     BB *pNxt;
     int	ip, first=0, last;
 
@@ -258,6 +260,7 @@ void Function::compressCFG()
 
     /* Allocate storage for dfsLast[] array */
     numBBs = stats.numBBaft;
+    Instrumentation::count(this,CNT_BBS,numBBs);
     m_dfsLast.resize(numBBs,nullptr); // = (BB **)allocMem(numBBs * sizeof(BB *))
 
     /* Now do a dfs numbering traversal and fill in the inEdges[] array */
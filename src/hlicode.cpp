@@ -66,6 +66,16 @@ void ICODE::setJCond(Expr *cexp)
 void ICODE ::invalidate()
 {
     invalid = true;
+    du1.unlinkAll();
+}
+
+/* Invalidates this definition once its value has been forward substituted into its only user; the
+ * definitions this icode used now reach that user instead. */
+void ICODE::forwardSubstituted()
+{
+    if(du1.used(0))
+        du1.moveReachingTo(du1.firstUse(0));
+    invalidate();
 }
 
 
@@ -93,8 +103,7 @@ bool ICODE::removeDefRegi (eReg regi, int thisDefIdx, LOCAL_ID *locId)
         invalidate();
         return true;
     }
-    HlTypeSupport *p=hlU()->get();
-    if(p and p->removeRegFromLong(regi,locId))
+    if(hasHl() and hlU()->removeRegFromLong(regi,locId))
     {
         du1.removeDef(regi); //du1.numRegsDef--;
         //du.def &= maskDuReg[regi];
@@ -305,6 +314,7 @@ static bool  needsLhs(unsigned opc)
  *       refines the HIGH_LEVEL icodes. */
 void Function::highLevelGen()
 {
+    ScopedPassTimer timer(PASS_HLGEN,this);
     size_t numIcode;        /* number of icode instructions */
     iICODE pIcode;          /* ptr to current icode node */
     Expr *rhs;              /* left- and right-hand side of expression */
@@ -333,7 +343,7 @@ void Function::highLevelGen()
             }
         if(ll->getOpcode()==iPUSH) {
             if(ll->testFlags(I)) {
-                lhs = new Constant(src_ll->opz,src_ll->byteWidth());
+                lhs = Constant::Create(src_ll->opz,src_ll->byteWidth());
             }
 //            lhs = AstIdent::id (*pIcode->ll(), DST, this, i, *pIcode, NONE);
         }
@@ -358,7 +368,7 @@ void Function::highLevelGen()
                 break;
 
             case iDEC:
-                rhs = new BinaryOperator(SUB,lhs, new Constant(1, 2));
+                rhs = new BinaryOperator(SUB,lhs, Constant::Create(1, 2));
                 pIcode->setAsgn(lhs, rhs);
                 break;
 
@@ -380,7 +390,7 @@ void Function::highLevelGen()
                 break;
 
             case iINC:
-                rhs = new BinaryOperator(ADD,lhs, new Constant(1, 2));
+                rhs = new BinaryOperator(ADD,lhs, Constant::Create(1, 2));
                 pIcode->setAsgn(lhs, rhs);
                 break;
 
@@ -508,7 +518,6 @@ QString writeJcond (const HLTYPE &h, Function * pProc, int *numLoc)
     Expr *inverted=h.expr()->inverse();
     //inverseCondOp (&h.exp);
     QString inverted_form = inverted->walkCondExpr (pProc, numLoc);
-    delete inverted;
 
     return QString("if %1 {\n").arg(inverted_form);
 }
@@ -517,7 +526,7 @@ QString writeJcond (const HLTYPE &h, Function * pProc, int *numLoc)
 /* Displays the inverse output of a HLI_JCOND icode.  This is used in the case
  * when the THEN clause of an if..then..else is empty.  The clause is
  * negated and the ELSE clause is used instead.	*/
-QString writeJcondInv(HLTYPE h, Function * pProc, int *numLoc)
+QString writeJcondInv(const HLTYPE &h, Function * pProc, int *numLoc)
 {
     QString _form;
 
@@ -561,25 +570,24 @@ void HLTYPE::set(Expr *l, Expr *r)
  *		 empty THEN clauses on an if..then..else.	*/
 QString HLTYPE::write1HlIcode (Function * pProc, int *numLoc) const
 {
-    const HlTypeSupport *p = get();
     switch (opcode)
     {
     case HLI_ASSIGN:
-        return p->writeOut(pProc,numLoc);
+        return asgn.writeOut(pProc,numLoc);
     case HLI_CALL:
-        return p->writeOut(pProc,numLoc);
+        return call.writeOut(pProc,numLoc);
     case HLI_RET:
     {
         QString e;
-        e = p->writeOut(pProc,numLoc);
+        e = exp.writeOut(pProc,numLoc);
         if (not e.isEmpty())
             return QString("return (%1);\n").arg(e);
         break;
     }
     case HLI_POP:
-        return QString("HLI_POP %1\n").arg(p->writeOut(pProc,numLoc));
+        return QString("HLI_POP %1\n").arg(exp.writeOut(pProc,numLoc));
     case HLI_PUSH:
-        return QString("HLI_PUSH %1\n").arg(p->writeOut(pProc,numLoc));
+        return QString("HLI_PUSH %1\n").arg(exp.writeOut(pProc,numLoc));
     case HLI_JCOND: //Handled elsewhere
         break;
     default:
@@ -625,9 +633,9 @@ void ICODE::writeDU()
         if (not du1.used(i))
             continue;
         printf ("%d: du1[%d][] = ", my_idx, i);
-        for(auto j : du1.idx[i].uses)
+        for(const DU1::Use *j=du1.uses(i); j; j=j->nextUse())
         {
-            printf ("%d ", j->loc_ip);
+            printf ("%d ", j->user->loc_ip);
         }
         printf ("\n");
     }
@@ -1,25 +1,27 @@
 #include "icode.h"
 #include "ast.h"
 
+const HLTYPE ICODE::s_no_hl;
+
 void HLTYPE::replaceExpr(Expr *e)
 {
     assert(e);
-    delete exp.v;
     exp.v=e;
 }
 
 
-HlTypeSupport *HLTYPE::get()
+/* Removes regi from the long register it is part of, in the payload selected by opcode */
+bool HLTYPE::removeRegFromLong(eReg regi, LOCAL_ID *locId)
 {
     switch(opcode)
     {
-    case HLI_ASSIGN: return &asgn;
+    case HLI_ASSIGN: return asgn.removeRegFromLong(regi,locId);
     case HLI_RET:
     case HLI_POP:
     case HLI_JCOND:
-    case HLI_PUSH:   return &exp;
-    case HLI_CALL:   return &call;
+    case HLI_PUSH:   return exp.removeRegFromLong(regi,locId);
+    case HLI_CALL:   return call.removeRegFromLong(regi,locId);
     default:
-        return nullptr;
+        return false;
     }
 }
@@ -11,16 +11,140 @@
 
 ICODE::TypeFilter<HIGH_LEVEL_ICODE> ICODE::select_high_level;
 ICODE::TypeAndValidFilter<HIGH_LEVEL_ICODE> ICODE::select_valid_high_level;
+void ICODE::DU1::resetChains()
+{
+    std::fill(m_first,m_first+MAX_REGS_DEF+1,nullptr);
+    std::fill(m_last,m_last+MAX_REGS_DEF+1,nullptr);
+    std::fill(m_num_uses,m_num_uses+MAX_REGS_DEF+1,0);
+    m_reaching = nullptr;
+}
+/* Records that the icode at location uses the definition regIdx of this icode */
+void ICODE::DU1::recordUse(int regIdx, iICODE location)
+{
+    DU1 &user_du(location->du1);
+    Use *u = new Use;
+    u->user = location;
+    u->def = this;
+    u->regIdx = regIdx;
+    u->m_next = nullptr;
+    u->m_prev = m_last[regIdx];
+    if(m_last[regIdx])
+        m_last[regIdx]->m_next = u;
+    else
+        m_first[regIdx] = u;
+    m_last[regIdx] = u;
+    m_num_uses[regIdx]++;
+
+    u->m_next_reaching = user_du.m_reaching;
+    if(user_du.m_reaching)
+        user_du.m_reaching->m_prev_reaching = &u->m_next_reaching;
+    u->m_prev_reaching = &user_du.m_reaching;
+    user_du.m_reaching = u;
+}
+/* Removes u from both the chain of its definition and the reaching list of its user, and frees it */
+void ICODE::DU1::unlink(Use *u)
+{
+    DU1 &d(*u->def);
+    if(u->m_prev)
+        u->m_prev->m_next = u->m_next;
+    else
+        d.m_first[u->regIdx] = u->m_next;
+    if(u->m_next)
+        u->m_next->m_prev = u->m_prev;
+    else
+        d.m_last[u->regIdx] = u->m_prev;
+    d.m_num_uses[u->regIdx]--;
+
+    *u->m_prev_reaching = u->m_next_reaching;
+    if(u->m_next_reaching)
+        u->m_next_reaching->m_prev_reaching = u->m_prev_reaching;
+    delete u;
+}
+/* Drops every chain this icode takes part in, either as a definition or as a user */
+void ICODE::DU1::unlinkAll()
+{
+    for(int i=0; i<=MAX_REGS_DEF; ++i)
+        while(m_first[i])
+            unlink(m_first[i]);
+    while(m_reaching)
+        unlink(m_reaching);
+}
+/* Makes target the user of every definition reaching this icode, used once this icode's expression has
+ * been substituted into target. Definitions already used by target keep a single use. */
+void ICODE::DU1::moveReachingTo(iICODE target)
+{
+    DU1 &target_du(target->du1);
+    if(&target_du==this)
+        return;
+    while(m_reaching)
+    {
+        Use *u = m_reaching;
+        bool already_used = false;
+        for(const Use *other=u->def->m_first[u->regIdx]; other; other=other->m_next)
+            if(other->user==target)
+            {
+                already_used = true;
+                break;
+            }
+        if(already_used)
+        {
+            unlink(u);
+            continue;
+        }
+        m_reaching = u->m_next_reaching;
+        if(m_reaching)
+            m_reaching->m_prev_reaching = &m_reaching;
+        u->user = target;
+        u->m_next_reaching = target_du.m_reaching;
+        if(target_du.m_reaching)
+            target_du.m_reaching->m_prev_reaching = &u->m_next_reaching;
+        u->m_prev_reaching = &target_du.m_reaching;
+        target_du.m_reaching = u;
+    }
+}
 CIcodeRec::CIcodeRec()
 {
 }
 
-/* Copies the icode that is pointed to by pIcode to the icode array.
- * If there is need to allocate extra memory, it is done so, and
- * the alloc variable is adjusted.        */
-ICODE * CIcodeRec::addIcode(ICODE *pIcode)
+uint64_t ICODE::s_copies = 0;
+
+ICODE::ICODE(const ICODE &other) : m_ll(other.m_ll),m_hl(other.m_hl),Parent(other.Parent),invalid(other.invalid),
+    insn(other.insn),type(other.type),du(other.du),du1(other.du1),loc_ip(other.loc_ip)
+{
+    m_ll.m_link = this;
+    s_copies++;
+}
+ICODE &ICODE::operator=(const ICODE &other)
+{
+    if(this == &other)
+        return *this;
+    m_ll = other.m_ll;
+    m_ll.m_link = this;
+    m_hl = other.m_hl;
+    Parent = other.Parent;
+    invalid = other.invalid;
+    insn = other.insn;
+    type = other.type;
+    du = other.du;
+    du1 = other.du1;
+    loc_ip = other.loc_ip;
+    s_copies++;
+    return *this;
+}
+
+/* Constructs a new icode at the end of the icode array and returns it, to be filled in place */
+ICODE & CIcodeRec::newIcode()
+{
+    emplace_back();
+    back().loc_ip = size()-1;
+    return back();
+}
+/* Moves the last icode of decoded, built there by scan(), to the end of the icode array.
+ * The list node is relinked, the icode itself is neither copied nor moved in memory. */
+ICODE * CIcodeRec::addIcode(CIcodeRec &decoded)
 {
-    push_back(*pIcode);
+    assert(not decoded.empty());
+    splice(end(),decoded,--decoded.end());
     back().loc_ip = size()-1;
     return &back();
 }
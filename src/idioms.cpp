@@ -21,7 +21,7 @@
 #include "dcc.h"
 #include "msvc_fixes.h"
 
-#include <boost/iterator/filter_iterator.hpp>
+#include <QtCore/QTextStream>
 #include <cstring>
 #include <deque>
 /*****************************************************************************
@@ -42,84 +42,125 @@ bool LLInst::isJmpInst()
     return false;
 }
 
+/*****************************************************************************
+ * IdiomRegistry - one instance of every idiom, indexed by the opcodes the
+ *                 idiom can start with.  Order of registration is the order
+ *                 in which idioms sharing a leading opcode are tried.
+ ****************************************************************************/
+IdiomRegistry::IdiomRegistry()
+{
+    add(new Idiom18(nullptr), "idiom18", {iDEC, iINC});
+    add(new Idiom19(nullptr), "idiom19", {iDEC, iINC});
+    add(new Idiom20(nullptr), "idiom20", {iDEC, iINC});
+    add(new Idiom1(nullptr),  "idiom1",  {iPUSH});
+    add(new Idiom2(nullptr),  "idiom2",  {iMOV});
+    add(new Idiom14(nullptr), "idiom14", {iMOV});
+    add(new Idiom13(nullptr), "idiom13", {iMOV});
+    add(new Idiom3(nullptr),  "idiom3",  {iCALL, iCALLF});
+    add(new Idiom17(nullptr), "idiom17", {iCALL, iCALLF});
+    add(new Idiom4(nullptr),  "idiom4",  {iRET, iRETF});
+    add(new Idiom5(nullptr),  "idiom5",  {iADD});
+    add(new Idiom8(nullptr),  "idiom8",  {iSAR});
+    add(new Idiom15(nullptr), "idiom15", {iSHL});
+    add(new Idiom12(nullptr), "idiom12", {iSHL});
+    add(new Idiom9(nullptr),  "idiom9",  {iSHR});
+    add(new Idiom6(nullptr),  "idiom6",  {iSUB});
+    add(new Idiom10(nullptr), "idiom10", {iOR});
+    add(new Idiom11(nullptr), "idiom11", {iNEG});
+    add(new Idiom16(nullptr), "idiom16", {iNEG});
+    add(new Idiom21(nullptr), "idiom21", {iXOR});
+    add(new Idiom7(nullptr),  "idiom7",  {iXOR});
+}
+IdiomRegistry &IdiomRegistry::get()
+{
+    static IdiomRegistry s_registry;
+    return s_registry;
+}
+void IdiomRegistry::add(Idiom *idiom, const char *name, std::initializer_list<llIcode> leaders)
+{
+    m_entries.emplace_back();
+    Entry &entry(m_entries.back());
+    entry.idiom.reset(idiom);
+    entry.name = name;
+    entry.min_length = idiom->minimum_match_length();
+    for(llIcode op : leaders)
+        m_by_opcode[op].push_back(uint8_t(m_entries.size()-1));
+}
+void IdiomRegistry::bind(Function *f, iICODE fin)
+{
+    m_bound = f;
+    for(Entry &entry : m_entries)
+        entry.idiom->bind(f,fin);
+}
+/**
+ * Tries the idioms that can start with the opcode of \a at, and performs the first one that matches.
+ * \a remaining is the number of icodes from \a at up to the bound end, idioms that need more are skipped.
+ * \returns the number of icodes to advance by.
+ */
+int IdiomRegistry::match(iICODE at, size_t remaining)
+{
+    llIcode op = at->ll()->getOpcode();
+    if(op<0 or op>iMOD)
+        return 1;
+    for(uint8_t idx : m_by_opcode[op])
+    {
+        Entry &entry(m_entries[idx]);
+        if(remaining < entry.min_length)
+            continue;
+        ++entry.attempts;
+        if(not Instrumentation::enabled())
+        {
+            if(entry.idiom->match(at))
+            {
+                ++entry.hits;
+                return entry.idiom->action();
+            }
+            continue;
+        }
+        auto started = std::chrono::steady_clock::now();
+        bool matched = entry.idiom->match(at);
+        int advance_by = matched ? entry.idiom->action() : 0;
+        entry.time += std::chrono::steady_clock::now() - started;
+        if(matched)
+        {
+            ++entry.hits;
+            Instrumentation::count(m_bound,CNT_IDIOMS);
+            return advance_by;
+        }
+    }
+    return 1;
+}
+void IdiomRegistry::writeStats(QTextStream &ostr) const
+{
+    ostr << "\nIdiom statistics (attempts / matches / time in us)\n";
+    for(const Entry &entry : m_entries)
+    {
+        if(entry.attempts==0)
+            continue;
+        ostr << QString("  %1 %2 / %3 / %4\n").arg(QString(entry.name)+":",-9).arg(entry.attempts,8).arg(entry.hits,6)
+                .arg(std::chrono::duration_cast<std::chrono::microseconds>(entry.time).count(),8);
+    }
+}
+
 /*****************************************************************************
  * findIdioms  - translates LOW_LEVEL icode idioms into HIGH_LEVEL icodes.
  ****************************************************************************/
 void Function::findIdioms()
 {
-    //    int     ip;             /* Index to current icode                   */
+    ScopedPassTimer timer(PASS_IDIOMS,this);
     iICODE  pEnd, pIcode;   /* Pointers to end of BB and current icodes */
     int16_t   delta;
 
     pIcode = Icode.begin();
     pEnd = Icode.end();
-    Idiom1  i01(this);
-    Idiom2  i02(this);
-    Idiom3  i03(this);
-    Idiom4  i04(this);
-    Idiom13 i13(this);
-    Idiom14 i14(this);
-    Idiom17 i17(this);
-    // xor idioms
-    Idiom21 i21(this);
-    Idiom7 i07(this);
-    // or idioms
-    Idiom10 i10(this);
-    // neg idiom
-    Idiom11 i11(this);
-    Idiom16 i16(this);
-    // shift idioms
-    Idiom8 i08(this);
-    Idiom12 i12(this);
-    Idiom15 i15(this);
-    Idiom9 i09(this);
-    //arithmetic idioms
-    Idiom5 i05(this);
-    Idiom6 i06(this);
-    Idiom18 i18(this);
-    Idiom19 i19(this);
-    Idiom20 i20(this);
-    struct is_valid
-    {
-        bool operator()(ICODE &z) { return z.valid();}
-    };
-    typedef boost::filter_iterator<is_valid,iICODE> ifICODE;
+    size_t remaining = Icode.size();
+    IdiomRegistry &idioms(IdiomRegistry::get());
+    idioms.bind(this,pEnd);
     while (pIcode != pEnd)
     {
+        int advance_by = 1;
         switch (pIcode->ll()->getOpcode())
         {
-        case iDEC: case iINC:
-            if (i18.match(pIcode))
-                advance(pIcode,i18.action());
-            else if (i19.match(pIcode))
-                advance(pIcode,i19.action());
-            else if (i20.match(pIcode))
-                advance(pIcode,i20.action());
-            else
-                pIcode++;
-            break;
-
-        case iPUSH:
-        {
-            /* Idiom 1 */
-            //TODO: add other push idioms.
-            advance(pIcode,i01(pIcode));
-            break;
-        }
-
-        case iMOV:
-        {
-            if (i02.match(pIcode)) /* Idiom 2 */
-                advance(pIcode,i02.action());
-            else if (i14.match(pIcode))  /* Idiom 14 */
-                advance(pIcode,i14.action());
-            else if (i13.match(pIcode))      /* Idiom 13 */
-                advance(pIcode,i13.action());
-            else
-                pIcode++;
-            break;
-        }
-
         case iCALL:  case iCALLF:
             /* Check for library functions that return a long register.
                          * Propagate this result */
@@ -131,61 +172,11 @@ void Function::findIdioms()
                             or (pIcode->ll()->src().proc.proc->retVal.type == TYPE_LONG_UNSIGN))
                         localId.newLongReg(TYPE_LONG_SIGN, LONGID_TYPE(rDX,rAX), pIcode/*ip*/);
                 }
-
-            /* Check for idioms */
-            if (i03.match(pIcode))         /* idiom 3 */
-                advance(pIcode,i03.action());
-            else if (i17.match(pIcode))  /* idiom 17 */
-                advance(pIcode,i17.action());
-            else
-                pIcode++;
-            break;
-
-        case iRET:          /* Idiom 4 */
-        case iRETF:
-            advance(pIcode,i04(pIcode));
-            break;
-
-        case iADD:          /* Idiom 5 */
-            advance(pIcode,i05(pIcode));
-            break;
-
-        case iSAR:          /* Idiom 8 */
-            advance(pIcode,i08(pIcode));
-            break;
-
-        case iSHL:
-            if (i15.match(pIcode))       /* idiom 15 */
-                advance(pIcode,i15.action());
-            else if (i12.match(pIcode))        /* idiom 12 */
-                advance(pIcode,i12.action());
-            else
-                pIcode++;
-            break;
-
-        case iSHR:          /* Idiom 9 */
-            advance(pIcode,i09(pIcode));
-            break;
-
-        case iSUB:          /* Idiom 6 */
-            advance(pIcode,i06(pIcode));
-            break;
-
-        case iOR:           /* Idiom 10 */
-            advance(pIcode,i10(pIcode));
-            break;
-
-        case iNEG:          /* Idiom 11 */
-            if (i11.match(pIcode))
-                advance(pIcode,i11.action());
-            else if (i16.match(pIcode))
-                advance(pIcode,i16.action());
-            else
-                pIcode++;
+            advance_by = idioms.match(pIcode,remaining);
             break;
 
         case iNOP:
-            (pIcode++)->invalidate();
+            pIcode->invalidate();
             break;
 
         case iENTER:		/* ENTER is equivalent to init PUSH bp */
@@ -193,21 +184,13 @@ void Function::findIdioms()
             {
                 flg |= (PROC_HLL | PROC_IS_HLL);
             }
-            pIcode++;
-            break;
-
-        case iXOR:          /* Idiom 7 */
-            if (i21.match(pIcode))
-                advance(pIcode,i21.action());
-            else if (i07.match(pIcode))
-                advance(pIcode,i07.action());
-            else
-                ++pIcode;
             break;
 
         default:
-            pIcode++;
+            advance_by = idioms.match(pIcode,remaining);
         }
+        advance(pIcode,advance_by);
+        remaining -= advance_by;
     }
 
     /* Check if number of parameter bytes match their calling convention */
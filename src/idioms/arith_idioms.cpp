@@ -19,8 +19,6 @@ using namespace std;
  ****************************************************************************/
 bool Idiom5::match(iICODE pIcode)
 {
-    if(distance(pIcode,m_end)<2)
-        return false;
     m_icodes[0]=pIcode++;
     m_icodes[1]=pIcode++;
     if (m_icodes[1]->ll()->match(iADC))
@@ -53,8 +51,6 @@ int Idiom5::action()
  ****************************************************************************/
 bool Idiom6::match(iICODE pIcode)
 {
-    if(distance(pIcode,m_end)<2)
-        return false;
     m_icodes[0]=pIcode++;
     m_icodes[1]=pIcode++;
     if (m_icodes[1]->ll()->match(iSBB))
@@ -96,8 +92,6 @@ bool Idiom18::match(iICODE picode)
 {
     if(picode==m_func->Icode.begin())
         return false;
-    if(std::distance(picode,m_end)<3)
-        return false;
     --picode; //
 
     for(int i=0; i<4; ++i)
@@ -197,8 +191,6 @@ int Idiom18::action() // action length
  ****************************************************************************/
 bool Idiom19::match(iICODE picode)
 {
-    if(std::distance(picode,m_end)<2)
-        return false;
     ICODE &ic(*picode);
     int type;
     for(int i=0; i<2; ++i)
@@ -233,7 +225,7 @@ int Idiom19::action()
 
     lhs = AstIdent::id (*m_icodes[0]->ll(), DST, m_func, m_icodes[0], *m_icodes[1], eUSE);
     lhs = UnaryOperator::Create(m_is_dec ? PRE_DEC : PRE_INC, lhs);
-    expr = new BinaryOperator(condOpJCond[m_icodes[1]->ll()->getOpcode() - iJB],lhs, new Constant(0, 2));
+    expr = new BinaryOperator(condOpJCond[m_icodes[1]->ll()->getOpcode() - iJB],lhs, Constant::Create(0, 2));
     m_icodes[1]->setJCond(expr);
     m_icodes[0]->invalidate();
     return 2;
@@ -258,8 +250,6 @@ bool Idiom20::match(iICODE picode)
 {
     uint8_t type = 0;	/* type of variable: 1 = reg-var, 2 = local */
     uint8_t regi;		/* register of the MOV */
-    if(std::distance(picode,m_end)<4)
-        return false;
     for(int i=0; i<4; ++i)
         m_icodes[i] =picode++;
     /* Check second instruction for a MOV */
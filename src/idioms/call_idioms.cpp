@@ -19,8 +19,6 @@ using namespace std;
  ****************************************************************************/
 bool Idiom3::match(iICODE picode)
 {
-    if(distance(picode,m_end)<2)
-        return false;
     m_param_count=0;
     /* Match ADD  SP, immed */
     for(int i=0; i<2; ++i)
@@ -66,8 +64,6 @@ int Idiom3::action()
  ****************************************************************************/
 bool Idiom17::match(iICODE picode)
 {
-    if(distance(picode,m_end)<2)
-        return false;
     m_param_count=0; /* Count on # pops */
     m_icodes.clear();
 
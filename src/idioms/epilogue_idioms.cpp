@@ -50,8 +50,6 @@ bool Idiom2::match(iICODE pIcode)
         return false;
     if ( pIcode->ll()->testFlags(I) or (not pIcode->ll()->match(rSP,rBP)) )
         return false;
-    if(distance(pIcode,m_end)<3)
-        return false;
     /* Matched MOV SP, BP */
     m_icodes.clear();
     m_icodes.push_back(pIcode);
@@ -110,12 +108,15 @@ bool Idiom4::match(iICODE pIcode)
     m_param_count = 0;
     /* Check for [POP DI]
      *           [POP SI] */
-    if(distance(m_func->Icode.begin(),pIcode)>=3)
+    iICODE search_at(pIcode);
+    int steps_back=0;
+    while(steps_back<3 and search_at!=m_func->Icode.begin())
     {
-        iICODE search_at(pIcode);
-        advance(search_at,-3);
-        popStkVars(search_at);
+        --search_at;
+        ++steps_back;
     }
+    if(steps_back==3)
+        popStkVars(search_at);
     if(pIcode != m_func->Icode.begin())
     {
         iICODE prev1 = --iICODE(pIcode);
@@ -26,8 +26,6 @@ using namespace std;
 
 bool Idiom14::match(iICODE pIcode)
 {
-    if(distance(pIcode,m_end)<2)
-        return false;
     m_icodes[0]=pIcode++;
     m_icodes[1]=pIcode++;
     LLInst * matched [] {m_icodes[0]->ll(),m_icodes[1]->ll()};
@@ -75,8 +73,6 @@ int Idiom14::action()
  ****************************************************************************/
 bool Idiom13::match(iICODE pIcode)
 {
-    if(distance(pIcode,m_end)<2)
-        return false;
     m_icodes[0]=pIcode++;
     m_icodes[1]=pIcode++;
     m_loaded_reg = rUNDEF;
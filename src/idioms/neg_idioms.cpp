@@ -21,8 +21,6 @@ bool Idiom11::match (iICODE picode)
 {
     //const char *matchstring="(oNEG rH) (oNEG rL) (SBB \rH i0)";
     condId type;          /* type of argument */
-    if(distance(picode,m_end)<3)
-        return false;
     for(int i=0; i<3; ++i)
         m_icodes[i]=picode++;
     type = m_icodes[0]->ll()->idType(DST);
@@ -80,8 +78,6 @@ int Idiom11::action()
 bool Idiom16::match (iICODE picode)
 {
     //const char *matchstring="(oNEG rR) (oSBB rR rR) (oINC rR)";
-    if(distance(picode,m_end)<3)
-        return false;
     for(int i=0; i<3; ++i)
         m_icodes[i]=picode++;
 
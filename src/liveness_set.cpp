@@ -44,11 +44,11 @@ bool LivenessSet::testRegAndSubregs(int r) const
 void LivenessSet::postProcessCompositeRegs()
 {
     if(testReg(rAL) and testReg(rAH))
-        registers.insert(rAX);
+        registers.set(rAX);
     if(testReg(rCL) and testReg(rCH))
-        registers.insert(rCX);
+        registers.set(rCX);
     if(testReg(rDL) and testReg(rDH))
-        registers.insert(rDX);
+        registers.set(rDX);
     if(testReg(rBL) and testReg(rBH))
-        registers.insert(rBX);
+        registers.set(rBX);
 }
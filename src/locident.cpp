@@ -15,6 +15,38 @@
 static const int LOCAL_ID_DELTA = 25;
 static const int IDX_ARRAY_DELTA = 5;
 
+namespace
+{
+/* Kinds of location an identifier can be looked up by */
+enum eIdKey
+{
+    KEY_REG=1,      /* byte/word register: type, register       */
+    KEY_STK,        /* byte/word stack: bp offset, index reg    */
+    KEY_GLB,        /* indexed global: seg:off, index reg       */
+    KEY_LONG_REG,   /* long register pair                       */
+    KEY_LONG_STK,   /* long stack: type, high and low offsets   */
+    KEY_LONG_GLB,   /* long global: seg:offH, offL              */
+    KEY_LONG_IDX    /* long indexed global: as above, index reg */
+};
+uint64_t idKey(eIdKey kind, uint64_t fields)
+{
+    return (uint64_t(kind) << 60) | fields;
+}
+uint64_t longGlbFields(int16_t seg, int16_t offH, int16_t offL)
+{
+    return (uint64_t(uint16_t(seg)) << 32) | (uint64_t(uint16_t(offH)) << 16) | uint16_t(offL);
+}
+}
+
+bool IDX_ARRAY::inList(iICODE idx) const
+{
+    return std::binary_search(m_members.begin(),m_members.end(),&*idx);
+}
+void IDX_ARRAY::push_back(iICODE idx)
+{
+    std::vector<iICODE>::push_back(idx);
+    m_members.insert(std::upper_bound(m_members.begin(),m_members.end(),&*idx),&*idx);
+}
 
 bool LONGID_TYPE::srcDstRegMatch(iICODE a, iICODE b) const
 {
@@ -77,6 +109,19 @@ void LOCAL_ID::newIdent(hlType t, frameType f)
 {
     id_arr.emplace_back(t,f);
 }
+/* Returns the index of the first identifier stored under key, or -1 */
+int LOCAL_ID::findIndexed(uint64_t key) const
+{
+    auto iter = m_index.find(key);
+    return (iter==m_index.end()) ? -1 : iter->second;
+}
+/* Records the last identifier under key, unless an earlier one is there already, and returns its index */
+int LOCAL_ID::addIndexed(uint64_t key)
+{
+    int idx = id_arr.size() - 1;
+    m_index.emplace(key,idx);
+    return idx;
+}
 
 
 /* Creates a new register identifier node of TYPE_BYTE_(UN)SIGN or
@@ -84,15 +129,14 @@ void LOCAL_ID::newIdent(hlType t, frameType f)
 int LOCAL_ID::newByteWordReg(hlType t, eReg regi)
 {
     /* Check for entry in the table */
-    auto found=std::find_if(id_arr.begin(),id_arr.end(),[t,regi](ID &el)->bool {
-        return ((el.type == t) and (el.id.regi == regi));
-    });
-    if(found!=id_arr.end())
-        return found-id_arr.begin();
+    uint64_t key = idKey(KEY_REG, (uint64_t(uint8_t(t)) << 8) | uint8_t(regi));
+    int found = findIndexed(key);
+    if(found >= 0)
+        return found;
     /* Not in table, create new identifier */
     newIdent (t, REG_FRAME);
     id_arr.back().id.regi = regi;
-    return id_arr.size() - 1;
+    return addIndexed(key);
 }
 
 
@@ -104,16 +148,13 @@ int LOCAL_ID::newByteWordReg(hlType t, eReg regi)
  *       flagging this entry as illegal is all that can be done.    */
 void LOCAL_ID::flagByteWordId (int off)
 {
-    auto found=std::find_if(id_arr.begin(),id_arr.end(),[off](ID &en)->bool {
-            //if (((en.type == TYPE_WORD_SIGN) or (en.type == TYPE_BYTE_SIGN)) and
-            return ((en.typeBitsize()<=16) and (en.id.bwId.off == off) and (en.id.bwId.regOff == 0));
-    });
-    if(found==id_arr.end())
+    int found = findIndexed(idKey(KEY_STK, uint32_t(off)));
+    if((found < 0) or (id_arr[found].typeBitsize() > 16))
     {
         printf("No entry to flag as invalid in LOCAL_ID::flagByteWordId \n");
         return;
     }
-    found->illegal = true;
+    id_arr[found].illegal = true;
 }
 
 /* Creates a new stack identifier node of TYPE_BYTE_(UN)SIGN or
@@ -121,20 +162,17 @@ void LOCAL_ID::flagByteWordId (int off)
 int LOCAL_ID::newByteWordStk(hlType t, int off, uint8_t regOff)
 {
     /* Check for entry in the table */
-    auto found=std::find_if(id_arr.begin(),id_arr.end(),[off,regOff](ID &el)->bool {
-        if ((el.id.bwId.off == off) and (el.id.bwId.regOff == regOff))
-            return true;
-        return false;
-    });
-    if(found!=id_arr.end())
-        return found-id_arr.begin(); //return Index to found element
+    uint64_t key = idKey(KEY_STK, (uint64_t(regOff) << 32) | uint32_t(off));
+    int found = findIndexed(key);
+    if(found >= 0)
+        return found; //return Index to found element
 
     /* Not in table, create new identifier */
     newIdent (t, STK_FRAME);
     ID &last_id(id_arr.back());
     last_id.id.bwId.regOff = regOff;
     last_id.id.bwId.off = off;
-    return id_arr.size()-1;
+    return addIndexed(key);
 }
 
 
@@ -149,22 +187,18 @@ int LOCAL_ID::newByteWordStk(hlType t, int off, uint8_t regOff)
  *            t: HIGH_LEVEL type            */
 int LOCAL_ID::newIntIdx(int16_t seg, int16_t off, eReg regi, hlType t)
 {
-    /* Check for entry in the table */
-    for (size_t idx = 0; idx < id_arr.size(); idx++)
-    {
-        if (/*(locSym->id[idx].type == t) and   Not checking type */
-                (id_arr[idx].id.bwGlb.seg == seg) and
-                (id_arr[idx].id.bwGlb.off == off) and
-                (id_arr[idx].id.bwGlb.regi == regi))
-            return (idx);
-    }
+    /* Check for entry in the table; not checking type */
+    uint64_t key = idKey(KEY_GLB, (uint64_t(uint16_t(seg)) << 24) | (uint64_t(uint16_t(off)) << 8) | uint8_t(regi));
+    int found = findIndexed(key);
+    if(found >= 0)
+        return found;
 
     /* Not in the table, create new identifier */
     newIdent (t, GLB_FRAME);
     id_arr.back().id.bwGlb.seg = seg;
     id_arr.back().id.bwGlb.off = off;
     id_arr.back().id.bwGlb.regi = regi;
-    return id_arr.size() - 1;
+    return addIndexed(key);
 }
 
 
@@ -176,34 +210,22 @@ int LOCAL_ID::newLongReg(hlType t, const LONGID_TYPE &longT, iICODE ix_)
     eReg regH,regL;
     regL = longT.l();
     regH = longT.h();
-    size_t idx;
-    //iICODE ix_;
-    /* Check for entry in the table */
-    for (idx = 0; idx < id_arr.size(); idx++)
+    /* Check for entry in the table; not checking type */
+    uint64_t key = idKey(KEY_LONG_REG, (uint64_t(uint8_t(regH)) << 8) | uint8_t(regL));
+    int found = findIndexed(key);
+    if(found >= 0)
     {
-        ID &entry(id_arr[idx]);
-        if(not entry.isLongRegisterPair())
-            continue;
-        if (/*(locSym->id[idx].type == t) and   Not checking type */
-                (entry.longId().h() == regH) and
-                (entry.longId().l() == regL))
-        {
-            /* Check for occurrence in the list */
-            if (entry.idx.inList(ix_))
-                return idx;
-            else
-            {
-                /* Insert icode index in list */
-                entry.idx.push_back(ix_);
-                return idx;
-            }
-        }
+        ID &entry(id_arr[found]);
+        /* Insert icode index in list, unless it is there already */
+        if (not entry.idx.inList(ix_))
+            entry.idx.push_back(ix_);
+        return found;
     }
 
     /* Not in the table, create new identifier */
     id_arr.emplace_back(t, LONGID_TYPE(regH,regL));
     id_arr.back().idx.push_back(ix_);
-    return (id_arr.size() - 1);
+    return addIndexed(key);
 }
 /** \returns an identifier conditional expression node of type TYPE_LONG or TYPE_WORD_SIGN	*/
 AstIdent * LOCAL_ID::createId(const ID *retVal, iICODE ix_)
@@ -216,21 +238,16 @@ AstIdent * LOCAL_ID::createId(const ID *retVal, iICODE ix_)
  * TYPE_LONG_(UN)SIGN and returns the index to this new entry.  */
 int LOCAL_ID::newLongGlb(int16_t seg, int16_t offH, int16_t offL,hlType t)
 {
-    size_t idx;
-
-    /* Check for entry in the table */
-    for (idx = 0; idx < id_arr.size(); idx++)
-    {
-        if (/*(locSym->id[idx].type == t) and   Not checking type */
-                (id_arr[idx].id.longGlb.seg == seg) and
-                (id_arr[idx].id.longGlb.offH == offH) and
-                (id_arr[idx].id.longGlb.offL == offL))
-            return (idx);
-    }
+    /* Check for entry in the table, whatever its index register; not checking type */
+    uint64_t key = idKey(KEY_LONG_GLB, longGlbFields(seg,offH,offL));
+    int found = findIndexed(key);
+    if(found >= 0)
+        return found;
     printf("%d",t);
     /* Not in the table, create new identifier */
     id_arr.emplace_back(t, LONGGLB_TYPE(seg,offH,offL));
-    return id_arr.size() - 1;
+    addIndexed(idKey(KEY_LONG_IDX, longGlbFields(seg,offH,offL)));
+    return addIndexed(key);
 
 }
 
@@ -240,20 +257,16 @@ int LOCAL_ID::newLongGlb(int16_t seg, int16_t offH, int16_t offL,hlType t)
  * TYPE_LONG_(UN)SIGN and returns the index to this new entry.  */
 int LOCAL_ID::newLongIdx( int16_t seg, int16_t offH, int16_t offL,uint8_t regi, hlType t)
 {
-    /* Check for entry in the table */
-    for (size_t idx = 0; idx < id_arr.size(); idx++)
-    {
-        if (/*(locSym->id[idx].type == t) and   Not checking type */
-                (id_arr[idx].id.longGlb.seg == seg) and
-                (id_arr[idx].id.longGlb.offH == offH) and
-                (id_arr[idx].id.longGlb.offL == offL) and
-                (id_arr[idx].id.longGlb.regi == regi))
-            return (idx);
-    }
+    /* Check for entry in the table; not checking type */
+    uint64_t key = idKey(KEY_LONG_IDX, (uint64_t(regi) << 48) | longGlbFields(seg,offH,offL));
+    int found = findIndexed(key);
+    if(found >= 0)
+        return found;
 
     /* Not in the table, create new identifier */
     id_arr.emplace_back(t,LONGGLB_TYPE(seg,offH,offL,regi));
-    return id_arr.size() - 1;
+    addIndexed(idKey(KEY_LONG_GLB, longGlbFields(seg,offH,offL)));
+    return addIndexed(key);
 }
 
 
@@ -261,18 +274,11 @@ int LOCAL_ID::newLongIdx( int16_t seg, int16_t offH, int16_t offL,uint8_t regi,
  * Returns the index to this entry. */
 int LOCAL_ID::newLongStk(hlType t, int offH, int offL)
 {
-    size_t idx;
-
     /* Check for entry in the table */
-    for (idx = 0; idx < id_arr.size(); idx++)
-    {
-        if(id_arr[idx].loc!=STK_FRAME)
-            continue;
-        if ((id_arr[idx].type == t) and
-                (id_arr[idx].longStkId().offH == offH) and
-                (id_arr[idx].longStkId().offL == offL))
-            return (idx);
-    }
+    uint64_t key = idKey(KEY_LONG_STK, (uint64_t(uint8_t(t)) << 32) | (uint64_t(uint16_t(offH)) << 16) | uint16_t(offL));
+    int found = findIndexed(key);
+    if(found >= 0)
+        return found;
 
     /* Not in the table; flag as invalid offH and offL */
     flagByteWordId (offH);
@@ -280,7 +286,7 @@ int LOCAL_ID::newLongStk(hlType t, int offH, int offL)
 
     /* Create new identifier */
     id_arr.emplace_back(t,LONG_STKID_TYPE(offH,offL));
-    return (id_arr.size() - 1);
+    return addIndexed(key);
 }
 
 
@@ -5,6 +5,7 @@
 #include "dcc.h"
 #include "project.h"
 #include "CallGraph.h"
+#include "ParallelDiscovery.h"
 #include "msvc_fixes.h"
 
 #include <QMap>
@@ -36,11 +37,13 @@ int strSize (const uint8_t *sym, char delim)
     const uint8_t *end_ptr=std::find(sym,sym+(prog.cbImage-(till_end)),delim);
     return end_ptr-sym+1;
 }
-ICODE * Function::translate_DIV(LLInst *ll, ICODE &_Icode)
+/* Appends the decoded DIV/IDIV to Icode, between the synthetic MOV that saves its dividend and the
+ * synthetic MOD that follows it.  Returns the MOD icode */
+ICODE * Function::translate_DIV(LLInst *ll, CIcodeRec &decoded)
 {
     /* MOV rTMP, reg */
 
-    ICODE eIcode = ICODE();
+    ICODE &eIcode(Icode.newIcode());
 
     eIcode.type = LOW_LEVEL_ICODE;
     eIcode.ll()->set(iMOV,0,rTMP);
@@ -58,25 +61,25 @@ ICODE * Function::translate_DIV(LLInst *ll, ICODE &_Icode)
     eIcode.setRegDU( rTMP, eDEF);
     eIcode.ll()->setFlags( SYNTHETIC );
     /* eIcode.ll()->label = SynthLab++; */
-    eIcode.ll()->label = _Icode.ll()->label;
-    Icode.addIcode(&eIcode);
+    eIcode.ll()->label = ll->label;
 
     /* iDIV, iIDIV */
-    Icode.addIcode(&_Icode);
+    ICODE &_Icode(*Icode.addIcode(decoded));
 
     /* iMOD */
-    eIcode = ICODE();
-    eIcode.type = LOW_LEVEL_ICODE;
-    eIcode.ll()->set(iMOD,ll->getFlag() | SYNTHETIC  | IM_TMP_DST);
-    eIcode.ll()->replaceSrc(_Icode.ll()->src());
-    eIcode.du = _Icode.du;
-    eIcode.ll()->label = SynthLab++;
-    return Icode.addIcode(&eIcode);
+    ICODE &modIcode(Icode.newIcode());
+    modIcode.type = LOW_LEVEL_ICODE;
+    modIcode.ll()->set(iMOD,ll->getFlag() | SYNTHETIC  | IM_TMP_DST);
+    modIcode.ll()->replaceSrc(_Icode.ll()->src());
+    modIcode.du = _Icode.du;
+    modIcode.ll()->label = SynthLab++;
+    return &modIcode;
 }
-ICODE *Function::translate_XCHG(LLInst *ll,ICODE &_Icode)
+/* Appends the decoded XCHG to Icode as three synthetic MOVs through rTMP.  Returns the last one */
+ICODE *Function::translate_XCHG(LLInst *ll,CIcodeRec &decoded)
 {
     /* MOV rTMP, regDst */
-    ICODE eIcode;
+    ICODE &eIcode(Icode.newIcode());
     eIcode.type = LOW_LEVEL_ICODE;
     eIcode.ll()->set(iMOV,SYNTHETIC,rTMP,ll->m_dst);
     eIcode.setRegDU( rTMP, eDEF);
@@ -88,28 +91,26 @@ ICODE *Function::translate_XCHG(LLInst *ll,ICODE &_Icode)
             eIcode.ll()->setFlags( B );
     }
     eIcode.ll()->label = ll->label;
-    Icode.addIcode(&eIcode);
 
     /* MOV regDst, regSrc */
     ll->set(iMOV,SYNTHETIC|ll->getFlag());
-    Icode.addIcode(&_Icode);
-    ll->setOpcode(iXCHG); /* for next case */
+    Icode.addIcode(decoded);
 
     /* MOV regSrc, rTMP */
-    eIcode = ICODE();
-    eIcode.type = LOW_LEVEL_ICODE;
-    eIcode.ll()->set(iMOV,SYNTHETIC);
-    eIcode.ll()->replaceDst(ll->src());
-    if(eIcode.ll()->m_dst.regi)
+    ICODE &srcIcode(Icode.newIcode());
+    srcIcode.type = LOW_LEVEL_ICODE;
+    srcIcode.ll()->set(iMOV,SYNTHETIC);
+    srcIcode.ll()->replaceDst(ll->src());
+    if(srcIcode.ll()->m_dst.regi)
     {
-        if((eIcode.ll()->m_dst.regi>=rAL) and (eIcode.ll()->m_dst.regi<=rBH))
-            eIcode.ll()->setFlags( B );
-        eIcode.setRegDU( eIcode.ll()->m_dst.regi, eDEF);
+        if((srcIcode.ll()->m_dst.regi>=rAL) and (srcIcode.ll()->m_dst.regi<=rBH))
+            srcIcode.ll()->setFlags( B );
+        srcIcode.setRegDU( srcIcode.ll()->m_dst.regi, eDEF);
     }
-    eIcode.ll()->replaceSrc(rTMP);
-    eIcode.setRegDU( rTMP, eUSE);
-    eIcode.ll()->label = SynthLab++;
-    return Icode.addIcode(&eIcode);
+    srcIcode.ll()->replaceSrc(rTMP);
+    srcIcode.setRegDU( rTMP, eUSE);
+    srcIcode.ll()->label = SynthLab++;
+    return &srcIcode;
 }
 
 /** FollowCtrl - Given an initial procedure, state information and symbol table
@@ -118,7 +119,8 @@ ICODE *Function::translate_XCHG(LLInst *ll,ICODE &_Icode)
 void Function::FollowCtrl(CALL_GRAPH * pcallGraph, STATE *pstate)
 {
     PROG &prog(Project::get()->prog);
-    ICODE   _Icode, *pIcode;     /* This gets copied to pProc->Icode[] later */
+    CIcodeRec decoded;          /* Holds the icode being scanned until it is linked into Icode */
+    ICODE   *pIcode;
     SYM *    psym;
     uint32_t   offset;
     eErrorId err;
@@ -140,7 +142,8 @@ void Function::FollowCtrl(CALL_GRAPH * pcallGraph, STATE *pstate)
 
     while (not done )
     {
-        err = scan(pstate->IP, _Icode);
+        err = ParallelDiscovery::scan(pstate->IP, decoded);
+        ICODE &_Icode(decoded.back());
         if(err)
             break;
         LLInst *ll = _Icode.ll();
@@ -162,15 +165,16 @@ void Function::FollowCtrl(CALL_GRAPH * pcallGraph, STATE *pstate)
             ll->label = SynthLab++;
         }
 
-        /* Copy Icode to Proc */
-        if ((ll->getOpcode() == iDIV) or (ll->getOpcode() == iIDIV))
-            pIcode = translate_DIV(ll, _Icode);
-        else if (_Icode.ll()->getOpcode() == iXCHG)
-            pIcode = translate_XCHG(ll, _Icode);
+        /* Move Icode to Proc */
+        llIcode opcode = ll->getOpcode();
+        if ((opcode == iDIV) or (opcode == iIDIV))
+            pIcode = translate_DIV(ll, decoded);
+        else if (opcode == iXCHG)
+            pIcode = translate_XCHG(ll, decoded);
         else
-            pIcode = Icode.addIcode(&_Icode);
+            pIcode = Icode.addIcode(decoded);
 
-        switch (ll->getOpcode()) {
+        switch (opcode) {
             /*** Conditional jumps ***/
             case iLOOP: case iLOOPE:    case iLOOPNE:
             case iJB:   case iJBE:      case iJAE:  case iJA:
@@ -314,15 +318,16 @@ void Function::FollowCtrl(CALL_GRAPH * pcallGraph, STATE *pstate)
     if (err) {
         this->flg &= ~TERMINATES;
 
+        uint32_t label = decoded.back().ll()->label;
         if (err == INVALID_386OP or err == INVALID_OPCODE)
         {
-            fatalError(err, prog.image()[_Icode.ll()->label], _Icode.ll()->label);
+            fatalError(err, prog.image()[label], label);
             this->flg |= PROC_BADINST;
         }
         else if (err == IP_OUT_OF_RANGE)
-            fatalError (err, _Icode.ll()->label);
+            fatalError (err, label);
         else
-            reportError(err, _Icode.ll()->label);
+            reportError(err, label);
     }
 }
 
@@ -545,7 +550,6 @@ bool Function::process_JMP (ICODE & pIcode, STATE *pstate, CALL_GRAPH * pcallGra
 {
     PROG &prog(Project::get()->prog);
     static uint8_t i2r[4] = {rSI, rDI, rBP, rBX};
-    ICODE       _Icode;
     uint32_t       cs, offTable, endTable;
     uint32_t       i, k, seg, target;
 
@@ -609,6 +613,7 @@ bool Function::process_JMP (ICODE & pIcode, STATE *pstate, CALL_GRAPH * pcallGra
 
         for (i = offTable; i < endTable; i += 2)
         {
+            ICODE _Icode;
             target = cs + LH(&prog.image()[i]);
             /* Be wary of 00 00 as code - it's probably data */
             if (not (prog.image()[target] or prog.image()[target+1]) or
@@ -787,7 +792,10 @@ bool Function::process_CALL(ICODE & pIcode, CALL_GRAPH * pcallGraph, STATE *psta
 
         }
         else
+        {
+            LibCheckReached(*iter);
             Project::get()->callGraph->insertCallGraph (this, iter);
+        }
 
         last_insn.ll()->src().proc.proc = &(*iter); // ^ target proc
 
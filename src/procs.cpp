@@ -299,9 +299,6 @@ Expr *Function::adjustActArgType (Expr *_exp, hlType forType)
                         offset = (state.r[rDS]<<4) + offL + 0x100;
                     else
                         offset = (state.r[rDS]<<4) + offL;
-                    expr->ident.idNode.strIdx = offset;
-                    expr->ident.type(STRING);
-                    delete c;
                     return AstIdent::String(offset);
                 }
 
@@ -375,6 +372,7 @@ void STKFRAME::adjustForArgType(size_t numArg_, hlType actType_)
                     /* Merge low and high */
                     psym->type = actType_;
                     psym->size = 4;
+                    Expr::symbolTypesChanged();
                     nsym = psym + 1;
                     nsym->macro = "HI";
                     psym->macro = "LO";
@@ -11,6 +11,8 @@
 #include <memory.h>
 #include <cassert>
 #include <algorithm>
+#include <memory>
+#include <unordered_map>
 
 
 /* Returns whether the given icode opcode is within the range of valid
@@ -226,22 +228,77 @@ static int longJCond22 (Assignment &asgn, iICODE pIcode,iICODE pEnd)
     return 4;
 }
 
-/* Propagates TYPE_LONG_(UN)SIGN icode information to the current pIcode
- * Pointer.
- * Arguments: i     : index into the local identifier table
- *            pLocId: ptr to the long local identifier
- *            pProc : ptr to current procedure's record.        */
-void Function::propLongStk (int i, const ID &pLocId)
+namespace
+{
+uint32_t offsetPairKey(int offH, int offL)
+{
+    return (uint32_t(uint16_t(offH)) << 16) | uint16_t(offL);
+}
+}
+/* Long register variable definitions (mov/pop/and/or/xor pairs), by register pair and in icode order, so
+ * findBackwarLongDefs() need not scan the icodes backwards.
+ * Rewrites only ever turn low-level icodes into high-level or invalid ones, so the candidates found when
+ * this is built are a superset of those valid at any later time. */
+struct LongRegDefs
+{
+    std::unordered_map<const ICODE *,size_t> position;          /* icode => position in Icode */
+    std::unordered_map<uint16_t,std::vector<iICODE> > by_pair;  /* (regH,regL) => candidate defs */
+    static uint16_t pairKey(int regH, int regL) { return uint16_t((regH << 8) | regL); }
+    explicit LongRegDefs(CIcodeRec &icodes);
+};
+LongRegDefs::LongRegDefs(CIcodeRec &icodes)
+{
+    size_t pos = 0;
+    for(auto iter = icodes.begin(); iter != icodes.end(); ++iter, ++pos)
+    {
+        position[&*iter] = pos;
+        iICODE next1(std::next(iter));
+        if((next1 == icodes.end()) or (iter->ll()->getOpcode() != next1->ll()->getOpcode()))
+            continue;
+        switch (iter->ll()->getOpcode())
+        {
+            case iMOV:
+                by_pair[pairKey(iter->ll()->m_dst.regi, next1->ll()->m_dst.regi)].push_back(iter);
+                break;
+            case iPOP: case iAND: case iOR: case iXOR:
+                by_pair[pairKey(next1->ll()->m_dst.regi, iter->ll()->m_dst.regi)].push_back(iter);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/* Propagates TYPE_LONG_(UN)SIGN information of the long stack variables with indexes in [first,last) to the
+ * icodes, with a single sweep of the icode list.
+ * Where an icode pair matches several of them, the one with the lowest index is used, as if each variable
+ * had been propagated in turn. */
+void Function::propLongStk (size_t first, size_t last)
 {
     int arc;
     Assignment asgn;
-    //COND_EXPR *lhs, *rhs;     /* Pointers to left and right hand expression */
     iICODE next1, pEnd;
     iICODE l23;
+    /* The variables by their (offHi,offLo); the lowest index is kept */
+    std::unordered_map<uint32_t,int> by_offsets;
+    for (size_t i = first; i < last; i++)
+    {
+        const ID &pLocId(localId.id_arr[i]);
+        if (pLocId.isLong() and (pLocId.loc == STK_FRAME))
+            by_offsets.emplace(offsetPairKey(pLocId.longStkId().offH, pLocId.longStkId().offL), i);
+    }
+    /* Index of the variable whose offsets are those of the dst or src operands of pIcode and atOffset, or -1 */
+    auto findVariable = [&by_offsets](iICODE pIcode, const LLInst &atOffset) -> int {
+        auto dst = by_offsets.find(offsetPairKey(pIcode->ll()->m_dst.off, atOffset.m_dst.off));
+        auto src = by_offsets.find(offsetPairKey(pIcode->ll()->src().off, atOffset.src().off));
+        int res = (dst == by_offsets.end()) ? -1 : dst->second;
+        if ((src != by_offsets.end()) and ((res < 0) or (src->second < res)))
+            res = src->second;
+        return res;
+    };
     /* Check all icodes for offHi:offLo */
     pEnd = Icode.end();
     size_t stat_size=Icode.size();
-//    for (idx = 0; idx < (Icode.size() - 1); idx++)
     for(auto pIcode = Icode.begin(); ;++pIcode)
     {
         assert(Icode.size()==stat_size);
@@ -250,9 +307,11 @@ void Function::propLongStk (int i, const ID &pLocId)
             break;
         if ((pIcode->type == HIGH_LEVEL_ICODE) or ( not pIcode->valid() ))
             continue;
+        int i;
         if (pIcode->ll()->getOpcode() == next1->ll()->getOpcode())
         {
-            if (checkLongEq (pLocId.longStkId(), pIcode, i, this, asgn, *next1->ll()) == true)
+            i = findVariable(pIcode, *next1->ll());
+            if ((i >= 0) and checkLongEq (localId.id_arr[i].longStkId(), pIcode, i, this, asgn, *next1->ll()))
             {
                 switch (pIcode->ll()->getOpcode())
                 {
@@ -292,7 +351,8 @@ void Function::propLongStk (int i, const ID &pLocId)
         /* Check long conditional (i.e. 2 CMPs and 3 branches */
         else if ((pIcode->ll()->getOpcode() == iCMP) and (isLong23 (pIcode->getParent(), l23, &arc)))
         {
-            if ( checkLongEq (pLocId.longStkId(), pIcode, i, this, asgn, *l23->ll()) )
+            i = findVariable(pIcode, *l23->ll());
+            if ( (i >= 0) and checkLongEq (localId.id_arr[i].longStkId(), pIcode, i, this, asgn, *l23->ll()) )
             {
                 advance(pIcode,longJCond23 (asgn, pIcode, arc, l23));
             }
@@ -302,38 +362,49 @@ void Function::propLongStk (int i, const ID &pLocId)
                  * 2 CMPs and 2 branches */
         else if ((pIcode->ll()->getOpcode() == iCMP) and isLong22 (pIcode, pEnd, l23))
         {
-            if ( checkLongEq (pLocId.longStkId(), pIcode, i, this,asgn, *l23->ll()) )
+            i = findVariable(pIcode, *l23->ll());
+            if ( (i >= 0) and checkLongEq (localId.id_arr[i].longStkId(), pIcode, i, this,asgn, *l23->ll()) )
             {
                 advance(pIcode,longJCond22 (asgn, pIcode,pEnd));
             }
         }
     }
 }
-int Function::findBackwarLongDefs(int loc_ident_idx, const ID &pLocId, iICODE beg)
+/* Finds the closest definition of the long register pair before beg, among the candidates of defs, and
+ * makes it a high-level icode.
+ * \returns whether one was found, not counting one in the first icode of the procedure. */
+int Function::findBackwarLongDefs(int loc_ident_idx, const LongRegDefs &defs, iICODE beg)
 {
     Assignment asgn;
     LLOperand * pmH,* pmL;
     iICODE pIcode;
-    riICODE rev(beg);
+    /* A copy: the identifier table may grow, and move, as operands are made identifiers */
+    const LONGID_TYPE long_regs(localId.id_arr[loc_ident_idx].longId());
+    auto candidates = defs.by_pair.find(LongRegDefs::pairKey(long_regs.h(), long_regs.l()));
+    if (candidates == defs.by_pair.end())
+        return false;
+    const std::vector<iICODE> &at(candidates->second);
+    size_t beg_pos = defs.position.at(&*beg);
+    /* Last candidate before beg */
+    auto rev = std::lower_bound(at.begin(), at.end(), beg_pos, [&defs](iICODE c, size_t pos) -> bool {
+        return defs.position.at(&*c) < pos;
+    });
     bool forced_finish=false;
-    for (; not forced_finish and rev!=Icode.rend();rev++) //idx = pLocId_idx - 1; idx > 0 ; idx--
+    while (not forced_finish and rev != at.begin())
     {
-        pIcode = (++riICODE(rev)).base();//forward iterator from rev
+        pIcode = *(--rev);
         iICODE next1((++iICODE(pIcode))); // next instruction
         ICODE &icode(*pIcode);
 
-
         if ((icode.type == HIGH_LEVEL_ICODE) or ( not icode.valid() ))
             continue;
-        if (icode.ll()->getOpcode() != next1->ll()->getOpcode())
-            continue;
 
         switch (icode.ll()->getOpcode())
         {
         case iMOV:
             pmH = &icode.ll()->m_dst;
             pmL = &next1->ll()->m_dst;
-            if ((pLocId.longId().h() == pmH->regi) and (pLocId.longId().l() == pmL->regi))
+            if ((long_regs.h() == pmH->regi) and (long_regs.l() == pmL->regi))
             {
                 localId.id_arr[loc_ident_idx].idx.push_back(pIcode);//idx-1//insert
                 icode.setRegDU( pmL->regi, eDEF);
@@ -348,7 +419,7 @@ int Function::findBackwarLongDefs(int loc_ident_idx, const ID &pLocId, iICODE be
         case iPOP:
             pmH = &next1->ll()->m_dst;
             pmL = &icode.ll()->m_dst;
-            if ((pLocId.longId().h() == pmH->regi) and (pLocId.longId().l() == pmL->regi))
+            if ((long_regs.h() == pmH->regi) and (long_regs.l() == pmL->regi))
             {
                 asgn.lhs = AstIdent::LongIdx (loc_ident_idx);
                 icode.setRegDU( pmH->regi, eDEF);
@@ -364,7 +435,7 @@ int Function::findBackwarLongDefs(int loc_ident_idx, const ID &pLocId, iICODE be
         case iAND: case iOR: case iXOR:
             pmL = &icode.ll()->m_dst;
             pmH = &next1->ll()->m_dst;
-            if ((pLocId.longId().h() == pmH->regi) and (pLocId.longId().l() == pmL->regi))
+            if ((long_regs.h() == pmH->regi) and (long_regs.l() == pmL->regi))
             {
                 asgn.lhs = AstIdent::LongIdx (loc_ident_idx);
                 asgn.rhs = AstIdent::Long (&this->localId, SRC, pIcode, LOW_FIRST, pIcode, eUSE, *next1->ll());
@@ -385,10 +456,13 @@ int Function::findBackwarLongDefs(int loc_ident_idx, const ID &pLocId, iICODE be
             break;
         } /* eos */
     }
-    return rev!=Icode.rend();
+    /* As the backward scan this replaces, a definition in the procedure's first icode is not reported */
+    return forced_finish and (pIcode != Icode.begin());
 }
-int Function::findForwardLongUses(int loc_ident_idx, const ID &pLocId, iICODE beg)
+int Function::findForwardLongUses(int loc_ident_idx, iICODE beg)
 {
+    /* A copy: the identifier table may grow, and move, as operands are made identifiers */
+    const LONGID_TYPE long_regs(localId.id_arr[loc_ident_idx].longId());
     bool forced_finish=false;
     auto pEnd=Icode.end();
     iICODE long_loc;
@@ -409,7 +483,7 @@ int Function::findForwardLongUses(int loc_ident_idx, const ID &pLocId, iICODE be
             {
             case iMOV:
                 {
-                    const LONGID_TYPE &ref_long(pLocId.longId());
+                    const LONGID_TYPE &ref_long(long_regs);
                     const LLOperand &src_op1(pIcode->ll()->src());
                     const LLOperand &src_op2(next1->ll()->src());
                     eReg srcReg1=src_op1.getReg2();
@@ -430,7 +504,7 @@ int Function::findForwardLongUses(int loc_ident_idx, const ID &pLocId, iICODE be
 
             case iPUSH:
                 {
-                    const LONGID_TYPE &ref_long(pLocId.longId());
+                    const LONGID_TYPE &ref_long(long_regs);
                     const LLOperand &src_op1(pIcode->ll()->src());
                     const LLOperand &src_op2(next1->ll()->src());
                     if ((ref_long.h() == src_op1.getReg2()) and (ref_long.l() == src_op2.getReg2()))
@@ -449,7 +523,7 @@ int Function::findForwardLongUses(int loc_ident_idx, const ID &pLocId, iICODE be
             case iAND: case iOR: case iXOR:
                 pmL = &pIcode->ll()->m_dst;
                 pmH = &next1->ll()->m_dst;
-                if ((pLocId.longId().h() == pmH->regi) and (pLocId.longId().l() == pmL->regi))
+                if ((long_regs.h() == pmH->regi) and (long_regs.l() == pmL->regi))
                 {
                     asgn.lhs = AstIdent::LongIdx (loc_ident_idx);
                     pIcode->setRegDU( pmH->regi, USE_DEF);
@@ -478,7 +552,7 @@ int Function::findForwardLongUses(int loc_ident_idx, const ID &pLocId, iICODE be
         /* Check long conditional (i.e. 2 CMPs and 3 branches */
         else if ((pIcode->ll()->getOpcode() == iCMP) and (isLong23 (pIcode->getParent(), long_loc, &arc)))
         {
-            if (checkLongRegEq (pLocId.longId(), pIcode, loc_ident_idx, this, asgn, *long_loc->ll()))
+            if (checkLongRegEq (long_regs, pIcode, loc_ident_idx, this, asgn, *long_loc->ll()))
             {
                 // reduce the advance by 1 here (loop increases) ?
                 advance(pIcode,longJCond23 (asgn, pIcode, arc, long_loc));
@@ -489,7 +563,7 @@ int Function::findForwardLongUses(int loc_ident_idx, const ID &pLocId, iICODE be
              * 2 CMPs and 2 branches */
         else if (pIcode->ll()->match(iCMP) and (isLong22 (pIcode, pEnd, long_loc)))
         {
-            if (checkLongRegEq (pLocId.longId(), pIcode, loc_ident_idx, this, asgn, *long_loc->ll()) )
+            if (checkLongRegEq (long_regs, pIcode, loc_ident_idx, this, asgn, *long_loc->ll()) )
             {
                 // TODO: verify that removing -1 does not change anything !
                 advance(pIcode,longJCond22 (asgn, pIcode,pEnd));
@@ -502,10 +576,10 @@ int Function::findForwardLongUses(int loc_ident_idx, const ID &pLocId, iICODE be
          * This is better code than HLI_JCOND (HI(regH:regL) | LO(regH:regL)) */
         else if (pIcode->ll()->match(iOR) and (next1 != pEnd) and (isJCond (next1->ll()->getOpcode())))
         {
-            if (pLocId.longId().srcDstRegMatch(pIcode,pIcode))
+            if (long_regs.srcDstRegMatch(pIcode,pIcode))
             {
                 asgn.lhs = AstIdent::LongIdx (loc_ident_idx);
-                asgn.rhs = new Constant(0, 4);  /* long 0 */
+                asgn.rhs = Constant::Create(0, 4);  /* long 0 */
                 asgn.lhs = new BinaryOperator(condOpJCond[next1->ll()->getOpcode() - iJB],asgn.lhs, asgn.rhs);
                 next1->setJCond(asgn.lhs);
                 next1->copyDU(*pIcode, eUSE, eUSE);
@@ -516,37 +590,31 @@ int Function::findForwardLongUses(int loc_ident_idx, const ID &pLocId, iICODE be
     return 0;
 }
 
-/** Finds the definition of the long register pointed to by pLocId, and
+/** Finds the definition of the long register identifier loc_ident_idx, and
  * transforms that instruction into a HIGH_LEVEL icode instruction.
- * @arg i     index into the local identifier table
- * @arg pLocId ptr to the long local identifier
+ * @arg loc_ident_idx index into the local identifier table
+ * @arg defs  candidate definitions of all long register pairs
  *
  */
-void Function::propLongReg (int loc_ident_idx, const ID &pLocId)
+void Function::propLongReg (int loc_ident_idx, const LongRegDefs &defs)
 {
     /* Process all definitions/uses of long registers at an icode position */
     // WARNING: this loop modifies the iterated-over container.
-    //size_t initial_size=pLocId.idx.size();
-    for (size_t j = 0; j < pLocId.idx.size(); j++)
+    for (size_t j = 0; j < localId.id_arr[loc_ident_idx].idx.size(); j++)
     {
-        auto idx_iter=pLocId.idx.begin();
-        std::advance(idx_iter,j);
+        iICODE at = localId.id_arr[loc_ident_idx].idx[j];
         /* Check backwards for a definition of this long register */
-        if (findBackwarLongDefs(loc_ident_idx,pLocId,*idx_iter))
-        {
-            //assert(initial_size==pLocId.idx.size());
+        if (findBackwarLongDefs(loc_ident_idx,defs,at))
             continue;
-        }
         /* If no definition backwards, check forward for a use of this long reg */
-        findForwardLongUses(loc_ident_idx,pLocId,*idx_iter);
-        //assert(initial_size==pLocId.idx.size());
+        findForwardLongUses(loc_ident_idx,at);
     } /* end for */
 }
 
 
 /* Propagates the long global address across all LOW_LEVEL icodes.
  * Transforms some LOW_LEVEL icodes into HIGH_LEVEL     */
-void Function::propLongGlb (int /*i*/, const ID &/*pLocId*/)
+void Function::propLongGlb (int /*i*/)
 {
     printf("WARN: Function::propLongGlb not implemented\n");
 }
@@ -556,23 +624,36 @@ void Function::propLongGlb (int /*i*/, const ID &/*pLocId*/)
  * into HIGH_LEVEL icodes.  */
 void Function::propLong()
 {
-    /* Pointer to current local identifier */
-    //TODO: change into range based for
-    for (size_t i = 0; i < localId.csym(); i++)
+    ScopedPassTimer timer(PASS_PROPLONG,this);
+    std::unique_ptr<LongRegDefs> reg_defs;
+    /* Identifiers are processed in order; new ones created on the way are processed after the others.
+     * Consecutive long stack variables are propagated together. */
+    for (size_t i = 0; i < localId.csym(); )
     {
         const ID &pLocId(localId.id_arr[i]);
-        if ((pLocId.type!=TYPE_LONG_SIGN) and (pLocId.type!=TYPE_LONG_UNSIGN))
+        if (not pLocId.isLong())
+        {
+            i++;
             continue;
+        }
         switch (pLocId.loc)
         {
         case STK_FRAME:
-            propLongStk (i, pLocId);
+        {
+            size_t last = i + 1;
+            while ((last < localId.csym()) and not (localId.id_arr[last].isLong() and (localId.id_arr[last].loc != STK_FRAME)))
+                last++;
+            propLongStk (i, last);
+            i = last;
             break;
+        }
         case REG_FRAME:
-            propLongReg (i, pLocId);
+            if (not reg_defs)
+                reg_defs.reset(new LongRegDefs(Icode));
+            propLongReg (i++, *reg_defs);
             break;
         case GLB_FRAME:
-            propLongGlb (i, pLocId);
+            propLongGlb (i++);
             break;
         }
     }
@@ -20,41 +20,50 @@
 #define OP386       0x000400    /* 386 op-code   */
 #define NSP         0x000800    /* NOT_HLL if SP is src or dst */
 
-static void rm(int i);
-static void modrm(int i);
-static void segrm(int i);
-static void data1(int i);
-static void data2(int i);
-static void regop(int i);
-static void segop(int i);
-static void strop(int i);
-static void escop(int i);
-static void axImp(int i);
-static void alImp(int i);
-static void axSrcIm(int i);
-static void memImp(int i);
-static void memReg0(int i);
-static void memOnly(int i);
-static void dispM(int i);
-static void dispS(int i);
-static void dispN(int i);
-static void dispF(int i);
-static void prefix(int i);
-static void immed(int i);
-static void shift(int i);
-static void arith(int i);
-static void trans(int i);
-static void const1(int i);
-static void const3(int i);
-static void none1(int i);
-static void none2(int i);
-static void checkInt(int i);
+/* Decoding state of the instruction being scanned, handed to each state of the scanner */
+struct ScanState
+{
+    const uint8_t * inst=nullptr;   /* Ptr. to current uint8_t of instruction */
+    ICODE *         icode=nullptr;  /* Ptr to Icode record filled in by scan() */
+    uint16_t        seg_prefix=0;
+    uint16_t        rep_prefix=0;
+};
+
+static void rm(ScanState &s, int i);
+static void modrm(ScanState &s, int i);
+static void segrm(ScanState &s, int i);
+static void data1(ScanState &s, int i);
+static void data2(ScanState &s, int i);
+static void regop(ScanState &s, int i);
+static void segop(ScanState &s, int i);
+static void strop(ScanState &s, int i);
+static void escop(ScanState &s, int i);
+static void axImp(ScanState &s, int i);
+static void alImp(ScanState &s, int i);
+static void axSrcIm(ScanState &s, int i);
+static void memImp(ScanState &s, int i);
+static void memReg0(ScanState &s, int i);
+static void memOnly(ScanState &s, int i);
+static void dispM(ScanState &s, int i);
+static void dispS(ScanState &s, int i);
+static void dispN(ScanState &s, int i);
+static void dispF(ScanState &s, int i);
+static void prefix(ScanState &s, int i);
+static void immed(ScanState &s, int i);
+static void shift(ScanState &s, int i);
+static void arith(ScanState &s, int i);
+static void trans(ScanState &s, int i);
+static void const1(ScanState &s, int i);
+static void const3(ScanState &s, int i);
+static void none1(ScanState &s, int i);
+static void none2(ScanState &s, int i);
+static void checkInt(ScanState &s, int i);
 
 #define IC      llIcode
 
 struct StateTabelEntry {
-    void (*state1)(int);
-    void (*state2)(int);
+    void (*state1)(ScanState &, int);
+    void (*state2)(ScanState &, int);
     uint32_t flg;
     llIcode opcode;
 };
@@ -317,12 +326,9 @@ static const StateTabelEntry stateTable[] = {
     {  trans,   none1, NSP                      , iINVALID    }    /* FF */
 } ;
 
-static uint16_t    SegPrefix, RepPrefix;
-static const uint8_t  *pInst;        /* Ptr. to current uint8_t of instruction */
-static ICODE * pIcode;        /* Ptr to Icode record filled in by scan() */
 
 
-static void decodeBranchTgt(x86_insn_t &insn)
+static void decodeBranchTgt(ScanState &s, x86_insn_t &insn)
 {
     x86_op_t *tgt_op = insn.x86_get_branch_target();
     if(tgt_op->type==op_expression)
@@ -334,11 +340,11 @@ static void decodeBranchTgt(x86_insn_t &insn)
     {
         addr = (uint16_t)(addr + insn.addr + insn.size);
     }
-    pIcode->ll()->replaceSrc((uint32_t)addr);
-    pIcode->ll()->setFlags(I);
+    s.icode->ll()->replaceSrc((uint32_t)addr);
+    s.icode->ll()->setFlags(I);
     //    PROG &prog(Project::get()->prog);
-    //    long off = (short)getWord();    /* Signed displacement */
-    //    assert(addr==(uint32_t)(off + (unsigned)(pInst - prog.image())));
+    //    long off = (short)getWord(s);    /* Signed displacement */
+    //    assert(addr==(uint32_t)(off + (unsigned)(s.inst - prog.image())));
 
 }
 
@@ -364,17 +370,26 @@ static void convertUsedFlags(x86_insn_t &from,ICODE &to)
     if(from.containsFlag(insn_eflag_direction,from.flags_tested))
         to.ll()->flagDU.u |= Df;
 }
-static void convertPrefix(x86_insn_prefix prefix,ICODE &to)
+static void convertPrefix(ScanState &s, x86_insn_prefix prefix)
 {
     if(prefix ==insn_no_prefix)
         return;
     // insn_lock - no need to handle
-    RepPrefix = (uint16_t)prefix & ~insn_lock;
+    s.rep_prefix = (uint16_t)prefix & ~insn_lock;
+}
+ScanContext::ScanContext() : m_disasm(opt_16_bit)
+{
+}
+/* The context of the calling thread, created by its first scan */
+ScanContext &ScanContext::current()
+{
+    static thread_local ScanContext context;
+    return context;
 }
 /****************************************************************************
  Checks for int 34 to int 3B - if so, converts to ESC nn instruction
  ****************************************************************************/
-static void fixFloatEmulation(x86_insn_t &insn)
+void ScanContext::fixFloatEmulation(x86_insn_t &insn)
 {
     if(insn.operand_count==0)
         return;
@@ -389,22 +404,21 @@ static void fixFloatEmulation(x86_insn_t &insn)
 
     int actual_valid_bytes=std::min(16U,prog.cbImage-insn.offset);
     memcpy(buf,prog.image()+insn.offset,actual_valid_bytes);
-    X86_Disasm ds(opt_16_bit);
-    x86_insn_t patched_insn;
+    uint32_t addr   = insn.addr;
+    uint32_t offset = insn.offset;
     //patch actual instruction into buffer;
     buf[1] = wOp-0x34+0xD8;
-    ds.x86_disasm(buf,actual_valid_bytes,0,1,&patched_insn);
-    patched_insn.addr   = insn.addr; // actual address
-    patched_insn.offset = insn.offset; // actual offset
-    insn = patched_insn;
+    insn.x86_oplist_free();
+    m_disasm.x86_disasm(buf,actual_valid_bytes,0,1,&insn);
+    insn.addr   = addr; // actual address
+    insn.offset = offset; // actual offset
     insn.size += 1; // to account for emulator call INT
 }
 
-int disassembleOneLibDisasm(uint32_t ip,x86_insn_t &l)
+int ScanContext::disassemble(uint32_t ip,x86_insn_t &l)
 {
     PROG &prog(Project::get()->prog);
-    X86_Disasm ds(opt_16_bit);
-    int cnt=ds.x86_disasm(prog.image(),prog.cbImage,0,ip,&l);
+    int cnt=m_disasm.x86_disasm(prog.image(),prog.cbImage,0,ip,&l);
     if(cnt and l.is_valid())
     {
         fixFloatEmulation(l); //can change 'l'
@@ -529,60 +543,65 @@ LLOperand convertOperand(const x86_op_t &from)
 /*****************************************************************************
  Scans one machine instruction at offset ip in prog.Image and returns error.
  At the same time, fill in low-level icode details for the scanned inst.
+ p is a newly constructed icode, in its final place.
  ****************************************************************************/
 
-eErrorId scan(uint32_t ip, ICODE &p)
+eErrorId ScanContext::scan(uint32_t ip, ICODE &p)
 {
     PROG &prog(Project::get()->prog);
     int  op;
-    p = ICODE();
+    ScanState s;
     p.type = LOW_LEVEL_ICODE;
     p.ll()->label = ip;            /* ip is absolute offset into image*/
     if (ip >= (uint32_t)prog.cbImage)
     {
         return (IP_OUT_OF_RANGE);
     }
-    int cnt=disassembleOneLibDisasm(ip,p.insn);
+    int cnt=disassemble(ip,p.insn);
     if(cnt)
     {
         convertUsedFlags(p.insn,p);
-        convertPrefix(p.insn.prefix,p);
+        convertPrefix(s,p.insn.prefix);
 
     }
 
-    SegPrefix = RepPrefix = 0;
-    pInst    = prog.image() + ip;
-    pIcode   = &p;
+    s.seg_prefix = s.rep_prefix = 0;
+    s.inst    = prog.image() + ip;
+    s.icode   = &p;
 
     do
     {
-        op = *pInst++;                        /* First state - trivial   */
+        op = *s.inst++;                        /* First state - trivial   */
         /* Convert to Icode.opcode */
         p.ll()->set(stateTable[op].opcode,stateTable[op].flg & ICODEMASK);
-        (*stateTable[op].state1)(op);        /* Second state */
-        (*stateTable[op].state2)(op);        /* Third state  */
+        (*stateTable[op].state1)(s,op);        /* Second state */
+        (*stateTable[op].state2)(s,op);        /* Third state  */
 
     } while (stateTable[op].state1 == prefix);    /* Loop if prefix */
     if(p.insn.group == x86_insn_t::insn_controlflow)
     {
         if(p.insn.x86_get_branch_target())
-            decodeBranchTgt(p.insn);
+            decodeBranchTgt(s,p.insn);
     }
     //    LLOperand conv = convertOperand(*p.insn.get_dest());
     //    assert(conv==p.ll()->dst);
     if (p.ll()->getOpcode()!=iINVALID)
     {
         /* Save bytes of image used */
-        p.ll()->numBytes = (uint8_t)((pInst - prog.image()) - ip);
+        p.ll()->numBytes = (uint8_t)((s.inst - prog.image()) - ip);
         if(p.insn.is_valid())
             assert(p.ll()->numBytes == p.insn.size);
         p.ll()->numBytes = p.insn.size;
-        return ((SegPrefix)? FUNNY_SEGOVR:  /* Seg. Override invalid */
-                             (RepPrefix ? FUNNY_REP: NO_ERR));/* REP prefix invalid */
+        return ((s.seg_prefix)? FUNNY_SEGOVR:  /* Seg. Override invalid */
+                             (s.rep_prefix ? FUNNY_REP: NO_ERR));/* REP prefix invalid */
     }
     /* Else opcode error */
     return ((stateTable[op].flg & OP386)? INVALID_386OP: INVALID_OPCODE);
 }
+eErrorId scan(uint32_t ip, ICODE &p)
+{
+    return ScanContext::current().scan(ip,p);
+}
 
 /***************************************************************************
  relocItem - returns true if uint16_t pointed at is in relocation table
@@ -603,10 +622,10 @@ static bool relocItem(const uint8_t *p)
 /***************************************************************************
  getWord - returns next uint16_t from image
  **************************************************************************/
-static uint16_t getWord(void)
+static uint16_t getWord(ScanState &s)
 {
-    uint16_t w = LH(pInst);
-    pInst += 2;
+    uint16_t w = LH(s.inst);
+    s.inst += 2;
     return w;
 }
 
@@ -626,10 +645,10 @@ static int signex(uint8_t b)
  *     Note: fdst == true is for the r/m part of the field (dest, unless TO_REG)
  *          fdst == false is for reg part of the field
  ***************************************************************************/
-static void setAddress(int i, bool fdst, uint16_t seg, int16_t reg, uint16_t off)
+static void setAddress(ScanState &s, int i, bool fdst, uint16_t seg, int16_t reg, uint16_t off)
 {
     /* If not to register (i.e. to r/m), and talking about r/m, then this is dest */
-    LLOperand *pm = (! (stateTable[i].flg & TO_REG) == fdst) ? &pIcode->ll()->m_dst : &pIcode->ll()->src();
+    LLOperand *pm = (! (stateTable[i].flg & TO_REG) == fdst) ? &s.icode->ll()->m_dst : &s.icode->ll()->src();
 
     /* Set segment.  A later procedure (lookupAddr in proclist.c) will
      * provide the value of this segment in the field segValue.
@@ -659,7 +678,7 @@ static void setAddress(int i, bool fdst, uint16_t seg, int16_t reg, uint16_t off
 
     if (seg)    /* So we can catch invalid use of segment overrides */
     {
-        SegPrefix = 0;
+        s.seg_prefix = 0;
     }
 }
 
@@ -667,63 +686,63 @@ static void setAddress(int i, bool fdst, uint16_t seg, int16_t reg, uint16_t off
 /****************************************************************************
  rm - Decodes r/m part of modrm uint8_t for dst (unless TO_REG) part of icode
  ***************************************************************************/
-static void rm(int i)
+static void rm(ScanState &s, int i)
 {
-    uint8_t mod = *pInst >> 6;
-    uint8_t rm  = *pInst++ & 7;
+    uint8_t mod = *s.inst >> 6;
+    uint8_t rm  = *s.inst++ & 7;
 
     switch (mod) {
         case 0:        /* No disp unless rm == 6 */
             if (rm == 6) {
-                setAddress(i, true, SegPrefix, 0, getWord());
-                pIcode->ll()->setFlags(WORD_OFF);
+                setAddress(s, i, true, s.seg_prefix, 0, getWord(s));
+                s.icode->ll()->setFlags(WORD_OFF);
             }
             else
-                setAddress(i, true, SegPrefix, rm + INDEX_BX_SI, 0);
+                setAddress(s, i, true, s.seg_prefix, rm + INDEX_BX_SI, 0);
             break;
 
         case 1:        /* 1 uint8_t disp */
-            setAddress(i, true, SegPrefix, rm+INDEX_BX_SI, (uint16_t)signex(*pInst++));
+            setAddress(s, i, true, s.seg_prefix, rm+INDEX_BX_SI, (uint16_t)signex(*s.inst++));
             break;
 
         case 2:        /* 2 uint8_t disp */
-            setAddress(i, true, SegPrefix, rm + INDEX_BX_SI, getWord());
-            pIcode->ll()->setFlags(WORD_OFF);
+            setAddress(s, i, true, s.seg_prefix, rm + INDEX_BX_SI, getWord(s));
+            s.icode->ll()->setFlags(WORD_OFF);
             break;
 
         case 3:        /* reg */
-            setAddress(i, true, 0, rm + rAX, 0);
+            setAddress(s, i, true, 0, rm + rAX, 0);
             break;
     }
-    //pIcode->insn.get_dest()->
-    if ((stateTable[i].flg & NSP) and (pIcode->ll()->src().getReg2()==rSP or
-                                      pIcode->ll()->m_dst.getReg2()==rSP))
-        pIcode->ll()->setFlags(NOT_HLL);
+    //s.icode->insn.get_dest()->
+    if ((stateTable[i].flg & NSP) and (s.icode->ll()->src().getReg2()==rSP or
+                                      s.icode->ll()->m_dst.getReg2()==rSP))
+        s.icode->ll()->setFlags(NOT_HLL);
 }
 
 
 /****************************************************************************
  modrm - Sets up src and dst from modrm uint8_t
  ***************************************************************************/
-static void modrm(int i)
+static void modrm(ScanState &s, int i)
 {
-    setAddress(i, false, 0, REG(*pInst) + rAX, 0);
-    rm(i);
+    setAddress(s, i, false, 0, REG(*s.inst) + rAX, 0);
+    rm(s, i);
 }
 
 
 /****************************************************************************
  segrm - seg encoded as reg of modrm
  ****************************************************************************/
-static void segrm(int i)
+static void segrm(ScanState &s, int i)
 {
-    int    reg = REG(*pInst) + rES;
+    int    reg = REG(*s.inst) + rES;
 
     if (reg > rDS or (reg == rCS and (stateTable[i].flg & TO_REG)))
-        pIcode->ll()->setOpcode((llIcode)0); // setCBW because it has that index
+        s.icode->ll()->setOpcode((llIcode)0); // setCBW because it has that index
     else {
-        setAddress(i, false, 0, (int16_t)reg, 0);
-        rm(i);
+        setAddress(s, i, false, 0, (int16_t)reg, 0);
+        rm(s, i);
     }
 }
 
@@ -731,126 +750,126 @@ static void segrm(int i)
 /****************************************************************************
  regop - src/dst reg encoded as low 3 bits of opcode
  ***************************************************************************/
-static void regop(int i)
+static void regop(ScanState &s, int i)
 {
-    setAddress(i, false, 0, ((int16_t)i & 0x7) + rAX, 0);
-    pIcode->ll()->replaceDst(pIcode->ll()->src());
+    setAddress(s, i, false, 0, ((int16_t)i & 0x7) + rAX, 0);
+    s.icode->ll()->replaceDst(s.icode->ll()->src());
 
 }
 
 /*****************************************************************************
  segop - seg encoded in middle of opcode
  *****************************************************************************/
-static void segop(int i)
+static void segop(ScanState &s, int i)
 {
     if(i==0x1E) {
 //        printf("es");
     }
-    setAddress(i, true, 0, (((int16_t)i & 0x18) >> 3) + rES, 0);
+    setAddress(s, i, true, 0, (((int16_t)i & 0x18) >> 3) + rES, 0);
 }
 
 
 /****************************************************************************
  axImp - Plugs an implied AX dst
  ***************************************************************************/
-static void axImp(int i)
+static void axImp(ScanState &s, int i)
 {
-    setAddress(i, true, 0, rAX, 0);
+    setAddress(s, i, true, 0, rAX, 0);
 }
 
 /* Implied AX source */
-static void axSrcIm (int )
+static void axSrcIm(ScanState &s, int)
 {
-    pIcode->ll()->replaceSrc(rAX);//src.regi = rAX;
+    s.icode->ll()->replaceSrc(rAX);//src.regi = rAX;
 }
 
 /* Implied AL source */
-static void alImp (int )
+static void alImp(ScanState &s, int)
 {
-    pIcode->ll()->replaceSrc(rAL);//src.regi = rAL;
+    s.icode->ll()->replaceSrc(rAL);//src.regi = rAL;
 }
 
 
 /*****************************************************************************
  memImp - Plugs implied src memory operand with any segment override
  ****************************************************************************/
-static void memImp(int i)
+static void memImp(ScanState &s, int i)
 {
-    setAddress(i, false, SegPrefix, 0, 0);
+    setAddress(s, i, false, s.seg_prefix, 0, 0);
 }
 
 
 /****************************************************************************
  memOnly - Instruction is not valid if modrm refers to register (i.e. mod == 3)
  ***************************************************************************/
-static void memOnly(int )
+static void memOnly(ScanState &s, int)
 {
-    if ((*pInst & 0xC0) == 0xC0)
-        pIcode->ll()->setOpcode(iINVALID);
+    if ((*s.inst & 0xC0) == 0xC0)
+        s.icode->ll()->setOpcode(iINVALID);
 }
 
 
 /****************************************************************************
  memReg0 - modrm for 'memOnly' and Reg field must also be 0
  ****************************************************************************/
-static void memReg0(int i)
+static void memReg0(ScanState &s, int i)
 {
-    if (REG(*pInst) or (*pInst & 0xC0) == 0xC0)
-        pIcode->ll()->setOpcode(iINVALID);
+    if (REG(*s.inst) or (*s.inst & 0xC0) == 0xC0)
+        s.icode->ll()->setOpcode(iINVALID);
     else
-        rm(i);
+        rm(s, i);
 }
 
 
 /***************************************************************************
  immed - Sets up dst and opcode from modrm uint8_t
  **************************************************************************/
-static void immed(int i)
+static void immed(ScanState &s, int i)
 {
     static llIcode immedTable[8] = {iADD, iOR, iADC, iSBB, iAND, iSUB, iXOR, iCMP};
 
-    pIcode->ll()->setOpcode(immedTable[REG(*pInst)]) ;
-    rm(i);
+    s.icode->ll()->setOpcode(immedTable[REG(*s.inst)]) ;
+    rm(s, i);
 
-    if (pIcode->ll()->getOpcode() == iADD or pIcode->ll()->getOpcode() == iSUB)
-        pIcode->ll()->clrFlags(NOT_HLL);    /* Allow ADD/SUB SP, immed */
+    if (s.icode->ll()->getOpcode() == iADD or s.icode->ll()->getOpcode() == iSUB)
+        s.icode->ll()->clrFlags(NOT_HLL);    /* Allow ADD/SUB SP, immed */
 }
 
 
 /****************************************************************************
  shift  - Sets up dst and opcode from modrm uint8_t
  ***************************************************************************/
-static void shift(int i)
+static void shift(ScanState &s, int i)
 {
     static llIcode shiftTable[8] =
     {
         (llIcode)iROL, (llIcode)iROR, (llIcode)iRCL, (llIcode)iRCR,
         (llIcode)iSHL, (llIcode)iSHR, (llIcode)0,     (llIcode)iSAR};
 
-    pIcode->ll()->setOpcode(shiftTable[REG(*pInst)]);
-    rm(i);
-    pIcode->ll()->replaceSrc(rCL); //src.regi =
+    s.icode->ll()->setOpcode(shiftTable[REG(*s.inst)]);
+    rm(s, i);
+    s.icode->ll()->replaceSrc(rCL); //src.regi =
 }
 
 
 /****************************************************************************
  trans - Sets up dst and opcode from modrm uint8_t
  ***************************************************************************/
-static void trans(int i)
+static void trans(ScanState &s, int i)
 {
     static llIcode transTable[8] =
     {
         iINC, iDEC, iCALL, iCALLF,
         iJMP, iJMPF,iPUSH, (llIcode)0
     };
-    LLInst *ll = pIcode->ll();
-//    if(transTable[REG(*pInst)]==iPUSH) {
+    LLInst *ll = s.icode->ll();
+//    if(transTable[REG(*s.inst)]==iPUSH) {
 //        printf("es");
 //    }
-    if ((uint8_t)REG(*pInst) < 2 or not (stateTable[i].flg & B)) { /* INC & DEC */
-        ll->setOpcode(transTable[REG(*pInst)]);   /* valid on bytes */
-        rm(i);
-        ll->replaceSrc( pIcode->ll()->m_dst );
+    if ((uint8_t)REG(*s.inst) < 2 or not (stateTable[i].flg & B)) { /* INC & DEC */
+        ll->setOpcode(transTable[REG(*s.inst)]);   /* valid on bytes */
+        rm(s, i);
+        ll->replaceSrc( s.icode->ll()->m_dst );
         if (ll->match(iJMP) or ll->match(iCALL) or ll->match(iCALLF))
             ll->setFlags(NO_OPS);
         else if (ll->match(iINC) or ll->match(iPUSH) or ll->match(iDEC))
@@ -862,7 +881,7 @@ static void trans(int i)
 /****************************************************************************
  arith - Sets up dst and opcode from modrm uint8_t
  ****************************************************************************/
-static void arith(int i)
+static void arith(ScanState &s, int i)
 {
     uint8_t opcode;
     static llIcode arithTable[8] =
@@ -870,28 +889,28 @@ static void arith(int i)
         iTEST,  iINVALID, iNOT, iNEG,
         iMUL ,  iIMUL, iDIV, iIDIV
     };
-    opcode = arithTable[REG(*pInst)];
-    pIcode->ll()->setOpcode((llIcode)opcode);
-    rm(i);
+    opcode = arithTable[REG(*s.inst)];
+    s.icode->ll()->setOpcode((llIcode)opcode);
+    rm(s, i);
     if (opcode == iTEST)
     {
         if (stateTable[i].flg & B)
-            data1(i);
+            data1(s, i);
         else
-            data2(i);
+            data2(s, i);
     }
     else if (not (opcode == iNOT or opcode == iNEG))
     {
-        pIcode->ll()->replaceSrc( pIcode->ll()->m_dst );
-        setAddress(i, true, 0, rAX, 0);            /* dst = AX  */
+        s.icode->ll()->replaceSrc( s.icode->ll()->m_dst );
+        setAddress(s, i, true, 0, rAX, 0);            /* dst = AX  */
     }
     else if (opcode == iNEG or opcode == iNOT)
-        pIcode->ll()->setFlags(NO_SRC);
+        s.icode->ll()->setFlags(NO_SRC);
 
     if ((opcode == iDIV) or (opcode == iIDIV))
     {
-        if ( not pIcode->ll()->testFlags(B) )
-            pIcode->ll()->setFlags(IM_TMP_DST);
+        if ( not s.icode->ll()->testFlags(B) )
+            s.icode->ll()->setFlags(IM_TMP_DST);
     }
 }
 
@@ -899,34 +918,34 @@ static void arith(int i)
 /*****************************************************************************
  data1 - Sets up immed from 1 uint8_t data
  *****************************************************************************/
-static void data1(int i)
+static void data1(ScanState &s, int i)
 {
-    pIcode->ll()->replaceSrc(LLOperand::CreateImm2((stateTable[i].flg & S_EXT)? signex(*pInst++): *pInst++,1));
-    pIcode->ll()->setFlags(I);
+    s.icode->ll()->replaceSrc(LLOperand::CreateImm2((stateTable[i].flg & S_EXT)? signex(*s.inst++): *s.inst++,1));
+    s.icode->ll()->setFlags(I);
 }
 
 
 /*****************************************************************************
  data2 - Sets up immed from 2 uint8_t data
  ****************************************************************************/
-static void data2(int )
+static void data2(ScanState &s, int)
 {
-    if (relocItem(pInst))
-        pIcode->ll()->setFlags(SEG_IMMED);
+    if (relocItem(s.inst))
+        s.icode->ll()->setFlags(SEG_IMMED);
 
     /* ENTER is a special case, it does not take a destination operand,
          * but this field is being used as the number of bytes to allocate
          * on the stack.  The procedure level is stored in the immediate
          * field.  There is no source operand; therefore, the flag flg is
          * set to NO_OPS.    */
-    if (pIcode->ll()->getOpcode() == iENTER)
+    if (s.icode->ll()->getOpcode() == iENTER)
     {
-        pIcode->ll()->m_dst.off = getWord();
-        pIcode->ll()->setFlags(NO_OPS);
+        s.icode->ll()->m_dst.off = getWord(s);
+        s.icode->ll()->setFlags(NO_OPS);
     }
     else
-        pIcode->ll()->replaceSrc(getWord());
-    pIcode->ll()->setFlags(I);
+        s.icode->ll()->replaceSrc(getWord(s));
+    s.icode->ll()->setFlags(I);
 }
 
 
@@ -934,18 +953,18 @@ static void data2(int )
  dispM - 2 uint8_t offset without modrm (== mod 0, rm 6) (Note:TO_REG bits are
          reversed)
  ****************************************************************************/
-static void dispM(int i)
+static void dispM(ScanState &s, int i)
 {
-    setAddress(i, false, SegPrefix, 0, getWord());
+    setAddress(s, i, false, s.seg_prefix, 0, getWord(s));
 }
 /****************************************************************************
  dispN - 2 uint8_t disp as immed relative to ip
  ****************************************************************************/
-static void dispN(int )
+static void dispN(ScanState &s, int)
 {
 
     //PROG &prog(Project::get()->prog);
-    /*long off = (short)*/getWord();    /* Signed displacement */
+    /*long off = (short)*/getWord(s);    /* Signed displacement */
 
     /* Note: the result of the subtraction could be between 32k and 64k, and
         still be positive; it is an offset from prog.Image. So this must be
@@ -957,9 +976,9 @@ static void dispN(int )
 /***************************************************************************
  dispS - 1 byte disp as immed relative to ip
  ***************************************************************************/
-static void dispS(int )
+static void dispS(ScanState &s, int)
 {
-    /*long off =*/ signex(*pInst++);     /* Signed displacement */
+    /*long off =*/ signex(*s.inst++);     /* Signed displacement */
 
     //    decodeBranchTgt();
 }
@@ -968,12 +987,12 @@ static void dispS(int )
 /****************************************************************************
  dispF - 4 byte disp as immed 20-bit target address
  ***************************************************************************/
-static void dispF(int i)
+static void dispF(ScanState &s, int i)
 {
-    uint16_t off = (unsigned)getWord();
-    uint16_t seg = (unsigned)getWord();
+    uint16_t off = (unsigned)getWord(s);
+    uint16_t seg = (unsigned)getWord(s);
     // FIXME: this is wrong since seg here is seg value, but setAddress treats it as register id
-    setAddress(i, true, seg, 0, off);
+    setAddress(s, i, true, seg, 0, off);
     //    decodeBranchTgt();
 }
 
@@ -982,12 +1001,12 @@ static void dispF(int i)
  prefix - picks up prefix uint8_t for following instruction (LOCK is ignored
           on purpose)
  ****************************************************************************/
-static void prefix(int )
+static void prefix(ScanState &s, int)
 {
-    if ((pIcode->ll()->getOpcode() == iREPE) or (pIcode->ll()->getOpcode() == iREPNE))
-        RepPrefix = pIcode->ll()->getOpcode();
+    if ((s.icode->ll()->getOpcode() == iREPE) or (s.icode->ll()->getOpcode() == iREPNE))
+        s.rep_prefix = s.icode->ll()->getOpcode();
     else
-        SegPrefix = pIcode->ll()->getOpcode();
+        s.seg_prefix = s.icode->ll()->getOpcode();
 }
 
 inline void BumpOpcode(LLInst &ll)
@@ -998,28 +1017,28 @@ inline void BumpOpcode(LLInst &ll)
 }
 
 /*****************************************************************************
- strop - checks RepPrefix and converts string instructions accordingly
+ strop - checks s.rep_prefix and converts string instructions accordingly
  *****************************************************************************/
-static void strop(int )
+static void strop(ScanState &s, int)
 {
-    if (RepPrefix)
+    if (s.rep_prefix)
     {
-        if ( pIcode->ll()->match(iCMPS) or pIcode->ll()->match(iSCAS) )
+        if ( s.icode->ll()->match(iCMPS) or s.icode->ll()->match(iSCAS) )
         {
-            if(pIcode->insn.prefix &  insn_rep_zero)
+            if(s.icode->insn.prefix &  insn_rep_zero)
             {
-                BumpOpcode(*pIcode->ll()); // iCMPS -> iREPE_CMPS
-                BumpOpcode(*pIcode->ll());
+                BumpOpcode(*s.icode->ll()); // iCMPS -> iREPE_CMPS
+                BumpOpcode(*s.icode->ll());
             }
-            else if(pIcode->insn.prefix &  insn_rep_notzero)
-                BumpOpcode(*pIcode->ll()); // iX -> iREPNE_X
+            else if(s.icode->insn.prefix &  insn_rep_notzero)
+                BumpOpcode(*s.icode->ll()); // iX -> iREPNE_X
         }
         else
-            if(pIcode->insn.prefix &  insn_rep_zero)
-                BumpOpcode(*pIcode->ll()); // iX -> iREPE_X
-        if (pIcode->ll()->match(iREP_LODS) )
-            pIcode->ll()->setFlags(NOT_HLL);
-        RepPrefix = 0;
+            if(s.icode->insn.prefix &  insn_rep_zero)
+                BumpOpcode(*s.icode->ll()); // iX -> iREPE_X
+        if (s.icode->ll()->match(iREP_LODS) )
+            s.icode->ll()->setFlags(NOT_HLL);
+        s.rep_prefix = 0;
     }
 }
 
@@ -1027,38 +1046,38 @@ static void strop(int )
 /***************************************************************************
  escop - esc operands
  ***************************************************************************/
-static void escop(int i)
+static void escop(ScanState &s, int i)
 {
-    pIcode->ll()->replaceSrc(REG(*pInst) + (uint32_t)((i & 7) << 3));
-    pIcode->ll()->setFlags(I);
-    rm(i);
+    s.icode->ll()->replaceSrc(REG(*s.inst) + (uint32_t)((i & 7) << 3));
+    s.icode->ll()->setFlags(I);
+    rm(s, i);
 }
 
 
 /****************************************************************************
  const1
  ****************************************************************************/
-static void const1(int )
+static void const1(ScanState &s, int)
 {
-    pIcode->ll()->replaceSrc(1);
-    pIcode->ll()->setFlags(I);
+    s.icode->ll()->replaceSrc(1);
+    s.icode->ll()->setFlags(I);
 }
 
 
 /*****************************************************************************
  const3
  ****************************************************************************/
-static void const3(int )
+static void const3(ScanState &s, int)
 {
-    pIcode->ll()->replaceSrc(3);
-    pIcode->ll()->setFlags(I);
+    s.icode->ll()->replaceSrc(3);
+    s.icode->ll()->setFlags(I);
 }
 
 
 /****************************************************************************
  none1
  ****************************************************************************/
-static void none1(int )
+static void none1(ScanState &s, int)
 {
 }
 
@@ -1066,26 +1085,26 @@ static void none1(int )
 /****************************************************************************
  none2 - Sets the NO_OPS flag if the operand is immediate
  ****************************************************************************/
-static void none2(int )
+static void none2(ScanState &s, int)
 {
-    if ( pIcode->ll()->testFlags(I) )
-        pIcode->ll()->setFlags(NO_OPS);
+    if ( s.icode->ll()->testFlags(I) )
+        s.icode->ll()->setFlags(NO_OPS);
 }
 
 /****************************************************************************
  Checks for int 34 to int 3B - if so, converts to ESC nn instruction
  ****************************************************************************/
-static void checkInt(int )
+static void checkInt(ScanState &s, int)
 {
-    uint16_t wOp = (uint16_t) pIcode->ll()->src().getImm2();
+    uint16_t wOp = (uint16_t) s.icode->ll()->src().getImm2();
     if ((wOp >= 0x34) and (wOp <= 0x3B))
     {
         /* This is a Borland/Microsoft floating point emulation instruction.
             Treat as if it is an ESC opcode */
-        pIcode->ll()->replaceSrc(wOp - 0x34);
-        pIcode->ll()->set(iESC,FLOAT_OP);
+        s.icode->ll()->replaceSrc(wOp - 0x34);
+        s.icode->ll()->set(iESC,FLOAT_OP);
 
-        escop(wOp - 0x34 + 0xD8);
+        escop(s, wOp - 0x34 + 0xD8);
 
     }
 }
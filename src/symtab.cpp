@@ -148,6 +148,7 @@ void SYMTAB::updateSymType (uint32_t symbol,const TypeContainer &tc)
     iter->type = tc.m_type;
     if (tc.m_size != 0)
         iter->size = tc.m_size;
+    Expr::symbolTypesChanged();
 }
 
 /* Creates an entry in the global symbol table (symtab) if the variable
@@ -0,0 +1,62 @@
+#include "fixwild.h"
+#include "SignatureFile.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <string.h>
+
+/* Digests of the patterns fixWildCards made, computed with the switch based version it replaced */
+static uint32_t fnv(uint32_t h, const uint8_t *p, int n)
+{
+    for(int i=0; i<n; i++)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+TEST(FixWild, KnownInstructions) {
+    /* mov ax,[nnnn]; call rel; mov bx,#nnnn; ret */
+    uint8_t pat[23] = {0xA1,0x12,0x34, 0xE8,0x00,0x10, 0xBB,0x55,0x66, 0x8B,0x46,0x04, 0xC3, 0x90,0x90};
+    uint8_t expected[23] = {0xA1,0xF4,0xF4, 0xE8,0xF4,0xF4, 0xBB,0xF4,0xF4, 0x8B,0x46,0x04, 0xC3};
+    fixWildCards(pat);
+    EXPECT_EQ(0,memcmp(expected,pat,23));
+}
+
+TEST(FixWild, ShippedSignaturesAreUnchanged) {
+    struct { const char *file; int keys; uint32_t digest; } golden[] = {
+        {"dccb2c.sig", 354, 0x162CF4FDu}, {"dccb2l.sig", 354, 0x28B4D44Du}, {"dccb2s.sig", 357, 0x38A25C2Eu},
+        {"dccb3c.sig", 820, 0x4E093419u}, {"dccb3m.sig", 823, 0x306B61E0u}, {"dccm5l.sig", 623, 0xDFD448C2u},
+        {"dccm5s.sig", 623, 0x9C557D2Bu}, {"dccm8l.sig",1345, 0xD97B092Bu}, {"dccm8m.sig",1345, 0xAF886063u},
+        {"dccm8s.sig",1347, 0x71EB5B76u}, {"dcct3p.sig", 357, 0x38A25C2Eu}, {"dcct4p.sig", 219, 0xC29866F3u},
+        {"dcct5p.sig", 185, 0xF1BA3952u},
+    };
+    for(const auto &g : golden)
+    {
+        SignatureFile sig;
+        std::string error;
+        ASSERT_TRUE(sig.load((std::string(DCC_SIGS_DIR "/") + g.file).c_str(),error)) << g.file << ": " << error;
+        ASSERT_EQ(g.keys,sig.numKeys) << g.file;
+        uint32_t h = 2166136261u;
+        for(const SignatureFile::Entry &e : sig.entries)
+        {
+            uint8_t pat[SignatureFile::PAT_LEN];
+            memcpy(pat,e.pattern,sizeof(pat));
+            fixWildCards(pat);
+            h = fnv(h,pat,sizeof(pat));
+        }
+        EXPECT_EQ(g.digest,h) << g.file;
+    }
+}
+
+TEST(FixWild, RandomPatternsAreUnchanged) {
+    std::mt19937 rng(1);
+    uint32_t h = 2166136261u;
+    for(int k=0; k<100000; k++)
+    {
+        uint8_t pat[23];
+        for(int i=0; i<23; i++)
+            pat[i] = uint8_t(rng());
+        fixWildCards(pat);
+        h = fnv(h,pat,sizeof(pat));
+    }
+    EXPECT_EQ(0xA8C9D5F0u,h);
+}
@@ -0,0 +1,53 @@
+#include "dcc.h"
+#include "project.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+TEST(Icode, ParsingDoesNotCopyIcodes) {
+    /* Exercises plain icodes, translate_XCHG, translate_DIV, a conditional jump and the synthetic
+     * jump made when the fall through path reaches already parsed code */
+    std::vector<uint8_t> code = {
+        0xB8, 0x07, 0x00,   /* 0: mov  ax,7     */
+        0x93,               /* 3: xchg ax,bx    */
+        0xF7, 0xF3,         /* 4: div  bx       */
+        0x74, 0x03,         /* 6: jz   0Bh      */
+        0xEB, 0x03,         /* 8: jmp  0Dh      */
+        0x90,               /* A: nop           */
+        0x40,               /* B: inc  ax       */
+        0x40,               /* C: inc  ax       */
+        0xC3                /* D: ret           */
+    };
+    PROG &prog(Project::get()->prog);
+    prog.Imagez = code.data();
+    prog.cbImage = code.size();
+    prog.map = (uint8_t *)calloc((code.size()+3)/4, 1);
+
+    Function *f = Function::Create(0,0,"parse_test",0);
+    STATE state;
+    uint64_t copies_before = ICODE::copies();
+    f->FollowCtrl(nullptr, &state);
+
+    EXPECT_EQ(copies_before, ICODE::copies());
+    /* mov, 3 movs for xchg, mov/div/mod, jz, jmp, ret, 2 incs and the jmp back to ret */
+    ASSERT_EQ(13u, f->Icode.size());
+    EXPECT_EQ(iMOD, f->Icode.GetIcode(6)->ll()->getOpcode());
+    EXPECT_EQ(iJMP, f->Icode.back().ll()->getOpcode());
+    EXPECT_TRUE(f->Icode.back().ll()->testFlags(SYNTHETIC));
+
+    delete f;
+    free(prog.map);
+    prog.map = nullptr;
+    prog.Imagez = nullptr;
+    prog.cbImage = 0;
+}
+
+TEST(Icode, CopiesAreCounted) {
+    ICODE ic;
+    uint64_t copies_before = ICODE::copies();
+    ICODE copy(ic);
+    EXPECT_EQ(copies_before+1, ICODE::copies());
+    EXPECT_EQ(&copy, copy.ll()->m_link);
+}
@@ -0,0 +1,62 @@
+#include "SignatureIndex.h"
+#include "SignatureFile.h"
+#include <QtCore/QStringList>
+#include <gtest/gtest.h>
+#include <string.h>
+
+static const char *shipped[] = {
+    "dccb2c.sig", "dccb2l.sig", "dccb2s.sig", "dccb3c.sig", "dccb3m.sig", "dccm5l.sig", "dccm5s.sig",
+    "dccm8l.sig", "dccm8m.sig", "dccm8s.sig", "dcct3p.sig", "dcct4p.sig", "dcct5p.sig",
+};
+
+TEST(Signatures, ShippedFilesVerify) {
+    for(const char *file : shipped)
+    {
+        SignatureFile sig;
+        std::string error;
+        ASSERT_TRUE(sig.load((std::string(DCC_SIGS_DIR "/") + file).c_str(),error)) << file << ": " << error;
+        EXPECT_TRUE(sig.verify(error)) << file << ": " << error;
+    }
+}
+
+TEST(Signatures, DamagedTableFailsToVerify) {
+    SignatureFile sig;
+    std::string error;
+    ASSERT_TRUE(sig.load(DCC_SIGS_DIR "/dccb2s.sig",error)) << error;
+    /* Send the first entry's hash elsewhere */
+    const uint8_t *pat = sig.entries[0].pattern;
+    int h = sig.hashIndex(pat);
+    for(int v=0; v<sig.numVert and sig.hashIndex(pat) == h; v++)
+        sig.g[v] = uint16_t((sig.g[v] + 1) % sig.numKeys);
+    ASSERT_NE(h,sig.hashIndex(pat));
+    EXPECT_FALSE(sig.verify(error));
+    EXPECT_FALSE(error.empty());
+}
+
+TEST(Signatures, CombinedIndexFindsEveryPattern) {
+    QStringList paths;
+    for(const char *file : shipped)
+        paths << QString(DCC_SIGS_DIR "/") + file;
+    SignatureIndex index;
+    std::vector<SignatureFile> files;
+    ASSERT_TRUE(index.load(paths,QString(),&files));
+    ASSERT_EQ(sizeof(shipped)/sizeof(shipped[0]),files.size());
+    std::string error;
+    EXPECT_TRUE(index.verify(error)) << error;
+
+    static const uint8_t zeroes[SignatureFile::PAT_LEN] = {0};
+    for(size_t set=0; set<files.size(); ++set)
+    {
+        for(const SignatureFile::Entry &e : files[set].entries)
+        {
+            if(memcmp(e.pattern,zeroes,sizeof(zeroes)) == 0)
+                continue;
+            int count = 0;
+            const SignatureIndex::Tag *tags = index.find(e.pattern,count);
+            bool named = false;
+            for(int t=0; t<count; ++t)
+                named = named or (tags[t].set == set and strncmp(tags[t].name,e.name,SignatureFile::SYM_LEN) == 0);
+            EXPECT_TRUE(named) << shipped[set] << ": " << e.name;
+        }
+    }
+}
@@ -24,6 +24,7 @@ void Function::buildCFG(Disassembler &ds)
 {
     if(flg & PROC_ISLIB)
         return; // Ignore library functions
+    ExprArena::Scope arena_scope(exprArena());
     createCFG();
     if (option.VeryVerbose)
         displayCFG();
@@ -46,6 +47,8 @@ void Function::controlFlowAnalysis()
 {
     if (flg & PROC_ISLIB)
         return;         /* Ignore library functions */
+    ScopedPassTimer timer(PASS_STRUCTURE,this);
+    ExprArena::Scope arena_scope(exprArena());
     derSeq *derivedG=nullptr;
 
     /* Make cfg reducible and build derived sequences */
@@ -80,12 +83,6 @@ void udm(void)
     Disassembler ds(2);
     for (auto iter = proj->pProcList.rbegin(); iter!=proj->pProcList.rend(); ++iter)
     {
-        Function &f(*iter);
-        if(option.CustomEntryPoint) {
-            if(f.procEntry!=option.CustomEntryPoint) {
-                continue;
-            }
-        }
         iter->buildCFG(ds);
     }
     if (option.asm2)
@@ -96,17 +93,22 @@ void udm(void)
      * and intermediate instructions.  Find expressions by forward
      * substitution algorithm */
     LivenessSet live_regs;
-    if(option.CustomEntryPoint) {
-        ilFunction iter = proj->findByEntry(option.CustomEntryPoint);
-        if(iter==proj->pProcList.end()) {
-            qCritical()<< "No function found at entry point" << QString::number(option.CustomEntryPoint,16);
-            return;
+    if (not option.EntryPoints.isEmpty())
+    {
+        /* Only the procedures asked for are decompiled, their callees are analysed for their liveness */
+        for (Function &f : proj->pProcList)
+        {
+            if ((f.flg & PROC_SELECTED) and not f.liveAnal)
+            {
+                live_regs.reset();
+                f.dataFlow (live_regs);
+            }
+        }
+        for (auto iter = proj->pProcList.rbegin(); iter!=proj->pProcList.rend(); ++iter)
+        {
+            if (iter->flg & PROC_SELECTED)
+                iter->controlFlowAnalysis();
         }
-        iter->dataFlow(live_regs);
-        iter->controlFlowAnalysis();
-        delete proj->callGraph;
-        proj->callGraph = new CALL_GRAPH;
-        proj->callGraph->proc = iter;
         return;
     }
     proj->pProcList.front().dataFlow (live_regs);
@@ -0,0 +1,73 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/** Reads little endian values from a part of a mapped library, without copying it.  Reading past the
+    end returns zeroes and marks the cursor failed, so that a record can be parsed first and checked
+    once */
+class ImageCursor
+{
+public:
+    ImageCursor() {}
+    ImageCursor(const uint8_t *begin, size_t size) : m_begin(begin), m_pos(begin), m_end(begin + size) {}
+
+    uint8_t byte()
+    {
+        const uint8_t *p = bytes(1);
+        return p ? p[0] : 0;
+    }
+    uint16_t word()
+    {
+        const uint8_t *p = bytes(2);
+        return p ? (uint16_t)(p[0] + (p[1] << 8)) : 0;
+    }
+    /** An OMF index: one byte, or two if the first has its top bit set */
+    uint16_t index()
+    {
+        uint8_t b = byte();
+        return (b & 0x80) ? (uint16_t)(((b & 0x7F) << 8) + byte()) : b;
+    }
+    /** A length prefixed string; sets len and returns its characters where they lie, not nul terminated */
+    const char *name(uint8_t &len)
+    {
+        len = byte();
+        const char *p = (const char *)bytes(len);
+        if (p == nullptr)
+            len = 0;
+        return p ? p : "";
+    }
+    /** The next n bytes, or nullptr if there are not that many left */
+    const uint8_t *bytes(size_t n)
+    {
+        if (n > left())
+        {
+            m_failed = true;
+            m_pos = m_end;
+            return nullptr;
+        }
+        const uint8_t *p = m_pos;
+        m_pos += n;
+        return p;
+    }
+    void    skip(size_t n) { bytes(n); }
+    /** Moves to pos, from the start of the part */
+    void    seek(size_t pos)
+    {
+        if (pos > size())
+        {
+            m_failed = true;
+            pos = size();
+        }
+        m_pos = m_begin + pos;
+    }
+    size_t  pos() const { return m_pos - m_begin; }
+    size_t  size() const { return m_end - m_begin; }
+    size_t  left() const { return m_end - m_pos; }
+    bool    atEnd() const { return m_pos == m_end; }
+    bool    failed() const { return m_failed; }
+private:
+    const uint8_t * m_begin = nullptr;
+    const uint8_t * m_pos = nullptr;
+    const uint8_t * m_end = nullptr;
+    bool            m_failed = false;
+};
@@ -1,5 +1,7 @@
 #include "LIB_PatternCollector.h"
 
+#include "OmfReader.h"
+#include "fixwild.h"
 #include "msvc_fixes.h"
 
 #include <cstring>
@@ -9,232 +11,160 @@
     LEDATA records. Functions such as _exit() have more than one segment
     declared with class CODE (MSC8 libraries) */
 
-extern void fixWildCards(uint8_t pat[]);
-void readNN(int n, FILE *fl)
+void LIB_PatternCollector::patternAt(uint32_t off, uint8_t *pat) const
 {
-    if (fseek(fl, (long)n, SEEK_CUR) != 0)
+    uint32_t end = std::min<uint32_t>(off + PATLEN, maxLeData);
+
+    memset(pat, 0, PATLEN);
+    /* Later records overwrite earlier ones, as they would when loaded */
+    for (const DataBlock &b : blocks)
     {
-        printf("Could not seek file\n");
-        exit(2);
+        uint32_t from = std::max(off, b.offset);
+        uint32_t to = std::min(end, b.offset + b.len);
+        if (from < to)
+            memcpy(pat + (from - off), b.data + (from - b.offset), to - from);
     }
 }
 
-void LIB_PatternCollector::readString(FILE *fl)
+void LIB_PatternCollector::endModule(int firstSym)
 {
-    uint8_t len;
-
-    len = readByte(fl);
-    if (fread(buf, 1, len, fl) != len)
+    /* Now find all the patterns for public code symbols that
+            we have found */
+    for (size_t i = firstSym; i < keys.size(); i++)
     {
-        printf("Could not read string len %d\n", len);
-        exit(2);
+        uint16_t off = keys[i].offset;
+        if (off > maxLeData)
+        {
+            note("Warning: no LEDATA for symbol #%d %s (offset %04X, max %04X)\n",
+                 (int)i, keys[i].name, off, maxLeData);
+            /* To make things consistant, we set the pattern for
+                this symbol to nulls */
+            memset(&keys[i].pat, 0, PATLEN);
+            continue;
+        }
+        /* Beware of short patterns! The rest is zeroes */
+        patternAt(off, keys[i].pat);
+        fixWildCards(keys[i].pat);
     }
-    buf[len] = '\0';
-    offset += len;
+    lnum = 0;               /* Reset index into lnames */
+    segnum = 0;             /* Reset index into snames */
+    codeLNAMES = NONE;      /* Invalidate indexes for code segment */
+    codeSEGDEF = NONE;
+    blocks.clear();         /* No data read this module */
+    maxLeData = 0;
 }
 
-int LIB_PatternCollector::readSyms(FILE *fl)
+int LIB_PatternCollector::readSyms(const uint8_t *image, size_t size)
 {
-    int i;
-    int count = 0;
-    int	firstSym = 0;			/* First symbol this module */
-    uint8_t b, c, type;
-    uint16_t w, len;
+    int firstSym = 0;       /* First symbol this module */
+    OmfReader reader(image, size);
+    OmfRecord rec;
 
-    codeLNAMES = NONE;			/* Invalidate indexes for code segment */
-    codeSEGDEF = NONE;			/* Else won't be assigned */
-
-    offset = 0;                 /* For diagnostics, really */
-
-    if ((leData = (uint8_t *)malloc(0xFF80)) == 0)
-    {
-        printf("Could not malloc 64k bytes for LEDATA\n");
-        exit(10);
-    }
-
-    while (not feof(fl))
+    keys.clear();
+    endModule(0);
+    while (reader.next(rec))
     {
-        type = readByte(fl);
-        len = readWord(fl);
+        ImageCursor in = rec.contents();
         /* Note: uncommenting the following generates a *lot* of output */
-        /*printf("Offset %05lX: type %02X len %d\n", offset-3, type, len);//*/
-        switch (type)
+        /*note("Offset %05lX: type %02X len %d\n", (long)rec.offset, rec.type, rec.len);//*/
+        switch (rec.type)
         {
-
-        case 0x96:				/* LNAMES */
-            while (len > 1)
+        case OMF_LNAMES:
+            while (not in.atEnd())
             {
-                readString(fl);
+                uint8_t len;
+                const char *name = in.name(len);
                 ++lnum;
-                if (strcmp((char *)buf, "CODE") == 0)
+                if (len == 4 and memcmp(name, "CODE", 4) == 0)
                 {
                     /* This is the class name we're looking for */
-                    codeLNAMES= lnum;
+                    codeLNAMES = lnum;
                 }
-                len -= strlen((char *)buf)+1;
             }
-            b = readByte(fl);		/* Checksum */
             break;
 
-        case 0x98:				/* Segment definition */
-            b = readByte(fl);		/* Segment attributes */
+        case OMF_SEGDEF:
+        {
+            uint8_t b = in.byte();  /* Segment attributes */
             if ((b & 0xE0) == 0)
             {
                 /* Alignment field is zero. Frame and offset follow */
-                readWord(fl);
-                readByte(fl);
+                in.skip(3);
             }
-
-            w = readWord(fl);		/* Segment length */
-
-            b = readByte(fl);		/* Segment name index */
+            in.word();              /* Segment length */
+            in.index();             /* Segment name index */
             ++segnum;
-
-            b = readByte(fl);		/* Class name index */
-            if ((b == codeLNAMES) and (codeSEGDEF == NONE))
+            if ((in.index() == codeLNAMES) and (codeSEGDEF == NONE))
             {
                 /* This is the segment defining the code class */
                 codeSEGDEF = segnum;
             }
-
-            b = readByte(fl);		/* Overlay index */
-            b = readByte(fl);		/* Checksum */
             break;
+        }
 
-        case 0x90:				/* PUBDEF: public symbols */
-            b = readByte(fl);		/* Base group */
-            c = readByte(fl);		/* Base segment */
-            len -= 2;
-            if (c == 0)
-            {
-                w = readWord(fl);
-                len -= 2;
-            }
-            while (len > 1)
+        case OMF_PUBDEF:            /* Public symbols */
+        {
+            in.index();             /* Base group */
+            int seg = in.index();   /* Base segment */
+            if (seg == 0)
+                in.word();          /* Base frame */
+            while (not in.atEnd())
             {
-                readString(fl);
-                w = readWord(fl);		/* Offset */
-                b = readByte(fl);		/* Type index */
-                if (c == codeSEGDEF)
+                uint8_t len;
+                const char *p = in.name(len);
+                uint16_t w = in.word();     /* Offset */
+                in.index();                 /* Type index */
+                if (seg == codeSEGDEF and not in.failed())
                 {
-                    char *p;
-                    HASHENTRY entry;
-                    p = (char *)buf;
-                    if (buf[0] == '_')	/* Leading underscore? */
+                    HASHENTRY entry = {};
+                    if (len and p[0] == '_')    /* Leading underscore? */
                     {
-                        p++; 			/* Yes, remove it*/
+                        p++;                    /* Yes, remove it*/
+                        len--;
                     }
-                    i = std::min(size_t(SYMLEN-1), strlen(p));
-                    memcpy(entry.name, p, i);
-                    entry.name[i] = '\0';
+                    len = std::min<uint8_t>(SYMLEN-1, len);
+                    memcpy(entry.name, p, len);
+                    entry.name[len] = '\0';
                     entry.offset = w;
-                    /*printf("%04X: %s is sym #%d\n", w, keys[count].name, count);//*/
                     keys.push_back(entry);
-                    count++;
                 }
-                len -= strlen((char *)buf) + 1 + 2 + 1;
             }
-            b = readByte(fl);		/* Checksum */
             break;
+        }
 
-
-        case 0xA0:				/* LEDATA */
+        case OMF_LEDATA:
         {
-            b = readByte(fl);		/* Segment index */
-            w = readWord(fl);		/* Offset */
-            len -= 3;
-            /*printf("LEDATA seg %d off %02X len %Xh, looking for %d\n", b, w, len-1, codeSEGDEF);//*/
-
-            if (b != codeSEGDEF)
-            {
-                readNN(len,fl);	/* Skip the data */
-                break;			/* Next record */
-            }
-
-
-            if (fread(&leData[w], 1, len-1, fl) != len-1)
-            {
-                printf("Could not read LEDATA length %d\n", len-1);
-                exit(2);
-            }
-            offset += len-1;
-            maxLeData = std::max<uint16_t>(maxLeData, w+len-1);
-
-            readByte(fl);				/* Checksum */
+            int seg = in.index();   /* Segment index */
+            uint16_t w = in.word(); /* Offset */
+            /*note("LEDATA seg %d off %02X len %Xh, looking for %d\n", seg, w, in.left(), codeSEGDEF);//*/
+            if (seg != codeSEGDEF or in.failed())
+                break;              /* Next record */
+            uint16_t len = in.left();
+            blocks.push_back({w, in.bytes(len), len});
+            maxLeData = std::max<uint32_t>(maxLeData, w + len);
             break;
         }
 
-        default:
-            readNN(len,fl);			/* Just skip the lot */
-
-            if (type == 0x8A)	/* Mod end */
-            {
-                /* Now find all the patterns for public code symbols that
-                        we have found */
-                for (i=firstSym; i < count; i++)
-                {
-                    uint16_t off = keys[i].offset;
-                    if (off == (uint16_t)-1)
-                    {
-                        continue;			/* Ignore if already done */
-                    }
-                    if (keys[i].offset > maxLeData)
-                    {
-                        printf(
-                                    "Warning: no LEDATA for symbol #%d %s "
-                                    "(offset %04X, max %04X)\n",
-                                    i, keys[i].name, off, maxLeData);
-                        /* To make things consistant, we set the pattern for
-                                    this symbol to nulls */
-                        memset(&keys[i].pat, 0, PATLEN);
-                        continue;
-                    }
-                    /* Copy to temp buffer so don't overrun later patterns.
-                                (e.g. when chopping a short pattern).
-                                Beware of short patterns! */
-                    if (off+PATLEN <= maxLeData)
-                    {
-                        /* Available pattern is >= PATLEN */
-                        memcpy(buf, &leData[off], PATLEN);
-                    }
-                    else
-                    {
-                        /* Short! Only copy what is available (and malloced!) */
-                        memcpy(buf, &leData[off], maxLeData-off);
-                        /* Set rest to zeroes */
-                        memset(&buf[maxLeData-off], 0, PATLEN-(maxLeData-off));
-                    }
-                    fixWildCards((uint8_t *)buf);
-                    /* Save into the hash entry. */
-                    memcpy(keys[i].pat, buf, PATLEN);
-                    keys[i].offset = (uint16_t)-1;	// Flag it as done
-                    //printf("Saved pattern for %s\n", keys[i].name);
-                }
-
-
-                while (readByte(fl) == 0);
-                readNN(-1,fl);			/* Unget the last byte (= type) */
-                lnum = 0;			/* Reset index into lnames */
-                segnum = 0;			/* Reset index into snames */
-                firstSym = count;	/* Remember index of first sym this mod */
-                codeLNAMES = NONE;	/* Invalidate indexes for code segment */
-                codeSEGDEF = NONE;
-                memset(leData, 0, maxLeData);	/* Clear out old junk */
-                maxLeData = 0;		/* No data read this module */
-            }
-
-            else if (type == 0xF1)
-            {
-                /* Library end record */
-                return count;
-            }
+        case OMF_MODEND:
+        case OMF_MODEND32:
+            endModule(firstSym);
+            firstSym = keys.size();     /* Remember index of first sym this mod */
+            break;
 
+        default:
+            break;                  /* Just skip the lot */
+        }
+        if (in.failed())
+        {
+            note("Record type %02X at offset %05lX is too short\n", rec.type, (long)rec.offset);
+            error = "damaged object module";
+            return -1;
         }
     }
-
-
-    free(leData);
-    keys.clear();
-
-    return count;
+    if (reader.error())
+    {
+        error = reader.error();
+        return -1;
+    }
+    return keys.size();
 }
@@ -5,21 +5,28 @@
 struct LIB_PatternCollector : public PatternCollector
 {
 protected:
-    unsigned long offset;
-    uint8_t lnum = 0;				/* Count of LNAMES  so far */
-    uint8_t segnum = 0;			/* Count of SEGDEFs so far */
-    uint8_t codeLNAMES;			/* Index of the LNAMES for "CODE" class */
-    uint8_t codeSEGDEF;			/* Index of the first SEGDEF that has class CODE */
-    #define NONE 0xFF			/* Improbable segment index */
-    uint8_t *leData;            /* Pointer to 64K of alloc'd data. Some .lib files
-                                   have the symbols (PUBDEFs) *after* the data
-                                   (LEDATA), so you need to keep the data here */
-    uint16_t maxLeData;			/* How much data we have in there */
-    /* read a length then string to buf[]; make it an asciiz string */
-    void readString( FILE *fl);
+    /* A LEDATA record of the code segment. Some .lib files have the symbols (PUBDEFs)
+        *after* the data (LEDATA), so the records are kept until the end of the module;
+        their data stays where it lies in the library */
+    struct DataBlock
+    {
+        uint32_t offset;            /* In the segment */
+        const uint8_t *data;
+        uint16_t len;
+    };
+    enum { NONE = -1 };             /* No such index */
+    int lnum = 0;                   /* Count of LNAMES  so far */
+    int segnum = 0;                 /* Count of SEGDEFs so far */
+    int codeLNAMES = NONE;          /* Index of the LNAMES for "CODE" class */
+    int codeSEGDEF = NONE;          /* Index of the first SEGDEF that has class CODE */
+    std::vector<DataBlock> blocks;  /* The code this module */
+    uint32_t maxLeData = 0;         /* How much data we have in there */
 
-public:
-    /* Read the .lib file, and put the keys into the array *keys[]. Returns the count */
-    int readSyms(FILE *fl);
+    /* The PATLEN bytes of code at off, zeroes where there are none */
+    void patternAt(uint32_t off, uint8_t *pat) const;
+    /* Find the patterns of the symbols from firstSym on, and start the next module */
+    void endModule(int firstSym);
 
+public:
+    int readSyms(const uint8_t *image, size_t size);
 };
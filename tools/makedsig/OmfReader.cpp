@@ -0,0 +1,38 @@
+#include "OmfReader.h"
+
+#include "msvc_fixes.h"
+
+bool OmfReader::next(OmfRecord &rec)
+{
+    if (m_done or m_pos >= m_size)
+        return false;
+    /* type, length, then length bytes of which the last is the checksum */
+    if (m_size - m_pos < 3)
+    {
+        m_error = "truncated record header";
+        m_done = true;
+        return false;
+    }
+    const uint8_t *p = m_image + m_pos;
+    uint16_t len = p[1] + (p[2] << 8);
+    if (len == 0 or len > m_size - m_pos - 3)
+    {
+        m_error = len ? "record runs past the end of the file" : "record of length 0";
+        m_done = true;
+        return false;
+    }
+    rec.type = p[0];
+    rec.offset = m_pos;
+    rec.data = p + 3;
+    rec.len = len - 1;
+    m_pos += 3 + len;
+    if (rec.type == OMF_LIBEND)
+        m_done = true;
+    else if (rec.type == OMF_MODEND or rec.type == OMF_MODEND32)
+    {
+        /* Modules of a library start on a page boundary; no record type is 0 */
+        while (m_pos < m_size and m_image[m_pos] == 0)
+            m_pos++;
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "ImageCursor.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Record types of the Intel/Microsoft object module format */
+enum OmfType
+{
+    OMF_MODEND = 0x8A, OMF_MODEND32 = 0x8B, OMF_PUBDEF = 0x90, OMF_LNAMES = 0x96, OMF_SEGDEF = 0x98,
+    OMF_LEDATA = 0xA0, OMF_LIBHDR = 0xF0, OMF_LIBEND = 0xF1
+};
+
+/** A record as it lies in the mapped file */
+struct OmfRecord
+{
+    uint8_t         type;
+    size_t          offset;     /* Of the record in the file, for messages */
+    const uint8_t * data;       /* The contents, without the type, length and checksum */
+    uint16_t        len;        /* Of data */
+    ImageCursor     contents() const { return ImageCursor(data, len); }
+};
+
+/** Walks the records of an object file or library in place.  The padding that follows each module of a
+    library is skipped, and the walk ends at the library end record, before the dictionary */
+class OmfReader
+{
+public:
+    OmfReader(const uint8_t *image, size_t size) : m_image(image), m_size(size) {}
+    /** Sets rec to the next record; returns false at the end, or if the next record is cut short */
+    bool    next(OmfRecord &rec);
+    /** The reason next() stopped early, or nullptr */
+    const char *error() const { return m_error; }
+private:
+    const uint8_t * m_image;
+    size_t          m_size;
+    size_t          m_pos = 0;
+    bool            m_done = false;
+    const char *    m_error = nullptr;
+};
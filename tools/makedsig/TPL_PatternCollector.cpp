@@ -1,5 +1,6 @@
 #include "TPL_PatternCollector.h"
 
+#include "fixwild.h"
 #include "msvc_fixes.h"
 
 #include <cstring>
@@ -12,158 +13,156 @@
 
 
 #define roundUp(w) ((w + 0x0F) & 0xFFF0)
-extern void fixWildCards(uint8_t pat[]);
-void TPL_PatternCollector::enterSym(FILE *f, const char *name, uint16_t pmapOffset)
+void TPL_PatternCollector::enterSym(const char *name, uint16_t pmapOffset)
 {
     uint16_t pm, cm, codeOffset, pcode;
     uint16_t j;
+    HASHENTRY entry = {};
 
     /* Enter a symbol with given name */
-    allocSym(count);
-    strcpy(keys[count].name, name);
+    strncpy(entry.name, name, SYMLEN-1);
     pm = pmap + pmapOffset;			/* Pointer to the 4 byte pmap structure */
-    fseek(f, unitBase+pm, SEEK_SET);/* Go there */
-    cm = readShort(f);				/* CSeg map offset */
-    codeOffset = readShort(f);		/* How far into the code segment is our rtn */
+    image.seek(unitBase+pm);		/* Go there */
+    cm = image.word();				/* CSeg map offset */
+    codeOffset = image.word();		/* How far into the code segment is our rtn */
     j = cm / 8;						/* Index into the cmap array */
+    if (j >= csegoffs.size())
+    {
+        note("No code segment %d for %s\n", j, name);
+        return;
+    }
     pcode = csegBase+csegoffs[j]+codeOffset;
-    fseek(f, unitBase+pcode, SEEK_SET);		/* Go there */
-    grab(f,PATLEN);					/* Grab the pattern to buf[] */
-    fixWildCards(buf);				/* Fix the wild cards */
-    memcpy(keys[count].pat, buf, PATLEN);	/* Copy to the key array */
-    count++;						/* Done one more */
-}
-
-void TPL_PatternCollector::allocSym(int count)
-{
-    keys.resize(count);
+    image.seek(unitBase+pcode);		/* Go there */
+    const uint8_t *code = image.bytes(PATLEN);	/* The pattern, in the library */
+    if (code == nullptr)
+        return;
+    memcpy(entry.pat, code, PATLEN);
+    fixWildCards(entry.pat);		/* Fix the wild cards */
+    keys.push_back(entry);			/* Done one more */
 }
 
-void TPL_PatternCollector::readCmapOffsets(FILE *f)
+void TPL_PatternCollector::readCmapOffsets()
 {
     uint16_t cumsize, csize;
     uint16_t i;
 
     /* Read the cmap table to find the start address of each segment */
-    fseek(f, unitBase+cmap, SEEK_SET);
+    image.seek(unitBase+cmap);
     cumsize = 0;
-    csegIdx = 0;
+    csegoffs.clear();
     for (i=cmap; i < pmap; i+=8)
     {
-        readShort(f);					/* Always 0 */
-        csize = readShort(f);
+        image.word();					/* Always 0 */
+        csize = image.word();
         if (csize == 0xFFFF) continue;	/* Ignore the first one... unit init */
-        csegoffs[csegIdx++] = cumsize;
+        csegoffs.push_back(cumsize);
         cumsize += csize;
-        grab(f,4);
+        image.skip(4);
     }
 }
 
-void TPL_PatternCollector::enterSystemUnit(FILE *f)
+/* Find the tables of the unit at base */
+void TPL_PatternCollector::readTables(uint16_t base)
+{
+    image.seek(base+0x0C);
+    cmap = image.word();
+    pmap = image.word();
+    image.seek(base+offStCseg);
+    csegBase = roundUp(image.word());	/* Round up to next 16 bdry */
+    note("CMAP table at %04X\n", cmap);
+    note("PMAP table at %04X\n", pmap);
+    note("Code seg base %04X\n", csegBase);
+}
+
+void TPL_PatternCollector::enterSystemUnit()
 {
     /* The system unit is special. The association between keywords and
             pmap entries is not stored in the .tpl file (as far as I can tell).
             So we hope that they are constant pmap entries.
         */
 
-    fseek(f, 0x0C, SEEK_SET);
-    cmap = readShort(f);
-    pmap = readShort(f);
-    fseek(f, offStCseg, SEEK_SET);
-    csegBase = roundUp(readShort(f));		/* Round up to next 16 bdry */
-    printf("CMAP table at %04X\n", cmap);
-    printf("PMAP table at %04X\n", pmap);
-    printf("Code seg base %04X\n", csegBase);
-
-    readCmapOffsets(f);
-
-    enterSym(f,"INITIALISE",	0x04);
-    enterSym(f,"UNKNOWN008",	0x08);
-    enterSym(f,"EXIT",		0x0C);
-    enterSym(f,"BlockMove",	0x10);
-    unknown(f,0x14, 0xC8);
-    enterSym(f,"PostIO",		0xC8);
-    enterSym(f,"UNKNOWN0CC",	0xCC);
-    enterSym(f,"STACKCHK",	0xD0);
-    enterSym(f,"UNKNOWN0D4",	0xD4);
-    enterSym(f,"WriteString",	0xD8);
-    enterSym(f,"WriteInt",	0xDC);
-    enterSym(f,"UNKNOWN0E0",	0xE0);
-    enterSym(f,"UNKNOWN0E4",	0xE4);
-    enterSym(f,"CRLF",		0xE8);
-    enterSym(f,"UNKNOWN0EC",	0xEC);
-    enterSym(f,"UNKNOWN0F0",	0xF0);
-    enterSym(f,"UNKNOWN0F4",	0xF4);
-    enterSym(f,"ReadEOL", 	0xF8);
-    enterSym(f,"Read",		0xFC);
-    enterSym(f,"UNKNOWN100",	0x100);
-    enterSym(f,"UNKNOWN104",	0x104);
-    enterSym(f,"PostWrite",	0x108);
-    enterSym(f,"UNKNOWN10C",	0x10C);
-    enterSym(f,"Randomize",	0x110);
-    unknown(f,0x114, 0x174);
-    enterSym(f,"Random",		0x174);
-    unknown(f,0x178, 0x1B8);
-    enterSym(f,"FloatAdd",	0x1B8);		/* A guess! */
-    enterSym(f,"FloatSub",	0x1BC);		/* disicx - dxbxax -> dxbxax*/
-    enterSym(f,"FloatMult",	0x1C0);		/* disicx * dxbxax -> dxbxax*/
-    enterSym(f,"FloatDivide",	0x1C4);		/* disicx / dxbxax -> dxbxax*/
-    enterSym(f,"UNKNOWN1C8",	0x1C8);
-    enterSym(f,"DoubleToFloat",0x1CC);	/* dxax to dxbxax */
-    enterSym(f,"UNKNOWN1D0",	0x1D0);
-    enterSym(f,"WriteFloat",	0x1DC);
-    unknown(f,0x1E0, 0x200);
+    readTables(0);
+    readCmapOffsets();
+
+    enterSym("INITIALISE",	0x04);
+    enterSym("UNKNOWN008",	0x08);
+    enterSym("EXIT",		0x0C);
+    enterSym("BlockMove",	0x10);
+    unknown(0x14, 0xC8);
+    enterSym("PostIO",		0xC8);
+    enterSym("UNKNOWN0CC",	0xCC);
+    enterSym("STACKCHK",	0xD0);
+    enterSym("UNKNOWN0D4",	0xD4);
+    enterSym("WriteString",	0xD8);
+    enterSym("WriteInt",	0xDC);
+    enterSym("UNKNOWN0E0",	0xE0);
+    enterSym("UNKNOWN0E4",	0xE4);
+    enterSym("CRLF",		0xE8);
+    enterSym("UNKNOWN0EC",	0xEC);
+    enterSym("UNKNOWN0F0",	0xF0);
+    enterSym("UNKNOWN0F4",	0xF4);
+    enterSym("ReadEOL", 	0xF8);
+    enterSym("Read",		0xFC);
+    enterSym("UNKNOWN100",	0x100);
+    enterSym("UNKNOWN104",	0x104);
+    enterSym("PostWrite",	0x108);
+    enterSym("UNKNOWN10C",	0x10C);
+    enterSym("Randomize",	0x110);
+    unknown(0x114, 0x174);
+    enterSym("Random",		0x174);
+    unknown(0x178, 0x1B8);
+    enterSym("FloatAdd",	0x1B8);		/* A guess! */
+    enterSym("FloatSub",	0x1BC);		/* disicx - dxbxax -> dxbxax*/
+    enterSym("FloatMult",	0x1C0);		/* disicx * dxbxax -> dxbxax*/
+    enterSym("FloatDivide",	0x1C4);		/* disicx / dxbxax -> dxbxax*/
+    enterSym("UNKNOWN1C8",	0x1C8);
+    enterSym("DoubleToFloat",0x1CC);	/* dxax to dxbxax */
+    enterSym("UNKNOWN1D0",	0x1D0);
+    enterSym("WriteFloat",	0x1DC);
+    unknown(0x1E0, 0x200);
 
 }
 
-void TPL_PatternCollector::readString(FILE *f)
-{
-    uint8_t len;
-
-    len = readByte(f);
-    grab(f,len);
-    buf[len] = '\0';
-}
-
-void TPL_PatternCollector::unknown(FILE *f, unsigned j, unsigned k)
+void TPL_PatternCollector::unknown(unsigned j, unsigned k)
 {
     /* Mark calls j to k (not inclusive) as unknown */
     unsigned i;
+    char name[SYMLEN];
 
     for (i=j; i < k; i+= 4)
     {
-        sprintf((char *)buf, "UNKNOWN%03X", i);
-        enterSym(f,(char *)buf, i);
+        snprintf(name, sizeof(name), "UNKNOWN%03X", i);
+        enterSym(name, i);
     }
 }
 
-void TPL_PatternCollector::nextUnit(FILE *f)
+/* Find the start of the next unit; false if there is none */
+bool TPL_PatternCollector::nextUnit()
 {
-    /* Find the start of the next unit */
-
-    uint16_t dsegBase, sizeSyms, sizeOther1, sizeOther2;
-
-    fseek(f, unitBase+offStCseg, SEEK_SET);
-    dsegBase = roundUp(readShort(f));
-    sizeSyms = roundUp(readShort(f));
-    sizeOther1 = roundUp(readShort(f));
-    sizeOther2 = roundUp(readShort(f));
-
-    unitBase += dsegBase + sizeSyms + sizeOther1 + sizeOther2;
-
-    fseek(f, unitBase, SEEK_SET);
-    if (fread(buf, 1, 4, f) == 4)
-    {
-        buf[4]='\0';
-        printf("Start of unit: found %s\n", buf);
-    }
-
+    uint16_t dsegBase, sizeSyms, sizeOther1, sizeOther2, size;
+
+    image.seek(unitBase+offStCseg);
+    dsegBase = roundUp(image.word());
+    sizeSyms = roundUp(image.word());
+    sizeOther1 = roundUp(image.word());
+    sizeOther2 = roundUp(image.word());
+    size = dsegBase + sizeSyms + sizeOther1 + sizeOther2;
+    if (size == 0 or image.failed())
+        return false;
+
+    unitBase += size;
+
+    image.seek(unitBase);
+    if (image.left() < 4)
+        return false;
+    note("Start of unit: found %.4s\n", (const char *)image.bytes(4));
+    return true;
 }
 
-void TPL_PatternCollector::setVersionSpecifics()
+bool TPL_PatternCollector::setVersionSpecifics(const uint8_t *magic)
 {
 
-    version = buf[3];			/* The x of TPUx */
+    version = magic[3];			/* The x of TPUx */
 
     switch (version)
     {
@@ -183,121 +182,98 @@ void TPL_PatternCollector::setVersionSpecifics()
         break;
 
     default:
-        printf("Unknown version %c!\n", version);
-        exit(1);
-
-    }
-
-}
+        error = std::string("unknown version ") + version;
+        return false;
 
-void TPL_PatternCollector::savePos(FILE *f)
-{
-
-    if (positionStack.size() >= 20)
-    {
-        printf("Overflowed filePosn array\n");
-        exit(1);
     }
-    positionStack.push_back(ftell(f));
+    return true;
 }
 
-void TPL_PatternCollector::restorePos(FILE *f)
-{
-    if (positionStack.empty() == 0)
-    {
-        printf("Underflowed filePosn array\n");
-        exit(1);
-    }
-
-    fseek(f, positionStack.back(), SEEK_SET);
-    positionStack.pop_back();
-}
-
-void TPL_PatternCollector::enterUnitProcs(FILE *f)
+void TPL_PatternCollector::enterUnitProcs()
 {
 
     uint16_t i, LL;
     uint16_t hash, hsize, dhdr, pmapOff;
     char cat;
-    char name[40];
-
-    fseek(f, unitBase+0x0C, SEEK_SET);
-    cmap = readShort(f);
-    pmap = readShort(f);
-    fseek(f, unitBase+offStCseg, SEEK_SET);
-    csegBase = roundUp(readShort(f));		/* Round up to next 16 bdry */
-    printf("CMAP table at %04X\n", cmap);
-    printf("PMAP table at %04X\n", pmap);
-    printf("Code seg base %04X\n", csegBase);
+    char name[256];
+    uint8_t len;
 
-    readCmapOffsets(f);
+    readTables(unitBase);
+    readCmapOffsets();
 
-    fseek(f, unitBase+pmap, SEEK_SET);		/* Go to first pmap entry */
-    if (readShort(f) != 0xFFFF)				/* FFFF means none */
+    image.seek(unitBase+pmap);				/* Go to first pmap entry */
+    if (image.word() != 0xFFFF)				/* FFFF means none */
     {
-        sprintf(name, "UNIT_INIT_%d", ++unitNum);
-        enterSym(f,name, 0);					/* This is the unit init code */
+        snprintf(name, sizeof(name), "UNIT_INIT_%d", ++unitNum);
+        enterSym(name, 0);					/* This is the unit init code */
     }
 
-    fseek(f, unitBase+0x0A, SEEK_SET);
-    hash = readShort(f);
-    //printf("Hash table at %04X\n", hash);
-    fseek(f, unitBase+hash, SEEK_SET);
-    hsize = readShort(f);
-    //printf("Hash table size %04X\n", hsize);
-    for (i=0; i <= hsize; i+= 2)
+    image.seek(unitBase+0x0A);
+    hash = image.word();
+    //note("Hash table at %04X\n", hash);
+    image.seek(unitBase+hash);
+    hsize = image.word();
+    //note("Hash table size %04X\n", hsize);
+    for (i=0; i <= hsize and not image.failed(); i+= 2)
     {
-        dhdr = readShort(f);
+        dhdr = image.word();
         if (dhdr)
         {
-            savePos(f);
-            fseek(f, unitBase+dhdr, SEEK_SET);
-            do
+            size_t pos = image.pos();
+            image.seek(unitBase+dhdr);
+            /* The chain cannot be longer than the unit is; stop a looping one */
+            for (int n=0; n < 0x10000 and not image.failed(); n++)
             {
-                LL = readShort(f);
-                readString(f);
-                strcpy(name, (char *)buf);
-                cat = readByte(f);
+                LL = image.word();
+                const char *p = image.name(len);
+                memcpy(name, p, len);
+                name[len] = '\0';
+                cat = image.byte();
                 if ((cat == charProc) or (cat == charFunc))
                 {
-                    grab(f,skipPmap);		/* Skip to the pmap */
-                    pmapOff = readShort(f);	/* pmap offset */
-                    printf("pmap offset for %13s: %04X\n", name, pmapOff);
-                    enterSym(f,name, pmapOff);
-                }
-                //printf("%13s %c ", name, cat);
-                if (LL)
-                {
-                    //printf("LL seek to %04X\n", LL);
-                    fseek(f, unitBase+LL, SEEK_SET);
+                    image.skip(skipPmap);		/* Skip to the pmap */
+                    pmapOff = image.word();	/* pmap offset */
+                    note("pmap offset for %13s: %04X\n", name, pmapOff);
+                    enterSym(name, pmapOff);
                 }
-            } while (LL);
-            restorePos(f);
+                //note("%13s %c ", name, cat);
+                if (LL == 0)
+                    break;
+                //note("LL seek to %04X\n", LL);
+                image.seek(unitBase+LL);
+            }
+            image.seek(pos);
         }
+        if (i == 0xFFFE)
+            break;
     }
 
 }
 
-int TPL_PatternCollector::readSyms(FILE *f)
+int TPL_PatternCollector::readSyms(const uint8_t *data, size_t size)
 {
-    grab(f,4);
-    if ((strncmp((char *)buf, "TPU0", 4) != 0) and ((strncmp((char *)buf, "TPU5", 4) != 0)))
+    image = ImageCursor(data, size);
+    keys.clear();
+    const uint8_t *magic = image.bytes(4);
+    if ((magic == nullptr) or ((memcmp(magic, "TPU0", 4) != 0) and (memcmp(magic, "TPU5", 4) != 0)))
     {
-        printf("Not a Turbo Pascal version 4 or 5 library file\n");
-        fclose(f);
-        exit(1);
+        error = "not a Turbo Pascal version 4 or 5 library file";
+        return -1;
     }
 
-    setVersionSpecifics();
+    if (not setVersionSpecifics(magic))
+        return -1;
 
-    enterSystemUnit(f);
     unitBase = 0;
-    do
+    unitNum = 0;
+    enterSystemUnit();
+    while (not image.failed() and nextUnit())
+        enterUnitProcs();
+    if (image.failed())
     {
-        nextUnit(f);
-        if (feof(f)) break;
-        enterUnitProcs(f);
-    } while (1);
+        error = "damaged library";
+        return -1;
+    }
 
-    return count;
+    return keys.size();
 }
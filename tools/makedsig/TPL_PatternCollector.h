@@ -1,6 +1,7 @@
 #ifndef TPL_PATTERNCOLLECTOR_H
 #define TPL_PATTERNCOLLECTOR_H
 #include "PatternCollector.h"
+#include "ImageCursor.h"
 
 #include <stdio.h>
 #include <stdint.h>
@@ -8,31 +9,24 @@
 
 struct TPL_PatternCollector : public PatternCollector {
 protected:
+    ImageCursor image;          /* The whole library */
     uint16_t cmap, pmap, csegBase, unitBase;
     uint16_t offStCseg, skipPmap;
-    int count = 0;
-    int	cAllocSym = 0;
     int unitNum = 0;
     char version, charProc, charFunc;
-    uint16_t csegoffs[100];
-    uint16_t csegIdx;
-    std::vector<long int> positionStack;
+    std::vector<uint16_t> csegoffs;
 
-    void enterSym(FILE *f,const char *name, uint16_t pmapOffset);
-    void allocSym(int count);
-    void readCmapOffsets(FILE *f);
-    void enterSystemUnit(FILE *f);
-    void readString(FILE *f);
-    void unknown(FILE *f,unsigned j, unsigned k);
-    void nextUnit(FILE *f);
-    void setVersionSpecifics(void);
-    void savePos(FILE *f);
-    void restorePos(FILE *f);
-    void enterUnitProcs(FILE *f);
+    void enterSym(const char *name, uint16_t pmapOffset);
+    void readCmapOffsets();
+    void readTables(uint16_t base);
+    void enterSystemUnit();
+    void unknown(unsigned j, unsigned k);
+    bool nextUnit();
+    bool setVersionSpecifics(const uint8_t *magic);
+    void enterUnitProcs();
 public:
     /* Read the .tpl file, and put the keys into the array *keys[]. Returns the count */
-    int readSyms(FILE *f);
+    int readSyms(const uint8_t *image, size_t size);
 };
 
 #endif // TPL_PATTERNCOLLECTOR_H
-
@@ -2,6 +2,7 @@
 
 #include "LIB_PatternCollector.h"
 #include "TPL_PatternCollector.h"
+#include "MappedFile.h"
 #include "perfhlib.h"		/* Symbol table prototypes */
 #include "msvc_fixes.h"
 
@@ -14,9 +15,15 @@
 #include <memory.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unordered_set>
 
 /* Symbol table constnts */
 #define C 2.2 /* Sparseness of graph. See Czech, Havas and Majewski for details */
+#define MAXKEYS 14894 /* The most keys whose g[] fits the 16 bit section size */
 
 /* prototypes */
 
@@ -24,64 +31,204 @@ void saveFile(FILE *fl, const PerfectHash &p_hash, PatternCollector *coll);		/*
 
 static int	 numKeys;				/* Number of useful codeview symbols */
 
+/* The signatures of several libraries. A signature a library before had already, name and
+    pattern alike, is left out */
+struct MergedCollector : public PatternCollector
+{
+    int readSyms(const uint8_t *, size_t) { return keys.size(); }
+    /* Add the keys of coll; returns how many were left out */
+    int merge(const PatternCollector &coll)
+    {
+        std::unordered_set<std::string> mine;
+        int dropped = 0;
+        for (const HASHENTRY &e : coll.keys)
+        {
+            std::string key(e.name, SYMLEN + PATLEN);
+            if (seen.count(key))
+            {
+                dropped++;
+                continue;
+            }
+            mine.insert(key);
+            keys.push_back(e);
+        }
+        seen.insert(mine.begin(), mine.end());
+        return dropped;
+    }
+private:
+    std::unordered_set<std::string> seen;
+};
+
+/* A library to read, and what was found in it */
+struct Library
+{
+    QString path;
+    std::unique_ptr<PatternCollector> collector;
+    size_t size = 0;
+    int count = 0;
+    std::string error;
+};
+
+static PatternCollector *collectorFor(const QString &path)
+{
+    if(path.endsWith("tpl", Qt::CaseInsensitive))
+        return new TPL_PatternCollector;
+    if(path.endsWith(".lib", Qt::CaseInsensitive) or path.endsWith(".obj", Qt::CaseInsensitive))
+        return new LIB_PatternCollector;
+    return nullptr;
+}
+
+static void readLibrary(Library &lib)
+{
+    MappedFile file;
+    if (not file.open(qPrintable(lib.path), lib.error))
+    {
+        lib.count = -1;
+        return;
+    }
+    lib.size = file.size();
+    lib.count = lib.collector->readSyms(file.data(), file.size());
+    if (lib.count < 0)
+        lib.error = lib.collector->error;
+}
+
+/* The names in a list file, one per line */
+static bool readList(const QString &path, QStringList &names)
+{
+    FILE *list = fopen(qPrintable(path), "rt");
+    char line[1024];
+    if (list == NULL)
+        return false;
+    while (fgets(line, sizeof(line), list))
+    {
+        QString name = QString(line).trimmed();
+        if (not name.isEmpty())
+            names << name;
+    }
+    fclose(list);
+    return true;
+}
 
 static void printUsage(bool longusage) {
     if(longusage)
         printf(
                     "This program is to make 'signatures' of known c and tpl library calls for the dcc program.\n"
-                    "It needs as the first arg the name of a library file, and as the second arg, the name "
-                    "of the signature file to be generated.\n"
+                    "It needs as arguments the names of one or more library files, and as the last arg, the name "
+                    "of the signature file to be generated. The signatures of all the libraries go into the one "
+                    "file; an argument @<file> names a file listing libraries, one per line.\n"
                     "Example: makedsig CL.LIB dccb3l.sig\n"
                     "      or makedsig turbo.tpl dcct4p.sig\n"
+                    "      or makedsig CS.LIB MATHS.LIB EMU.LIB dccb2s.sig\n"
+                    "Options:\n"
+                    "  --seed <n>     seed of the hash table generation (default 1); the same seed and\n"
+                    "                 libraries always give the same signature file\n"
+                    "  --threads <n>  number of threads reading the libraries and searching for the hash\n"
+                    "                 tables (default 1)\n"
                     );
     else
-        printf("Usage: makedsig <libname> <signame>\n"
+        printf("Usage: makedsig [--seed <n>] [--threads <n>] <libname>... <signame>\n"
                "or makedsig -h for help\n");
 }
 int main(int argc, char *argv[])
 {
     QCoreApplication app(argc,argv);
     FILE *f2; // output file
-    FILE *srcfile; // .lib file
-    int s;
-    if(app.arguments().size()<2) {
+    uint32_t seed = 1;
+    int threads = 1;
+    QStringList args;
+    const QStringList arguments = app.arguments();
+    for(int i=1; i<arguments.size(); ++i) {
+        const QString &arg(arguments[i]);
+        if (arg.startsWith("-h") or arg.startsWith("-?"))
+        {
+            printUsage(true);
+            return 0;
+        }
+        bool ok = true;
+        if(arg == "--seed" and i+1 < arguments.size())
+            seed = arguments[++i].toUInt(&ok);
+        else if(arg == "--threads" and i+1 < arguments.size())
+            threads = arguments[++i].toInt(&ok);
+        else
+            args << arg;
+        if(not ok or threads < 1) {
+            printUsage(false);
+            return -1;
+        }
+    }
+    if(args.size()<2) {
         printUsage(false);
         return 0;
     }
-    QString arg2 = app.arguments()[1];
-    if (arg2.startsWith("-h") or arg2.startsWith("-?"))
-    {
-        printUsage(true);
-        return 0;
+    QString sigName = args.takeLast();
+    QStringList names;
+    for(const QString &arg : args) {
+        if(not arg.startsWith("@"))
+            names << arg;
+        else if(not readList(arg.mid(1), names)) {
+            printf("Cannot read %s\n", qPrintable(arg.mid(1)));
+            exit(2);
+        }
     }
-    PatternCollector *collector;
-    if(arg2.endsWith("tpl")) {
-        collector = new TPL_PatternCollector;
-    } else if(arg2.endsWith(".lib")) {
-        collector = new LIB_PatternCollector;
-    } else {
-        qCritical() << "Unsupported file type.";
-        return -1;
+    std::vector<Library> libs(names.size());
+    for(int i=0; i<names.size(); ++i) {
+        libs[i].path = names[i];
+        libs[i].collector.reset(collectorFor(names[i]));
+        if(not libs[i].collector) {
+            qCritical() << "Unsupported file type:" << names[i];
+            return -1;
+        }
     }
-    if ((srcfile = fopen(argv[1], "rb")) == NULL)
+
+    /* Each library is read by one thread; they are merged in the order given, so the
+        signature file does not depend on the number of threads */
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i; (i = next++) < libs.size(); )
+            readLibrary(libs[i]);
+    };
+    std::vector<std::thread> pool;
+    for (int i=1; i < std::min<int>(threads, libs.size()); i++)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread &t : pool)
+        t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    MergedCollector merged;
+    size_t bytes = 0;
+    int dropped = 0;
+    for (Library &lib : libs)
     {
-        printf("Cannot read %s\n", argv[1]);
+        fputs(lib.collector->log.c_str(), stdout);
+        if (lib.count < 0)
+        {
+            printf("Cannot read %s: %s\n", qPrintable(lib.path), lib.error.c_str());
+            exit(2);
+        }
+        if (libs.size() > 1)
+            printf("%s: %d symbols\n", qPrintable(lib.path), lib.count);
+        bytes += lib.size;
+        dropped += merged.merge(*lib.collector);
+        lib.collector.reset();
+    }
+    if (libs.size() > 1)
+        printf("%d libraries, %.2f MB read in %.3f s: %d symbols, %d already in an earlier library\n",
+               (int)libs.size(), bytes / 1e6, seconds, (int)merged.keys.size(), dropped);
+    numKeys = merged.keys.size();
+    if (numKeys == 0)
+    {
+        printf("No signatures found\n");
         exit(2);
     }
-
-    if ((f2 = fopen(argv[2], "wb")) == NULL)
+    if (numKeys > MAXKEYS)
     {
-        printf("Cannot write %s\n", argv[2]);
+        printf("%d symbols are too many for one signature file; the most is %d\n", numKeys, MAXKEYS);
         exit(2);
     }
 
-    fprintf(stderr, "Seed: ");
-    scanf("%d", &s);
-    srand(s);
-
     PerfectHash p_hash;
-    numKeys = collector->readSyms(srcfile);			/* Read the keys (symbols) */
-
     printf("Num keys: %d; vertices: %d\n", numKeys, (int)(numKeys*C));
     /* Set the parameters for the hash table */
     p_hash.setHashParams(   numKeys,					/* The number of symbols */
@@ -91,13 +238,18 @@ int main(int argc, char *argv[])
                             numKeys*C);			/* C is the sparseness of the graph. See Czech,
                                         Havas and Majewski for details */
 
-    /* The following two functions are in perfhlib.c */
-    p_hash.map(collector);     /* Perform the mapping. This will call getKey() repeatedly */
-    p_hash.assign();						/* Generate the function g */
+    /* Generate T1, T2 and g. This will call getKey() repeatedly */
+    p_hash.generate(&merged, seed, threads);
+    printf("Seed %u: hash tables found at attempt %d\n", seed, p_hash.attempts());
 
-    saveFile(f2,p_hash,collector);     /* Save the resultant information */
+    /* Opened only now, so that no signature file is left behind if the libraries could not be read */
+    if ((f2 = fopen(qPrintable(sigName), "wb")) == NULL)
+    {
+        printf("Cannot write %s\n", qPrintable(sigName));
+        exit(2);
+    }
+    saveFile(f2,p_hash,&merged);     /* Save the resultant information */
 
-    fclose(srcfile);
     fclose(f2);
 
 }
@@ -5,128 +5,59 @@
 /* Descended from xansi; thanks Geoff! thanks Glenn! */
 
 #include "parsehdr.h"
+#include "PrototypeDB.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
 
-static dword userval;
-namespace {
-/* the IGNORE byte */
-byte slosh;
-byte last_slosh;
-byte quote1;
-byte quote2;
-byte comment;
-byte hash;
-byte ignore1; /* Special: ignore egactly 1 char */
-byte double_slash;
-byte spare;
-
-int buff_idx;
-char buffer[BUFF_SIZE];
-
-byte start; /* Started recording to the buffer */
-byte func;  /* Function header detected */
-byte hash_ext;
-int curly; /* Level inside curly brackets */
-int xtern; /* Level inside a extern "C" {} situation */
-int round1; /* Level inside () */
-int line, col;
-dword chars;
-char lastch;
-
-#define NIL -1 /* Used as an illegal index */
-
-FILE *datFile;     /* Stream of the data (output) file */
-char fileName[81]; /* Name of current header file */
-
-PH_FUNC_STRUCT *pFunc; /* Pointer to the functions array */
-int numFunc;           /* How many elements saved so far */
-int allocFunc;         /* How many elements allocated so far */
-int headFunc;          /* Head of the function name linked list */
-
-PH_ARG_STRUCT *pArg; /* Pointer to the arguements array */
-int numArg;          /* How many elements saved so far */
-int allocArg;        /* How many elements allocated so far */
-int headArg;         /* Head of the arguements linked list */
-}
-// DO Callback
-boolT phDoCB(int id, char *data) {
-  /*	return callback(hDCX, id, data, userval);*/
-  return true;
-}
+void HeaderParser::say(const char *fmt, ...) {
+  char msg[512];
+  va_list ap;
 
-void phError(char *errmsg) {
-  char msg[200];
-
-  sprintf(msg, "PH *ERROR*\nFile: %s L=%d C=%d O=%lu\n%s", fileName, line, col,
-          chars, errmsg);
-  printf(msg);
+  va_start(ap, fmt);
+  vsnprintf(msg, sizeof(msg), fmt, ap);
+  va_end(ap);
+  log += msg;
 }
 
-void phWarning(char *errmsg) {
-  char msg[200];
+void HeaderParser::phError(const char *errmsg) {
+  say("PH *ERROR*\nFile: %s L=%d C=%d O=%lu\n%s", m_fileName.c_str(), line, col,
+      chars, errmsg);
+}
 
-  sprintf(msg, "PH -warning-\nFile: %s L=%d C=%d O=%lu\n%s\n", fileName, line,
-          col, chars, errmsg);
-  printf(msg);
+void HeaderParser::phWarning(const char *errmsg) {
+  say("PH -warning-\nFile: %s L=%d C=%d O=%lu\n%s\n", m_fileName.c_str(), line,
+      col, chars, errmsg);
 }
 
-int IsIgnore() {
+int HeaderParser::IsIgnore() const {
   return (comment || quote1 || quote2 || slosh || hash || ignore1 ||
           double_slash);
 }
 
-boolT isAlphaNum(char ch) {
-  return (((ch >= 'A') && (ch <= 'Z')) || ((ch >= 'a') && (ch <= 'z')) ||
-          ((ch >= '0') && (ch <= '9')) || (ch == '_'));
-}
-
-boolT AddToBuffer(char ch) {
-  if (buff_idx >= BUFF_SIZE) {
-    ERR("function buffer overflow (function unterminated?)\n");
-    return false;
-  } else {
-    buffer[buff_idx++] = ch;
-    return true;
-  }
-}
-
-boolT remFromBuffer() {
-  if (buff_idx == 0) {
-    ERR("function buffer underflow (internal error?)\n");
-    return false;
-  } else {
-    buff_idx--;
-    return true;
-  }
-}
-
 /*----------------------------------------------*/
 /* This is a function declaration, typedef, etc.*/
 /* 			Do something with it. 				*/
 /*----------------------------------------------*/
 
-void ProcessBuffer(int id) {
-  if (buff_idx > 0) {
-    buffer[buff_idx] = '\0';
-
-    // CALL CALL BACK FUNTION WITH APPRORIATE CODE!
-
+void HeaderParser::ProcessBuffer(int id) {
+  if (!buffer.empty()) {
     switch (id) {
     case PH_FUNCTION:
     // eek, but...
     case PH_PROTO:
       // sort out into params etc
-      phBuffToFunc(buffer);
+      phBuffToFunc(buffer.c_str());
       break;
 
     case PH_TYPEDEF:
     case PH_DEFINE:
-      // sort out into defs
-      phBuffToDef(buffer);
-      break;
+    // sort out into defs
 
     case PH_MPROTO:
     // eek!
@@ -136,595 +67,279 @@ void ProcessBuffer(int id) {
 
     case PH_JUNK:
     default:
-      phDoCB(id, buffer);
       break;
     }
     start = false;
     func = false;
-    buff_idx = 0;
+    buffer.clear();
   }
 }
 
-void phInit(char *filename) // filename is for reference only!!!
-{
-  slosh = last_slosh = start = func = comment = double_slash = hash = ignore1 =
-      quote1 = quote2 = hash_ext = false;
-
-  buff_idx = curly = xtern = col = round1 = 0;
-
-  line = 1;
-
-  chars = 0L;
-
-  lastch = 0;
-}
-
-boolT phFree(void) {
-  // remove atoms etc, free buffers
-  return true;
-}
-
-void phChar(char ch) {
-  col++;
-  chars++;
-  //	printf("%d%% done\r", chars*100/filelen);
+/* Take a lump of data from a header file, and churn the state machine
+    through each char.  The state is kept from one lump to the next */
+void HeaderParser::data(const char *buff, size_t ndata) {
+  for (size_t i = 0; i < ndata; i++) {
+    char ch = buff[i];
 
-  if (slosh != last_slosh) {
-    DBG("[SLOSH OFF]");
-  }
+    if (ch == '\r')
+      continue; /* As if read in text mode */
+    col++;
+    chars++;
 
-  switch (ch) {
-  case ',':
-    if (!IsIgnore() && (curly == xtern) && (start) && (func))
-    /* must be multi proto */
-    {
-      if (lastch == ')') /* eg int foo(), bar(); */
+    switch (ch) {
+    case ',':
+      if (!IsIgnore() && (curly == xtern) && (start) && (func))
+      /* must be multi proto */
       {
-        ProcessBuffer(PH_MPROTO);
-        DBG("[END OF MULTIPROTOTYPE]")
-      }
-    }
-    break;
-
-  case ';':
-    if (!IsIgnore() && (curly == xtern) && (start)) {
-      if (func) {
-        if (lastch == ')') {
-          ProcessBuffer(PH_PROTO);
-          DBG("[END OF PROTOTYPE]")
+        if (lastch == ')') /* eg int foo(), bar(); */
+        {
+          ProcessBuffer(PH_MPROTO);
+          DBG("[END OF MULTIPROTOTYPE]")
         }
-      } else {
-        ProcessBuffer(PH_VAR);
-        DBG("[END OF VARIABLE]")
-      }
-    }
-    break;
-
-  case 10: /* end of line */
-    line++;
-    /* 			chars++;	*/ /* must have been a CR before it
-                                                  methinks */
-    col = 0;
-    if (double_slash) {
-      double_slash = false;
-      DBG("[DOUBLE_SLASH_COMMENT OFF]")
-    } else if (hash) {
-      if (hash_ext) {
-        hash_ext = false;
-      } else {
-        hash = false;
-        DBG("[HASH OFF]")
       }
-    }
-    if (xtern && (strncmp(buffer, "extern", 6) == 0)) {
-      start = false; /* Not the start of anything */
-      buff_idx = 0;  /* Kill the buffer */
-    }
-    break;
-
-  case '#': /* start of # something at beginning of line */
-    if ((!IsIgnore()) && (curly == xtern)) {
-      hash = true;
-      DBG("[HASH ON]")
-    }
-    break;
-
-  case '{':
-    if (!IsIgnore()) {
-      char st[80];
+      break;
 
-      if ((curly == xtern) && (start) && (func)) {
-        ProcessBuffer(PH_FUNCTION);
-        DBG("[FUNCTION DECLARED]")
+    case ';':
+      if (!IsIgnore() && (curly == xtern) && (start)) {
+        if (func) {
+          if (lastch == ')') {
+            ProcessBuffer(PH_PROTO);
+            DBG("[END OF PROTOTYPE]")
+          }
+        } else {
+          ProcessBuffer(PH_VAR);
+          DBG("[END OF VARIABLE]")
+        }
       }
+      break;
 
-      curly++;
-      sprintf(st, "[CURLY++ %d]", curly);
-      DBG(st)
-    }
-    break;
+    case 10: /* end of line */
+      line++;
+      col = 0;
+      if (double_slash) {
+        double_slash = false;
+        DBG("[DOUBLE_SLASH_COMMENT OFF]")
+      } else if (hash) {
+        if (hash_ext) {
+          hash_ext = false;
+        } else {
+          hash = false;
+          DBG("[HASH OFF]")
+        }
+      }
+      if (xtern && (buffer.compare(0, 6, "extern") == 0)) {
+        start = false;  /* Not the start of anything */
+        buffer.clear(); /* Kill the buffer */
+      }
+      break;
 
-  case '}':
-    if (!IsIgnore()) {
-      char st[80];
+    case '#': /* start of # something at beginning of line */
+      if ((!IsIgnore()) && (curly == xtern)) {
+        hash = true;
+        DBG("[HASH ON]")
+      }
+      break;
 
-      if (curly > 0) {
-        if (xtern && (xtern == curly)) {
-          xtern = 0;
-          DBG("[EXTERN OFF]");
+    case '{':
+      if (!IsIgnore()) {
+        if ((curly == xtern) && (start) && (func)) {
+          ProcessBuffer(PH_FUNCTION);
+          DBG("[FUNCTION DECLARED]")
         }
-        curly--;
-        sprintf(st, "[CURLY-- %d]", curly);
-        DBG(st)
-      } else {
-        /* match the {s */
-        ERR("too many \"}\"\n");
+        curly++;
       }
-    }
-    break;
+      break;
 
-  case '(':
-    if (!IsIgnore()) {
-      char st[80];
+    case '}':
+      if (!IsIgnore()) {
+        if (curly > 0) {
+          if (xtern && (xtern == curly)) {
+            xtern = 0;
+            DBG("[EXTERN OFF]");
+          }
+          curly--;
+        } else {
+          /* match the {s */
+          phError("too many \"}\"\n");
+        }
+      }
+      break;
 
-      if ((curly == xtern) && (round1 == 0) && (start)) {
-        func = true;
-        DBG("[FUNCTION]")
+    case '(':
+      if (!IsIgnore()) {
+        if ((curly == xtern) && (round1 == 0) && (start)) {
+          func = true;
+          DBG("[FUNCTION]")
+        }
+        round1++;
       }
-      round1++;
-      sprintf(st, "[ROUND++ %d]", round1);
-      DBG(st)
-    }
-    break;
-
-  case ')':
-    if (!IsIgnore()) {
-      char st[80];
-
-      if (round1 > 0) {
-        round1--;
-        sprintf(st, "[ROUND-- %d]", round1);
-        DBG(st)
-      } else {
-        ERR("too many \")\"\n");
+      break;
+
+    case ')':
+      if (!IsIgnore()) {
+        if (round1 > 0) {
+          round1--;
+        } else {
+          phError("too many \")\"\n");
+        }
       }
-    }
-    break;
-
-  case '\\':
-    if (!slosh && (quote1 || quote2)) {
-      last_slosh = true;
-      DBG("[SLOSH ON]")
-    } else if (hash) {
-      hash_ext = true;
-    }
-    break;
+      break;
 
-  case '*':
-    if (lastch == '/') /* allow nested comments ! */
-    {
-      char st[80];
+    case '\\':
+      if (!slosh && (quote1 || quote2)) {
+        last_slosh = true;
+        DBG("[SLOSH ON]")
+      } else if (hash) {
+        hash_ext = true;
+      }
+      break;
 
-      comment++;
+    case '*':
+      if (lastch == '/') /* allow nested comments ! */
+      {
+        comment++;
 
-      if (start) {
-        remFromBuffer();
+        if (start && !buffer.empty()) {
+          buffer.pop_back();
+        }
       }
+      break;
 
-      sprintf(st, "[COMMENT++ %d]", comment);
-      DBG(st)
-    }
-    break;
-
-  case '/':
-    if ((lastch == '*') && (!quote1) && (!quote2)) {
-      if (comment > 0) {
-        char st[80];
+    case '/':
+      if ((lastch == '*') && (!quote1) && (!quote2)) {
+        if (comment > 0) {
+          comment--;
 
-        comment--;
+          /* Don't want the closing slash in the buffer */
+          ignore1 = true;
+        } else {
+          phError("too many \"*/\"\n");
+        }
+      } else if (lastch == '/') {
+        /* Double slash to end of line is a comment. */
+        double_slash = true;
 
-        /* Don't want the closing slash in the buffer */
-        ignore1 = true;
+        if (start && !buffer.empty()) {
+          buffer.pop_back();
+        }
 
-        sprintf(st, "[COMMENT-- %d]", comment);
-        DBG(st)
-      } else {
-        ERR("too many \"*/\"\n");
+        DBG("[DOUBLE_SLASH_COMMENT ON]")
       }
-    } else if (lastch == '/') {
-      /* Double slash to end of line is a comment. */
-      double_slash = true;
+      break;
 
-      if (start) {
-        remFromBuffer();
-      }
+    case '\"':
+      if ((!comment) && (!quote1) && (!slosh)) {
+        quote2 = (byte)(!quote2);
 
-      DBG("[DOUBLE_SLASH_COMMENT ON]")
-    }
-    break;
-
-  case '\"':
-    if ((!comment) && (!quote1) && (!slosh)) {
-      quote2 = (byte)(!quote2);
-      if (quote2)
-        DBG("[QUOTE2ON]")
-      if (!quote2)
-        DBG("[QUOTE2OFF]")
-
-      /* We want to catch the extern "C" {} thing... */
-      if (!quote2 && start && (lastch == 'C')) {
-        if (strcmp(buffer, "extern ") == 0) {
-          char st[80];
-
-          xtern = curly + 1; /* The level inside the extern {} */
-          sprintf(st, "[EXTERN ON %d]", xtern);
-          DBG(st)
+        /* We want to catch the extern "C" {} thing... */
+        if (!quote2 && start && (lastch == 'C')) {
+          if (buffer == "extern ") {
+            xtern = curly + 1; /* The level inside the extern {} */
+            DBG("[EXTERN ON]");
+          }
         }
       }
-    }
-    break;
+      break;
 
-  case '\'':
-    if ((!comment) && (!quote2) && (!slosh)) {
-      {
+    case '\'':
+      if ((!comment) && (!quote2) && (!slosh)) {
         quote1 = (byte)(!quote1);
-        if (quote1)
-          DBG("[QUOTE1ON]")
-        if (!quote1)
-          DBG("[QUOTE1OFF]")
       }
-    }
-    break;
+      break;
 
-  case '\t':
-    ch = ' ';
-    break;
+    case '\t':
+      ch = ' ';
+      break;
 
-  default:
-    if ((ch != -1) && !IsIgnore() && (curly == xtern) && (!start) &&
-        (ch != ' ')) {
-      start = true;
-      DBG("[START OF SOMETHING]")
+    default:
+      if ((ch != -1) && !IsIgnore() && (curly == xtern) && (!start) &&
+          (ch != ' ')) {
+        start = true;
+        DBG("[START OF SOMETHING]")
+      }
+      break;
     }
-    break;
-  }
 
-  if (ch != -1) {
-    if (start && !IsIgnore()) {
-      AddToBuffer(ch);
+    if (ch != -1) {
+      if (start && !IsIgnore()) {
+        buffer += ch;
+      }
     }
-  }
 
-  lastch = ch;
-  slosh = last_slosh;
-  last_slosh = 0;
-  ignore1 = false;
-
-} /* of phChar */
-
-/* Take a lump of data from a header file, and churn the state machine
-    through each char */
-boolT phData(char *buff, int ndata) {
-  int i, j;
-#ifdef DEBUG
-  char cLine[81];
-  char cfLine[90];
-#endif
-
-  if (ndata < 1) {
-    ndata = strlen(buff);
+    lastch = ch;
+    slosh = last_slosh;
+    last_slosh = 0;
+    ignore1 = false;
   }
-  j = 0;
-
-  for (i = 0; i < ndata; i++) {
-    phChar(buff[i]);
-#ifdef DEBUG
-    if (j < 80)
-      cLine[j++] = buff[i];
-    if (buff[i] == '\n') {
-      cLine[j] = '\0';
-      sprintf(cfLine, "\n***%03d %s\n", line, cLine);
-      DBG(cfLine);
-      j = 0;
-    }
-#endif
-  }
-
-  return true;
 }
 
-boolT phPost(void) {
+boolT HeaderParser::post(void) {
   boolT err = true;
   char msg[80];
 
   if (quote1) {
-    WARN("EOF: \' not closed");
+    phWarning("EOF: \' not closed");
     err = false;
   }
 
   if (quote2) {
-    WARN("EOF: \" not closed");
+    phWarning("EOF: \" not closed");
     err = false;
   }
 
   if (comment) {
-    WARN("EOF: comment not closed");
+    phWarning("EOF: comment not closed");
     err = false;
   }
 
   if (slosh) {
-    WARN("EOF: internal slosh set error");
+    phWarning("EOF: internal slosh set error");
     err = false;
   }
 
   if (curly > 0) {
     sprintf(msg, "EOF: { level = %d", curly);
-    WARN(msg);
+    phWarning(msg);
     err = false;
   }
 
   if (round1 > 0) {
     sprintf(msg, "EOF: ( level = %d", round1);
-    WARN(msg);
+    phWarning(msg);
     err = false;
   }
 
   if (hash) {
-    WARN("warning hash is set on last line ???");
+    phWarning("warning hash is set on last line ???");
     err = false;
   }
 
   return err;
 }
 
-#if 0
-enum FUNC_E { NORM , LEFT , RIGHT, NEXT };
-
-void
-NamesToLabel(LPPH_FUNC lpF)
-{
-int	i, j;
-
-    for (i=0; i < lpF->num_params; i++)
-    {
-        while (isspace(types[i][0]))
-        {
-            lstrcdel(types[i], 0);
-        }
-
-        j = 0;
-        while(names[i][j] != '\0')
-        {
-            if ((names[i][j] != '*')	&&
-                    (names[i][j] != '[') &&
-                    (names[i][j] != ']'))
-            {
-                lstrccat(label[i], names[i][j]);
-            }
-            j++ ;
-        }
-    }
-}
-
-boolT
-MoveLastWord(char *src, char *dest)		/* take arg name from type  */
-{
-int		i, l;
-LPSTR	s2;
-
-    if (s2 = strchr(src, '*'))	/* if there is a * use it as starting point */
-    {
-        lstrcpy(dest, s2);
-        *s2 = '\0';	/* terminate */
-    }
-    else
-    {
-        l = strlen(src);
-        i = l-1;
-        while ((i > 0) && ((isspace(src[i])) || (src[i] == '[') || (src[i] == ']')))
-        /* find last non space or non [] */
-        {
-            if (isspace(src[i]))
-            {
-                lstrcdel(src, i);
-            }	/* remove trailing spaces */
-            i--;
-        }
-        while ((i > 0) && (!isspace(src[i])))	/* find the previous space */
-        {
-            i--;
-        }
-        if (i)
-        {
-            i++;
-            lstrcpy(dest, &src[i]);
-            src[i] = '\0';		/* terminate */
-        }
-        else
-        {
-            /* no type !!! */
-
-//			if ((mode == TOANSI) ||
-//						((mode == FROMANSI) && (strstr(src, "...") == NULL))
-//				 )
-
-            if (strstr(src, "...") == NULL)	// not a var arg perhaps?
-            {
-            char	msg[80];
-
-//				sprintf(msg,"no type for arg # %d, \"%s\"\n",lpF->num_params, (LPSTR) src);
-//				ERR(msg);
-                return false;
-            }
-            else	// d'oh!
-            {
-                WARN("looks like a vararg to me!");
-                /* maybe it is a ... !!!!!! */
-            }
-        }
-    }
-
-
-    i = strlen(src) - 1;
-
-    while ((isspace(src[i])) && (i >= 0))
-    {
-        src[i--] = '\0';
-    }
-
-    i = 0;
-    while (dest[i] != '\0')
-    {
-        if (isspace(dest[i]))
-        {
-            lstrcdel(dest, i);
-        }
-        i++ ;
-    }
-
-    while ((isspace(src[0])) && (src[0] != '\0'))
-    {
-        lstrcdel(src, 0);
-    }
-
-    return true;
-}
-
-
-
-
-int
-Lookup(char *aname)	/* lookup var name in labels and return arg number */
-{
-int		i, p;
-char	tname[NAMES_L];
-int		bstate = false;
-
-/* eg: lookup *fred[] for match to fred */
-
-    tname[0] = '\0';
-    p = -1;		/* default return for no match */
-
-    /* tname is aname without puncs etc */
-    i = 0;
-    while(aname[i] != '\0')
-    {
-        if (aname[i] == '[')
-        {
-            bstate = true;
-        }
-        else
-        if (aname[i] == ']')
-        {
-            bstate = false;
-        }
-
-        if ((isalnum(aname[i]) || aname[i] == '-' || aname[i] == '_') && (!bstate))
-        {
-            lstrccat(tname, aname[i]);
-        }
-        i++;
-    }
-
-    /* lookup tname in the labels and find out which arg it is */
-    for (i=0; i < num_params; i++)
-    {
-        if (lstrcmp(tname, label[i]) == 0)
-        {
-            p = i;	/* this one ! */
-            break;
-        }
-    }
-    return p;
-}
-
-
-/* put the name and type at correct arg number */
-
-
-boolT
-Plop(char *atype, char *aname, int FAR *num_params, int FAR *num_found)
-{
-char	msg[80];
-int	t;
-
-    if (num_found >= num_params)
-    {
-        sprintf(msg,"extra argument \"%s\" in func \"%s\"\n", (LPSTR) aname, (LPSTR) func_name);
-        ERR(msg);
-        return false;
-    }
-
-    t = Lookup(aname);	/* arg number */
-
-    if (t == -1)	/* couldn't find it */
-    {
-        sprintf(msg,"bad argument \"%s\" in func \"%s\"\n", (LPSTR) aname, (LPSTR) func_name);
-        ERR(msg);
-        return false;
-    }
-
-    if ((strlen(types[t]) > 0) || (strlen(names[t]) > 0))	/* in use ? */
-    {
-
-        sprintf(msg,"argument \"%s\" already used in \"%s\"\n", (LPSTR) aname, (LPSTR) func_name);
-        ERR(msg);
-        return false;
-    }
-
-    lstrcpy(types[t], atype);
-    lstrcpy(names[t], aname);
-
-    num_found++;		/* got another! */
-
-    return true;
-}
-
-#define IGN                                                                    \
-  ((*chp == '(') || (*chp == ')') || (*chp == ',') || (*chp == ';') ||         \
-   (isspace(*chp)))
-
-#define IGNP                                                                   \
-  ((*chp == '(') || (*chp == ')') || (*chp == ',') || (*chp == ';') ||         \
-   (*chp == '\n'))
-
-#endif
-
-char token[40]; /* Strings that might be types, nodifiers or idents */
-char ident[40]; /* Names of functions or protos go here */
-char lastChar;
-char *p;
-int indirect;
-boolT isLong, isShort, isUnsigned;
-int lastTokPos; /* For "^" in error messages */
-char *buffP;
-int tok;     /* Current token */
-baseType bt; /* Type of current param (or return type) */
-int argNum;  /* Arg number (in case no name: arg1, arg2...) */
-
-void initType(void) {
+void HeaderParser::initType(void) {
   indirect = 0;
   isLong = isShort = isUnsigned = false;
   bt = BT_INT;
 }
 
-void errorParse(char *msg) {
-  printf("%s: got ", msg);
+void HeaderParser::errorParse(const char *msg) {
+  say("%s: got ", msg);
   if (tok == TOK_NAME)
-    printf("<%s>", token);
+    say("<%s>", token.c_str());
   else if (tok == TOK_DOTS)
-    printf("...");
+    say("...");
   else
-    printf("%c (%X)", tok, tok);
-  printf("\n%s\n", buffP);
-  printf("%*c\n", lastTokPos + 1, '^');
+    say("%c (%X)", tok, tok);
+  say("\n%s\n", buffP);
+  say("%*c\n", lastTokPos + 1, '^');
 }
 
 /* Get a token from pointer p */
-int getToken(void) {
+int HeaderParser::getToken(void) {
   char ch;
 
-  memset(token, 0, sizeof(token));
+  token.clear();
   while (*p && ((*p == ' ') || (*p == '\n')))
     p++;
   lastTokPos = p - buffP; /* For error messages */
@@ -734,7 +349,7 @@ int getToken(void) {
     return ch;
   }
 
-  while (ch = *p++) {
+  while ((ch = *p++)) {
     switch (ch) {
     case '*':
     case '[':
@@ -745,7 +360,7 @@ int getToken(void) {
     case ';':
     case ' ':
     case '\n':
-      if (strlen(token)) {
+      if (!token.empty()) {
         if ((ch != ' ') && (ch != '\n'))
           lastChar = ch;
         return TOK_NAME;
@@ -759,42 +374,44 @@ int getToken(void) {
         p += 2;
         return TOK_DOTS;
       }
+      /* fall through */
 
     default:
-      token[strlen(token)] = ch;
+      token += ch;
     }
   }
+  p--; /* Stay on the nul */
   return TOK_EOL;
 }
 
-boolT isBaseType(void) {
+boolT HeaderParser::isBaseType(void) {
   if (tok != TOK_NAME)
     return false;
 
-  if (strcmp(token, "int") == 0) {
+  if (token == "int") {
     bt = BT_INT;
-  } else if (strcmp(token, "char") == 0) {
+  } else if (token == "char") {
     bt = BT_CHAR;
-  } else if (strcmp(token, "void") == 0) {
+  } else if (token == "void") {
     bt = BT_VOID;
-  } else if (strcmp(token, "float") == 0) {
+  } else if (token == "float") {
     bt = BT_FLOAT;
-  } else if (strcmp(token, "double") == 0) {
+  } else if (token == "double") {
     bt = BT_DOUBLE;
-  } else if (strcmp(token, "struct") == 0) {
+  } else if (token == "struct") {
     bt = BT_STRUCT;
     tok = getToken(); /* The name of the struct */
                       /* Do something with the struct name */
-  } else if (strcmp(token, "union") == 0) {
+  } else if (token == "union") {
     bt = BT_STRUCT;   /* Well its still a struct */
     tok = getToken(); /* The name of the union */
                       /* Do something with the union name */
-  } else if (strcmp(token, "FILE") == 0) {
+  } else if (token == "FILE") {
     bt = BT_STRUCT;
-  } else if (strcmp(token, "size_t") == 0) {
+  } else if (token == "size_t") {
     bt = BT_INT;
     isUnsigned = true;
-  } else if (strcmp(token, "va_list") == 0) {
+  } else if (token == "va_list") {
     bt = BT_VOID;
     indirect = 1; /* va_list is a void* */
   } else
@@ -802,45 +419,51 @@ boolT isBaseType(void) {
   return true;
 }
 
-boolT isModifier(void) {
+boolT HeaderParser::isModifier(void) {
   if (tok != TOK_NAME)
     return false;
-  if (strcmp(token, "long") == 0) {
+  if (token == "long") {
     isLong = true;
-  } else if (strcmp(token, "unsigned") == 0) {
+  } else if (token == "unsigned") {
     isUnsigned = true;
-  } else if (strcmp(token, "short") == 0) {
+  } else if (token == "short") {
     isShort = true;
-  } else if (strcmp(token, "const") == 0) {
+  } else if (token == "const") {
 
-  } else if (strcmp(token, "_far") == 0) {
+  } else if (token == "_far") {
 
   } else
     return false;
   return true;
 }
 
-boolT isAttrib(void) {
+boolT HeaderParser::isAttrib(void) {
 
   if (tok != TOK_NAME)
     return false;
-  if (strcmp(token, "far") == 0) {
+  if (token == "far") {
     /* Not implemented yet */
-  } else if (strcmp(token, "__far") == 0) {
+  } else if (token == "__far") {
     /* Not implemented yet */
-  } else if (strcmp(token, "__interrupt") == 0) {
+  } else if (token == "__interrupt") {
     /* Not implemented yet */
   } else
     return false;
   return true;
 }
 
-boolT isCdecl(void) {
-  return ((strcmp(token, "__cdecl") == 0) || (strcmp(token, "_Cdecl") == 0) ||
-          (strcmp(token, "cdecl") == 0));
+boolT HeaderParser::isCdecl(void) {
+  if ((token == "__cdecl") || (token == "_Cdecl") || (token == "cdecl")) {
+    callConv = PrototypeDB::CC_CDECL;
+  } else if ((token == "__pascal") || (token == "_pascal") ||
+             (token == "pascal")) {
+    callConv = PrototypeDB::CC_PASCAL;
+  } else
+    return false;
+  return true;
 }
 
-void getTypeAndIdent(void) {
+void HeaderParser::getTypeAndIdent(void) {
   /* Get a type and ident pair. Complicated by the fact that types are
       actually optional modifiers followed by types, and the identifier
       is also optional. For example:
@@ -887,14 +510,14 @@ void getTypeAndIdent(void) {
 
   if (tok == TOK_NAME) {
     /* This could be an ident or an unknown type */
-    strcpy(ident, token);
+    ident = token;
     tok = getToken();
   }
 
   if (!ib && (tok != ',') && (tok != '(') && (tok != ')')) {
     /* That was (probably) not an ident! Assume it was an unknown type */
-    printf("Unknown type %s\n", ident);
-    ident[0] = '\0';
+    say("Unknown type %s\n", ident.c_str());
+    ident.clear();
     bt = BT_UNKWN;
 
     while (tok == '*') {
@@ -909,7 +532,7 @@ void getTypeAndIdent(void) {
 
   if (tok == TOK_NAME) {
     /* This has to be the ident */
-    strcpy(ident, token);
+    ident = token;
     tok = getToken();
   }
 
@@ -917,12 +540,12 @@ void getTypeAndIdent(void) {
     indirect++; /* Treat x[] like *x */
     do {
       tok = getToken(); /* Ignore stuff between the '[' and ']' */
-    } while (tok != ']');
+    } while (tok != ']' && tok != TOK_EOL);
     tok = getToken();
   }
 }
 
-hlType convType(void) {
+hlType HeaderParser::convType(void) {
   /* Convert from base type and signed/unsigned flags, etc, to a htType
       as Cristina currently uses */
 
@@ -967,94 +590,37 @@ hlType convType(void) {
   }
 }
 
-/* Add a new function to the array of function name and return types. The
-    array is logically sorted by a linked list. Note that numArg is filled
-    in later */
-boolT addNewFunc(char *name, hlType typ) {
-  int i, prev, res;
-
-  /* First see if the name already exists */
-  prev = NIL;
-  for (i = headFunc; i != NIL; i = pFunc[i].next) {
-    res = strcmp(pFunc[i].name, name);
-    if (res > 0) {
-      break; /* Exit this loop when just past insert point */
-    }
-    if (res == 0) {
-      /* Already have this function name */
-      return true;
-    }
-    prev = i;
-  }
-
-  if (numFunc >= allocFunc) {
-    allocFunc += DELTA_FUNC;
-    pFunc = (PH_FUNC_STRUCT *)realloc(pFunc, allocFunc * sizeof(PH_FUNC_STRUCT));
-    if (pFunc == NULL) {
-      fprintf(stderr, "Could not allocate %ud bytes for function array\n",
-              allocFunc * sizeof(PH_FUNC_STRUCT));
-      exit(1);
-    }
-    memset(&pFunc[allocFunc - DELTA_FUNC], 0,
-           DELTA_FUNC * sizeof(PH_FUNC_STRUCT));
-  }
-
-  name[SYMLEN - 1] = '\0';
-  strcpy(pFunc[numFunc].name, name);
-  pFunc[numFunc].typ = typ;
-  pFunc[numFunc].firstArg = numArg;
-  if (prev == NIL) {
-    pFunc[numFunc].next = headFunc;
-    headFunc = numFunc;
-  } else {
-    pFunc[numFunc].next = pFunc[prev].next;
-    pFunc[prev].next = numFunc;
-  }
-  numFunc++;
-
+/* Add a new function to the functions of this file. Returns true if it
+    already has one of that name. Note that numArg is filled in later */
+boolT HeaderParser::addNewFunc(const std::string &name, hlType typ) {
+  if (!m_names.insert(name).second)
+    return true; /* Already have this function name */
+  PH_FUNC f;
+  f.name = name;
+  f.typ = typ;
+  f.numArg = 0;
+  f.bVararg = false;
+  f.conv = callConv;
+  funcs.push_back(f);
   return false;
 }
 
-/* Add a new arguement to the array of arguement name and types. The
-    array is logically sorted by a linked list */
-void addNewArg(char *name, hlType typ) {
-  if (numArg >= allocArg) {
-    allocArg += DELTA_FUNC;
-    pArg = (PH_ARG_STRUCT *)realloc(pArg, allocArg * sizeof(PH_ARG_STRUCT));
-    if (pArg == NULL) {
-      fprintf(stderr, "Could not allocate %ud bytes for arguement array\n",
-              allocArg * sizeof(PH_ARG_STRUCT));
-      exit(1);
-    }
-    memset(&pArg[allocArg - DELTA_FUNC], 0, DELTA_FUNC * sizeof(PH_ARG_STRUCT));
-  }
-  name[SYMLEN - 1] = '\0';
-  strcpy(pArg[numArg].name, name);
-  pArg[numArg].typ = typ;
-  numArg++;
-}
-
-void parseParam(void) {
+void HeaderParser::parseParam(void) {
   initType();
   if (tok == TOK_DOTS) {
     tok = getToken();
-    pFunc[numFunc - 1].bVararg = true;
+    funcs.back().bVararg = true;
     return;
   }
 
   getTypeAndIdent();
 
   if ((bt == BT_VOID) && (indirect == 0)) {
-    /* Just a void arg list. Ignore and pFunc[].numArgs will be set to zero */
+    /* Just a void arg list. Ignore and numArg will be set to zero */
     return;
   }
   argNum++;
-  if (ident[0]) {
-    addNewArg(ident, convType());
-  } else {
-    sprintf(ident, "arg%d", argNum);
-    addNewArg(ident, convType());
-  }
+  funcs.back().args.push_back(convType());
 }
 
 /* Parse the prototype as follows:
@@ -1066,19 +632,22 @@ and where paramdef is
 Note that the closing semicolon is not seen.
 */
 
-void phBuffToFunc(char *buff) {
+void HeaderParser::phBuffToFunc(const char *buff) {
 
   initType();
+  callConv = PrototypeDB::CC_UNKNOWN;
+  ident.clear();
+  lastChar = '\0';
   p = buffP = buff;
   tok = getToken();
 
   /* Ignore typedefs, for now */
-  if ((tok == TOK_NAME) && (strcmp(token, "typedef") == 0))
+  if ((tok == TOK_NAME) && (token == "typedef"))
     return;
 
   getTypeAndIdent();
 
-  if (ident[0] == '\0') {
+  if (ident.empty()) {
     errorParse("Expected function name");
     return;
   }
@@ -1103,69 +672,161 @@ void phBuffToFunc(char *buff) {
     }
     tok = getToken();
   }
-  pFunc[numFunc - 1].numArg = argNum; /* Number of args this func */
+  funcs.back().numArg = argNum; /* Number of args this func */
 }
 
-void phBuffToDef(char *buff) {}
+namespace {
+/* The prototypes of all the files, the first of each name */
+std::vector<PH_FUNC> pFunc;
+std::vector<hlType> pArg;   /* The args of pFunc, one after the other */
+std::vector<int> firstArg;  /* Index in pArg of the args of pFunc[i] */
+std::unordered_set<std::string> funcNames;
+
+/* Add the functions of a file that no file before it declared */
+void merge(HeaderParser &parser) {
+  for (PH_FUNC &f : parser.funcs) {
+    if (!funcNames.insert(f.name).second)
+      continue;
+    firstArg.push_back(pArg.size());
+    pArg.insert(pArg.end(), f.args.begin(), f.args.end());
+    pFunc.push_back(std::move(f));
+  }
+}
 
-void writeFile(char *buffer, int len) {
+void writeFile(FILE *datFile, const char *buffer, int len) {
   if ((int)fwrite(buffer, 1, len, datFile) != len) {
     printf("Could not write to file\n");
     exit(1);
   }
 }
 
-void writeFileShort(word w) {
+void writeFileShort(FILE *datFile, word w) {
   byte b;
 
   b = (byte)(w & 0xFF);
-  writeFile((char *)&b, 1); /* Write a short little endian */
+  writeFile(datFile, (char *)&b, 1); /* Write a short little endian */
   b = (byte)(w >> 8);
-  writeFile((char *)&b, 1);
+  writeFile(datFile, (char *)&b, 1);
+}
+
+/* dcclibs.dat: the functions sorted by name, their names cut to SYMLEN */
+void saveFile(FILE *datFile) {
+  std::vector<int> order(pFunc.size());
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(),
+            [](int a, int b) { return pFunc[a].name < pFunc[b].name; });
+
+  fprintf(datFile, "dccp");          /* Signature */
+  fprintf(datFile, "FN");            /* Function name tag */
+  writeFileShort(datFile, pFunc.size()); /* Number of func name records */
+  for (int i : order) {
+    char name[SYMLEN] = {0};
+    strncpy(name, pFunc[i].name.c_str(), SYMLEN - 1);
+    writeFile(datFile, name, SYMLEN);
+    writeFileShort(datFile, (word)pFunc[i].typ);
+    writeFileShort(datFile, (word)pFunc[i].numArg);
+    writeFileShort(datFile, (word)firstArg[i]);
+    char vararg = pFunc[i].bVararg;
+    writeFile(datFile, &vararg, 1);
+  }
+
+  fprintf(datFile, "PM");            /* Parameter Name tag */
+  writeFileShort(datFile, pArg.size()); /* Number of args */
+  for (hlType t : pArg)
+    writeFileShort(datFile, (word)t);
+}
+
+/* The prototypes as a PrototypeDB, which dcc prefers to dcclibs.dat */
+void saveDatabase(PrototypeDB::Builder &builder) {
+  std::string error;
+  if (!builder.save("dcclibs.pdb", error)) {
+    printf("Could not write dcclibs.pdb: %s\n", error.c_str());
+    exit(2);
+  }
+  printf("%d prototypes written to dcclibs.pdb\n", builder.count());
 }
 
-void saveFile(void) {
-  int i;
-
-  fprintf(datFile, "dccp"); /* Signature */
-  fprintf(datFile, "FN");   /* Function name tag */
-  writeFileShort(numFunc);  /* Number of func name records */
-  for (i = headFunc; i != NIL; i = pFunc[i].next) {
-    writeFile(pFunc[i].name, SYMLEN);
-    writeFileShort((word)pFunc[i].typ);
-    writeFileShort((word)pFunc[i].numArg);
-    writeFileShort((word)pFunc[i].firstArg);
-    writeFile((char *)&pFunc[i].bVararg, 1);
+void addToDatabase(PrototypeDB::Builder &builder) {
+  for (size_t i = 0; i < pFunc.size(); i++) {
+    std::vector<uint16_t> args;
+    for (int j = 0; j < pFunc[i].numArg; j++)
+      args.push_back((uint16_t)pArg[firstArg[i] + j]);
+    builder.add(pFunc[i].name, (uint16_t)pFunc[i].typ, args, pFunc[i].bVararg,
+                (PrototypeDB::CallConv)pFunc[i].conv);
   }
+}
 
-  fprintf(datFile, "PM"); /* Parameter Name tag */
-  writeFileShort(numArg); /* Number of args */
-  for (i = 0; i < numArg; i++) {
-    //      writeFile(pArg[i].name, SYMLEN);    // Don't want names yet
-    writeFileShort((word)pArg[i].typ);
+/* Parse a header file, FBUF_SIZE bytes at a time. Returns false if it
+    cannot be opened */
+bool parseFile(HeaderParser &parser, const std::string &fileName,
+               std::vector<char> &buf, uint64_t &bytes) {
+  FILE *f = fopen(fileName.c_str(), "rb");
+  if (f == NULL)
+    return false;
+  size_t ndata;
+  while ((ndata = fread(buf.data(), 1, buf.size(), f)) != 0) {
+    parser.data(buf.data(), ndata);
+    bytes += ndata;
   }
+  parser.post();
+  fclose(f);
+  return true;
 }
+} // namespace
 
 int main(int argc, char *argv[]) {
-  char *buf;
-  long fSize;
-  int ndata;
-  FILE *f, *fl;
+  FILE *datFile, *fl;
   int i;
-  char *p;
-
-  if (argc != 2) {
-    printf("Usage: parsehdr <listfile>\n"
+  const char *convert = NULL;
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  PrototypeDB::Builder builder;
+
+  for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+    if (strcmp(argv[i], "-m") == 0 && strchr("smclh", argv[i + 1][0]))
+      builder.setMemoryModel(argv[i + 1][0]);
+    else if (strcmp(argv[i], "-c") == 0)
+      convert = argv[i + 1];
+    else if (strcmp(argv[i], "-j") == 0 && atoi(argv[i + 1]) > 0)
+      threads = atoi(argv[i + 1]);
+    else
+      break;
+  }
+  if ((convert == NULL) ? (i != argc - 1) : (i != argc)) {
+    printf("Usage: parsehdr [-j <threads>] [-m <model>] <listfile>\n"
+           "       parsehdr [-m <model>] -c <dcclibs.dat>\n"
            "where <listfile> is a file of header file names to parse.\n"
-           "The file dcclibs.dat will be written\n");
+           "The files dcclibs.dat and dcclibs.pdb will be written; with -c,\n"
+           "an existing dcclibs.dat is compiled to dcclibs.pdb. <model> is\n"
+           "the memory model the headers are for: s, m, c, l or h\n");
     exit(1);
   }
+  if (convert) {
+    std::string error;
+    if (!PrototypeDB::readLegacy(convert, builder, error)) {
+      printf("Could not read %s: %s\n", convert, error.c_str());
+      exit(1);
+    }
+    saveDatabase(builder);
+    return 0;
+  }
 
-  fl = fopen(argv[1], "rt");
+  fl = fopen(argv[i], "rt");
   if (fl == NULL) {
-    printf("Could not open file list file %s\n", argv[1]);
+    printf("Could not open file list file %s\n", argv[i]);
     exit(1);
   }
+  /* One file per line; trailing blanks are not part of the name */
+  std::vector<std::string> files;
+  char line[1024];
+  while (fgets(line, sizeof(line), fl)) {
+    std::string name(line);
+    while (!name.empty() && strchr(" \t\r\n", name.back()))
+      name.pop_back();
+    if (!name.empty())
+      files.push_back(name);
+  }
+  fclose(fl);
 
   datFile = fopen("dcclibs.dat", "wb");
   if (datFile == NULL) {
@@ -1173,101 +834,51 @@ int main(int argc, char *argv[]) {
     exit(2);
   }
 
-  /* Allocate the arrys for function and proto names and types */
-  pFunc = (PH_FUNC_STRUCT *)malloc(DELTA_FUNC * sizeof(PH_FUNC_STRUCT));
-  if (pFunc == 0) {
-    fprintf(stderr, "Could not malloc %ud bytes for function name array\n",
-            DELTA_FUNC * sizeof(PH_FUNC_STRUCT));
-    exit(1);
-  }
-  memset(pFunc, 0, DELTA_FUNC * sizeof(PH_FUNC_STRUCT));
-  allocFunc = DELTA_FUNC;
-  numFunc = 0;
-
-  pArg = (PH_ARG_STRUCT *)malloc(DELTA_FUNC * sizeof(PH_ARG_STRUCT));
-  if (pArg == 0) {
-    fprintf(stderr, "Could not malloc %ud bytes for arguement array\n",
-            DELTA_FUNC * sizeof(PH_ARG_STRUCT));
-    exit(1);
-  }
-  memset(pArg, 0, DELTA_FUNC * sizeof(PH_ARG_STRUCT));
-  allocArg = DELTA_FUNC;
-  numArg = 0;
-
-  headFunc = headArg = NIL;
-
-  buf = NULL;
-  while (!feof(fl)) {
-    /* Get another filename from the file list */
-    p = fgets(fileName, 80, fl);
-    if (p == NULL)
-      break; /* Otherwise read last filename twice */
-    i = strlen(fileName) - 1;
-    if (fileName[i] == '\n')
-      fileName[i] = '\0';
-    f = fopen(fileName, "rt");
-    if (f == NULL) {
-      printf("Could not open header file %s\n", fileName);
-      exit(1);
-    }
-
-    printf("Processing %s...\n", fileName);
-
-    fseek(f, 0, SEEK_END);
-    fSize = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    ndata = std::min<int>(fSize, FBUF_SIZE);
-    if (buf)
-      free(buf);
-    buf = (char *)malloc(ndata);
-    if (buf == 0) {
-      printf("Could not malloc input file buffer of %d bytes\n", ndata);
+  /* The files are parsed in parallel, each by its own parser, and merged in
+      the order of the list, so that the first declaration of a name wins as
+      if they had been parsed one after the other */
+  std::vector<std::unique_ptr<HeaderParser>> parsers(files.size());
+  std::vector<char> opened(files.size(), 0);
+  std::atomic<size_t> next(0);
+  std::atomic<uint64_t> totalBytes(0);
+  threads = std::max(1, std::min<int>(threads, files.size()));
+  auto start = std::chrono::steady_clock::now();
+  auto worker = [&]() {
+    std::vector<char> buf(FBUF_SIZE);
+    uint64_t bytes = 0;
+    for (size_t n; (n = next++) < files.size();) {
+      parsers[n].reset(new HeaderParser(files[n]));
+      opened[n] = parseFile(*parsers[n], files[n], buf, bytes);
+    }
+    totalBytes += bytes;
+  };
+  std::vector<std::thread> workers;
+  for (i = 1; i < threads; i++)
+    workers.emplace_back(worker);
+  worker();
+  for (std::thread &t : workers)
+    t.join();
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  for (size_t n = 0; n < files.size(); n++) {
+    printf("Processing %s...\n", files[n].c_str());
+    if (!opened[n]) {
+      printf("Could not open header file %s\n", files[n].c_str());
       exit(1);
     }
-
-    while (!feof(f)) {
-      ndata = fread(buf, 1, ndata, f);
-      phData(buf, ndata);
-    }
-    phPost();
-    fclose(f);
+    fputs(parsers[n]->log.c_str(), stdout);
+    merge(*parsers[n]);
+    parsers[n].reset();
   }
-  saveFile();
-  fclose(datFile);
-  fclose(fl);
+  printf("%d files, %.2f MB parsed in %.3f s by %d threads: %.1f MB/s, "
+         "%d prototypes\n",
+         (int)files.size(), totalBytes / 1e6, seconds, threads,
+         seconds > 0 ? totalBytes / 1e6 / seconds : 0.0, (int)pFunc.size());
 
-  free(buf);
-  free(pFunc);
-  free(pArg);
-}
-
-#if CHECK_HEAP
-void checkHeap(char *msg)
-
-/* HEAPCHK.C: This program checks the heap for
- * consistency and prints an appropriate message.
- */
-{
-  int heapstatus;
-
-  printf("%s\n", msg);
-
-  /* Check heap status */
-  heapstatus = _heapchk();
-  switch (heapstatus) {
-  case _HEAPOK:
-    printf(" OK - heap is fine\n");
-    break;
-  case _HEAPEMPTY:
-    printf(" OK - heap is empty\n");
-    break;
-  case _HEAPBADBEGIN:
-    printf("ERROR - bad start of heap\n");
-    break;
-  case _HEAPBADNODE:
-    printf("ERROR - bad node in heap\n");
-    break;
-  }
+  saveFile(datFile);
+  fclose(datFile);
+  addToDatabase(builder);
+  saveDatabase(builder);
 }
-
-#endif
@@ -1,5 +1,11 @@
 #pragma once
 #include "Enums.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
 /*
  *$Log:	parsehdr.h,v $
  */
@@ -10,56 +16,15 @@ typedef unsigned char byte;	    /* 8 bits 	*/
 typedef unsigned short word;    /* 16 bits	*/
 typedef unsigned char boolT;    /* 8 bits 	*/
 
-#define BUFF_SIZE 8192          /* Holds a declaration */
-#define FBUF_SIZE 32700        /* Holds part of a header file */
-
-#define	NARGS		15
-#define	NAMES_L		160
-#define	TYPES_L		160
-#define	FUNC_L		160
-
-#define	ERRF	stdout
+#define FBUF_SIZE 65536         /* Holds part of a header file */
 
-void	phError(char *errmsg);
-void	phWarning(char *errmsg);
-
-#define	ERR(msg)		phError(msg)
 #ifdef DEBUG
-#define	DBG(str) printf(str);
+#define	DBG(str) say("%s", str);
 #else
 #define DBG(str) ;
 #endif
-#define	WARN(msg)		phWarning(msg)
-#define OUT(str)		fprintf(outfile, str)
-
-#define	PH_PARAMS	32
-#define PH_NAMESZ	15
 
 #define  SYMLEN     16                  /* Including the null */
-#define  Int        long                /* For locident.h */
-//#include "locident.h"                   /* For the hlType enum */
-//#define  bool       unsigned char       /* For internal use */
-
-typedef
-struct ph_func_tag
-{
-    char    name[SYMLEN];               /* Name of function or arg */
-    hlType  typ;                        /* Return type */
-    int     numArg;                     /* Number of args */
-    int     firstArg;                   /* Index of first arg in chain */
-    int     next;                       /* Index of next function in chain */
-    bool    bVararg;                    /* True if variable num args */
-} PH_FUNC_STRUCT;
-
-typedef
-struct ph_arg_tag
-{
-    char    name[SYMLEN];               /* Name of function or arg */
-    hlType  typ;                        /* Parameter type */
-} PH_ARG_STRUCT;
-
-#define DELTA_FUNC 32                   /* Number to alloc at once */
-
 
 #define	PH_JUNK			0		/* LPSTR		buffer, nothing happened */
 #define	PH_PROTO		1		/* LPPH_FUNC 	ret val, func name, args */
@@ -71,18 +36,6 @@ struct ph_arg_tag
 #define	PH_MPROTO		7		/* ????? multi proto????                 */
 #define	PH_VAR			8		/* ????? var decl                        */
 
-/* PROTOS */
-
-boolT	phData(char *buff, int ndata);
-boolT	phPost(void);
-boolT	phFree(void);
-void    checkHeap(char *msg);   /* For debugging only */
-
-void	phBuffToFunc(char *buff);
-
-void	phBuffToDef(char *buff);
-
-
 #define TOK_TYPE    256         /* A type name (e.g. "int") */
 #define TOK_NAME    257         /* A function or parameter name */
 #define TOK_DOTS    258         /* "..." */
@@ -92,3 +45,79 @@ typedef enum
 {
     BT_INT, BT_CHAR, BT_FLOAT, BT_DOUBLE, BT_STRUCT, BT_VOID, BT_UNKWN
 } baseType;
+
+/* A function declaration */
+struct PH_FUNC
+{
+    std::string name;                   /* Whole name of the function */
+    hlType  typ;                        /* Return type */
+    int     numArg;                     /* Number of args, once they are all parsed */
+    bool    bVararg;                    /* True if variable num args */
+    int     conv;                       /* PrototypeDB::CallConv */
+    std::vector<hlType> args;           /* Types of the args parsed, even if the list had errors */
+};
+
+/* Parses one header file, fed to it a buffer at a time.  All the state is in the object, so that
+    files can be parsed in parallel, one parser each */
+class HeaderParser
+{
+public:
+    explicit HeaderParser(const std::string &fileName) : m_fileName(fileName) {}
+
+    void    data(const char *buff, size_t ndata);   /* Churn the state machine through the data */
+    boolT   post(void);                             /* Called at the end of the file */
+
+    std::vector<PH_FUNC>    funcs;      /* Functions declared, in order, the first of each name */
+    std::string             log;        /* The messages, to print once the file is merged */
+private:
+    void    say(const char *fmt, ...);
+    void    phError(const char *errmsg);
+    void    phWarning(const char *errmsg);
+    int     IsIgnore() const;
+    void    ProcessBuffer(int id);
+
+    /* The declaration parser */
+    void    initType(void);
+    void    errorParse(const char *msg);
+    int     getToken(void);
+    boolT   isBaseType(void);
+    boolT   isModifier(void);
+    boolT   isAttrib(void);
+    boolT   isCdecl(void);
+    void    getTypeAndIdent(void);
+    hlType  convType(void);
+    boolT   addNewFunc(const std::string &name, hlType typ);
+    void    parseParam(void);
+    void    phBuffToFunc(const char *buff);
+
+    std::string m_fileName;
+    std::unordered_set<std::string> m_names;
+
+    /* the IGNORE byte */
+    byte    slosh = 0, last_slosh = 0, quote1 = 0, quote2 = 0, comment = 0, hash = 0;
+    byte    ignore1 = 0;        /* Special: ignore exactly 1 char */
+    byte    double_slash = 0;
+    byte    start = 0;          /* Started recording to the buffer */
+    byte    func = 0;           /* Function header detected */
+    byte    hash_ext = 0;
+    int     curly = 0;          /* Level inside curly brackets */
+    int     xtern = 0;          /* Level inside a extern "C" {} situation */
+    int     round1 = 0;         /* Level inside () */
+    int     line = 1, col = 0;
+    dword   chars = 0;
+    char    lastch = 0;
+    std::string buffer;         /* Holds a declaration */
+
+    std::string token;          /* Strings that might be types, modifiers or idents */
+    std::string ident;          /* Names of functions or protos go here */
+    char    lastChar = 0;
+    const char *p = nullptr;
+    int     indirect = 0;
+    boolT   isLong = 0, isShort = 0, isUnsigned = 0;
+    int     lastTokPos = 0;     /* For "^" in error messages */
+    const char *buffP = nullptr;
+    int     tok = 0;            /* Current token */
+    baseType bt = BT_INT;       /* Type of current param (or return type) */
+    int     argNum = 0;         /* Arg number (in case no name: arg1, arg2...) */
+    int     callConv = 0;       /* Of the current declaration */
+};
@@ -0,0 +1,99 @@
+/* Times the signature hashing and comparison kernels over the patterns of signature files, and checks
+    that every version gives the results of the portable one */
+
+#include "SignatureFile.h"
+#include "SigKernels.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std::chrono;
+
+static const int ROUNDS = 20;
+static const uint8_t WILD = 0xF4;
+
+struct Keys
+{
+    const SignatureFile *file;
+    const uint8_t *pattern;
+};
+
+/* Nanoseconds per key taken by f over all the keys, ROUNDS times; f returns a value to keep */
+template<class F>
+static double timeKeys(const std::vector<Keys> &keys, uint32_t &check, F f)
+{
+    auto start = steady_clock::now();
+    uint32_t sum = 0;
+    for (int r=0; r < ROUNDS; r++)
+        for (size_t i=0; i < keys.size(); i++)
+            sum += f(keys[i], i);
+    double ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    check = sum;
+    return ns / (double(ROUNDS) * keys.size());
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc <= 1)
+    {
+        printf("Usage: sigbench <SigFilename> ...\n");
+        printf("Times the signature kernels over the patterns of the files\n");
+        printf("e.g. %s sigs/*.sig\n", argv[0]);
+        exit(1);
+    }
+    std::vector<SignatureFile> files(argc-1);
+    std::vector<Keys> keys;
+    for (int i=1; i < argc; i++)
+    {
+        std::string error;
+        if (not files[i-1].load(argv[i], error))
+        {
+            printf("Cannot open signature file %s: %s\n", argv[i], error.c_str());
+            exit(2);
+        }
+    }
+    for (const SignatureFile &f : files)
+        for (const SignatureFile::Entry &e : f.entries)
+            keys.push_back({&f, e.pattern});
+    /* Each key is compared with the next one, mostly a mismatch late in the pattern */
+    std::vector<uint8_t> others(keys.size() * SigKernels::PAT_LEN);
+    for (size_t i=0; i < keys.size(); i++)
+    {
+        memcpy(&others[i * SigKernels::PAT_LEN], keys[i].pattern, SigKernels::PAT_LEN);
+        if (i & 1)
+            others[i * SigKernels::PAT_LEN + SigKernels::PAT_LEN-1] ^= 1;
+    }
+    printf("%d files, %d keys, %d rounds\n", argc-1, (int)keys.size(), ROUNDS);
+    printf("%-10s %12s %12s %12s\n", "kernels", "hash ns", "equal ns", "wild ns");
+
+    uint32_t expected[3] = {0, 0, 0};
+    int failed = 0;
+    for (const SigKernels *k : SigKernels::available())
+    {
+        uint32_t check[3];
+        double hashNs = timeKeys(keys, check[0], [k](const Keys &key, size_t) {
+            uint16_t u, v;
+            k->sums(key.file->lanes.data(), key.pattern, u, v);
+            u %= key.file->numVert;
+            v %= key.file->numVert;
+            return uint32_t((key.file->g[u] + key.file->g[v]) % key.file->numKeys);
+        });
+        double equalNs = timeKeys(keys, check[1], [k, &others](const Keys &key, size_t i) {
+            return uint32_t(k->equal(key.pattern, &others[i * SigKernels::PAT_LEN]) ? i : 0);
+        });
+        double wildNs = timeKeys(keys, check[2], [k, &others](const Keys &key, size_t i) {
+            return uint32_t(k->wildMatch(key.pattern, &others[i * SigKernels::PAT_LEN], SigKernels::PAT_LEN, WILD) ? i : 0);
+        });
+        if (k == SigKernels::available().front())
+            memcpy(expected, check, sizeof(expected));
+        bool same = memcmp(expected, check, sizeof(check)) == 0;
+        if (not same)
+            failed++;
+        printf("%-10s %12.2f %12.2f %12.2f%s\n", k->name, hashNs, equalNs, wildNs,
+               same ? "" : "  results differ from portable!");
+    }
+    printf("Selected: %s\n", SigKernels::best().name);
+    return failed ? 3 : 0;
+}
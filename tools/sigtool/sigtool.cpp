@@ -0,0 +1,276 @@
+/* Queries, statistics and checks of signature files, loaded once the way dcc loads them: one file, several,
+    or the dcc*.sig of a directory as one combined index */
+
+#include "SignatureIndex.h"
+#include "SignatureFile.h"
+#include "fixwild.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
+
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+
+using namespace std::chrono;
+
+static void printUsage(bool longusage)
+{
+    printf("Usage: sigtool [--stats] [--verify] [--fixed] [-q <queryfile>] <sigfile|sigdir>...\n");
+    if (not longusage)
+    {
+        printf("or sigtool -h for help\n");
+        return;
+    }
+    printf("Loads the signature files, and every dcc*.sig of the directories, as dcc does, then:\n"
+           "  -q <file>   answers the queries of file, one per line, or of the standard input if it is -.\n"
+           "              A query is a pattern, 23 bytes in hex, or a function name\n"
+           "  --fixed     the patterns of the queries have their wildcards fixed already; otherwise they\n"
+           "              are code bytes, and are wildcarded as dcc does before looking them up\n"
+           "  --stats     statistics of each set and of the combined index (the default)\n"
+           "  --verify    checks the hash tables of each set and of the combined index\n"
+           "e.g. sigtool --verify sigs\n"
+           "     echo strcmp | sigtool -q - sigs/dccb2s.sig\n");
+}
+
+static void printPattern(const uint8_t *pat)
+{
+    for (int i=0; i < PATLEN; i++)
+        printf("%02X%s", pat[i], i+1 < PATLEN ? " " : "");
+}
+
+/* A pattern written as 23 hex bytes, spaces between them or not */
+static bool parsePattern(const char *s, uint8_t *pat)
+{
+    int n = 0;
+    while (*s)
+    {
+        if (isspace((unsigned char)*s))
+        {
+            s++;
+            continue;
+        }
+        if (not isxdigit((unsigned char)s[0]) or not isxdigit((unsigned char)s[1]) or n == PATLEN)
+            return false;
+        char hex[3] = {s[0], s[1], 0};
+        pat[n++] = (uint8_t)strtoul(hex, nullptr, 16);
+        s += 2;
+    }
+    return n == PATLEN;
+}
+
+struct Query
+{
+    const SignatureIndex &index;
+    bool fixed;
+    /* Where each name is: the pattern and the tag, for the name queries */
+    std::unordered_multimap<std::string, std::pair<size_t, int>> names;
+    int queries = 0, found = 0;
+
+    Query(const SignatureIndex &_index, bool _fixed) : index(_index), fixed(_fixed)
+    {
+        for (size_t i=0; i < index.patternCount(); i++)
+        {
+            int count;
+            const SignatureIndex::Tag *tags = index.tags(i, count);
+            for (int t=0; t < count; t++)
+                names.emplace(QString(tags[t].name).toLower().toStdString(), std::make_pair(i, t));
+        }
+    }
+    void ask(const char *line)
+    {
+        uint8_t pat[PATLEN];
+        queries++;
+        if (parsePattern(line, pat))
+        {
+            if (not fixed)
+                fixWildCards(pat);
+            int count;
+            const SignatureIndex::Tag *tags = index.find(pat, count);
+            printPattern(pat);
+            if (count == 0)
+                printf(": not found\n");
+            else
+            {
+                found++;
+                printf(":");
+                for (int t=0; t < count; t++)
+                    printf(" %s (%s)", tags[t].name, qPrintable(index.sets()[tags[t].set].file));
+                printf("\n");
+            }
+            return;
+        }
+        /* Names are found whatever their case, as dispsig finds them */
+        auto range = names.equal_range(QString(line).toLower().toStdString());
+        if (range.first == range.second)
+        {
+            printf("%s: not found\n", line);
+            return;
+        }
+        found++;
+        std::vector<std::pair<size_t, int>> where;
+        for (auto it = range.first; it != range.second; ++it)
+            where.push_back(it->second);
+        std::sort(where.begin(), where.end(), [this](std::pair<size_t, int> a, std::pair<size_t, int> b) {
+            int n;
+            return index.tags(a.first, n)[a.second].set < index.tags(b.first, n)[b.second].set;
+        });
+        for (const std::pair<size_t, int> &w : where)
+        {
+            int n;
+            const SignatureIndex::Tag &tag(index.tags(w.first, n)[w.second]);
+            printf("%s: ", tag.name);
+            printPattern(index.pattern(w.first));
+            printf(" (%s)\n", qPrintable(index.sets()[tag.set].file));
+        }
+    }
+};
+
+static int runQueries(const SignatureIndex &index, const QString &from, bool fixed)
+{
+    FILE *f = from == "-" ? stdin : fopen(qPrintable(from), "rt");
+    if (f == nullptr)
+    {
+        printf("Cannot open query file %s\n", qPrintable(from));
+        return 2;
+    }
+    Query query(index, fixed);
+    char line[256];
+    auto start = steady_clock::now();
+    while (fgets(line, sizeof(line), f))
+    {
+        QString q = QString(line).trimmed();
+        if (not q.isEmpty())
+            query.ask(qPrintable(q));
+    }
+    double us = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1000.0;
+    if (f != stdin)
+        fclose(f);
+    fprintf(stderr, "%d queries, %d found, %.2f us per query\n", query.queries, query.found,
+            query.queries ? us / query.queries : 0.0);
+    return 0;
+}
+
+static void printStats(const SignatureIndex &index, const std::vector<SignatureFile> &files)
+{
+    printf("%-14s %6s %6s %6s %6s %6s %6s\n", "Set", "Keys", "Vert", "Ratio", "Dupl", "Empty", "Wild%");
+    for (size_t s=0; s < files.size(); s++)
+    {
+        const SignatureFile &f(files[s]);
+        int dupl = 0, empty = 0;
+        uint64_t wild = 0;
+        static const uint8_t zeroes[PATLEN] = {0};
+        for (int i=0; i < f.numKeys; i++)
+        {
+            const uint8_t *pat = f.entries[i].pattern;
+            if (memcmp(pat, zeroes, PATLEN) == 0)
+                empty++;                /* Dropped as a duplicate, or makedsig found no code for it */
+            else if (f.numVert and f.hashIndex(pat) != i)
+                dupl++;                 /* Its pattern is an earlier entry's */
+            wild += std::count(pat, pat+PATLEN, WILD);
+        }
+        printf("%-14s %6d %6d %6.2f %6d %6d %6.2f\n", qPrintable(index.sets()[s].file), f.numKeys, f.numVert,
+               f.numKeys ? double(f.numVert) / f.numKeys : 0.0, dupl, empty,
+               f.numKeys ? wild * 100.0 / (double(f.numKeys) * PATLEN) : 0.0);
+    }
+    SignatureIndex::TableStats ts = index.tableStats();
+    printf("\nCombined index: %zu patterns, %zu names, %zu slots, load factor %.2f\n", ts.patterns, ts.names,
+           ts.table_size, ts.table_size ? double(ts.patterns) / ts.table_size : 0.0);
+    printf("Collisions: %zu patterns not in their home slot, %.3f probes per pattern, at most %d\n",
+           ts.displaced, ts.patterns ? double(ts.probes) / ts.patterns : 0.0, ts.max_probes);
+    printf("Patterns in more than one set: %zu; wildcard density %.2f%%\n", ts.shared,
+           ts.patterns ? ts.wild_bytes * 100.0 / (double(ts.patterns) * PATLEN) : 0.0);
+    printf("Loaded in %.3f ms\n", duration_cast<microseconds>(index.stats().load_time).count() / 1000.0);
+}
+
+static int verify(const SignatureIndex &index, const std::vector<SignatureFile> &files)
+{
+    int bad = 0;
+    std::string error;
+    for (size_t s=0; s < files.size(); s++)
+    {
+        if (files[s].verify(error))
+            printf("%s: ok\n", qPrintable(index.sets()[s].file));
+        else
+        {
+            printf("%s: %s\n", qPrintable(index.sets()[s].file), error.c_str());
+            bad++;
+        }
+    }
+    if (index.verify(error))
+        printf("Combined index: ok\n");
+    else
+    {
+        printf("Combined index: %s\n", error.c_str());
+        bad++;
+    }
+    return bad ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    bool stats = false, check = false, fixed = false;
+    QString queries;
+    QStringList paths;
+    const QStringList arguments = app.arguments();
+    for (int i=1; i < arguments.size(); ++i)
+    {
+        const QString &arg(arguments[i]);
+        if (arg.startsWith("-h") or arg.startsWith("-?"))
+        {
+            printUsage(true);
+            return 0;
+        }
+        if (arg == "--stats")
+            stats = true;
+        else if (arg == "--verify")
+            check = true;
+        else if (arg == "--fixed")
+            fixed = true;
+        else if (arg == "-q" and i+1 < arguments.size())
+            queries = arguments[++i];
+        else if (arg.startsWith("-") and arg != "-")
+        {
+            printUsage(false);
+            return 1;
+        }
+        else if (QFileInfo(arg).isDir())
+        {
+            QDir dir(arg);
+            for (const QString &name : dir.entryList(QStringList() << "dcc*.sig", QDir::Files, QDir::Name))
+                paths << dir.absoluteFilePath(name);
+        }
+        else
+            paths << arg;
+    }
+    if (paths.isEmpty())
+    {
+        printUsage(false);
+        return 1;
+    }
+    if (not check and queries.isEmpty())
+        stats = true;
+
+    SignatureIndex index;
+    std::vector<SignatureFile> files;
+    if (not index.load(paths, QString(), &files) or files.size() != (size_t)paths.size())
+    {
+        printf("Cannot load all of the signature files\n");
+        return 2;
+    }
+    int res = 0;
+    if (stats)
+        printStats(index, files);
+    if (check)
+        res = verify(index, files);
+    if (not queries.isEmpty())
+        res = std::max(res, runQueries(index, queries, fixed));
+    return res;
+}